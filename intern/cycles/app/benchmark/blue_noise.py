@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+#
+# Copyright 2011-2021 Blender Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Generate a blue noise benchmark scene for cycles_benchmark.
+#
+# A floor with a row of boxes is lit by a large emissive panel, giving soft shadows and indirect
+# light that are noisy at low sample counts. The scene is written with and without blue noise
+# sampling. The rel_mse_lowpass metric of cycles_benchmark shows the difference in perceived
+# noise at equal sample counts, while rel_mse should stay about the same:
+#
+#   ./blue_noise.py --output /tmp/blue_noise
+#   cycles --samples 4096 --output /tmp/blue_noise/reference.exr /tmp/blue_noise/blue_noise_white.xml
+#   cycles_benchmark --samples 16 --reference /tmp/blue_noise/reference.exr \
+#       /tmp/blue_noise/blue_noise_white.xml /tmp/blue_noise/blue_noise_blue.xml
+
+import argparse
+import os
+
+
+def quad(p0, p1, p2, p3):
+    P = " ".join("%f %f %f" % p for p in (p0, p1, p2, p3))
+    return '<mesh P="%s" nverts="4" verts="0 1 2 3" />' % P
+
+
+def box(x0, x1, y0, y1, z0, z1):
+    return [
+        quad((x0, y1, z0), (x0, y1, z1), (x1, y1, z1), (x1, y1, z0)),
+        quad((x0, y0, z0), (x0, y0, z1), (x0, y1, z1), (x0, y1, z0)),
+        quad((x1, y0, z0), (x1, y1, z0), (x1, y1, z1), (x1, y0, z1)),
+        quad((x0, y0, z0), (x0, y1, z0), (x1, y1, z0), (x1, y0, z0)),
+        quad((x0, y0, z1), (x1, y0, z1), (x1, y1, z1), (x0, y1, z1)),
+    ]
+
+
+def write_scene(filepath, use_blue_noise, num_boxes):
+    # Floor at Y = -2, the camera at the origin looks along +Z.
+    lines = []
+    lines.append('<cycles>')
+    lines.append('<camera width="960" height="540" />')
+    lines.append('<integrator use_blue_noise="%s" max_bounce="4" />' %
+                 ("true" if use_blue_noise else "false"))
+    lines.append('<background><background name="bg" strength="0.05" />'
+                 '<connect from="bg background" to="output surface" /></background>')
+
+    lines.append('<shader name="diffuse"><diffuse_bsdf name="bsdf" color="0.8 0.8 0.8" />'
+                 '<connect from="bsdf bsdf" to="output surface" /></shader>')
+    lines.append('<shader name="emission"><emission name="emit" color="1.0 0.95 0.9" strength="20" />'
+                 '<connect from="emit emission" to="output surface" /></shader>')
+
+    lines.append('<state shader="diffuse">')
+    lines.append(quad((-20.0, -2.0, 0.0), (-20.0, -2.0, 40.0), (20.0, -2.0, 40.0),
+                      (20.0, -2.0, 0.0)))
+    for i in range(num_boxes):
+        x = -6.0 + 12.0 * (i + 0.5) / num_boxes
+        lines.extend(box(x - 0.4, x + 0.4, -2.0, -0.8, 9.0, 9.8))
+    lines.append('</state>')
+
+    # Emissive panel above and to the side of the boxes.
+    lines.append('<state shader="emission">')
+    lines.append(quad((-4.0, 6.0, 6.0), (4.0, 6.0, 6.0), (4.0, 6.0, 10.0), (-4.0, 6.0, 10.0)))
+    lines.append('</state>')
+
+    lines.append('</cycles>')
+
+    with open(filepath, "w") as f:
+        f.write("\n".join(lines))
+        f.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a blue noise benchmark scene")
+    parser.add_argument("--output", default=".", help="Output directory")
+    parser.add_argument("--boxes", type=int, default=6, help="Number of boxes")
+    args = parser.parse_args()
+
+    os.makedirs(args.output, exist_ok=True)
+
+    for use_blue_noise in (False, True):
+        filename = "blue_noise_%s.xml" % ("blue" if use_blue_noise else "white")
+        filepath = os.path.join(args.output, filename)
+        write_scene(filepath, use_blue_noise, args.boxes)
+        print("Written " + filepath)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+#
+# Copyright 2011-2021 Blender Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Generate an interior benchmark scene for cycles_benchmark.
+#
+# A closed diffuse room is lit only through a small window by an emissive panel outside, so
+# nearly all light arrives indirectly. The scene is written with and without path guiding. To
+# compare noise at equal time, render a reference with many samples and then both variants with
+# the same time limit:
+#
+#   ./interior.py --output /tmp/interior
+#   cycles --samples 16384 --output /tmp/interior/reference.exr /tmp/interior/interior_plain.xml
+#   cycles_benchmark --time-limit 60 --samples 100000 --reference /tmp/interior/reference.exr \
+#       /tmp/interior/interior_plain.xml /tmp/interior/interior_guiding.xml
+
+import argparse
+import os
+
+
+def quad(p0, p1, p2, p3):
+    P = " ".join("%f %f %f" % p for p in (p0, p1, p2, p3))
+    return '<mesh P="%s" nverts="4" verts="0 1 2 3" />' % P
+
+
+def write_scene(filepath, use_guiding, window_size):
+    # Room spans [-5, 5] in X and Y and [-1, 11] in Z, the camera at the origin looks along +Z.
+    x0, x1 = -5.0, 5.0
+    y0, y1 = -5.0, 5.0
+    z0, z1 = -1.0, 11.0
+
+    # Window in the right wall.
+    wy0, wy1 = 1.0, 1.0 + window_size
+    wz0, wz1 = 6.0, 6.0 + window_size
+
+    lines = []
+    lines.append('<cycles>')
+    lines.append('<camera width="960" height="540" />')
+    lines.append('<integrator use_guiding="%s" max_bounce="8" />' %
+                 ("true" if use_guiding else "false"))
+    lines.append('<background><background name="bg" strength="0.0" />'
+                 '<connect from="bg background" to="output surface" /></background>')
+
+    lines.append('<shader name="wall"><diffuse_bsdf name="bsdf" color="0.8 0.8 0.8" />'
+                 '<connect from="bsdf bsdf" to="output surface" /></shader>')
+    lines.append('<shader name="emission"><emission name="emit" color="1.0 0.95 0.9" strength="200" />'
+                 '<connect from="emit emission" to="output surface" /></shader>')
+
+    lines.append('<state shader="wall">')
+    # Floor, ceiling, left, back and front walls.
+    lines.append(quad((x0, y0, z0), (x1, y0, z0), (x1, y0, z1), (x0, y0, z1)))
+    lines.append(quad((x0, y1, z0), (x0, y1, z1), (x1, y1, z1), (x1, y1, z0)))
+    lines.append(quad((x0, y0, z0), (x0, y0, z1), (x0, y1, z1), (x0, y1, z0)))
+    lines.append(quad((x0, y0, z1), (x1, y0, z1), (x1, y1, z1), (x0, y1, z1)))
+    lines.append(quad((x0, y0, z0), (x0, y1, z0), (x1, y1, z0), (x1, y0, z0)))
+    # Right wall around the window.
+    lines.append(quad((x1, y0, z0), (x1, y0, z1), (x1, wy0, z1), (x1, wy0, z0)))
+    lines.append(quad((x1, wy1, z0), (x1, wy1, z1), (x1, y1, z1), (x1, y1, z0)))
+    lines.append(quad((x1, wy0, z0), (x1, wy0, wz0), (x1, wy1, wz0), (x1, wy1, z0)))
+    lines.append(quad((x1, wy0, wz1), (x1, wy0, z1), (x1, wy1, z1), (x1, wy1, wz1)))
+    lines.append('</state>')
+
+    # Emissive panel outside the window.
+    lines.append('<state shader="emission">')
+    lines.append(quad((x1 + 4.0, y0, z0), (x1 + 4.0, y1, z0), (x1 + 4.0, y1, z1),
+                      (x1 + 4.0, y0, z1)))
+    lines.append('</state>')
+
+    lines.append('</cycles>')
+
+    with open(filepath, "w") as f:
+        f.write("\n".join(lines))
+        f.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate an interior benchmark scene")
+    parser.add_argument("--output", default=".", help="Output directory")
+    parser.add_argument("--window-size", type=float, default=1.0, help="Size of the window")
+    args = parser.parse_args()
+
+    os.makedirs(args.output, exist_ok=True)
+
+    for use_guiding in (False, True):
+        filename = "interior_%s.xml" % ("guiding" if use_guiding else "plain")
+        filepath = os.path.join(args.output, filename)
+        write_scene(filepath, use_guiding, args.window_size)
+        print("Written " + filepath)
+
+
+if __name__ == "__main__":
+    main()
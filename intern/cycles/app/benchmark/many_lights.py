@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# Copyright 2011-2021 Blender Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Generate many light benchmark scenes for cycles_standalone.
+#
+# Half of the lights are point and spot lights, the other half emissive quads, scattered above
+# a diffuse floor. Each scene is written with and without the light tree, to compare noise at
+# equal render time:
+#
+#   ./many_lights.py --output /tmp/many_lights 1000 10000 100000
+#   cycles --samples 64 /tmp/many_lights/many_lights_10000_tree.xml
+
+import argparse
+import os
+import random
+
+
+def write_scene(filepath, num_lights, use_light_tree, seed):
+    rng = random.Random(seed)
+    size = 50.0
+
+    lines = []
+    lines.append('<cycles>')
+    lines.append('<camera width="960" height="540" />')
+    lines.append('<integrator use_light_tree="%s" max_bounce="2" />' %
+                 ("true" if use_light_tree else "false"))
+    lines.append('<background><background name="bg" strength="0.0" />'
+                 '<connect from="bg background" to="output surface" /></background>')
+
+    lines.append('<shader name="floor"><diffuse_bsdf name="bsdf" color="0.8 0.8 0.8" />'
+                 '<connect from="bsdf bsdf" to="output surface" /></shader>')
+    lines.append('<shader name="emission"><emission name="emit" color="1.0 0.9 0.7" strength="20" />'
+                 '<connect from="emit emission" to="output surface" /></shader>')
+
+    # Camera looks along +Z, the floor is a large quad behind the lights.
+    lines.append('<state shader="floor">')
+    lines.append('<mesh P="%f %f 60 %f %f 60 %f %f 60 %f %f 60" nverts="4" verts="0 1 2 3" />' %
+                 (-size, -size, size, -size, size, size, -size, size))
+    lines.append('</state>')
+
+    num_quads = num_lights // 2
+    num_points = num_lights - num_quads
+
+    # Emissive quads facing the camera.
+    P = []
+    verts = []
+    for i in range(num_quads):
+        x = rng.uniform(-size, size)
+        y = rng.uniform(-size, size)
+        z = rng.uniform(40.0, 58.0)
+        r = rng.uniform(0.05, 0.2)
+        P.extend((x - r, y - r, z, x + r, y - r, z, x + r, y + r, z, x - r, y + r, z))
+        verts.extend((4 * i, 4 * i + 1, 4 * i + 2, 4 * i + 3))
+
+    if num_quads:
+        lines.append('<state shader="emission">')
+        lines.append('<mesh P="%s" nverts="%s" verts="%s" />' %
+                     (" ".join("%.4f" % p for p in P),
+                      " ".join(["4"] * num_quads),
+                      " ".join(str(v) for v in verts)))
+        lines.append('</state>')
+
+    # Point and spot lights with random colors.
+    lines.append('<shader name="light"><emission name="emit" color="1 1 1" strength="1" />'
+                 '<connect from="emit emission" to="output surface" /></shader>')
+    lines.append('<state shader="light">')
+    for i in range(num_points):
+        co = (rng.uniform(-size, size), rng.uniform(-size, size), rng.uniform(40.0, 58.0))
+        strength = (rng.uniform(0.0, 50.0), rng.uniform(0.0, 50.0), rng.uniform(0.0, 50.0))
+        if i % 4 == 0:
+            lines.append('<light light_type="spot" co="%.4f %.4f %.4f" dir="0 0 1" '
+                         'spot_angle="0.8" strength="%.3f %.3f %.3f" size="0.05" use_mis="true" />' %
+                         (co + strength))
+        else:
+            lines.append('<light light_type="point" co="%.4f %.4f %.4f" '
+                         'strength="%.3f %.3f %.3f" size="0.05" use_mis="true" />' %
+                         (co + strength))
+    lines.append('</state>')
+
+    lines.append('</cycles>')
+
+    with open(filepath, "w") as f:
+        f.write("\n".join(lines))
+        f.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate many light benchmark scenes")
+    parser.add_argument("counts", type=int, nargs="*", default=[1000, 10000, 100000])
+    parser.add_argument("--output", default=".", help="Output directory")
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    os.makedirs(args.output, exist_ok=True)
+
+    for num_lights in args.counts:
+        for use_light_tree in (False, True):
+            filename = "many_lights_%d_%s.xml" % (num_lights, "tree" if use_light_tree else "flat")
+            filepath = os.path.join(args.output, filename)
+            write_scene(filepath, num_lights, use_light_tree, args.seed)
+            print("Written " + filepath)
+
+
+if __name__ == "__main__":
+    main()
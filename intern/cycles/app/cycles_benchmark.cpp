@@ -0,0 +1,633 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Headless benchmark runner.
+ *
+ * Renders a set of XML scenes a number of times and writes the timings as JSON, so that results
+ * of different builds can be compared. Every pass creates a new session and loads the scene
+ * again, so scene loading, device update and BVH build are measured in every pass too.
+ *
+ * With a reference image the relative mean squared error of the combined pass is reported as
+ * well, which combined with a time limit compares noise of integrator settings at equal time. */
+
+#include <stdio.h>
+
+#include "device/device.h"
+#include "render/buffers.h"
+#include "render/camera.h"
+#include "render/output_driver.h"
+#include "render/scene.h"
+#include "render/session.h"
+#include "render/stats.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_args.h"
+#include "util/util_foreach.h"
+#include "util/util_guarded_allocator.h"
+#include "util/util_image.h"
+#include "util/util_logging.h"
+#include "util/util_path.h"
+#include "util/util_progress.h"
+#include "util/util_string.h"
+#include "util/util_unique_ptr.h"
+#include "util/util_version.h"
+
+#include "app/cycles_xml.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct BenchmarkOptions {
+  vector<string> filepaths;
+  string output_filepath;
+  string reference_filepath;
+  int width, height;
+  int warmup_passes;
+  int passes;
+  SceneParams scene_params;
+  SessionParams session_params;
+} options;
+
+/* Measurements of a single render of a scene. */
+struct BenchmarkPass {
+  int width, height;
+  int samples;
+  double render_time;
+  double device_update_time;
+  double bvh_build_time;
+  size_t device_memory_peak;
+  /* Relative mean squared error against the reference image, negative if there is none. */
+  double rel_mse;
+  /* Same after low-pass filtering the error, closer to the perceived noise. */
+  double rel_mse_lowpass;
+  /* Kernel time per profiling event, in seconds summed over all threads. */
+  vector<std::pair<string, double>> kernel_times;
+};
+
+/* JSON */
+
+static double samples_per_second(const BenchmarkPass &pass)
+{
+  return (pass.render_time > 0.0) ? pass.samples / pass.render_time : 0.0;
+}
+
+static double median(vector<double> values)
+{
+  if (values.empty()) {
+    return 0.0;
+  }
+
+  sort(values.begin(), values.end());
+  const size_t middle = values.size() / 2;
+  return (values.size() % 2) ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+static string json_pass(const BenchmarkPass &pass, const string &indent)
+{
+  const double pixel_samples = (double)pass.width * pass.height * pass.samples;
+
+  string json = indent + "{\n";
+  json += string_printf("%s  \"samples\": %d,\n", indent.c_str(), pass.samples);
+  json += string_printf("%s  \"render_time\": %f,\n", indent.c_str(), pass.render_time);
+  json += string_printf(
+      "%s  \"samples_per_second\": %f,\n", indent.c_str(), samples_per_second(pass));
+  json += string_printf("%s  \"pixel_samples_per_second\": %f,\n",
+                        indent.c_str(),
+                        (pass.render_time > 0.0) ? pixel_samples / pass.render_time : 0.0);
+  json += string_printf(
+      "%s  \"device_update_time\": %f,\n", indent.c_str(), pass.device_update_time);
+  json += string_printf("%s  \"bvh_build_time\": %f,\n", indent.c_str(), pass.bvh_build_time);
+  json += string_printf("%s  \"device_memory_peak\": %zu,\n",
+                        indent.c_str(),
+                        pass.device_memory_peak);
+  if (pass.rel_mse >= 0.0) {
+    json += string_printf("%s  \"rel_mse\": %g,\n", indent.c_str(), pass.rel_mse);
+    json += string_printf(
+        "%s  \"rel_mse_lowpass\": %g,\n", indent.c_str(), pass.rel_mse_lowpass);
+  }
+  json += indent + "  \"kernel_times\": {";
+
+  for (size_t i = 0; i < pass.kernel_times.size(); i++) {
+    json += string_printf("%s\n%s    %s: %f",
+                          (i == 0) ? "" : ",",
+                          indent.c_str(),
+                          string_to_json(pass.kernel_times[i].first).c_str(),
+                          pass.kernel_times[i].second);
+  }
+
+  json += (pass.kernel_times.empty()) ? "}\n" : "\n" + indent + "  }\n";
+  json += indent + "}";
+  return json;
+}
+
+/* Error Metric */
+
+/* Collects the combined pass of the full frame. */
+class BenchmarkOutputDriver : public OutputDriver {
+ public:
+  void write_render_tile(const Tile &tile) override
+  {
+    if (pixels.empty()) {
+      width = tile.full_size.x;
+      height = tile.full_size.y;
+      pixels.resize((size_t)width * height * 4, 0.0f);
+    }
+
+    vector<float> tile_pixels((size_t)tile.size.x * tile.size.y * 4);
+    if (!tile.get_pass_pixels("combined", 4, tile_pixels.data())) {
+      return;
+    }
+
+    for (int y = 0; y < tile.size.y; y++) {
+      const float *src = &tile_pixels[(size_t)y * tile.size.x * 4];
+      float *dst = &pixels[((size_t)(tile.offset.y + y) * width + tile.offset.x) * 4];
+      std::copy(src, src + tile.size.x * 4, dst);
+    }
+  }
+
+  int width = 0, height = 0;
+  vector<float> pixels;
+};
+
+struct ReferenceImage {
+  int width = 0, height = 0;
+  vector<float> pixels;
+} reference;
+
+static bool reference_load(const string &filepath)
+{
+  unique_ptr<ImageInput> in(ImageInput::open(filepath));
+  if (!in) {
+    fprintf(stderr, "Failed to open reference image %s\n", filepath.c_str());
+    return false;
+  }
+
+  const ImageSpec &spec = in->spec();
+  reference.width = spec.width;
+  reference.height = spec.height;
+  reference.pixels.resize((size_t)spec.width * spec.height * 4, 1.0f);
+
+  vector<float> pixels((size_t)spec.width * spec.height * spec.nchannels);
+  if (!in->read_image(TypeDesc::FLOAT, pixels.data())) {
+    fprintf(stderr, "Failed to read reference image %s\n", filepath.c_str());
+    return false;
+  }
+
+  /* Convert to RGBA, images are stored top to bottom unlike render buffers. */
+  const int num_channels = min(spec.nchannels, 4);
+  for (int y = 0; y < spec.height; y++) {
+    const float *src = &pixels[(size_t)y * spec.width * spec.nchannels];
+    float *dst = &reference.pixels[(size_t)(spec.height - 1 - y) * spec.width * 4];
+    for (int x = 0; x < spec.width; x++) {
+      for (int c = 0; c < num_channels; c++) {
+        dst[x * 4 + c] = src[(size_t)x * spec.nchannels + c];
+      }
+    }
+  }
+
+  in->close();
+  return true;
+}
+
+/* Relative mean squared error of RGB, robust to very dark reference pixels. */
+static double rel_mse(const BenchmarkOutputDriver &output)
+{
+  if (output.width != reference.width || output.height != reference.height) {
+    fprintf(stderr, "Reference image resolution does not match the render\n");
+    return -1.0;
+  }
+
+  double sum = 0.0;
+  const size_t num_pixels = (size_t)output.width * output.height;
+  for (size_t i = 0; i < num_pixels; i++) {
+    for (int c = 0; c < 3; c++) {
+      const double value = output.pixels[i * 4 + c];
+      const double ref = reference.pixels[i * 4 + c];
+      sum += (value - ref) * (value - ref) / (ref * ref + 1e-2);
+    }
+  }
+
+  return (num_pixels) ? sum / (num_pixels * 3) : 0.0;
+}
+
+/* Relative mean squared error of RGB after blurring the error with a Gaussian of one pixel
+ * radius. Noise with its energy at high frequencies, like blue noise, is largely filtered out
+ * the same way it is by the eye or a denoiser, while white noise is not. */
+static double rel_mse_lowpass(const BenchmarkOutputDriver &output)
+{
+  if (output.width != reference.width || output.height != reference.height) {
+    return -1.0;
+  }
+
+  const int width = output.width;
+  const int height = output.height;
+  const int radius = 3;
+
+  float weights[radius + 1];
+  float weight_sum = 0.0f;
+  for (int i = 0; i <= radius; i++) {
+    weights[i] = expf(-0.5f * i * i);
+    weight_sum += (i == 0) ? weights[i] : 2.0f * weights[i];
+  }
+  for (int i = 0; i <= radius; i++) {
+    weights[i] /= weight_sum;
+  }
+
+  const size_t num_pixels = (size_t)width * height;
+  vector<float> error(num_pixels * 3), blurred(num_pixels * 3);
+  for (size_t i = 0; i < num_pixels; i++) {
+    for (int c = 0; c < 3; c++) {
+      const float value = output.pixels[i * 4 + c];
+      const float ref = reference.pixels[i * 4 + c];
+      error[i * 3 + c] = (value - ref) / sqrtf(ref * ref + 1e-2f);
+    }
+  }
+
+  /* Separable filter, clamping at the image borders. */
+  for (int pass = 0; pass < 2; pass++) {
+    const vector<float> &src = (pass == 0) ? error : blurred;
+    vector<float> &dst = (pass == 0) ? blurred : error;
+
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        for (int c = 0; c < 3; c++) {
+          float sum = 0.0f;
+          for (int i = -radius; i <= radius; i++) {
+            const int sx = (pass == 0) ? clamp(x + i, 0, width - 1) : x;
+            const int sy = (pass == 1) ? clamp(y + i, 0, height - 1) : y;
+            sum += weights[abs(i)] * src[((size_t)sy * width + sx) * 3 + c];
+          }
+          dst[((size_t)y * width + x) * 3 + c] = sum;
+        }
+      }
+    }
+  }
+
+  double sum = 0.0;
+  foreach (const float e, error) {
+    sum += (double)e * e;
+  }
+
+  return (num_pixels) ? sum / (num_pixels * 3) : 0.0;
+}
+
+/* Rendering */
+
+static void kernel_times_flatten(const NamedNestedSampleStats &stats,
+                                 const string &prefix,
+                                 vector<std::pair<string, double>> &kernel_times)
+{
+  /* Profiler samples are taken every millisecond. */
+  const string name = prefix + stats.name;
+  kernel_times.push_back({name, stats.sum_samples * 0.001});
+
+  foreach (const NamedNestedSampleStats &entry, stats.entries) {
+    kernel_times_flatten(entry, name + "/", kernel_times);
+  }
+}
+
+static bool benchmark_pass(const string &filepath, BenchmarkPass &pass)
+{
+  unique_ptr<Session> session = make_unique<Session>(options.session_params,
+                                                     options.scene_params);
+  Scene *scene = session->scene;
+  scene->enable_update_stats();
+
+  xml_read_file(scene, filepath.c_str());
+
+  if (!(options.width == 0 || options.height == 0)) {
+    scene->camera->set_full_width(options.width);
+    scene->camera->set_full_height(options.height);
+  }
+  scene->camera->compute_auto_viewplane();
+
+  Pass *combined = scene->create_node<Pass>();
+  combined->set_name(ustring("combined"));
+  combined->set_type(PASS_COMBINED);
+
+  BenchmarkOutputDriver *output = nullptr;
+  if (!options.reference_filepath.empty()) {
+    unique_ptr<BenchmarkOutputDriver> driver = make_unique<BenchmarkOutputDriver>();
+    output = driver.get();
+    session->set_output_driver(std::move(driver));
+  }
+
+  BufferParams buffer_params;
+  buffer_params.width = scene->camera->get_full_width();
+  buffer_params.height = scene->camera->get_full_height();
+  buffer_params.full_width = buffer_params.width;
+  buffer_params.full_height = buffer_params.height;
+
+  session->reset(options.session_params, buffer_params);
+  session->start();
+  session->wait();
+
+  if (session->progress.get_error()) {
+    fprintf(stderr,
+            "Error rendering %s: %s\n",
+            filepath.c_str(),
+            session->progress.get_error_message().c_str());
+    return false;
+  }
+
+  double total_time;
+  session->progress.get_time(total_time, pass.render_time);
+
+  pass.width = buffer_params.width;
+  pass.height = buffer_params.height;
+  pass.samples = session->progress.get_current_sample();
+  pass.device_memory_peak = session->stats.mem_peak;
+  pass.rel_mse = (output) ? rel_mse(*output) : -1.0;
+  pass.rel_mse_lowpass = (output) ? rel_mse_lowpass(*output) : -1.0;
+
+  /* Scene update statistics are cleared on every update, so these are for the last update. */
+  pass.device_update_time = 0.0;
+  foreach (const NamedTimeEntry &entry, scene->update_stats->scene.times.entries) {
+    if (entry.name == "device_update") {
+      pass.device_update_time += entry.time;
+    }
+  }
+
+  pass.bvh_build_time = 0.0;
+  foreach (const NamedTimeEntry &entry, scene->update_stats->geometry.times.entries) {
+    if (string_startswith(entry.name, "device_update (build")) {
+      pass.bvh_build_time += entry.time;
+    }
+  }
+
+  RenderStats render_stats;
+  session->collect_statistics(&render_stats);
+
+  pass.kernel_times.clear();
+  if (render_stats.has_profiling) {
+    render_stats.kernel.update_sum();
+    kernel_times_flatten(render_stats.kernel, "", pass.kernel_times);
+  }
+
+  return true;
+}
+
+static bool benchmark_scene(const string &filepath, string &json)
+{
+  for (int i = 0; i < options.warmup_passes; i++) {
+    fprintf(stderr, "%s: warm-up pass %d/%d\n", filepath.c_str(), i + 1, options.warmup_passes);
+
+    BenchmarkPass pass;
+    if (!benchmark_pass(filepath, pass)) {
+      return false;
+    }
+  }
+
+  vector<BenchmarkPass> passes;
+  for (int i = 0; i < options.passes; i++) {
+    fprintf(stderr, "%s: pass %d/%d\n", filepath.c_str(), i + 1, options.passes);
+
+    BenchmarkPass pass;
+    if (!benchmark_pass(filepath, pass)) {
+      return false;
+    }
+    passes.push_back(pass);
+  }
+
+  vector<double> render_times, rates, device_update_times, bvh_build_times, errors;
+  vector<double> errors_lowpass;
+  foreach (const BenchmarkPass &pass, passes) {
+    render_times.push_back(pass.render_time);
+    rates.push_back(samples_per_second(pass));
+    device_update_times.push_back(pass.device_update_time);
+    bvh_build_times.push_back(pass.bvh_build_time);
+    errors.push_back(pass.rel_mse);
+    errors_lowpass.push_back(pass.rel_mse_lowpass);
+  }
+
+  json = "    {\n";
+  json += string_printf("      \"filepath\": %s,\n", string_to_json(filepath).c_str());
+  json += string_printf("      \"render_time\": %f,\n", median(render_times));
+  json += string_printf("      \"samples_per_second\": %f,\n", median(rates));
+  json += string_printf("      \"device_update_time\": %f,\n", median(device_update_times));
+  json += string_printf("      \"bvh_build_time\": %f,\n", median(bvh_build_times));
+  if (!options.reference_filepath.empty()) {
+    json += string_printf("      \"rel_mse\": %g,\n", median(errors));
+    json += string_printf("      \"rel_mse_lowpass\": %g,\n", median(errors_lowpass));
+  }
+  json += "      \"passes\": [\n";
+
+  for (size_t i = 0; i < passes.size(); i++) {
+    json += json_pass(passes[i], "        ");
+    json += (i + 1 < passes.size()) ? ",\n" : "\n";
+  }
+
+  json += "      ]\n";
+  json += "    }";
+  return true;
+}
+
+static bool benchmark_run()
+{
+  vector<string> scenes_json;
+
+  foreach (const string &filepath, options.filepaths) {
+    string json;
+    if (!benchmark_scene(filepath, json)) {
+      return false;
+    }
+    scenes_json.push_back(json);
+  }
+
+  string json = "{\n";
+  json += string_printf("  \"version\": %s,\n", string_to_json(CYCLES_VERSION_STRING).c_str());
+  json += string_printf("  \"device\": %s,\n",
+                        string_to_json(options.session_params.device.description).c_str());
+  json += string_printf("  \"threads\": %d,\n", options.session_params.threads);
+  json += string_printf("  \"warmup_passes\": %d,\n", options.warmup_passes);
+  json += string_printf("  \"passes\": %d,\n", options.passes);
+  json += string_printf("  \"time_limit\": %f,\n", options.session_params.time_limit);
+  /* Peak of the whole process, guarded allocations only. */
+  json += string_printf("  \"host_memory_peak\": %zu,\n", util_guarded_get_mem_peak());
+  json += "  \"scenes\": [\n";
+
+  for (size_t i = 0; i < scenes_json.size(); i++) {
+    json += scenes_json[i];
+    json += (i + 1 < scenes_json.size()) ? ",\n" : "\n";
+  }
+
+  json += "  ]\n";
+  json += "}\n";
+
+  if (options.output_filepath.empty()) {
+    fputs(json.c_str(), stdout);
+    return true;
+  }
+
+  if (!path_write_text(options.output_filepath, json)) {
+    fprintf(stderr, "Failed to write %s\n", options.output_filepath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+/* Options */
+
+static int files_parse(int argc, const char *argv[])
+{
+  for (int i = 0; i < argc; i++) {
+    options.filepaths.push_back(argv[i]);
+  }
+
+  return 0;
+}
+
+static void options_parse(int argc, const char **argv)
+{
+  options.width = 0;
+  options.height = 0;
+  options.warmup_passes = 1;
+  options.passes = 3;
+  options.session_params.background = true;
+  options.session_params.use_profiling = true;
+  options.session_params.use_auto_tile = false;
+  options.session_params.tile_size = 0;
+  options.session_params.samples = 64;
+
+  string devicename = "CPU";
+  string texture_compression = "none";
+  bool no_profiling = false;
+
+  ArgParse ap;
+  bool help = false, debug = false;
+  int verbosity = 1;
+
+  ap.options("Usage: cycles_benchmark [options] scene.xml [scene.xml ...]",
+             "%*",
+             files_parse,
+             "",
+             "--device %s",
+             &devicename,
+             "Device to use",
+             "--samples %d",
+             &options.session_params.samples,
+             "Number of samples to render per pass",
+             "--time-limit %F",
+             &options.session_params.time_limit,
+             "Stop rendering a pass after this many seconds, to compare results at equal time",
+             "--threads %d",
+             &options.session_params.threads,
+             "CPU Rendering Threads",
+             "--width %d",
+             &options.width,
+             "Override the scene width in pixels",
+             "--height %d",
+             &options.height,
+             "Override the scene height in pixels",
+             "--warmup %d",
+             &options.warmup_passes,
+             "Number of passes to render before measuring",
+             "--passes %d",
+             &options.passes,
+             "Number of measured passes",
+             "--output %s",
+             &options.output_filepath,
+             "File path to write the JSON results to, standard output if not set",
+             "--reference %s",
+             &options.reference_filepath,
+             "Reference image to report the relative mean squared error of every pass against",
+             "--texture-compression %s",
+             &texture_compression,
+             "Storage of float textures: none, half, block",
+             "--no-profiling",
+             &no_profiling,
+             "Don't collect kernel stage times, which has a small overhead",
+#ifdef WITH_CYCLES_LOGGING
+             "--debug",
+             &debug,
+             "Enable debug logging",
+             "--verbose %d",
+             &verbosity,
+             "Set verbosity of the logger",
+#endif
+             "--help",
+             &help,
+             "Print help message",
+             NULL);
+
+  if (ap.parse(argc, argv) < 0) {
+    fprintf(stderr, "%s\n", ap.geterror().c_str());
+    ap.usage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (debug) {
+    util_logging_start();
+    util_logging_verbosity_set(verbosity);
+  }
+
+  if (help || options.filepaths.empty()) {
+    ap.usage();
+    exit(EXIT_SUCCESS);
+  }
+
+  if (no_profiling) {
+    options.session_params.use_profiling = false;
+  }
+
+  if (texture_compression == "none") {
+    options.scene_params.texture_compression = IMAGE_COMPRESSION_NONE;
+  }
+  else if (texture_compression == "half") {
+    options.scene_params.texture_compression = IMAGE_COMPRESSION_HALF;
+  }
+  else if (texture_compression == "block") {
+    options.scene_params.texture_compression = IMAGE_COMPRESSION_BLOCK;
+  }
+  else {
+    fprintf(stderr, "Unknown texture compression: %s\n", texture_compression.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  DeviceType device_type = Device::type_from_string(devicename.c_str());
+  vector<DeviceInfo> devices = Device::available_devices(DEVICE_MASK(device_type));
+
+  if (devices.empty()) {
+    fprintf(stderr, "Unknown device: %s\n", devicename.c_str());
+    exit(EXIT_FAILURE);
+  }
+  else if (options.session_params.samples <= 0) {
+    fprintf(stderr, "Invalid number of samples: %d\n", options.session_params.samples);
+    exit(EXIT_FAILURE);
+  }
+  else if (options.warmup_passes < 0 || options.passes <= 0) {
+    fprintf(stderr, "Invalid number of passes\n");
+    exit(EXIT_FAILURE);
+  }
+  else if (!options.reference_filepath.empty() && !reference_load(options.reference_filepath)) {
+    exit(EXIT_FAILURE);
+  }
+
+  options.session_params.device = devices.front();
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+  util_logging_init(argv[0]);
+  path_init();
+  options_parse(argc, argv);
+
+  return (benchmark_run()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
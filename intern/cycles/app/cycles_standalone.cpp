@@ -415,6 +415,12 @@ static void options_parse(int argc, const char **argv)
              "--tile-size %d",
              &options.session_params.tile_size,
              "Tile size in pixels",
+             "--bvh-cache-dir %s",
+             &options.scene_params.bvh_cache_directory,
+             "Directory to store built BVHs in, to reuse them in later renders",
+             "--bvh-cache-size %d",
+             &options.scene_params.bvh_cache_size,
+             "Maximum size of the BVH cache directory in gigabytes, 0 for no limit",
              "--list-devices",
              &list,
              "List information about all available devices",
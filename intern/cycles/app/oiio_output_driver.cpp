@@ -16,6 +16,8 @@
 
 #include "app/oiio_output_driver.h"
 
+#include "render/tile.h"
+
 CCL_NAMESPACE_BEGIN
 
 OIIOOutputDriver::OIIOOutputDriver(const string_view filepath,
@@ -27,12 +29,109 @@ OIIOOutputDriver::OIIOOutputDriver(const string_view filepath,
 
 OIIOOutputDriver::~OIIOOutputDriver()
 {
+  close_tiled_output();
+}
+
+bool OIIOOutputDriver::open_tiled_output(const Tile &tile)
+{
+  tiled_output_ = ImageOutput::create(filepath_);
+  if (tiled_output_ == nullptr || !tiled_output_->supports("tiles")) {
+    log_("Failed to create tiled image file, tiled rendering requires a format such as OpenEXR");
+    tiled_output_ = nullptr;
+    return false;
+  }
+
+  const int width = tile.full_size.x;
+  const int height = tile.full_size.y;
+
+  /* Render tiles form a regular grid starting at the first tile, and their size is either a
+   * multiple of the image tile size or smaller than it. So image tiles of this size are aligned
+   * with all render tiles. */
+  const int tile_width = min(tile.offset.x + tile.size.x, TileManager::IMAGE_TILE_SIZE);
+  const int tile_height = min(tile.offset.y + tile.size.y, TileManager::IMAGE_TILE_SIZE);
+
+  /* Rows are flipped to the top-down convention, so the grid of render tiles starts at the
+   * bottom of the image. Extend the data window above the display window, so that image tiles
+   * are aligned with render tiles after the flip. The padding rows are written as zeros with the
+   * top row of render tiles. */
+  padding_rows_ = int(align_up(height, tile_height)) - height;
+
+  ImageSpec spec(width, height + padding_rows_, 4, TypeDesc::FLOAT);
+  spec.y = -padding_rows_;
+  spec.full_x = 0;
+  spec.full_y = 0;
+  spec.full_width = width;
+  spec.full_height = height;
+  spec.tile_width = tile_width;
+  spec.tile_height = tile_height;
+
+  if (!tiled_output_->open(filepath_, spec)) {
+    log_("Failed to create tiled image file");
+    tiled_output_ = nullptr;
+    return false;
+  }
+
+  log_(string_printf("Writing image %s in tiles", filepath_.c_str()));
+
+  num_tiled_pixels_written_ = 0;
+
+  return true;
+}
+
+void OIIOOutputDriver::close_tiled_output()
+{
+  if (tiled_output_ == nullptr) {
+    return;
+  }
+
+  tiled_output_->close();
+  tiled_output_ = nullptr;
 }
 
 void OIIOOutputDriver::write_render_tile(const Tile &tile)
 {
-  /* Only write the full buffer, no intermediate tiles. */
+  /* Tiles of a full-frame result which was rendered in tiles, written as they are finished. */
   if (!(tile.size == tile.full_size)) {
+    if (tiled_output_ == nullptr && !open_tiled_output(tile)) {
+      return;
+    }
+
+    const int width = tile.size.x;
+    const int height = tile.size.y;
+
+    /* Rows are stored bottom-up, so padding rows above the top row of tiles are appended. */
+    const bool is_top_row = (tile.offset.y + height == tile.full_size.y);
+    const int padded_height = is_top_row ? height + padding_rows_ : height;
+
+    vector<float> pixels(size_t(width) * padded_height * 4, 0.0f);
+    if (!tile.get_pass_pixels(pass_, 4, pixels.data())) {
+      log_("Failed to read render pass pixels");
+      return;
+    }
+
+    const int y = tile.full_size.y - tile.offset.y - height;
+    const int y_begin = is_top_row ? y - padding_rows_ : y;
+
+    if (!tiled_output_->write_tiles(tile.offset.x,
+                                    tile.offset.x + width,
+                                    y_begin,
+                                    y + height,
+                                    0,
+                                    1,
+                                    TypeDesc::FLOAT,
+                                    pixels.data() + size_t(padded_height - 1) * width * 4,
+                                    AutoStride,
+                                    -width * 4 * sizeof(float),
+                                    AutoStride)) {
+      log_("Failed to write image tile: " + tiled_output_->geterror());
+      return;
+    }
+
+    num_tiled_pixels_written_ += int64_t(width) * height;
+    if (num_tiled_pixels_written_ >= int64_t(tile.full_size.x) * tile.full_size.y) {
+      close_tiled_output();
+    }
+
     return;
   }
 
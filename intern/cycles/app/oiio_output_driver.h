@@ -34,9 +34,20 @@ class OIIOOutputDriver : public OutputDriver {
   void write_render_tile(const Tile &tile) override;
 
  protected:
+  /* Open tiled image for the full frame when the first tile of a tiled render is written. */
+  bool open_tiled_output(const Tile &tile);
+  void close_tiled_output();
+
   string filepath_;
   string pass_;
   LogFunction log_;
+
+  /* Image for writing tiles of full-frame results as they are finished, so that the full frame
+   * is never held in memory. */
+  unique_ptr<ImageOutput> tiled_output_;
+  int64_t num_tiled_pixels_written_ = 0;
+  /* Rows of the data window above the display window, to align image tiles with render tiles. */
+  int padding_rows_ = 0;
 };
 
 CCL_NAMESPACE_END
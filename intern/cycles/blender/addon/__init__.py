@@ -61,6 +61,7 @@ class CyclesRender(bpy.types.RenderEngine):
     bl_use_spherical_stereo = True
     bl_use_custom_freestyle = True
     bl_use_alembic_procedural = True
+    bl_use_packed_bake = True
 
     def __init__(self):
         self.session = None
@@ -87,6 +88,9 @@ class CyclesRender(bpy.types.RenderEngine):
     def render_frame_finish(self):
         engine.render_frame_finish(self)
 
+    def memory_statistics(self):
+        return engine.memory_statistics(self)
+
     def draw(self, context, depsgraph):
         engine.draw(self, depsgraph, context.space_data)
 
@@ -26,6 +26,10 @@ def _configure_argument_parser():
     parser.add_argument("--cycles-print-stats",
                         help="Print rendering statistics to stderr",
                         action='store_true')
+    parser.add_argument("--cycles-memory-stats",
+                        help="Write memory statistics of objects, images and BVH as JSON to the given "
+                             "file at the end of every render",
+                        default=None)
     parser.add_argument("--cycles-device",
                         help="Set the device to use for Cycles, overriding user preferences and the scene setting."
                              "Valid options are 'CPU', 'CUDA', 'OPTIX', or 'HIP'"
@@ -48,6 +52,10 @@ def _parse_command_line():
         import _cycles
         _cycles.enable_print_stats()
 
+    if args.cycles_memory_stats:
+        import _cycles
+        _cycles.enable_memory_stats(args.cycles_memory_stats)
+
     if args.cycles_device:
         import _cycles
         _cycles.set_device_override(args.cycles_device)
@@ -105,6 +113,23 @@ def render(engine, depsgraph):
         _cycles.render(engine.session, depsgraph.as_pointer())
 
 
+def enable_memory_statistics(filepath=""):
+    import _cycles
+    _cycles.enable_memory_stats(filepath)
+
+
+def memory_statistics(engine):
+    """Memory statistics of the last render as a dictionary, or None if they were not collected."""
+    session = getattr(engine, "session", None)
+    if not session:
+        return None
+
+    import _cycles
+    import json
+    stats = _cycles.memory_stats(session)
+    return json.loads(stats) if stats else None
+
+
 def render_frame_finish(engine):
     if not engine.session:
         return
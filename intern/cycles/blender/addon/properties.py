@@ -53,6 +53,7 @@ enum_displacement_methods = (
 enum_bvh_layouts = (
     ('BVH2', "BVH2", "", 1),
     ('EMBREE', "Embree", "", 4),
+    ('BVH4', "BVH4", "Four-wide BVH with quantized child bounds", 32),
 )
 
 enum_bvh_types = (
@@ -125,6 +126,13 @@ enum_texture_limit = (
     ('8192', "8192", "Limit texture size to 8192 pixels", 7),
 )
 
+enum_texture_compression = (
+    ('NONE', "None", "Store float textures at full precision", 0),
+    ('HALF', "Half Float", "Store float textures as half float when their values fit, using half the memory", 1),
+    ('BLOCK', "Block", "Store float textures block compressed when rendering on the CPU, using a fifth of the memory with "
+     "lower precision, and as half float on other devices", 2),
+)
+
 # NOTE: Identifiers are expected to be an upper case version of identifiers from  `Pass::get_type_enum()`
 enum_view3d_shading_render_pass = (
     ('', "General", ""),
@@ -337,6 +345,13 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default='PROGRESSIVE_MUTI_JITTER',
     )
 
+    use_blue_noise: BoolProperty(
+        name="Blue Noise",
+        description="Distribute noise between neighboring pixels as blue noise, which is less "
+        "visible and easier to denoise at low sample counts",
+        default=False,
+    )
+
     use_layer_samples: EnumProperty(
         name="Layer Samples",
         description="How to use per view layer sample settings",
@@ -352,6 +367,27 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default=0.01,
     )
 
+    use_light_tree: BoolProperty(
+        name="Light Tree",
+        description="Sample lights proportional to their estimated contribution using a hierarchy of lights, "
+        "reducing noise in scenes with many lights at the cost of slower light selection",
+        default=False,
+    )
+
+    use_guiding: BoolProperty(
+        name="Path Guiding",
+        description="Learn the distribution of incoming light while rendering and use it to guide "
+        "scattering directions, reducing noise in scenes with difficult indirect lighting. "
+        "Only supported on CPU",
+        default=False,
+    )
+    guiding_training_samples: IntProperty(
+        name="Training Samples",
+        description="Number of samples per pixel used to learn the distribution of incoming light",
+        min=1, max=(1 << 24),
+        default=128,
+    )
+
     use_adaptive_sampling: BoolProperty(
         name="Use Adaptive Sampling",
         description="Automatically reduce the number of samples per pixel based on estimated noise level",
@@ -490,6 +526,13 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         min=2, max=65536
     )
 
+    volume_skip_empty: BoolProperty(
+        name="Skip Empty Space",
+        description="Step over regions of volume objects without any active voxels, "
+        "instead of evaluating the volume shader there",
+        default=True,
+    )
+
     dicing_rate: FloatProperty(
         name="Dicing Rate",
         description="Size of a micropolygon in pixels",
@@ -511,6 +554,15 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         min=0, max=16,
         default=12,
     )
+    dicing_reuse_tolerance: FloatProperty(
+        name="Dicing Reuse Tolerance",
+        description="Reuse the diced topology of the previous frame when the control mesh topology is unchanged "
+        "and its size on screen changed by less than this fraction, only moving the diced vertices. "
+        "Zero always dices again",
+        min=0.0, max=1.0,
+        default=0.0,
+        subtype='FACTOR'
+    )
 
     dicing_camera: PointerProperty(
         name="Dicing Camera",
@@ -626,6 +678,21 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default=0,
         min=0, max=16,
     )
+    bvh_cache_directory: StringProperty(
+        name="BVH Cache",
+        description="Directory to store built BVHs in, to load them instead of building again when rendering "
+        "the same geometry, for example static sets in another frame or on another render farm node. "
+        "Leave empty to disable",
+        subtype='DIR_PATH',
+        default="",
+    )
+    bvh_cache_size: IntProperty(
+        name="BVH Cache Size",
+        description="Maximum size in gigabytes of the BVH cache directory, the least recently used BVHs are "
+        "removed when it is exceeded. 0 for no limit, in which case the directory has to be cleaned up externally",
+        min=0, max=1048576,
+        default=16,
+    )
 
     bake_type: EnumProperty(
         name="Bake Type",
@@ -719,6 +786,21 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         items=enum_texture_limit
     )
 
+    texture_cache_size: IntProperty(
+        name="Texture Cache Size",
+        description="Memory budget in megabytes for loading image texture tiles on demand when rendering on the CPU, "
+        "0 loads full images",
+        min=0, max=1048576,
+        default=0,
+    )
+
+    texture_compression: EnumProperty(
+        name="Texture Compression",
+        default='NONE',
+        description="Reduced precision storage of float image textures, to save memory",
+        items=enum_texture_compression
+    )
+
     use_fast_gi: BoolProperty(
         name="Fast GI Approximation",
         description="Approximate diffuse indirect light with background tinted ambient occlusion. This provides fast alternative to full global illumination, for interactive viewport rendering or final renders with reduced quality",
@@ -1181,6 +1263,14 @@ class CyclesCurveRenderSettings(bpy.types.PropertyGroup):
         min=0, max=24,
         default=2,
     )
+    use_quantized_keys: BoolProperty(
+        name="Quantize Keys",
+        description="Store curve keys at reduced precision relative to the bounds of each curve, "
+        "saving up to half of their memory. Only used with the native BVH, not with Embree or OptiX, "
+        "and when curves have more than 4 keys on average. Keys of motion steps are stored at full "
+        "precision",
+        default=False,
+    )
 
     @classmethod
     def register(cls):
@@ -285,6 +285,7 @@ class CYCLES_RENDER_PT_sampling_advanced(CyclesButtonsPanel, Panel):
         col = layout.column(align=True)
         col.active = not(cscene.use_adaptive_sampling)
         col.prop(cscene, "sampling_pattern", text="Pattern")
+        layout.prop(cscene, "use_blue_noise")
 
         layout.separator()
 
@@ -292,6 +293,14 @@ class CYCLES_RENDER_PT_sampling_advanced(CyclesButtonsPanel, Panel):
         col.prop(cscene, "min_light_bounces")
         col.prop(cscene, "min_transparent_bounces")
         col.prop(cscene, "light_sampling_threshold", text="Light Threshold")
+        col.prop(cscene, "use_light_tree")
+
+        col = layout.column(align=True)
+        col.active = use_cpu(context)
+        col.prop(cscene, "use_guiding")
+        sub = col.column(align=True)
+        sub.active = cscene.use_guiding
+        sub.prop(cscene, "guiding_training_samples")
 
         for view_layer in scene.view_layers:
             if view_layer.samples > 0:
@@ -325,6 +334,7 @@ class CYCLES_RENDER_PT_subdivision(CyclesButtonsPanel, Panel):
 
         col.prop(cscene, "offscreen_dicing_scale", text="Offscreen Scale")
         col.prop(cscene, "max_subdivisions")
+        col.prop(cscene, "dicing_reuse_tolerance", text="Reuse Tolerance")
 
         col.prop(cscene, "dicing_camera")
 
@@ -345,6 +355,7 @@ class CYCLES_RENDER_PT_hair(CyclesButtonsPanel, Panel):
         col.prop(ccscene, "shape", text="Shape")
         if ccscene.shape == 'RIBBONS':
             col.prop(ccscene, "subdivisions", text="Curve Subdivisions")
+        col.prop(ccscene, "use_quantized_keys")
 
 
 class CYCLES_RENDER_PT_volumes(CyclesButtonsPanel, Panel):
@@ -364,6 +375,7 @@ class CYCLES_RENDER_PT_volumes(CyclesButtonsPanel, Panel):
         col.prop(cscene, "volume_preview_step_rate", text="Viewport")
 
         layout.prop(cscene, "volume_max_steps", text="Max Steps")
+        layout.prop(cscene, "volume_skip_empty")
 
 
 class CYCLES_RENDER_PT_light_paths(CyclesButtonsPanel, Panel):
@@ -636,6 +648,12 @@ class CYCLES_RENDER_PT_performance_memory(CyclesButtonsPanel, Panel):
         sub.active = cscene.use_auto_tile
         sub.prop(cscene, "tile_size")
 
+        sub = col.column()
+        sub.active = use_cpu(context)
+        sub.prop(cscene, "texture_cache_size")
+
+        col.prop(cscene, "texture_compression")
+
 
 class CYCLES_RENDER_PT_performance_acceleration_structure(CyclesButtonsPanel, Panel):
     bl_label = "Acceleration Structure"
@@ -669,6 +687,11 @@ class CYCLES_RENDER_PT_performance_acceleration_structure(CyclesButtonsPanel, Pa
         sub.active = not cscene.debug_use_spatial_splits and not use_embree
         sub.prop(cscene, "debug_bvh_time_steps")
 
+        sub = col.column()
+        sub.active = not use_embree
+        sub.prop(cscene, "bvh_cache_directory")
+        sub.prop(cscene, "bvh_cache_size")
+
 
 class CYCLES_RENDER_PT_performance_final_render(CyclesButtonsPanel, Panel):
     bl_label = "Final Render"
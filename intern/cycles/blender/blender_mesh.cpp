@@ -1048,7 +1048,8 @@ static void create_subd_mesh(Scene *scene,
                              const bool need_motion,
                              const float motion_scale,
                              float dicing_rate,
-                             int max_subdivisions)
+                             int max_subdivisions,
+                             float dicing_reuse_tolerance)
 {
   BL::Object b_ob = b_ob_info.real_object;
 
@@ -1081,6 +1082,7 @@ static void create_subd_mesh(Scene *scene,
   mesh->set_subd_dicing_rate(subd_dicing_rate);
   mesh->set_subd_max_level(max_subdivisions);
   mesh->set_subd_objecttoworld(get_transform(b_ob.matrix_world()));
+  mesh->set_subd_dicing_reuse_tolerance(dicing_reuse_tolerance);
 }
 
 /* Sync */
@@ -1159,7 +1161,8 @@ void BlenderSync::sync_mesh(BL::Depsgraph b_depsgraph, BObjectInfo &b_ob_info, M
                          need_motion,
                          motion_scale,
                          dicing_rate,
-                         max_subdivisions);
+                         max_subdivisions,
+                         dicing_reuse_tolerance);
       else
         create_mesh(scene,
                     &new_mesh,
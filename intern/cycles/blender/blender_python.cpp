@@ -908,6 +908,28 @@ static PyObject *enable_print_stats_func(PyObject * /*self*/, PyObject * /*args*
   Py_RETURN_NONE;
 }
 
+static PyObject *enable_memory_stats_func(PyObject * /*self*/, PyObject *args)
+{
+  const char *filepath = "";
+  if (!PyArg_ParseTuple(args, "|s", &filepath)) {
+    return NULL;
+  }
+
+  BlenderSession::use_memory_stats = true;
+  BlenderSession::memory_stats_filepath = filepath;
+  Py_RETURN_NONE;
+}
+
+static PyObject *memory_stats_func(PyObject * /*self*/, PyObject *value)
+{
+  BlenderSession *session = (BlenderSession *)PyLong_AsVoidPtr(value);
+
+  if (session->memory_stats_json.empty()) {
+    Py_RETURN_NONE;
+  }
+  return PyUnicode_FromString(session->memory_stats_json.c_str());
+}
+
 static PyObject *get_device_types_func(PyObject * /*self*/, PyObject * /*args*/)
 {
   vector<DeviceType> device_types = Device::available_types();
@@ -991,6 +1013,8 @@ static PyMethodDef methods[] = {
 
     /* Statistics. */
     {"enable_print_stats", enable_print_stats_func, METH_NOARGS, ""},
+    {"enable_memory_stats", enable_memory_stats_func, METH_VARARGS, ""},
+    {"memory_stats", memory_stats_func, METH_O, ""},
 
     /* Compute Device selection */
     {"get_device_types", get_device_types_func, METH_VARARGS, ""},
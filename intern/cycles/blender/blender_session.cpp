@@ -53,6 +53,8 @@ CCL_NAMESPACE_BEGIN
 DeviceTypeMask BlenderSession::device_override = DEVICE_MASK_ALL;
 bool BlenderSession::headless = false;
 bool BlenderSession::print_render_stats = false;
+bool BlenderSession::use_memory_stats = false;
+string BlenderSession::memory_stats_filepath = "";
 
 BlenderSession::BlenderSession(BL::RenderEngine &b_engine,
                                BL::Preferences &b_userpref,
@@ -123,7 +125,7 @@ void BlenderSession::create_session()
 {
   const SessionParams session_params = BlenderSync::get_session_params(
       b_engine, b_userpref, b_scene, background);
-  const SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+  const SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
   const bool session_pause = BlenderSync::get_session_pause(b_scene, background);
 
   /* reset status/progress */
@@ -209,7 +211,7 @@ void BlenderSession::reset_session(BL::BlendData &b_data, BL::Depsgraph &b_depsg
 
   const SessionParams session_params = BlenderSync::get_session_params(
       b_engine, b_userpref, b_scene, background);
-  const SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+  const SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
 
   if (scene->params.modified(scene_params) || session->params.modified(session_params) ||
       !this->b_render.use_persistent_data()) {
@@ -290,6 +292,22 @@ static void add_cryptomatte_layer(BL::RenderResult &b_rr, string name, string ma
   render_add_metadata(b_rr, prefix + "manifest", manifest);
 }
 
+void BlenderSession::write_memory_statistics(MemoryStats &stats)
+{
+  memory_stats_json = stats.json_report();
+
+  if (!memory_stats_filepath.empty()) {
+    if (path_write_text(memory_stats_filepath, memory_stats_json)) {
+      VLOG(1) << "Memory statistics written to " << memory_stats_filepath;
+    }
+    else {
+      fprintf(stderr,
+              "Failed to write memory statistics to %s\n",
+              memory_stats_filepath.c_str());
+    }
+  }
+}
+
 void BlenderSession::stamp_view_layer_metadata(Scene *scene, const string &view_layer_name)
 {
   BL::RenderResult b_rr = b_engine.get_result();
@@ -441,10 +459,17 @@ void BlenderSession::render(BL::Depsgraph &b_depsgraph_)
     session->start();
     session->wait();
 
-    if (!b_engine.is_preview() && background && print_render_stats) {
+    const bool need_print_stats = background && print_render_stats;
+    if (!b_engine.is_preview() && (need_print_stats || use_memory_stats)) {
       RenderStats stats;
       session->collect_statistics(&stats);
-      printf("Render statistics:\n%s\n", stats.full_report().c_str());
+      if (use_memory_stats) {
+        session->collect_memory_statistics(&stats);
+        write_memory_statistics(stats.memory);
+      }
+      if (need_print_stats) {
+        printf("Render statistics:\n%s\n", stats.full_report().c_str());
+      }
     }
 
     if (session->progress.get_cancel())
@@ -600,9 +625,19 @@ void BlenderSession::bake(BL::Depsgraph &b_depsgraph_,
   scene->bake_manager->set(scene, b_object.name());
 
   /* Add render pass that we want to bake, and name it Combined so that it is
-   * used as that on the Blender side. */
-  Pass *pass = scene->create_node<Pass>();
-  pass->set_name(ustring("Combined"));
+   * used as that on the Blender side. The engine bakes multiple objects with the
+   * same session, in which case the pass from the previous object is reused. */
+  Pass *pass = nullptr;
+  foreach (Pass *scene_pass, scene->passes) {
+    if (scene_pass->get_name() == "Combined") {
+      pass = scene_pass;
+      break;
+    }
+  }
+  if (pass == nullptr) {
+    pass = scene->create_node<Pass>();
+    pass->set_name(ustring("Combined"));
+  }
   pass->set_type(bake_type_to_pass(bake_type, bake_filter));
   pass->set_include_albedo((bake_filter & BL::BakeSettings::pass_filter_COLOR));
 
@@ -662,7 +697,7 @@ void BlenderSession::synchronize(BL::Depsgraph &b_depsgraph_)
   /* on session/scene parameter changes, we recreate session entirely */
   const SessionParams session_params = BlenderSync::get_session_params(
       b_engine, b_userpref, b_scene, background);
-  const SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+  const SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
   const bool session_pause = BlenderSync::get_session_pause(b_scene, background);
 
   if (session->params.modified(session_params) || scene->params.modified(scene_params)) {
@@ -117,6 +117,9 @@ class BlenderSession {
 
   bool use_developer_ui;
 
+  /* Memory statistics of the last final render as JSON, when collecting them is enabled. */
+  string memory_stats_json;
+
   /* Global state which is common for all render sessions created from Blender.
    * Usually denotes command line arguments.
    */
@@ -130,9 +133,16 @@ class BlenderSession {
 
   static bool print_render_stats;
 
+  /* Collect memory statistics at the end of final renders, and write them to this file when it
+   * is not empty. */
+  static bool use_memory_stats;
+  static string memory_stats_filepath;
+
  protected:
   void stamp_view_layer_metadata(Scene *scene, const string &view_layer_name);
 
+  void write_memory_statistics(MemoryStats &stats);
+
   /* Check whether session error happened.
    * If so, it is reported to the render engine and true is returned.
    * Otherwise false is returned. */
@@ -72,6 +72,7 @@ BlenderSync::BlenderSync(BL::RenderEngine &b_engine,
       use_developer_ui(use_developer_ui),
       dicing_rate(1.0f),
       max_subdivisions(12),
+      dicing_reuse_tolerance(0.0f),
       progress(progress),
       has_updates_(true)
 {
@@ -79,6 +80,7 @@ BlenderSync::BlenderSync(BL::RenderEngine &b_engine,
   dicing_rate = preview ? RNA_float_get(&cscene, "preview_dicing_rate") :
                           RNA_float_get(&cscene, "dicing_rate");
   max_subdivisions = RNA_int_get(&cscene, "max_subdivisions");
+  dicing_reuse_tolerance = RNA_float_get(&cscene, "dicing_reuse_tolerance");
 }
 
 BlenderSync::~BlenderSync()
@@ -115,6 +117,9 @@ void BlenderSync::sync_recalc(BL::Depsgraph &b_depsgraph, BL::SpaceView3D &b_v3d
       dicing_prop_changed = true;
     }
 
+    /* Only affects the next tessellation, meshes do not need to be exported again. */
+    dicing_reuse_tolerance = RNA_float_get(&cscene, "dicing_reuse_tolerance");
+
     int updated_max_subdivisions = RNA_int_get(&cscene, "max_subdivisions");
 
     if (max_subdivisions != updated_max_subdivisions) {
@@ -309,6 +314,7 @@ void BlenderSync::sync_integrator(BL::ViewLayer &b_view_layer, bool background)
   float volume_step_rate = (preview) ? get_float(cscene, "volume_preview_step_rate") :
                                        get_float(cscene, "volume_step_rate");
   integrator->set_volume_step_rate(volume_step_rate);
+  integrator->set_volume_skip_empty(get_boolean(cscene, "volume_skip_empty"));
 
   integrator->set_caustics_reflective(get_boolean(cscene, "caustics_reflective"));
   integrator->set_caustics_refractive(get_boolean(cscene, "caustics_refractive"));
@@ -335,10 +341,15 @@ void BlenderSync::sync_integrator(BL::ViewLayer &b_view_layer, bool background)
   }
 
   integrator->set_light_sampling_threshold(get_float(cscene, "light_sampling_threshold"));
+  integrator->set_use_light_tree(get_boolean(cscene, "use_light_tree"));
+
+  integrator->set_use_guiding(get_boolean(cscene, "use_guiding"));
+  integrator->set_guiding_training_samples(get_int(cscene, "guiding_training_samples"));
 
   SamplingPattern sampling_pattern = (SamplingPattern)get_enum(
       cscene, "sampling_pattern", SAMPLING_NUM_PATTERNS, SAMPLING_PATTERN_SOBOL);
   integrator->set_sampling_pattern(sampling_pattern);
+  integrator->set_use_blue_noise(get_boolean(cscene, "use_blue_noise"));
 
   if (preview) {
     integrator->set_use_adaptive_sampling(
@@ -727,7 +738,9 @@ void BlenderSync::free_data_after_sync(BL::Depsgraph &b_depsgraph)
 
 /* Scene Parameters */
 
-SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
+SceneParams BlenderSync::get_scene_params(BL::BlendData &b_data,
+                                          BL::Scene &b_scene,
+                                          bool background)
 {
   SceneParams params;
   PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
@@ -751,6 +764,7 @@ SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
   params.hair_subdivisions = get_int(csscene, "subdivisions");
   params.hair_shape = (CurveShapeType)get_enum(
       csscene, "shape", CURVE_NUM_SHAPE_TYPES, CURVE_THICK);
+  params.use_quantized_curve_keys = get_boolean(csscene, "use_quantized_keys");
 
   int texture_limit;
   if (background) {
@@ -766,8 +780,17 @@ SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
     params.texture_limit = 0;
   }
 
+  params.texture_cache_size = get_int(cscene, "texture_cache_size");
+  params.texture_compression = (ImageCompression)get_enum(
+      cscene, "texture_compression", IMAGE_COMPRESSION_NUM_TYPES, IMAGE_COMPRESSION_NONE);
+
   params.bvh_layout = DebugFlags().cpu.bvh_layout;
 
+  BL::ID b_scene_id(b_scene);
+  params.bvh_cache_directory = blender_absolute_path(
+      b_data, b_scene_id, get_string(cscene, "bvh_cache_directory"));
+  params.bvh_cache_size = get_int(cscene, "bvh_cache_size");
+
   params.background = background;
 
   return params;
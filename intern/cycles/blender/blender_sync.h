@@ -94,7 +94,9 @@ class BlenderSync {
   }
 
   /* get parameters */
-  static SceneParams get_scene_params(BL::Scene &b_scene, bool background);
+  static SceneParams get_scene_params(BL::BlendData &b_data,
+                                      BL::Scene &b_scene,
+                                      bool background);
   static SessionParams get_session_params(BL::RenderEngine &b_engine,
                                           BL::Preferences &b_userpref,
                                           BL::Scene &b_scene,
@@ -237,6 +239,7 @@ class BlenderSync {
 
   float dicing_rate;
   int max_subdivisions;
+  float dicing_reuse_tolerance;
 
   struct RenderLayerInfo {
     RenderLayerInfo()
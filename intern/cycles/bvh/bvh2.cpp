@@ -16,6 +16,7 @@
  */
 
 #include "bvh/bvh2.h"
+#include "bvh/bvh_cache.h"
 
 #include "render/hair.h"
 #include "render/mesh.h"
@@ -27,6 +28,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_progress.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -39,6 +41,19 @@ int BVHStackEntry::encodeIdx() const
   return (node->is_leaf()) ? ~idx : idx;
 }
 
+static float bvh_node_area_sum(const BVHNode *node)
+{
+  if (node->is_leaf()) {
+    return 0.0f;
+  }
+
+  float area = node->bounds.half_area();
+  for (int i = 0; i < node->num_children(); i++) {
+    area += bvh_node_area_sum(node->get_child(i));
+  }
+  return area;
+}
+
 BVH2::BVH2(const BVHParams &params_,
            const vector<Geometry *> &geometry_,
            const vector<Object *> &objects_)
@@ -48,7 +63,17 @@ BVH2::BVH2(const BVHParams &params_,
 
 void BVH2::build(Progress &progress, Stats *)
 {
+  string cache_key;
+  if (params.cache) {
+    progress.set_substatus("Loading BVH from cache");
+    cache_key = params.cache->key(this);
+    if (params.cache->load(this, cache_key)) {
+      return;
+    }
+  }
+
   progress.set_substatus("Building BVH");
+  const double build_start = time_dt();
 
   /* build nodes */
   BVHBuild bvh_build(objects,
@@ -94,19 +119,34 @@ void BVH2::build(Progress &progress, Stats *)
   progress.set_substatus("Packing BVH nodes");
   pack_nodes(root);
 
+  const float root_area = root->bounds.half_area();
+  build_node_cost = (root_area > 0.0f) ? bvh_node_area_sum(root) / root_area : 0.0f;
+  node_cost = build_node_cost;
+
   /* free build nodes */
   root->deleteSubtree();
+
+  if (params.cache) {
+    params.cache->store(this, cache_key, time_dt() - build_start);
+  }
 }
 
 void BVH2::refit(Progress &progress)
 {
   progress.set_substatus("Packing BVH primitives");
-  pack_primitives();
+  if (params.top_level) {
+    /* Merged instance BVHs are left untouched, only primitives of the top level are updated. */
+    pack_primitives_visibility(num_top_level_prims);
+  }
+  else {
+    pack_primitives();
+  }
 
   if (progress.get_cancel())
     return;
 
   progress.set_substatus("Refitting BVH nodes");
+  node_cost = 0.0f;
   refit_nodes();
 }
 
@@ -315,11 +355,14 @@ void BVH2::pack_nodes(const BVHNode *root)
 
 void BVH2::refit_nodes()
 {
-  assert(!params.top_level);
-
+  /* For the top level BVH only its own nodes are refit, object leaves get the bounds of the
+   * object and nodes of instance BVHs are not visited. */
   BoundBox bbox = BoundBox::empty;
   uint visibility = 0;
   refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility);
+
+  const float root_area = bbox.half_area();
+  node_cost = (root_area > 0.0f) ? node_cost / root_area : 0.0f;
 }
 
 void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
@@ -331,7 +374,13 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     const int c0 = data[0].x;
     const int c1 = data[0].y;
 
-    refit_primitives(c0, c1, bbox, visibility);
+    if (c0 < 0) {
+      /* Object instance in the top level BVH. */
+      refit_primitives(~c0, ~c0 + 1, bbox, visibility);
+    }
+    else {
+      refit_primitives(c0, c1, bbox, visibility);
+    }
 
     /* TODO(sergey): De-duplicate with pack_leaf(). */
     float4 leaf_data[BVH_NODE_LEAF_SIZE];
@@ -367,6 +416,7 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     bbox.grow(bbox0);
     bbox.grow(bbox1);
     visibility = visibility0 | visibility1;
+    node_cost += bbox.half_area();
   }
 }
 
@@ -446,7 +496,12 @@ void BVH2::pack_primitives()
   pack.prim_visibility.clear();
   pack.prim_visibility.resize(tidx_size);
   /* Fill in all the arrays. */
-  for (unsigned int i = 0; i < tidx_size; i++) {
+  pack_primitives_visibility(tidx_size);
+}
+
+void BVH2::pack_primitives_visibility(size_t num_prims)
+{
+  for (unsigned int i = 0; i < num_prims; i++) {
     if (pack.prim_index[i] != -1) {
       int tob = pack.prim_object[i];
       Object *ob = objects[tob];
@@ -473,6 +528,7 @@ void BVH2::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 
   /* track offsets of instanced BVH data in global array */
   size_t prim_offset = pack.prim_index.size();
+  num_top_level_prims = prim_offset;
   size_t nodes_offset = nodes_size;
   size_t nodes_leaf_offset = leaf_nodes_size;
 
@@ -597,45 +653,59 @@ void BVH2::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
       }
     }
 
-    if (bvh->pack.nodes.size()) {
-      int4 *bvh_nodes = &bvh->pack.nodes[0];
-      size_t bvh_nodes_size = bvh->pack.nodes.size();
-
-      for (size_t i = 0, j = 0; i < bvh_nodes_size; j++) {
-        size_t nsize, nsize_bbox;
-        if (bvh_nodes[i].x & PATH_RAY_NODE_UNALIGNED) {
-          nsize = BVH_UNALIGNED_NODE_SIZE;
-          nsize_bbox = 0;
-        }
-        else {
-          nsize = BVH_NODE_SIZE;
-          nsize_bbox = 0;
-        }
+    pack_nodes_offset = pack_instance_nodes(
+        bvh, pack_nodes, pack_nodes_offset, noffset, noffset_leaf);
 
-        memcpy(pack_nodes + pack_nodes_offset, bvh_nodes + i, nsize_bbox * sizeof(int4));
+    nodes_offset += bvh->pack.nodes.size();
+    nodes_leaf_offset += bvh->pack.leaf_nodes.size();
+    prim_offset += bvh->pack.prim_index.size();
+  }
+}
 
-        /* Modify offsets into arrays */
-        int4 data = bvh_nodes[i + nsize_bbox];
-        data.z += (data.z < 0) ? -noffset_leaf : noffset;
-        data.w += (data.w < 0) ? -noffset_leaf : noffset;
-        pack_nodes[pack_nodes_offset + nsize_bbox] = data;
+size_t BVH2::pack_instance_nodes(const BVH2 *bvh,
+                                 int4 *pack_nodes,
+                                 size_t pack_nodes_offset,
+                                 int noffset,
+                                 int noffset_leaf)
+{
+  if (bvh->pack.nodes.size() == 0) {
+    return pack_nodes_offset;
+  }
 
-        /* Usually this copies nothing, but we better
-         * be prepared for possible node size extension.
-         */
-        memcpy(&pack_nodes[pack_nodes_offset + nsize_bbox + 1],
-               &bvh_nodes[i + nsize_bbox + 1],
-               sizeof(int4) * (nsize - (nsize_bbox + 1)));
+  const int4 *bvh_nodes = &bvh->pack.nodes[0];
+  size_t bvh_nodes_size = bvh->pack.nodes.size();
 
-        pack_nodes_offset += nsize;
-        i += nsize;
-      }
+  for (size_t i = 0, j = 0; i < bvh_nodes_size; j++) {
+    size_t nsize, nsize_bbox;
+    if (bvh_nodes[i].x & PATH_RAY_NODE_UNALIGNED) {
+      nsize = BVH_UNALIGNED_NODE_SIZE;
+      nsize_bbox = 0;
+    }
+    else {
+      nsize = BVH_NODE_SIZE;
+      nsize_bbox = 0;
     }
 
-    nodes_offset += bvh->pack.nodes.size();
-    nodes_leaf_offset += bvh->pack.leaf_nodes.size();
-    prim_offset += bvh->pack.prim_index.size();
+    memcpy(pack_nodes + pack_nodes_offset, bvh_nodes + i, nsize_bbox * sizeof(int4));
+
+    /* Modify offsets into arrays */
+    int4 data = bvh_nodes[i + nsize_bbox];
+    data.z += (data.z < 0) ? -noffset_leaf : noffset;
+    data.w += (data.w < 0) ? -noffset_leaf : noffset;
+    pack_nodes[pack_nodes_offset + nsize_bbox] = data;
+
+    /* Usually this copies nothing, but we better
+     * be prepared for possible node size extension.
+     */
+    memcpy(&pack_nodes[pack_nodes_offset + nsize_bbox + 1],
+           &bvh_nodes[i + nsize_bbox + 1],
+           sizeof(int4) * (nsize - (nsize_bbox + 1)));
+
+    pack_nodes_offset += nsize;
+    i += nsize;
   }
+
+  return pack_nodes_offset;
 }
 
 CCL_NAMESPACE_END
@@ -48,6 +48,18 @@ class BVH2 : public BVH {
   void build(Progress &progress, Stats *stats);
   void refit(Progress &progress);
 
+  /* Sum of the surface area of inner nodes relative to the root, as an estimate of traversal
+   * cost. Refitting increases it when primitives move away from where the tree was built for,
+   * so comparing it to the cost after the build tells when rebuilding is worth it. */
+  float get_node_cost() const
+  {
+    return node_cost;
+  }
+  float get_build_node_cost() const
+  {
+    return build_node_cost;
+  }
+
   PackedBVH pack;
 
  protected:
@@ -61,7 +73,7 @@ class BVH2 : public BVH {
   virtual BVHNode *widen_children_nodes(const BVHNode *root);
 
   /* pack */
-  void pack_nodes(const BVHNode *root);
+  virtual void pack_nodes(const BVHNode *root);
 
   void pack_leaf(const BVHStackEntry &e, const LeafNode *leaf);
   void pack_inner(const BVHStackEntry &e, const BVHStackEntry &e0, const BVHStackEntry &e1);
@@ -91,7 +103,7 @@ class BVH2 : public BVH {
                            uint visibility1);
 
   /* refit */
-  void refit_nodes();
+  virtual void refit_nodes();
   void refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility);
 
   /* Refit range of primitives. */
@@ -99,10 +111,28 @@ class BVH2 : public BVH {
 
   /* triangles and strands */
   void pack_primitives();
+  void pack_primitives_visibility(size_t num_prims);
   void pack_triangle(int idx, float4 storage[3]);
 
   /* merge instance BVH's */
   void pack_instances(size_t nodes_size, size_t leaf_nodes_size);
+
+  /* Copy inner nodes of an instance BVH into the top level arrays, offsetting child indices.
+   * Returns offset in the top level nodes array past the last copied node. */
+  virtual size_t pack_instance_nodes(const BVH2 *bvh,
+                                     int4 *pack_nodes,
+                                     size_t pack_nodes_offset,
+                                     int noffset,
+                                     int noffset_leaf);
+
+  /* Number of primitives of the top level BVH itself, the primitives of merged instance BVHs
+   * follow them in the packed arrays. */
+  size_t num_top_level_prims = 0;
+
+  float node_cost = 0.0f;
+  float build_node_cost = 0.0f;
+
+  friend class BVHCache;
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh4.h"
+
+#include "bvh/bvh_node.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+#include "util/util_string.h"
+
+CCL_NAMESPACE_BEGIN
+
+BVH4::BVH4(const BVHParams &params_,
+           const vector<Geometry *> &geometry_,
+           const vector<Object *> &objects_)
+    : BVH2(params_, geometry_, objects_)
+{
+  /* Quantized bounds are axis aligned, traversal of unaligned nodes is not supported. */
+  params.use_unaligned_nodes = false;
+}
+
+/* Building */
+
+static BVHNode *bvh4_widen_node_recursive(const BVHNode *node)
+{
+  if (node->is_leaf()) {
+    return new LeafNode(*reinterpret_cast<const LeafNode *>(node));
+  }
+
+  /* Collapse binary nodes into a node with up to four children, opening the child with the
+   * largest surface area first, since it is the most likely one to be traversed. */
+  const BVHNode *children[BVH4_NUM_CHILDREN];
+  int num_children = 0;
+  for (int i = 0; i < node->num_children(); ++i) {
+    children[num_children++] = node->get_child(i);
+  }
+
+  while (num_children < BVH4_NUM_CHILDREN) {
+    int best_child = -1;
+    float best_area = -FLT_MAX;
+    for (int i = 0; i < num_children; ++i) {
+      const BVHNode *child = children[i];
+      if (child->is_leaf() || num_children + child->num_children() - 1 > BVH4_NUM_CHILDREN) {
+        continue;
+      }
+      const float area = child->bounds.safe_area();
+      if (area > best_area) {
+        best_area = area;
+        best_child = i;
+      }
+    }
+    if (best_child == -1) {
+      break;
+    }
+
+    const BVHNode *opened = children[best_child];
+    children[best_child] = opened->get_child(0);
+    for (int i = 1; i < opened->num_children(); ++i) {
+      children[num_children++] = opened->get_child(i);
+    }
+  }
+
+  BVHNode *wide_children[BVH4_NUM_CHILDREN];
+  for (int i = 0; i < num_children; ++i) {
+    wide_children[i] = bvh4_widen_node_recursive(children[i]);
+  }
+
+  return new InnerNode(node->bounds, wide_children, num_children);
+}
+
+BVHNode *BVH4::widen_children_nodes(const BVHNode *root)
+{
+  if (root == NULL) {
+    return NULL;
+  }
+  return bvh4_widen_node_recursive(root);
+}
+
+/* Packing */
+
+/* Quantize child bounds relative to the quantization grid of the node. The result is always
+ * conservative: the dequantized bounds, computed the same way as the kernel does it, contain
+ * the original bounds. */
+static void bvh4_quantize_bounds(const float lower,
+                                 const float upper,
+                                 const float origin,
+                                 const float scale,
+                                 uint &r_lower,
+                                 uint &r_upper)
+{
+  if (scale == 0.0f) {
+    /* Flat node, all children are at the origin. */
+    r_lower = 0;
+    r_upper = 0;
+    return;
+  }
+
+  const float inv_scale = 1.0f / scale;
+  int q_lower = clamp((int)floorf((lower - origin) * inv_scale), 0, BVH4_QUANTIZATION_STEPS);
+  int q_upper = clamp((int)ceilf((upper - origin) * inv_scale), 0, BVH4_QUANTIZATION_STEPS);
+
+  while (q_lower > 0 && origin + (float)q_lower * scale > lower) {
+    --q_lower;
+  }
+  while (q_upper < BVH4_QUANTIZATION_STEPS && origin + (float)q_upper * scale < upper) {
+    ++q_upper;
+  }
+
+  r_lower = (uint)q_lower;
+  r_upper = (uint)q_upper;
+}
+
+void bvh4_pack_node_bounds(const BoundBox *bounds, const int num, int4 data[BVH4_NODE_SIZE])
+{
+  assert(num <= BVH4_NUM_CHILDREN);
+
+  BoundBox node_bounds = BoundBox::empty;
+  for (int i = 0; i < num; ++i) {
+    node_bounds.grow(bounds[i]);
+  }
+
+  /* Pad the quantization grid by a few ULPs of the node size and position, to stay
+   * conservative in the presence of rounding errors in the kernel, which may use FMA. */
+  const float3 size = node_bounds.size();
+  const float3 pad = (fabs(node_bounds.min) + fabs(node_bounds.max) + size) * (4.0f * FLT_EPSILON);
+  const float3 origin = node_bounds.min - pad;
+  const float3 extent = size + 2.0f * pad;
+  float3 scale = extent * (1.0f / BVH4_QUANTIZATION_STEPS);
+  scale = make_float3(nextafterf(scale.x, FLT_MAX),
+                      nextafterf(scale.y, FLT_MAX),
+                      nextafterf(scale.z, FLT_MAX));
+
+  uint q_lower[3] = {0, 0, 0}, q_upper[3] = {0, 0, 0};
+
+  for (int i = 0; i < num; ++i) {
+    for (int axis = 0; axis < 3; ++axis) {
+      uint lower, upper;
+      bvh4_quantize_bounds(
+          bounds[i].min[axis], bounds[i].max[axis], origin[axis], scale[axis], lower, upper);
+      q_lower[axis] |= lower << (8 * i);
+      q_upper[axis] |= upper << (8 * i);
+    }
+  }
+
+  data[2] = make_int4(
+      __float_as_int(origin.x), __float_as_int(origin.y), __float_as_int(origin.z), 0);
+  data[3] = make_int4(
+      __float_as_int(scale.x), __float_as_int(scale.y), __float_as_int(scale.z), 0);
+  data[4] = make_int4(q_lower[0], q_upper[0], q_lower[1], q_upper[1]);
+  data[5] = make_int4(q_lower[2], q_upper[2], 0, 0);
+}
+
+void BVH4::pack_node(int idx,
+                     const BoundBox *bounds,
+                     const int *child,
+                     const uint *visibility,
+                     const int num)
+{
+  assert(idx + BVH4_NODE_SIZE <= pack.nodes.size());
+  assert(num <= BVH4_NUM_CHILDREN);
+
+  int4 data[BVH4_NODE_SIZE];
+  memset(data, 0, sizeof(data));
+
+  for (int i = 0; i < num; ++i) {
+    data[0][i] = child[i];
+    data[1][i] = visibility[i] & ~PATH_RAY_NODE_UNALIGNED;
+  }
+
+  bvh4_pack_node_bounds(bounds, num, data);
+
+  memcpy(&pack.nodes[idx], data, sizeof(int4) * BVH4_NODE_SIZE);
+}
+
+void BVH4::pack_inner(const BVHStackEntry &e, const BVHStackEntry *en, int num)
+{
+  BoundBox bounds[BVH4_NUM_CHILDREN];
+  int child[BVH4_NUM_CHILDREN];
+  uint visibility[BVH4_NUM_CHILDREN];
+
+  for (int i = 0; i < num; ++i) {
+    bounds[i] = en[i].node->bounds;
+    child[i] = en[i].encodeIdx();
+    visibility[i] = en[i].node->visibility;
+  }
+
+  pack_node(e.idx, bounds, child, visibility, num);
+}
+
+void BVH4::pack_nodes(const BVHNode *root)
+{
+  const size_t num_nodes = root->getSubtreeSize(BVH_STAT_NODE_COUNT);
+  const size_t num_leaf_nodes = root->getSubtreeSize(BVH_STAT_LEAF_COUNT);
+  assert(num_leaf_nodes <= num_nodes);
+  const size_t num_inner_nodes = num_nodes - num_leaf_nodes;
+  const size_t node_size = num_inner_nodes * BVH4_NODE_SIZE;
+
+  /* Resize arrays */
+  pack.nodes.clear();
+  pack.leaf_nodes.clear();
+  /* For top level BVH, first merge existing BVH's so we know the offsets. */
+  if (params.top_level) {
+    pack_instances(node_size, num_leaf_nodes * BVH_NODE_LEAF_SIZE);
+  }
+  else {
+    pack.nodes.resize(node_size);
+    pack.leaf_nodes.resize(num_leaf_nodes * BVH_NODE_LEAF_SIZE);
+  }
+
+  int nextNodeIdx = 0, nextLeafNodeIdx = 0;
+
+  vector<BVHStackEntry> stack;
+  stack.reserve(BVHParams::MAX_DEPTH * BVH4_NUM_CHILDREN);
+  if (root->is_leaf()) {
+    stack.push_back(BVHStackEntry(root, nextLeafNodeIdx++));
+  }
+  else {
+    stack.push_back(BVHStackEntry(root, nextNodeIdx));
+    nextNodeIdx += BVH4_NODE_SIZE;
+  }
+
+  while (stack.size()) {
+    BVHStackEntry e = stack.back();
+    stack.pop_back();
+
+    if (e.node->is_leaf()) {
+      /* leaf node */
+      const LeafNode *leaf = reinterpret_cast<const LeafNode *>(e.node);
+      pack_leaf(e, leaf);
+    }
+    else {
+      /* inner node */
+      const int num_children = e.node->num_children();
+      BVHStackEntry children[BVH4_NUM_CHILDREN];
+      for (int i = 0; i < num_children; ++i) {
+        const BVHNode *child = e.node->get_child(i);
+        if (child->is_leaf()) {
+          children[i] = BVHStackEntry(child, nextLeafNodeIdx++);
+        }
+        else {
+          children[i] = BVHStackEntry(child, nextNodeIdx);
+          nextNodeIdx += BVH4_NODE_SIZE;
+        }
+        stack.push_back(children[i]);
+      }
+
+      pack_inner(e, children, num_children);
+    }
+  }
+  assert(node_size == nextNodeIdx);
+  /* root index to start traversal at, to handle case of single leaf node */
+  pack.root_index = (root->is_leaf()) ? -1 : 0;
+
+  VLOG(2) << "BVH4 packed " << num_inner_nodes << " inner nodes ("
+          << string_human_readable_size(node_size * sizeof(int4)) << ") and " << num_leaf_nodes
+          << " leaf nodes ("
+          << string_human_readable_size(num_leaf_nodes * BVH_NODE_LEAF_SIZE * sizeof(int4))
+          << "), binary BVH inner nodes would take "
+          << string_human_readable_size((num_leaf_nodes > 0 ? num_leaf_nodes - 1 : 0) *
+                                        BVH_NODE_SIZE * sizeof(int4))
+          << ".";
+}
+
+/* Refitting */
+
+void BVH4::refit_nodes()
+{
+  BoundBox bbox = BoundBox::empty;
+  uint visibility = 0;
+  refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility);
+
+  const float root_area = bbox.half_area();
+  node_cost = (root_area > 0.0f) ? node_cost / root_area : 0.0f;
+}
+
+void BVH4::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
+{
+  if (leaf) {
+    /* Leaf nodes are the same as in BVH2. */
+    BVH2::refit_node(idx, true, bbox, visibility);
+    return;
+  }
+
+  assert(idx + BVH4_NODE_SIZE <= pack.nodes.size());
+
+  const int4 data = pack.nodes[idx];
+  BoundBox child_bbox[BVH4_NUM_CHILDREN];
+  int child[BVH4_NUM_CHILDREN];
+  uint child_visibility[BVH4_NUM_CHILDREN];
+  int num_children = 0;
+
+  for (int i = 0; i < BVH4_NUM_CHILDREN; ++i) {
+    const int c = data[i];
+    /* Root is never a child, so zero address denotes unused child. */
+    if (c == 0) {
+      break;
+    }
+    child_bbox[num_children] = BoundBox::empty;
+    child_visibility[num_children] = 0;
+    refit_node((c < 0) ? -c - 1 : c,
+               (c < 0),
+               child_bbox[num_children],
+               child_visibility[num_children]);
+    child[num_children] = c;
+    ++num_children;
+  }
+
+  pack_node(idx, child_bbox, child, child_visibility, num_children);
+
+  for (int i = 0; i < num_children; ++i) {
+    bbox.grow(child_bbox[i]);
+    visibility |= child_visibility[i];
+  }
+  node_cost += bbox.half_area();
+}
+
+/* Statistics */
+
+size_t BVH4::binary_inner_nodes_size() const
+{
+  size_t num_binary_nodes = 0;
+  for (size_t i = 0; i < pack.nodes.size(); i += BVH4_NODE_SIZE) {
+    const int4 data = pack.nodes[i];
+    int num_children = 0;
+    for (int j = 0; j < BVH4_NUM_CHILDREN; ++j) {
+      num_children += (data[j] != 0) ? 1 : 0;
+    }
+    num_binary_nodes += max(num_children - 1, 0);
+  }
+  return num_binary_nodes * BVH_NODE_SIZE * sizeof(int4);
+}
+
+/* Pack Instances */
+
+size_t BVH4::pack_instance_nodes(const BVH2 *bvh,
+                                 int4 *pack_nodes,
+                                 size_t pack_nodes_offset,
+                                 int noffset,
+                                 int noffset_leaf)
+{
+  const size_t bvh_nodes_size = bvh->pack.nodes.size();
+  if (bvh_nodes_size == 0) {
+    return pack_nodes_offset;
+  }
+
+  const int4 *bvh_nodes = &bvh->pack.nodes[0];
+
+  for (size_t i = 0; i < bvh_nodes_size; i += BVH4_NODE_SIZE) {
+    /* Modify offsets into arrays, keeping unused children at zero. */
+    int4 data = bvh_nodes[i];
+    for (int j = 0; j < BVH4_NUM_CHILDREN; ++j) {
+      if (data[j] != 0) {
+        data[j] += (data[j] < 0) ? -noffset_leaf : noffset;
+      }
+    }
+    pack_nodes[pack_nodes_offset] = data;
+
+    memcpy(&pack_nodes[pack_nodes_offset + 1],
+           &bvh_nodes[i + 1],
+           sizeof(int4) * (BVH4_NODE_SIZE - 1));
+
+    pack_nodes_offset += BVH4_NODE_SIZE;
+  }
+
+  return pack_nodes_offset;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BVH4_H__
+#define __BVH4_H__
+
+#include "bvh/bvh2.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Size of inner node in number of int4. Leaf nodes are shared with BVH2. */
+#define BVH4_NODE_SIZE 6
+#define BVH4_NUM_CHILDREN 4
+
+/* Number of quantization steps of the child bounds, per axis. */
+#define BVH4_QUANTIZATION_STEPS 255
+
+/* Pack quantized bounds of up to four children into entries 2 to 5 of the node data. The
+ * dequantized bounds contain the given bounds. */
+void bvh4_pack_node_bounds(const BoundBox *bounds, const int num, int4 data[BVH4_NODE_SIZE]);
+
+/* BVH4
+ *
+ * BVH with up to four children per node, collapsed from the binary BVH produced by BVHBuild.
+ * Child bounds are stored as 8 bit offsets relative to the bounds of the node, so a node with
+ * four children takes 96 bytes, which is half the size of three BVH2 nodes with the same
+ * children. Leaf nodes, primitive arrays and instancing are the same as in BVH2.
+ *
+ * Inner node layout:
+ *
+ *   [0]: Child node addresses, 0 for unused children.
+ *   [1]: Child visibility flags, 0 for unused children.
+ *   [2]: Origin of the quantization grid (xyz).
+ *   [3]: Size of the quantization step (xyz).
+ *   [4]: Quantized lower X, upper X, lower Y, upper Y. One byte per child.
+ *   [5]: Quantized lower Z, upper Z. One byte per child.
+ *
+ * Only aligned nodes are supported, and only the CPU kernel implements traversal of this
+ * layout. */
+class BVH4 : public BVH2 {
+ public:
+  /* Size the inner nodes would take in the BVH2 layout. Every node with N children replaces
+   * N - 1 binary nodes. */
+  size_t binary_inner_nodes_size() const;
+
+ protected:
+  /* constructor */
+  friend class BVH;
+  BVH4(const BVHParams &params,
+       const vector<Geometry *> &geometry,
+       const vector<Object *> &objects);
+
+  /* Building process. */
+  virtual BVHNode *widen_children_nodes(const BVHNode *root) override;
+
+  /* pack */
+  virtual void pack_nodes(const BVHNode *root) override;
+
+  void pack_inner(const BVHStackEntry &e, const BVHStackEntry *en, int num);
+  void pack_node(int idx,
+                 const BoundBox *bounds,
+                 const int *child,
+                 const uint *visibility,
+                 const int num);
+
+  /* refit */
+  virtual void refit_nodes() override;
+  void refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility);
+
+  /* merge instance BVH's */
+  virtual size_t pack_instance_nodes(const BVH2 *bvh,
+                                     int4 *pack_nodes,
+                                     size_t pack_nodes_offset,
+                                     int noffset,
+                                     int noffset_leaf) override;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __BVH4_H__ */
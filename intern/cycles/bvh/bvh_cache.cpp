@@ -0,0 +1,520 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh_cache.h"
+#include "bvh/bvh2.h"
+#include "bvh/bvh4.h"
+
+#include "render/hair.h"
+#include "render/mesh.h"
+#include "render/object.h"
+#include "render/stats.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_map.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+#include "util/util_time.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Increment when the packed BVH layout or the hashed build inputs change. */
+#define BVH_CACHE_VERSION 1
+
+static const char BVH_CACHE_MAGIC[8] = {'C', 'Y', 'C', 'L', 'B', 'V', 'H', '2'};
+
+struct BVHCacheHeader {
+  char magic[8];
+  int version;
+  int root_index;
+  float node_cost;
+  float build_node_cost;
+  double build_time;
+  uint64_t num_top_level_prims;
+
+  uint64_t num_nodes;
+  uint64_t num_leaf_nodes;
+  uint64_t num_object_node;
+  uint64_t num_prim_type;
+  uint64_t num_prim_visibility;
+  uint64_t num_prim_index;
+  uint64_t num_prim_object;
+  uint64_t num_prim_time;
+};
+
+/* Hashing */
+
+static void hash_append_data(MD5Hash &md5, const void *data, size_t size)
+{
+  /* Append large arrays in chunks, as MD5Hash takes the size as int. */
+  const uint8_t *bytes = (const uint8_t *)data;
+  while (size > 0) {
+    const size_t chunk_size = min(size, (size_t)(1 << 30));
+    md5.append(bytes, (int)chunk_size);
+    bytes += chunk_size;
+    size -= chunk_size;
+  }
+}
+
+template<typename T> static void hash_append(MD5Hash &md5, const T &value)
+{
+  hash_append_data(md5, &value, sizeof(value));
+}
+
+template<typename T> static void hash_append_array(MD5Hash &md5, const array<T> &data)
+{
+  hash_append(md5, data.size());
+  hash_append_data(md5, data.data(), sizeof(T) * data.size());
+}
+
+static void hash_append_float3(MD5Hash &md5, const float3 *data, size_t size)
+{
+  /* Only the xyz components, the padding is not guaranteed to be initialized. */
+  const size_t chunk_size = 1024;
+  float chunk[chunk_size * 3];
+
+  hash_append(md5, size);
+  for (size_t start = 0; start < size; start += chunk_size) {
+    const size_t num = min(chunk_size, size - start);
+    for (size_t i = 0; i < num; i++) {
+      chunk[i * 3 + 0] = data[start + i].x;
+      chunk[i * 3 + 1] = data[start + i].y;
+      chunk[i * 3 + 2] = data[start + i].z;
+    }
+    hash_append_data(md5, chunk, sizeof(float) * 3 * num);
+  }
+}
+
+static void hash_append_pack(MD5Hash &md5, const PackedBVH &pack)
+{
+  hash_append(md5, pack.root_index);
+  hash_append_array(md5, pack.nodes);
+  hash_append_array(md5, pack.leaf_nodes);
+  hash_append_array(md5, pack.object_node);
+  hash_append_array(md5, pack.prim_type);
+  hash_append_array(md5, pack.prim_visibility);
+  hash_append_array(md5, pack.prim_index);
+  hash_append_array(md5, pack.prim_object);
+  hash_append_array(md5, pack.prim_time);
+}
+
+static void hash_append_geometry(MD5Hash &md5, const Geometry *geom)
+{
+  hash_append(md5, (int)geom->primitive_type());
+  hash_append(md5, geom->get_motion_steps());
+
+  if (geom->geometry_type == Geometry::MESH || geom->geometry_type == Geometry::VOLUME) {
+    const Mesh *mesh = static_cast<const Mesh *>(geom);
+    hash_append_float3(md5, mesh->get_verts().data(), mesh->get_verts().size());
+    hash_append_array(md5, mesh->get_triangles());
+  }
+  else if (geom->geometry_type == Geometry::HAIR) {
+    const Hair *hair = static_cast<const Hair *>(geom);
+    hash_append_float3(md5, hair->get_curve_keys().data(), hair->get_curve_keys().size());
+    hash_append_array(md5, hair->get_curve_radius());
+    hash_append_array(md5, hair->get_curve_first_key());
+  }
+
+  const Attribute *attr_mP = (geom->has_motion_blur()) ?
+                                 geom->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION) :
+                                 NULL;
+  if (attr_mP) {
+    hash_append_float3(md5, attr_mP->data_float3(), attr_mP->buffer.size() / sizeof(float3));
+  }
+  else {
+    hash_append(md5, (size_t)0);
+  }
+}
+
+/* BVH Cache */
+
+BVHCache::BVHCache() : max_size_(0), hits_(0), misses_(0), time_saved_(0.0)
+{
+}
+
+void BVHCache::set_directory(const string &directory, const size_t max_size)
+{
+  directory_ = directory;
+  max_size_ = max_size;
+}
+
+string BVHCache::filepath(const string &key) const
+{
+  return path_join(directory_, key + ".bvh");
+}
+
+string BVHCache::key(const BVH2 *bvh) const
+{
+  const BVHParams &params = bvh->params;
+  MD5Hash md5;
+
+  hash_append(md5, BVH_CACHE_VERSION);
+  hash_append(md5, params.use_spatial_split);
+  hash_append(md5, params.spatial_split_alpha);
+  hash_append(md5, params.unaligned_split_threshold);
+  hash_append(md5, params.sah_node_cost);
+  hash_append(md5, params.sah_primitive_cost);
+  hash_append(md5, params.min_leaf_size);
+  hash_append(md5, params.max_triangle_leaf_size);
+  hash_append(md5, params.max_motion_triangle_leaf_size);
+  hash_append(md5, params.max_curve_leaf_size);
+  hash_append(md5, params.max_motion_curve_leaf_size);
+  hash_append(md5, params.top_level);
+  hash_append(md5, (int)params.bvh_layout);
+  hash_append(md5, params.use_unaligned_nodes);
+  hash_append(md5, params.num_motion_curve_steps);
+  hash_append(md5, params.num_motion_triangle_steps);
+  hash_append(md5, params.bvh_type);
+  hash_append(md5, params.curve_subdivisions);
+
+  unordered_map<const Geometry *, int> geometry_index;
+  hash_append(md5, bvh->geometry.size());
+  foreach (const Geometry *geom, bvh->geometry) {
+    const int index = geometry_index.size();
+    geometry_index[geom] = index;
+
+    hash_append(md5, (int)geom->geometry_type);
+    hash_append(md5, geom->is_instanced());
+
+    if (params.top_level) {
+      hash_append(md5, geom->prim_offset);
+
+      /* Instance BVHs are copied into the packed arrays of the scene BVH. */
+      if (geom->need_build_bvh(params.bvh_layout)) {
+        const BVH2 *instance_bvh = static_cast<const BVH2 *>(geom->bvh);
+        if (instance_bvh) {
+          hash_append_pack(md5, instance_bvh->pack);
+        }
+        continue;
+      }
+    }
+
+    hash_append_geometry(md5, geom);
+  }
+
+  hash_append(md5, bvh->objects.size());
+  foreach (const Object *ob, bvh->objects) {
+    unordered_map<const Geometry *, int>::const_iterator it = geometry_index.find(
+        ob->get_geometry());
+    hash_append(md5, (it != geometry_index.end()) ? it->second : -1);
+    hash_append(md5, ob->is_traceable());
+    hash_append(md5, ob->visibility_for_tracing());
+    hash_append_float3(md5, &ob->bounds.min, 1);
+    hash_append_float3(md5, &ob->bounds.max, 1);
+  }
+
+  return md5.get_hex();
+}
+
+/* Reading and Writing */
+
+template<typename T> static bool write_array(FILE *f, const array<T> &data)
+{
+  return data.size() == 0 || fwrite(data.data(), sizeof(T), data.size(), f) == data.size();
+}
+
+template<typename T> static bool read_array(FILE *f, array<T> &data, const uint64_t size)
+{
+  data.resize(size);
+  return size == 0 || fread(data.data(), sizeof(T), size, f) == size;
+}
+
+/* Validation
+ *
+ * Cache files may be truncated, corrupt or written by another build, so everything the kernel
+ * uses to index memory is checked before the arrays are used. */
+
+static size_t geometry_num_primitives(const Geometry *geom)
+{
+  if (geom->geometry_type == Geometry::MESH || geom->geometry_type == Geometry::VOLUME) {
+    return static_cast<const Mesh *>(geom)->num_triangles();
+  }
+  if (geom->geometry_type == Geometry::HAIR) {
+    return static_cast<const Hair *>(geom)->num_curves();
+  }
+  return 0;
+}
+
+/* Add the size of an array to the expected file size, failing when it can not fit in the file. */
+static bool add_array_size(uint64_t &total_size,
+                           const uint64_t num_elements,
+                           const size_t element_size,
+                           const size_t file_size)
+{
+  if (num_elements > (file_size - total_size) / element_size) {
+    return false;
+  }
+  total_size += num_elements * element_size;
+  return true;
+}
+
+/* Check the counts of the header against each other, the scene and the file size, before any
+ * memory is allocated for the arrays. */
+static bool header_is_valid(const BVH2 *bvh, const BVHCacheHeader &header, const size_t file_size)
+{
+  const uint64_t num_prims = header.num_prim_index;
+  if (header.num_prim_type != num_prims || header.num_prim_visibility != num_prims ||
+      header.num_prim_object != num_prims ||
+      (header.num_prim_time != 0 && header.num_prim_time != num_prims) ||
+      header.num_top_level_prims > num_prims) {
+    return false;
+  }
+
+  const uint64_t num_objects = (bvh->params.top_level) ? bvh->objects.size() : 0;
+  if (header.num_object_node != num_objects) {
+    return false;
+  }
+
+  if (header.num_leaf_nodes % BVH_NODE_LEAF_SIZE != 0 ||
+      !((header.root_index == 0 && header.num_nodes > 0) ||
+        (header.root_index == -1 && header.num_leaf_nodes > 0))) {
+    return false;
+  }
+
+  uint64_t total_size = sizeof(header);
+  return file_size >= total_size &&
+         add_array_size(total_size, header.num_nodes, sizeof(int4), file_size) &&
+         add_array_size(total_size, header.num_leaf_nodes, sizeof(int4), file_size) &&
+         add_array_size(total_size, header.num_object_node, sizeof(int), file_size) &&
+         add_array_size(total_size, header.num_prim_type, sizeof(int), file_size) &&
+         add_array_size(total_size, header.num_prim_visibility, sizeof(uint), file_size) &&
+         add_array_size(total_size, header.num_prim_index, sizeof(int), file_size) &&
+         add_array_size(total_size, header.num_prim_object, sizeof(int), file_size) &&
+         add_array_size(total_size, header.num_prim_time, sizeof(float2), file_size) &&
+         total_size == file_size;
+}
+
+/* Check that all node, leaf, primitive and object indices stored in the arrays are in range. */
+static bool pack_is_valid(const BVH2 *bvh, const PackedBVH &pack)
+{
+  const size_t num_nodes = pack.nodes.size();
+  const size_t num_leaves = pack.leaf_nodes.size() / BVH_NODE_LEAF_SIZE;
+  const size_t num_prims = pack.prim_index.size();
+  const size_t num_objects = max(bvh->objects.size(), (size_t)1);
+  const bool is_bvh4 = (bvh->params.bvh_layout == BVH_LAYOUT_BVH4);
+
+  /* Inner nodes are stored one after the other. BVH2 node sizes depend on the alignment. */
+  vector<bool> is_node_start(num_nodes, false);
+  size_t node_index = 0;
+  while (node_index < num_nodes) {
+    is_node_start[node_index] = true;
+    if (is_bvh4) {
+      node_index += BVH4_NODE_SIZE;
+    }
+    else {
+      node_index += (pack.nodes[node_index].x & PATH_RAY_NODE_UNALIGNED) ?
+                        BVH_UNALIGNED_NODE_SIZE :
+                        BVH_NODE_SIZE;
+    }
+  }
+  if (node_index != num_nodes) {
+    return false;
+  }
+
+  auto is_valid_child = [&](const int child) {
+    return (child >= 0) ? ((size_t)child < num_nodes && is_node_start[child]) :
+                          ((size_t)~child < num_leaves);
+  };
+
+  for (size_t i = 0; i < num_nodes; i++) {
+    if (!is_node_start[i]) {
+      continue;
+    }
+    if (is_bvh4) {
+      /* Unused children are zero, the root is never a child. */
+      for (int j = 0; j < BVH4_NUM_CHILDREN; j++) {
+        if (pack.nodes[i][j] != 0 && !is_valid_child(pack.nodes[i][j])) {
+          return false;
+        }
+      }
+    }
+    else if (!is_valid_child(pack.nodes[i].z) || !is_valid_child(pack.nodes[i].w)) {
+      return false;
+    }
+  }
+
+  /* Objects without a BVH of their own point to node 0, which is never traversed for them. */
+  for (const int object_node : pack.object_node) {
+    if (object_node != 0 && !is_valid_child(object_node)) {
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < num_leaves; i++) {
+    const int4 &leaf = pack.leaf_nodes[i * BVH_NODE_LEAF_SIZE];
+    if (leaf.x < 0) {
+      /* Object leaf, referencing the primitive that stores the object index. */
+      if ((size_t)~leaf.x >= num_prims) {
+        return false;
+      }
+    }
+    else if (leaf.y < leaf.x || (size_t)leaf.y > num_prims) {
+      return false;
+    }
+  }
+
+  /* Primitive indices of the top level BVH include the offset of their geometry. */
+  size_t max_prim_index = 0;
+  foreach (const Geometry *geom, bvh->geometry) {
+    const size_t prim_offset = (bvh->params.top_level) ? geom->prim_offset : 0;
+    max_prim_index = max(max_prim_index, prim_offset + geometry_num_primitives(geom));
+  }
+
+  for (size_t i = 0; i < num_prims; i++) {
+    const int prim_index = pack.prim_index[i];
+    const int prim_object = pack.prim_object[i];
+    if ((prim_index != -1 && (prim_index < 0 || (size_t)prim_index >= max_prim_index)) ||
+        prim_object < 0 || (size_t)prim_object >= num_objects) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool BVHCache::load(BVH2 *bvh, const string &key)
+{
+  const double load_start = time_dt();
+  PackedBVH &pack = bvh->pack;
+
+  BVHCacheHeader header;
+  FILE *f = path_fopen(filepath(key), "rb");
+  bool success = f && fread(&header, sizeof(header), 1, f) == 1 &&
+                 memcmp(header.magic, BVH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == BVH_CACHE_VERSION &&
+                 header_is_valid(bvh, header, path_file_size(filepath(key)));
+
+  success = success && read_array(f, pack.nodes, header.num_nodes) &&
+            read_array(f, pack.leaf_nodes, header.num_leaf_nodes) &&
+            read_array(f, pack.object_node, header.num_object_node) &&
+            read_array(f, pack.prim_type, header.num_prim_type) &&
+            read_array(f, pack.prim_visibility, header.num_prim_visibility) &&
+            read_array(f, pack.prim_index, header.num_prim_index) &&
+            read_array(f, pack.prim_object, header.num_prim_object) &&
+            read_array(f, pack.prim_time, header.num_prim_time) && pack_is_valid(bvh, pack);
+
+  if (f) {
+    fclose(f);
+  }
+
+  if (success) {
+    /* Mark as recently used, so it is removed last when the cache exceeds its size. */
+    path_touch(filepath(key));
+  }
+
+  thread_scoped_lock lock(mutex_);
+
+  if (!success) {
+    /* Leave no partially read data for the build. */
+    pack = PackedBVH();
+    misses_++;
+    return false;
+  }
+
+  pack.root_index = header.root_index;
+  bvh->num_top_level_prims = header.num_top_level_prims;
+  bvh->node_cost = header.node_cost;
+  bvh->build_node_cost = header.build_node_cost;
+
+  const double load_time = time_dt() - load_start;
+  hits_++;
+  time_saved_ += max(header.build_time - load_time, 0.0);
+
+  VLOG(2) << "Loaded BVH " << key << " from cache in " << load_time << " seconds, building took "
+          << header.build_time << " seconds.";
+
+  return true;
+}
+
+void BVHCache::store(const BVH2 *bvh, const string &key, const double build_time)
+{
+  const PackedBVH &pack = bvh->pack;
+
+  BVHCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BVH_CACHE_MAGIC, sizeof(header.magic));
+  header.version = BVH_CACHE_VERSION;
+  header.root_index = pack.root_index;
+  header.node_cost = bvh->node_cost;
+  header.build_node_cost = bvh->build_node_cost;
+  header.build_time = build_time;
+  header.num_top_level_prims = bvh->num_top_level_prims;
+  header.num_nodes = pack.nodes.size();
+  header.num_leaf_nodes = pack.leaf_nodes.size();
+  header.num_object_node = pack.object_node.size();
+  header.num_prim_type = pack.prim_type.size();
+  header.num_prim_visibility = pack.prim_visibility.size();
+  header.num_prim_index = pack.prim_index.size();
+  header.num_prim_object = pack.prim_object.size();
+  header.num_prim_time = pack.prim_time.size();
+
+  /* Write to a temporary file first, so that other processes sharing the cache directory never
+   * read a partially written file. */
+  const string path = filepath(key);
+  const string temp_path = string_printf(
+      "%s.%llx.tmp", path.c_str(), (unsigned long long)(time_dt() * 1e9) ^ (uintptr_t)bvh);
+
+  path_create_directories(path);
+  FILE *f = path_fopen(temp_path, "wb");
+  if (!f) {
+    VLOG(1) << "Failed to write BVH cache file " << temp_path << ".";
+    return;
+  }
+
+  bool success = fwrite(&header, sizeof(header), 1, f) == 1 && write_array(f, pack.nodes) &&
+                 write_array(f, pack.leaf_nodes) && write_array(f, pack.object_node) &&
+                 write_array(f, pack.prim_type) && write_array(f, pack.prim_visibility) &&
+                 write_array(f, pack.prim_index) && write_array(f, pack.prim_object) &&
+                 write_array(f, pack.prim_time);
+  success = (fclose(f) == 0) && success;
+
+  /* Renaming fails when another process stored the same BVH in the meantime, which is fine. */
+  if (!success || !path_rename(temp_path, path)) {
+    path_remove(temp_path);
+    return;
+  }
+
+  remove_least_recently_used();
+}
+
+void BVHCache::remove_least_recently_used()
+{
+  if (max_size_ == 0) {
+    return;
+  }
+
+  /* Scanning the directory once is enough when multiple BVHs are stored at the same time. */
+  thread_scoped_lock lock(remove_mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return;
+  }
+
+  path_remove_least_recently_modified(directory_, ".bvh", max_size_);
+}
+
+void BVHCache::collect_statistics(MeshStats *stats)
+{
+  thread_scoped_lock lock(mutex_);
+
+  stats->use_bvh_cache = true;
+  stats->bvh_cache_hits = hits_;
+  stats->bvh_cache_misses = misses_;
+  stats->bvh_cache_time_saved = time_saved_;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BVH_CACHE_H__
+#define __BVH_CACHE_H__
+
+#include "util/util_string.h"
+#include "util/util_thread.h"
+#include "util/util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+class BVH2;
+class MeshStats;
+
+/* BVH Cache
+ *
+ * On-disk cache of packed BVH2 arrays, keyed by a hash of everything the build reads: the BVH
+ * parameters, primitives of the geometry and objects, and packed arrays of instance BVHs. A
+ * re-render of the same scene, or another frame of a static set rendered on any machine that
+ * shares the cache directory, loads the arrays instead of building the BVH again.
+ *
+ * The total size of the files in the directory is kept below a limit, by removing the least
+ * recently used files after storing a new one. Files are marked as used by updating their
+ * modification time when they are loaded, so static sets loaded in every frame are kept.
+ *
+ * Safe to use from multiple threads, as object BVHs are built in parallel. */
+class BVHCache {
+ public:
+  BVHCache();
+
+  /* Directory to store cached BVHs in, empty to disable the cache. A max_size of zero does not
+   * limit the size of the directory. */
+  void set_directory(const string &directory, const size_t max_size);
+  bool enabled() const
+  {
+    return !directory_.empty();
+  }
+
+  /* Hash of the build inputs of the BVH. */
+  string key(const BVH2 *bvh) const;
+
+  /* Load packed arrays of a BVH with the given key. Returns false when it is not cached. */
+  bool load(BVH2 *bvh, const string &key);
+
+  /* Store packed arrays of a BVH which took build_time seconds to build. */
+  void store(const BVH2 *bvh, const string &key, const double build_time);
+
+  void collect_statistics(MeshStats *stats);
+
+ protected:
+  string filepath(const string &key) const;
+  void remove_least_recently_used();
+
+  string directory_;
+  size_t max_size_;
+  thread_mutex remove_mutex_;
+
+  thread_mutex mutex_;
+  uint64_t hits_;
+  uint64_t misses_;
+  double time_saved_;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __BVH_CACHE_H__ */
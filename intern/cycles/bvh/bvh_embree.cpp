@@ -396,6 +396,16 @@ void BVHEmbree::add_object(Object *ob, int i)
 }
 
 void BVHEmbree::add_instance(Object *ob, int i)
+{
+  RTCGeometry geom_id = rtcNewGeometry(rtc_device, RTC_GEOMETRY_TYPE_INSTANCE);
+  set_instance(geom_id, ob);
+
+  rtcCommitGeometry(geom_id);
+  rtcAttachGeometryByID(scene, geom_id, i * 2);
+  rtcReleaseGeometry(geom_id);
+}
+
+void BVHEmbree::set_instance(RTCGeometry geom_id, const Object *ob)
 {
   BVHEmbree *instance_bvh = (BVHEmbree *)(ob->get_geometry()->bvh);
   assert(instance_bvh != NULL);
@@ -404,7 +414,6 @@ void BVHEmbree::add_instance(Object *ob, int i)
   const size_t num_motion_steps = min(num_object_motion_steps, RTC_MAX_TIME_STEP_COUNT);
   assert(num_object_motion_steps <= RTC_MAX_TIME_STEP_COUNT);
 
-  RTCGeometry geom_id = rtcNewGeometry(rtc_device, RTC_GEOMETRY_TYPE_INSTANCE);
   rtcSetGeometryInstancedScene(geom_id, instance_bvh->scene);
   rtcSetGeometryTimeStepCount(geom_id, num_motion_steps);
 
@@ -432,10 +441,6 @@ void BVHEmbree::add_instance(Object *ob, int i)
 
   rtcSetGeometryUserData(geom_id, (void *)instance_bvh->scene);
   rtcSetGeometryMask(geom_id, ob->visibility_for_tracing());
-
-  rtcCommitGeometry(geom_id);
-  rtcAttachGeometryByID(scene, geom_id, i * 2);
-  rtcReleaseGeometry(geom_id);
 }
 
 void BVHEmbree::add_triangles(const Object *ob, const Mesh *mesh, int i)
@@ -675,10 +680,18 @@ void BVHEmbree::refit(Progress &progress)
 {
   progress.set_substatus("Refitting BVH nodes");
 
-  /* Update all vertex buffers, then tell Embree to rebuild/-fit the BVHs. */
+  /* Update all vertex buffers and instance transforms, then tell Embree to rebuild/-fit the
+   * BVHs. For the top level this relies on the caller to only refit when the same objects with
+   * the same number of primitives are traced. */
   unsigned geom_id = 0;
   foreach (Object *ob, objects) {
-    if (!params.top_level || (ob->is_traceable() && !ob->get_geometry()->is_instanced())) {
+    if (params.top_level && ob->is_traceable() && ob->get_geometry()->is_instanced()) {
+      /* The instanced scene may have been rebuilt, so set it again along with the transform. */
+      RTCGeometry geom = rtcGetGeometry(scene, geom_id);
+      set_instance(geom, ob);
+      rtcCommitGeometry(geom);
+    }
+    else if (!params.top_level || ob->is_traceable()) {
       Geometry *geom = ob->get_geometry();
 
       if (geom->geometry_type == Geometry::MESH || geom->geometry_type == Geometry::VOLUME) {
@@ -687,6 +700,7 @@ void BVHEmbree::refit(Progress &progress)
           RTCGeometry geom = rtcGetGeometry(scene, geom_id);
           set_tri_vertex_buffer(geom, mesh, true);
           rtcSetGeometryUserData(geom, (void *)mesh->prim_offset);
+          rtcSetGeometryMask(geom, ob->visibility_for_tracing());
           rtcCommitGeometry(geom);
         }
       }
@@ -696,6 +710,7 @@ void BVHEmbree::refit(Progress &progress)
           RTCGeometry geom = rtcGetGeometry(scene, geom_id + 1);
           set_curve_vertex_buffer(geom, hair, true);
           rtcSetGeometryUserData(geom, (void *)hair->curve_segment_offset);
+          rtcSetGeometryMask(geom, ob->visibility_for_tracing());
           rtcCommitGeometry(geom);
         }
       }
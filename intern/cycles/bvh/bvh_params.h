@@ -24,6 +24,8 @@
 
 CCL_NAMESPACE_BEGIN
 
+class BVHCache;
+
 /* Layout of BVH tree.
  *
  * For example, how wide BVH tree is, in terms of number of children
@@ -112,6 +114,9 @@ class BVHParams {
   /* These are needed for Embree. */
   int curve_subdivisions;
 
+  /* On-disk cache of built BVHs, or NULL. Only used for the BVH2 layout. */
+  BVHCache *cache;
+
   /* fixed parameters */
   enum { MAX_DEPTH = 64, MAX_SPATIAL_DEPTH = 48, NUM_SPATIAL_BINS = 32 };
 
@@ -143,6 +148,8 @@ class BVHParams {
     bvh_type = 0;
 
     curve_subdivisions = 4;
+
+    cache = NULL;
   }
 
   /* SAH costs */
@@ -100,7 +100,7 @@ bool CPUDevice::show_samples() const
 
 BVHLayoutMask CPUDevice::get_bvh_layout_mask() const
 {
-  BVHLayoutMask bvh_layout_mask = BVH_LAYOUT_BVH2;
+  BVHLayoutMask bvh_layout_mask = BVH_LAYOUT_BVH2 | BVH_LAYOUT_BVH4;
 #ifdef WITH_EMBREE
   bvh_layout_mask |= BVH_LAYOUT_EMBREE;
 #endif /* WITH_EMBREE */
@@ -168,6 +168,15 @@ void CPUDevice::mem_copy_to(device_memory &mem)
   }
 }
 
+void CPUDevice::mem_copy_to(device_memory &mem, size_t /*offset*/, size_t /*size*/)
+{
+  if (!mem.device_pointer || mem.type == MEM_TEXTURE) {
+    mem_copy_to(mem);
+  }
+
+  /* Device memory is the host memory, copy is no-op. */
+}
+
 void CPUDevice::mem_copy_from(
     device_memory & /*mem*/, size_t /*y*/, size_t /*w*/, size_t /*h*/, size_t /*elem*/)
 {
@@ -72,6 +72,7 @@ class CPUDevice : public Device {
 
   virtual void mem_alloc(device_memory &mem) override;
   virtual void mem_copy_to(device_memory &mem) override;
+  virtual void mem_copy_to(device_memory &mem, size_t offset, size_t size) override;
   virtual void mem_copy_from(
       device_memory &mem, size_t y, size_t w, size_t h, size_t elem) override;
   virtual void mem_zero(device_memory &mem) override;
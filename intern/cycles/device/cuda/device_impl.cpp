@@ -752,6 +752,11 @@ CUDADevice::CUDAMem *CUDADevice::generic_alloc(device_memory &mem, size_t pitch_
 }
 
 void CUDADevice::generic_copy_to(device_memory &mem)
+{
+  generic_copy_to(mem, 0, mem.memory_size());
+}
+
+void CUDADevice::generic_copy_to(device_memory &mem, size_t offset, size_t size)
 {
   if (!mem.host_pointer || !mem.device_pointer) {
     return;
@@ -763,8 +768,9 @@ void CUDADevice::generic_copy_to(device_memory &mem)
   thread_scoped_lock lock(cuda_mem_map_mutex);
   if (!cuda_mem_map[&mem].use_mapped_host || mem.host_pointer != mem.shared_pointer) {
     const CUDAContextScope scope(this);
-    cuda_assert(
-        cuMemcpyHtoD((CUdeviceptr)mem.device_pointer, mem.host_pointer, mem.memory_size()));
+    cuda_assert(cuMemcpyHtoD((CUdeviceptr)(mem.device_pointer + offset),
+                             (const char *)mem.host_pointer + offset,
+                             size));
   }
 }
 
@@ -836,6 +842,16 @@ void CUDADevice::mem_copy_to(device_memory &mem)
   }
 }
 
+void CUDADevice::mem_copy_to(device_memory &mem, size_t offset, size_t size)
+{
+  if (!mem.device_pointer || mem.type == MEM_TEXTURE) {
+    mem_copy_to(mem);
+  }
+  else if (mem.type != MEM_GLOBAL || mem.is_resident(this)) {
+    generic_copy_to(mem, offset, size);
+  }
+}
+
 void CUDADevice::mem_copy_from(device_memory &mem, size_t y, size_t w, size_t h, size_t elem)
 {
   if (mem.type == MEM_TEXTURE || mem.type == MEM_GLOBAL) {
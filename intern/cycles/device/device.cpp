@@ -58,7 +58,7 @@ Device::~Device() noexcept(false)
 
 void Device::build_bvh(BVH *bvh, Progress &progress, bool refit)
 {
-  assert(bvh->params.bvh_layout == BVH_LAYOUT_BVH2);
+  assert(bvh->params.bvh_layout == BVH_LAYOUT_BVH2 || bvh->params.bvh_layout == BVH_LAYOUT_BVH4);
 
   BVH2 *const bvh2 = static_cast<BVH2 *>(bvh);
   if (refit) {
@@ -382,6 +382,12 @@ void *Device::get_cpu_osl_memory()
   return nullptr;
 }
 
+void Device::mem_copy_to(device_memory &mem, size_t /*offset*/, size_t /*size*/)
+{
+  /* Devices without support for partial copies copy everything. */
+  mem_copy_to(mem);
+}
+
 /* DeviceInfo */
 
 CCL_NAMESPACE_END
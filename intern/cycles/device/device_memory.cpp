@@ -136,6 +136,13 @@ void device_memory::device_copy_to()
   }
 }
 
+void device_memory::device_copy_to(size_t offset, size_t size)
+{
+  if (host_pointer) {
+    device->mem_copy_to(*this, offset, size);
+  }
+}
+
 void device_memory::device_copy_from(size_t y, size_t w, size_t h, size_t elem)
 {
   assert(type != MEM_TEXTURE && type != MEM_READ_ONLY && type != MEM_GLOBAL);
@@ -179,6 +186,36 @@ bool device_memory::is_resident(Device *sub_device) const
   return device->is_resident(device_pointer, sub_device);
 }
 
+/* Device Memory Range */
+
+void device_memory_merge_ranges(vector<device_memory_range> &ranges)
+{
+  if (ranges.empty()) {
+    return;
+  }
+
+  sort(ranges.begin(),
+       ranges.end(),
+       [](const device_memory_range &a, const device_memory_range &b) {
+         return a.offset < b.offset;
+       });
+
+  size_t num_merged = 0;
+  for (size_t i = 1; i < ranges.size(); i++) {
+    device_memory_range &merged = ranges[num_merged];
+    const device_memory_range &range = ranges[i];
+
+    if (range.offset <= merged.offset + merged.size) {
+      merged.size = max(merged.offset + merged.size, range.offset + range.size) - merged.offset;
+    }
+    else {
+      ranges[++num_merged] = range;
+    }
+  }
+
+  ranges.resize(num_merged + 1);
+}
+
 /* Device Sub Ptr */
 
 device_sub_ptr::device_sub_ptr(device_memory &mem, size_t offset, size_t size) : device(mem.device)
@@ -236,6 +273,14 @@ device_texture::device_texture(Device *device,
       data_type = TYPE_UINT16;
       data_elements = 1;
       break;
+    case IMAGE_DATA_TYPE_BLOCK_HALF4:
+      data_type = TYPE_UCHAR;
+      data_elements = sizeof(TextureBlockHalf4);
+      break;
+    case IMAGE_DATA_TYPE_BLOCK_HALF:
+      data_type = TYPE_UCHAR;
+      data_elements = sizeof(TextureBlockHalf);
+      break;
     case IMAGE_DATA_NUM_TYPES:
       assert(0);
       return;
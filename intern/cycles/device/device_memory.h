@@ -21,6 +21,7 @@
  *
  * Data types for allocating, copying and freeing device memory. */
 
+#include "util/util_algorithm.h"
 #include "util/util_array.h"
 #include "util/util_half.h"
 #include "util/util_string.h"
@@ -232,6 +233,18 @@ template<> struct device_type_traits<uint64_t> {
   static_assert(sizeof(uint64_t) == num_elements_cpu * datatype_size(data_type));
 };
 
+/* Device Memory Range
+ *
+ * Range of elements in a device vector, for copying only part of it to the device. */
+
+struct device_memory_range {
+  size_t offset;
+  size_t size;
+};
+
+/* Sort ranges by offset and merge overlapping and adjacent ranges in place. */
+void device_memory_merge_ranges(vector<device_memory_range> &ranges);
+
 /* Device Memory
  *
  * Base class for all device memory. This should not be allocated directly,
@@ -297,6 +310,7 @@ class device_memory {
   void device_alloc();
   void device_free();
   void device_copy_to();
+  void device_copy_to(size_t offset, size_t size);
   void device_copy_from(size_t y, size_t w, size_t h, size_t elem);
   void device_zero();
 
@@ -487,6 +501,7 @@ template<typename T> class device_vector : public device_memory {
     host_pointer = 0;
     modified = true;
     need_realloc_ = true;
+    modified_ranges.clear();
     assert(device_pointer == 0);
   }
 
@@ -512,6 +527,15 @@ template<typename T> class device_vector : public device_memory {
     modified = true;
   }
 
+  /* Tag a range of elements as modified. If nothing else is modified, only these ranges are
+   * copied by copy_to_device_if_modified(). */
+  void tag_modified(size_t offset, size_t size)
+  {
+    if (!modified && size != 0) {
+      modified_ranges.push_back({offset, size});
+    }
+  }
+
   void tag_realloc()
   {
     need_realloc_ = true;
@@ -544,21 +568,36 @@ template<typename T> class device_vector : public device_memory {
     if (data_size != 0) {
       device_copy_to();
     }
+    modified_ranges.clear();
   }
 
   void copy_to_device_if_modified()
   {
-    if (!modified) {
+    if (modified || (!device_pointer && !modified_ranges.empty())) {
+      copy_to_device();
       return;
     }
 
-    copy_to_device();
+    if (modified_ranges.empty()) {
+      return;
+    }
+
+    /* Merge overlapping and adjacent ranges, and copy each of them. */
+    device_memory_merge_ranges(modified_ranges);
+
+    for (const device_memory_range &range : modified_ranges) {
+      assert(range.offset + range.size <= data_size);
+      device_copy_to(range.offset * sizeof(T), range.size * sizeof(T));
+    }
+
+    modified_ranges.clear();
   }
 
   void clear_modified()
   {
     modified = false;
     need_realloc_ = false;
+    modified_ranges.clear();
   }
 
   void copy_from_device()
@@ -589,6 +628,9 @@ template<typename T> class device_vector : public device_memory {
   {
     return width * ((height == 0) ? 1 : height) * ((depth == 0) ? 1 : depth);
   }
+
+  /* Modified ranges in elements, when not all memory is modified. */
+  vector<device_memory_range> modified_ranges;
 };
 
 /* Device Sub Memory
@@ -641,6 +683,13 @@ class device_texture : public device_memory {
  protected:
   size_t size(const size_t width, const size_t height, const size_t depth)
   {
+    if (info.data_type == IMAGE_DATA_TYPE_BLOCK_HALF4 ||
+        info.data_type == IMAGE_DATA_TYPE_BLOCK_HALF) {
+      /* Number of blocks, each block is one element. */
+      return divide_up(width, TEXTURE_BLOCK_SIZE) *
+             divide_up((height == 0) ? 1 : height, TEXTURE_BLOCK_SIZE) *
+             ((depth == 0) ? 1 : depth);
+    }
     return width * ((height == 0) ? 1 : height) * ((depth == 0) ? 1 : depth);
   }
 };
@@ -724,6 +724,11 @@ HIPDevice::HIPMem *HIPDevice::generic_alloc(device_memory &mem, size_t pitch_pad
 }
 
 void HIPDevice::generic_copy_to(device_memory &mem)
+{
+  generic_copy_to(mem, 0, mem.memory_size());
+}
+
+void HIPDevice::generic_copy_to(device_memory &mem, size_t offset, size_t size)
 {
   if (!mem.host_pointer || !mem.device_pointer) {
     return;
@@ -735,8 +740,9 @@ void HIPDevice::generic_copy_to(device_memory &mem)
   thread_scoped_lock lock(hip_mem_map_mutex);
   if (!hip_mem_map[&mem].use_mapped_host || mem.host_pointer != mem.shared_pointer) {
     const HIPContextScope scope(this);
-    hip_assert(
-        hipMemcpyHtoD((hipDeviceptr_t)mem.device_pointer, mem.host_pointer, mem.memory_size()));
+    hip_assert(hipMemcpyHtoD((hipDeviceptr_t)(mem.device_pointer + offset),
+                             (char *)mem.host_pointer + offset,
+                             size));
   }
 }
 
@@ -808,6 +814,16 @@ void HIPDevice::mem_copy_to(device_memory &mem)
   }
 }
 
+void HIPDevice::mem_copy_to(device_memory &mem, size_t offset, size_t size)
+{
+  if (!mem.device_pointer || mem.type == MEM_TEXTURE) {
+    mem_copy_to(mem);
+  }
+  else if (mem.type != MEM_GLOBAL || mem.is_resident(this)) {
+    generic_copy_to(mem, offset, size);
+  }
+}
+
 void HIPDevice::mem_copy_from(device_memory &mem, size_t y, size_t w, size_t h, size_t elem)
 {
   if (mem.type == MEM_TEXTURE || mem.type == MEM_GLOBAL) {
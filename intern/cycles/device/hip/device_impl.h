@@ -110,12 +110,14 @@ class HIPDevice : public Device {
   HIPMem *generic_alloc(device_memory &mem, size_t pitch_padding = 0);
 
   void generic_copy_to(device_memory &mem);
+  void generic_copy_to(device_memory &mem, size_t offset, size_t size);
 
   void generic_free(device_memory &mem);
 
   void mem_alloc(device_memory &mem) override;
 
   void mem_copy_to(device_memory &mem) override;
+  void mem_copy_to(device_memory &mem, size_t offset, size_t size) override;
 
   void mem_copy_from(device_memory &mem, size_t y, size_t w, size_t h, size_t elem) override;
 
@@ -705,65 +705,59 @@ template<typename T> size_t array_size_in_bytes(const Node *node, const SocketTy
 
 }  // namespace
 
+size_t Node::get_size_in_bytes(const SocketType &socket) const
+{
+  switch (socket.type) {
+    case SocketType::BOOLEAN:
+    case SocketType::FLOAT:
+    case SocketType::INT:
+    case SocketType::UINT:
+    case SocketType::COLOR:
+    case SocketType::VECTOR:
+    case SocketType::POINT:
+    case SocketType::NORMAL:
+    case SocketType::POINT2:
+    case SocketType::CLOSURE:
+    case SocketType::STRING:
+    case SocketType::ENUM:
+    case SocketType::TRANSFORM:
+    case SocketType::NODE:
+      return socket.size();
+
+    case SocketType::BOOLEAN_ARRAY:
+      return array_size_in_bytes<bool>(this, socket);
+    case SocketType::FLOAT_ARRAY:
+      return array_size_in_bytes<float>(this, socket);
+    case SocketType::INT_ARRAY:
+      return array_size_in_bytes<int>(this, socket);
+    case SocketType::COLOR_ARRAY:
+      return array_size_in_bytes<float3>(this, socket);
+    case SocketType::VECTOR_ARRAY:
+      return array_size_in_bytes<float3>(this, socket);
+    case SocketType::POINT_ARRAY:
+      return array_size_in_bytes<float3>(this, socket);
+    case SocketType::NORMAL_ARRAY:
+      return array_size_in_bytes<float3>(this, socket);
+    case SocketType::POINT2_ARRAY:
+      return array_size_in_bytes<float2>(this, socket);
+    case SocketType::STRING_ARRAY:
+      return array_size_in_bytes<ustring>(this, socket);
+    case SocketType::TRANSFORM_ARRAY:
+      return array_size_in_bytes<Transform>(this, socket);
+    case SocketType::NODE_ARRAY:
+      return array_size_in_bytes<void *>(this, socket);
+
+    case SocketType::UNDEFINED:
+      break;
+  }
+  return 0;
+}
+
 size_t Node::get_total_size_in_bytes() const
 {
   size_t total_size = 0;
   foreach (const SocketType &socket, type->inputs) {
-    switch (socket.type) {
-      case SocketType::BOOLEAN:
-      case SocketType::FLOAT:
-      case SocketType::INT:
-      case SocketType::UINT:
-      case SocketType::COLOR:
-      case SocketType::VECTOR:
-      case SocketType::POINT:
-      case SocketType::NORMAL:
-      case SocketType::POINT2:
-      case SocketType::CLOSURE:
-      case SocketType::STRING:
-      case SocketType::ENUM:
-      case SocketType::TRANSFORM:
-      case SocketType::NODE:
-        total_size += socket.size();
-        break;
-
-      case SocketType::BOOLEAN_ARRAY:
-        total_size += array_size_in_bytes<bool>(this, socket);
-        break;
-      case SocketType::FLOAT_ARRAY:
-        total_size += array_size_in_bytes<float>(this, socket);
-        break;
-      case SocketType::INT_ARRAY:
-        total_size += array_size_in_bytes<int>(this, socket);
-        break;
-      case SocketType::COLOR_ARRAY:
-        total_size += array_size_in_bytes<float3>(this, socket);
-        break;
-      case SocketType::VECTOR_ARRAY:
-        total_size += array_size_in_bytes<float3>(this, socket);
-        break;
-      case SocketType::POINT_ARRAY:
-        total_size += array_size_in_bytes<float3>(this, socket);
-        break;
-      case SocketType::NORMAL_ARRAY:
-        total_size += array_size_in_bytes<float3>(this, socket);
-        break;
-      case SocketType::POINT2_ARRAY:
-        total_size += array_size_in_bytes<float2>(this, socket);
-        break;
-      case SocketType::STRING_ARRAY:
-        total_size += array_size_in_bytes<ustring>(this, socket);
-        break;
-      case SocketType::TRANSFORM_ARRAY:
-        total_size += array_size_in_bytes<Transform>(this, socket);
-        break;
-      case SocketType::NODE_ARRAY:
-        total_size += array_size_in_bytes<void *>(this, socket);
-        break;
-
-      case SocketType::UNDEFINED:
-        break;
-    }
+    total_size += get_size_in_bytes(socket);
   }
   return total_size;
 }
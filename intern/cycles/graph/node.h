@@ -170,6 +170,9 @@ struct Node {
   /* compute hash of node and its socket values */
   void hash(MD5Hash &md5);
 
+  /* Get size of a single socket value, including array contents. */
+  size_t get_size_in_bytes(const SocketType &socket) const;
+
   /* Get total size of this node. */
   size_t get_total_size_in_bytes() const;
 
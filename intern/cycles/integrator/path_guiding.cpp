@@ -0,0 +1,394 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "integrator/path_guiding.h"
+
+#include "device/device.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_atomic.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Spatial leaves are split once they received more than this factor times the square root of
+ * the number of samples per pixel of the iteration, as proposed in the paper. */
+static constexpr float kSpatialSplitFactor = 12000.0f;
+static constexpr int kMaxSpatialDepth = 32;
+
+/* Directional quadrants with more than this fraction of the energy are subdivided. */
+static constexpr float kDirectionalRefineFraction = 0.01f;
+static constexpr int kMaxDirectionalDepth = 20;
+
+/* Avoid overflow of the iteration length for very long training. */
+static constexpr int kMaxIterationShift = 20;
+
+/* Must match guiding_direction_to_square() in the kernel. */
+static float2 guiding_direction_to_square(const float3 &D)
+{
+  const float cos_theta = clamp(D.z, -1.0f, 1.0f);
+  float phi = atan2f(D.y, D.x);
+  if (phi < 0.0f) {
+    phi += M_2PI_F;
+  }
+
+  return make_float2(clamp((cos_theta + 1.0f) * 0.5f, 0.0f, 1.0f),
+                     clamp(phi * M_1_2PI_F, 0.0f, 1.0f));
+}
+
+static KernelGuidingDirectionalNode guiding_directional_node_empty()
+{
+  KernelGuidingDirectionalNode node;
+  for (int i = 0; i < 4; i++) {
+    node.energy[i] = 0.0f;
+    node.child[i] = -1;
+  }
+  return node;
+}
+
+/* --------------------------------------------------------------------
+ * Directional tree.
+ */
+
+void PathGuiding::DirectionalTree::init()
+{
+  nodes.clear();
+  nodes.push_back(guiding_directional_node_empty());
+}
+
+float PathGuiding::DirectionalTree::total() const
+{
+  if (nodes.empty()) {
+    return 0.0f;
+  }
+
+  const KernelGuidingDirectionalNode &root = nodes[0];
+  return root.energy[0] + root.energy[1] + root.energy[2] + root.energy[3];
+}
+
+void PathGuiding::DirectionalTree::record(float2 p, const float value)
+{
+  int index = 0;
+
+  while (true) {
+    KernelGuidingDirectionalNode &node = nodes[index];
+
+    const int qx = (p.x >= 0.5f) ? 1 : 0;
+    const int qy = (p.y >= 0.5f) ? 1 : 0;
+    const int quadrant = qx + 2 * qy;
+
+    if (node.child[quadrant] < 0) {
+      atomic_add_and_fetch_float(&node.energy[quadrant], value);
+      break;
+    }
+
+    p = p * 2.0f - make_float2((float)qx, (float)qy);
+    index = node.child[quadrant];
+  }
+}
+
+void PathGuiding::DirectionalTree::accumulate()
+{
+  /* Children are always stored after their parent. */
+  for (int i = nodes.size() - 1; i >= 0; i--) {
+    KernelGuidingDirectionalNode &node = nodes[i];
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+      if (node.child[quadrant] >= 0) {
+        const KernelGuidingDirectionalNode &child = nodes[node.child[quadrant]];
+        node.energy[quadrant] = child.energy[0] + child.energy[1] + child.energy[2] +
+                                child.energy[3];
+      }
+    }
+  }
+}
+
+void PathGuiding::DirectionalTree::refine(const DirectionalTree &other,
+                                          const float threshold,
+                                          const int max_depth)
+{
+  struct StackEntry {
+    int index;
+    /* Corresponding node in the other tree, or -1 if the other tree has no node here. */
+    int other_index;
+    /* Energy of the node, used to estimate energy of quadrants when other tree has no node. */
+    float energy;
+    int depth;
+  };
+
+  init();
+
+  vector<StackEntry> stack;
+  stack.push_back({0, other.nodes.empty() ? -1 : 0, other.total(), 1});
+
+  while (!stack.empty()) {
+    const StackEntry entry = stack.back();
+    stack.pop_back();
+
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+      const float energy = (entry.other_index >= 0) ?
+                               other.nodes[entry.other_index].energy[quadrant] :
+                               entry.energy * 0.25f;
+
+      if (!(energy > threshold) || entry.depth >= max_depth) {
+        continue;
+      }
+
+      const int child = nodes.size();
+      nodes.push_back(guiding_directional_node_empty());
+      nodes[entry.index].child[quadrant] = child;
+
+      const int other_child = (entry.other_index >= 0) ?
+                                  other.nodes[entry.other_index].child[quadrant] :
+                                  -1;
+      stack.push_back({child, other_child, energy, entry.depth + 1});
+    }
+  }
+}
+
+/* --------------------------------------------------------------------
+ * Path guiding.
+ */
+
+PathGuiding::PathGuiding(Device *device)
+    : thread_bounds_(BoundBox(BoundBox::empty)),
+      device_spatial_nodes_(device, "__guiding_spatial_nodes", MEM_GLOBAL),
+      device_directional_nodes_(device, "__guiding_directional_nodes", MEM_GLOBAL)
+{
+  reset(GuidingParams());
+}
+
+void PathGuiding::reset(const GuidingParams &params)
+{
+  params_ = params;
+
+  spatial_nodes_.clear();
+  spatial_nodes_.resize(1);
+  spatial_nodes_[0].sampling.init();
+  spatial_nodes_[0].building.init();
+
+  thread_bounds_.clear();
+
+  iteration_ = 0;
+  iteration_samples_ = 0;
+  num_trained_samples_ = 0;
+
+  device_update();
+}
+
+int PathGuiding::spatial_lookup(const float3 &P) const
+{
+  int index = 0;
+
+  while (spatial_nodes_[index].child >= 0) {
+    const SpatialNode &node = spatial_nodes_[index];
+    index = node.child + ((P[node.axis] < node.split) ? 0 : 1);
+  }
+
+  return index;
+}
+
+void PathGuiding::record(const float3 &P, const float3 &D, const float value)
+{
+  SpatialNode &node = spatial_nodes_[spatial_lookup(P)];
+  atomic_fetch_and_add_uint32(&node.num_samples, 1);
+
+  /* Bounds are only needed until the spatial tree is first split. */
+  if (spatial_nodes_.size() == 1) {
+    thread_bounds_.local().grow(P);
+  }
+
+  if (value > 0.0f && isfinite_safe(value)) {
+    node.building.record(guiding_direction_to_square(D), value);
+  }
+}
+
+void PathGuiding::update(const int num_samples)
+{
+  if (!need_record()) {
+    return;
+  }
+
+  num_trained_samples_ += num_samples;
+  iteration_samples_ += num_samples;
+
+  /* The last iteration takes all remaining training samples, rather than ending the training
+   * with a short iteration which would give a noisy distribution. */
+  const int iteration_length = 1 << min(iteration_, kMaxIterationShift);
+  const int remaining_samples = params_.training_samples - num_trained_samples_;
+  if (remaining_samples > 0 && (iteration_samples_ < iteration_length ||
+                                remaining_samples < 2 * iteration_length)) {
+    return;
+  }
+
+  finish_iteration();
+}
+
+void PathGuiding::finish_iteration()
+{
+  /* Initialize bounds of the spatial tree from the recorded positions. */
+  if (spatial_nodes_.size() == 1) {
+    BoundBox bounds = BoundBox::empty;
+    for (const BoundBox &thread_bounds : thread_bounds_) {
+      if (thread_bounds.valid()) {
+        bounds.grow(thread_bounds);
+      }
+    }
+    spatial_nodes_[0].bounds = bounds;
+  }
+
+  /* Radiance recorded in this iteration is the distribution to sample in the next one. */
+  for (SpatialNode &node : spatial_nodes_) {
+    if (node.child < 0) {
+      node.building.accumulate();
+      node.sampling.nodes.swap(node.building.nodes);
+    }
+  }
+
+  if (spatial_nodes_[0].bounds.valid()) {
+    const float threshold = kSpatialSplitFactor *
+                            sqrtf((float)(1 << min(iteration_, kMaxIterationShift)));
+    split_spatial_leaves((uint)threshold);
+  }
+
+  for (SpatialNode &node : spatial_nodes_) {
+    if (node.child < 0) {
+      node.building.refine(node.sampling,
+                           kDirectionalRefineFraction * node.sampling.total(),
+                           kMaxDirectionalDepth);
+      node.num_samples = 0;
+    }
+  }
+
+  device_update();
+
+  VLOG(3) << "Path guiding iteration " << iteration_ << " finished after "
+          << iteration_samples_ << " samples, " << get_num_spatial_leaves()
+          << " spatial leaves.";
+
+  ++iteration_;
+  iteration_samples_ = 0;
+}
+
+void PathGuiding::split_spatial_leaves(const uint threshold)
+{
+  vector<int> stack;
+  for (int i = 0; i < spatial_nodes_.size(); i++) {
+    if (spatial_nodes_[i].child < 0) {
+      stack.push_back(i);
+    }
+  }
+
+  while (!stack.empty()) {
+    const int index = stack.back();
+    stack.pop_back();
+
+    if (spatial_nodes_[index].num_samples <= threshold ||
+        spatial_nodes_[index].depth >= kMaxSpatialDepth) {
+      continue;
+    }
+
+    const int child = spatial_nodes_.size();
+    spatial_nodes_.resize(child + 2);
+
+    /* Split the largest dimension in the middle, assuming the recorded samples are evenly
+     * distributed between both halves. */
+    SpatialNode &node = spatial_nodes_[index];
+    const float3 size = node.bounds.size();
+    node.axis = (size.x > size.y) ? ((size.x > size.z) ? 0 : 2) : ((size.y > size.z) ? 1 : 2);
+    node.split = 0.5f * (node.bounds.min[node.axis] + node.bounds.max[node.axis]);
+    node.child = child;
+
+    for (int i = 0; i < 2; i++) {
+      SpatialNode &child_node = spatial_nodes_[child + i];
+      child_node.bounds = node.bounds;
+      if (i == 0) {
+        child_node.bounds.max[node.axis] = node.split;
+      }
+      else {
+        child_node.bounds.min[node.axis] = node.split;
+      }
+      child_node.depth = node.depth + 1;
+      child_node.num_samples = node.num_samples / 2;
+      child_node.sampling = node.sampling;
+      child_node.building = node.building;
+
+      stack.push_back(child + i);
+    }
+
+    node.sampling.nodes.clear();
+    node.building.nodes.clear();
+    node.num_samples = 0;
+  }
+}
+
+int PathGuiding::get_num_spatial_leaves() const
+{
+  int num_leaves = 0;
+  for (const SpatialNode &node : spatial_nodes_) {
+    if (node.child < 0) {
+      ++num_leaves;
+    }
+  }
+  return num_leaves;
+}
+
+void PathGuiding::device_update()
+{
+  size_t num_directional_nodes = 0;
+  for (const SpatialNode &node : spatial_nodes_) {
+    if (node.child < 0 && node.sampling.total() > 0.0f) {
+      num_directional_nodes += node.sampling.nodes.size();
+    }
+  }
+
+  KernelGuidingSpatialNode *knodes = device_spatial_nodes_.alloc(spatial_nodes_.size());
+  KernelGuidingDirectionalNode *kdirectional_nodes = device_directional_nodes_.alloc(
+      max(num_directional_nodes, (size_t)1));
+  kdirectional_nodes[0] = guiding_directional_node_empty();
+
+  int directional_offset = 0;
+  for (int i = 0; i < spatial_nodes_.size(); i++) {
+    const SpatialNode &node = spatial_nodes_[i];
+    KernelGuidingSpatialNode &knode = knodes[i];
+
+    knode.child = node.child;
+    knode.axis = node.axis;
+    knode.split = node.split;
+    knode.directional_root = -1;
+
+    /* Leaves without recorded radiance are not guided. */
+    if (node.child >= 0 || !(node.sampling.total() > 0.0f)) {
+      continue;
+    }
+
+    knode.directional_root = directional_offset;
+    for (const KernelGuidingDirectionalNode &directional_node : node.sampling.nodes) {
+      KernelGuidingDirectionalNode &kdirectional_node = kdirectional_nodes[directional_offset++];
+      kdirectional_node = directional_node;
+      for (int quadrant = 0; quadrant < 4; quadrant++) {
+        if (kdirectional_node.child[quadrant] >= 0) {
+          kdirectional_node.child[quadrant] += knode.directional_root;
+        }
+      }
+    }
+  }
+
+  device_spatial_nodes_.copy_to_device();
+  device_directional_nodes_.copy_to_device();
+}
+
+CCL_NAMESPACE_END
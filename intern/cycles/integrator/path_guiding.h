@@ -0,0 +1,145 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "device/device_memory.h"
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_tbb.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class Device;
+
+class GuidingParams {
+ public:
+  /* Guide directions of surface and volume scattering with the learned radiance distribution. */
+  bool use = false;
+
+  /* Number of samples per pixel used to train the guiding distribution, after which it stays
+   * fixed for the rest of the render. */
+  int training_samples = 128;
+
+  bool modified(const GuidingParams &other) const
+  {
+    return !(use == other.use && training_samples == other.training_samples);
+  }
+};
+
+/* Path Guiding
+ *
+ * Host side of the spatio-directional tree (SD-tree) sampled by the kernel, see
+ * kernel_path_guiding.h. The tree is trained in iterations of doubling number of samples: while
+ * an iteration is rendered the kernel samples the distribution learned in the previous
+ * iteration, and the incoming radiance at path vertices is recorded into a separate building
+ * tree. After the iteration the building tree becomes the sampling tree, and the structure of
+ * both the spatial and directional trees is refined.
+ *
+ * Recording is safe to be done from multiple threads. The tree structure is only modified by
+ * update(), which is not to be called while rendering. */
+class PathGuiding {
+ public:
+  explicit PathGuiding(Device *device);
+
+  /* Discard the learned distribution and start training from scratch with the new parameters. */
+  void reset(const GuidingParams &params);
+
+  const GuidingParams &get_params() const
+  {
+    return params_;
+  }
+
+  /* Check whether radiance at path vertices is to be recorded for training. */
+  bool need_record() const
+  {
+    return params_.use && num_trained_samples_ < params_.training_samples;
+  }
+
+  /* Record incoming radiance arriving at P from direction D, divided by the probability density
+   * of sampling D. Safe to call from multiple threads. */
+  void record(const float3 &P, const float3 &D, const float value);
+
+  /* Inform that the given number of samples per pixel was rendered. Finishes the training
+   * iteration when enough samples were rendered, and uploads the new guiding distribution. */
+  void update(const int num_samples);
+
+  /* Number of leaves in the spatial tree. */
+  int get_num_spatial_leaves() const;
+
+ protected:
+  /* Quadtree over the cylindrical mapping of directions. Energy is recorded in leaf quadrants
+   * only, to reduce contention between threads, and summed up the tree after the iteration. */
+  struct DirectionalTree {
+    vector<KernelGuidingDirectionalNode> nodes;
+
+    void init();
+    float total() const;
+
+    void record(float2 p, const float value);
+    void accumulate();
+
+    /* Build the structure from the energy of the other tree: quadrants with more than the
+     * threshold energy are subdivided, and quadrants with less energy are collapsed. */
+    void refine(const DirectionalTree &other, const float threshold, const int max_depth);
+  };
+
+  /* Node of the spatial binary tree. Children of inner nodes are stored next to each other, and
+   * split the bounds in the middle along the axis. */
+  struct SpatialNode {
+    BoundBox bounds = BoundBox::empty;
+    int depth = 0;
+    int axis = 0;
+    float split = 0.0f;
+    int child = -1;
+
+    /* Number of recorded samples, accessed atomically. */
+    uint num_samples = 0;
+
+    /* Directional distributions of leaves. */
+    DirectionalTree sampling;
+    DirectionalTree building;
+  };
+
+  int spatial_lookup(const float3 &P) const;
+
+  void finish_iteration();
+  void split_spatial_leaves(const uint threshold);
+
+  /* Copy the sampling trees to the device. */
+  void device_update();
+
+  GuidingParams params_;
+
+  vector<SpatialNode> spatial_nodes_;
+
+  /* Bounds of the recorded positions, used to initialize the bounds of the spatial tree. */
+  enumerable_thread_specific<BoundBox> thread_bounds_;
+
+  /* Training iteration, and number of samples per pixel rendered in it. */
+  int iteration_ = 0;
+  int iteration_samples_ = 0;
+  int num_trained_samples_ = 0;
+
+  device_vector<KernelGuidingSpatialNode> device_spatial_nodes_;
+  device_vector<KernelGuidingDirectionalNode> device_directional_nodes_;
+};
+
+CCL_NAMESPACE_END
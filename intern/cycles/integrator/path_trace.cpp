@@ -149,6 +149,13 @@ void PathTrace::device_free()
   render_state_.need_reset_params = true;
 }
 
+void PathTrace::collect_memory_statistics(NamedSizeStats *stats)
+{
+  for (auto &&path_trace_work : path_trace_works_) {
+    path_trace_work->collect_memory_statistics(stats);
+  }
+}
+
 void PathTrace::set_progress(Progress *progress)
 {
   progress_ = progress;
@@ -197,6 +204,8 @@ void PathTrace::render_pipeline(RenderWork render_work)
     return;
   }
 
+  guiding_update(render_work);
+
   adaptive_sample(render_work);
   if (render_cancel_.is_requested) {
     return;
@@ -487,6 +496,48 @@ void PathTrace::set_adaptive_sampling(const AdaptiveSampling &adaptive_sampling)
   render_scheduler_.set_adaptive_sampling(adaptive_sampling);
 }
 
+void PathTrace::set_guiding_params(const GuidingParams &params, const bool reset)
+{
+  if (!params.use || device_->info.type != DEVICE_CPU) {
+    if (guiding_) {
+      for (auto &&path_trace_work : path_trace_works_) {
+        path_trace_work->set_guiding(nullptr);
+      }
+      guiding_.reset();
+    }
+    return;
+  }
+
+  if (!guiding_) {
+    guiding_ = make_unique<PathGuiding>(device_);
+    guiding_->reset(params);
+  }
+  else if (reset || guiding_->get_params().modified(params)) {
+    guiding_->reset(params);
+  }
+
+  PathGuiding *guiding = guiding_->need_record() ? guiding_.get() : nullptr;
+  for (auto &&path_trace_work : path_trace_works_) {
+    path_trace_work->set_guiding(guiding);
+  }
+}
+
+void PathTrace::guiding_update(const RenderWork &render_work)
+{
+  if (!guiding_ || !guiding_->need_record() || render_work.path_trace.num_samples == 0) {
+    return;
+  }
+
+  guiding_->update(render_work.path_trace.num_samples);
+
+  if (!guiding_->need_record()) {
+    VLOG(3) << "Path guiding training finished.";
+    for (auto &&path_trace_work : path_trace_works_) {
+      path_trace_work->set_guiding(nullptr);
+    }
+  }
+}
+
 void PathTrace::cryptomatte_postprocess(const RenderWork &render_work)
 {
   if (!render_work.cryptomatte.postprocess) {
@@ -904,42 +955,68 @@ bool PathTrace::copy_render_tile_from_device()
   return success;
 }
 
-static string get_layer_view_name(const RenderBuffers &buffers)
+static string get_layer_view_name(const BufferParams &params)
 {
   string result;
 
-  if (buffers.params.layer.size()) {
-    result += string(buffers.params.layer);
+  if (params.layer.size()) {
+    result += string(params.layer);
   }
 
-  if (buffers.params.view.size()) {
+  if (params.view.size()) {
     if (!result.empty()) {
       result += ", ";
     }
-    result += string(buffers.params.view);
+    result += string(params.view);
   }
 
   return result;
 }
 
+static string get_layer_view_name(const RenderBuffers &buffers)
+{
+  return get_layer_view_name(buffers.params);
+}
+
+static void full_buffer_read_error(Progress *progress)
+{
+  const string error_message = "Error reading tiles from file";
+  if (progress) {
+    progress->set_error(error_message);
+    progress->set_cancel(error_message);
+  }
+  else {
+    LOG(ERROR) << error_message;
+  }
+}
+
 void PathTrace::process_full_buffer_from_disk(string_view filename)
 {
   VLOG(3) << "Processing full frame buffer file " << filename;
 
   progress_set_status("Reading full buffer from disk");
 
+  BufferParams buffer_params;
+  DenoiseParams denoise_params;
+  int num_tiles = 0;
+  if (!tile_manager_.open_full_buffer_from_disk(
+          filename, &buffer_params, &denoise_params, &num_tiles)) {
+    full_buffer_read_error(progress_);
+    return;
+  }
+
+  if (num_tiles > 1) {
+    process_full_buffer_tiles_from_disk(buffer_params, denoise_params, num_tiles);
+    tile_manager_.close_full_buffer_from_disk();
+    return;
+  }
+
+  tile_manager_.close_full_buffer_from_disk();
+
   RenderBuffers full_frame_buffers(cpu_device_.get());
 
-  DenoiseParams denoise_params;
   if (!tile_manager_.read_full_buffer_from_disk(filename, &full_frame_buffers, &denoise_params)) {
-    const string error_message = "Error reading tiles from file";
-    if (progress_) {
-      progress_->set_error(error_message);
-      progress_->set_cancel(error_message);
-    }
-    else {
-      LOG(ERROR) << error_message;
-    }
+    full_buffer_read_error(progress_);
     return;
   }
 
@@ -965,6 +1042,7 @@ void PathTrace::process_full_buffer_from_disk(string_view filename)
   }
 
   full_frame_state_.render_buffers = &full_frame_buffers;
+  full_frame_state_.offset = make_int2(0, 0);
 
   progress_set_status(layer_view_name, "Finishing");
 
@@ -975,6 +1053,88 @@ void PathTrace::process_full_buffer_from_disk(string_view filename)
   full_frame_state_.render_buffers = nullptr;
 }
 
+/* Copy window of the source buffers into the destination, which gets the size of the window. */
+static void render_buffers_copy_window(const RenderBuffers &src, RenderBuffers *dst)
+{
+  const BufferParams &src_params = src.params;
+
+  BufferParams dst_params = src_params;
+  dst_params.width = src_params.window_width;
+  dst_params.height = src_params.window_height;
+  dst_params.full_x = src_params.full_x + src_params.window_x;
+  dst_params.full_y = src_params.full_y + src_params.window_y;
+  dst_params.window_x = 0;
+  dst_params.window_y = 0;
+  dst_params.update_offset_stride();
+
+  dst->reset(dst_params);
+
+  const int64_t pass_stride = src_params.pass_stride;
+  const int64_t row_size = dst_params.width * pass_stride;
+
+  for (int y = 0; y < dst_params.height; ++y) {
+    const float *src_row = src.buffer.data() +
+                           ((src_params.window_y + y) * int64_t(src_params.width) +
+                            src_params.window_x) *
+                               pass_stride;
+    memcpy(dst->buffer.data() + y * row_size, src_row, sizeof(float) * row_size);
+  }
+}
+
+void PathTrace::process_full_buffer_tiles_from_disk(const BufferParams &buffer_params,
+                                                    const DenoiseParams &denoise_params,
+                                                    const int num_tiles)
+{
+  /* Pixels around the tile which are denoised together with it, avoiding visible seams between
+   * tiles. Is rounded up to the tile size of the image file. */
+  static const int kDenoiseOverlap = 64;
+
+  RenderBuffers tile_buffers(cpu_device_.get());
+  RenderBuffers window_buffers(cpu_device_.get());
+
+  const string layer_view_name = get_layer_view_name(buffer_params);
+
+  render_state_.has_denoised_result = false;
+
+  if (denoise_params.use) {
+    /* See comment in process_full_buffer_from_disk() about the denoiser re-use. */
+    set_denoiser_params(denoise_params);
+  }
+
+  for (int tile_index = 0; tile_index < num_tiles; ++tile_index) {
+    if (progress_ && progress_->get_cancel()) {
+      break;
+    }
+
+    progress_set_status(layer_view_name,
+                        string_printf("Finishing tile %d/%d", tile_index + 1, num_tiles));
+
+    const int overlap = denoise_params.use ? kDenoiseOverlap : 0;
+    if (!tile_manager_.read_tile_from_disk(tile_index, overlap, &tile_buffers)) {
+      full_buffer_read_error(progress_);
+      break;
+    }
+
+    if (denoise_params.use) {
+      denoiser_->denoise_buffer(tile_buffers.params, &tile_buffers, 0, false);
+      render_state_.has_denoised_result = true;
+    }
+
+    /* Pass accessors write all pixels of the buffer, so only give them the tile itself. */
+    render_buffers_copy_window(tile_buffers, &window_buffers);
+
+    full_frame_state_.render_buffers = &window_buffers;
+    full_frame_state_.offset = make_int2(window_buffers.params.full_x - buffer_params.full_x,
+                                         window_buffers.params.full_y - buffer_params.full_y);
+
+    tile_buffer_write();
+
+    full_frame_state_.render_buffers = nullptr;
+  }
+
+  full_frame_state_.offset = make_int2(0, 0);
+}
+
 int PathTrace::get_num_render_tile_samples() const
 {
   if (full_frame_state_.render_buffers) {
@@ -1036,7 +1196,7 @@ int2 PathTrace::get_render_tile_size() const
 int2 PathTrace::get_render_tile_offset() const
 {
   if (full_frame_state_.render_buffers) {
-    return make_int2(0, 0);
+    return full_frame_state_.offset;
   }
 
   const Tile &tile = tile_manager_.get_current_tile();
@@ -18,6 +18,7 @@
 
 #include "integrator/denoiser.h"
 #include "integrator/pass_accessor.h"
+#include "integrator/path_guiding.h"
 #include "integrator/path_trace_work.h"
 #include "integrator/work_balancer.h"
 #include "render/buffers.h"
@@ -33,6 +34,7 @@ class Device;
 class DeviceScene;
 class DisplayDriver;
 class Film;
+class NamedSizeStats;
 class RenderBuffers;
 class RenderScheduler;
 class RenderWork;
@@ -76,6 +78,9 @@ class PathTrace {
 
   void device_free();
 
+  /* Add memory used for rendering on all devices to the statistics. */
+  void collect_memory_statistics(NamedSizeStats *stats);
+
   /* Set progress tracker.
    * Used to communicate details about the progress to the outer world, check whether rendering is
    * to be canceled.
@@ -100,6 +105,10 @@ class PathTrace {
    * Use this to configure the adaptive sampler before rendering any samples. */
   void set_adaptive_sampling(const AdaptiveSampling &adaptive_sampling);
 
+  /* Set parameters of path guiding.
+   * The learned distribution is discarded when the parameters changed or reset is requested. */
+  void set_guiding_params(const GuidingParams &params, const bool reset);
+
   /* Sets output driver for render buffer output. */
   void set_output_driver(unique_ptr<OutputDriver> driver);
 
@@ -134,7 +143,10 @@ class PathTrace {
   bool copy_render_tile_from_device();
 
   /* Read given full-frame file from disk, perform needed processing and write it to the software
-   * via the write callback. */
+   * via the write callback.
+   *
+   * Files with multiple render tiles are processed one tile at a time, so that the full frame is
+   * never held in memory. */
   void process_full_buffer_from_disk(string_view filename);
 
   /* Get number of samples in the current big tile render buffers. */
@@ -205,6 +217,7 @@ class PathTrace {
    * of rendering. */
   void init_render_buffers(const RenderWork &render_work);
   void path_trace(RenderWork &render_work);
+  void guiding_update(const RenderWork &render_work);
   void adaptive_sample(RenderWork &render_work);
   void denoise(const RenderWork &render_work);
   void cryptomatte_postprocess(const RenderWork &render_work);
@@ -229,6 +242,12 @@ class PathTrace {
   /* Write current tile into the file on disk. */
   void tile_buffer_write_to_disk();
 
+  /* Denoise and write full-frame buffer from the file opened in the tile manager, one render tile
+   * at a time. */
+  void process_full_buffer_tiles_from_disk(const BufferParams &buffer_params,
+                                           const DenoiseParams &denoise_params,
+                                           const int num_tiles);
+
   /* Run the progress_update_cb callback if it is needed. */
   void progress_update_if_needed(const RenderWork &render_work);
 
@@ -266,6 +285,9 @@ class PathTrace {
   /* Denoiser which takes care of denoising the big tile. */
   unique_ptr<Denoiser> denoiser_;
 
+  /* Path guiding distribution, trained during the first samples of the render. CPU only. */
+  unique_ptr<PathGuiding> guiding_;
+
   /* State which is common for all the steps of the render work.
    * Is brought up to date in the `render()` call and is accessed from all the steps involved into
    * rendering the work. */
@@ -316,6 +338,9 @@ class PathTrace {
   /* State of the full frame processing and writing to the software. */
   struct {
     RenderBuffers *render_buffers = nullptr;
+
+    /* Offset of the render buffers within the full frame. */
+    int2 offset = make_int2(0, 0);
   } full_frame_state_;
 };
 
@@ -23,6 +23,7 @@
 #include "render/buffers.h"
 #include "render/film.h"
 #include "render/scene.h"
+#include "render/stats.h"
 
 #include "kernel/kernel_types.h"
 
@@ -71,6 +72,12 @@ void PathTraceWork::set_effective_buffer_params(const BufferParams &effective_fu
   effective_buffer_params_ = effective_buffer_params;
 }
 
+void PathTraceWork::collect_memory_statistics(NamedSizeStats *stats)
+{
+  stats->add_entry(NamedSizeEntry(device_->info.description + " render buffers",
+                                  buffers_->buffer.memory_size()));
+}
+
 bool PathTraceWork::has_multiple_works() const
 {
   /* Assume if there are multiple works working on the same big tile none of the works gets the
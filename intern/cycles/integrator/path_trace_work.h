@@ -28,6 +28,8 @@ class BufferParams;
 class Device;
 class DeviceScene;
 class Film;
+class NamedSizeStats;
+class PathGuiding;
 class PathTraceDisplay;
 class RenderBuffers;
 
@@ -66,6 +68,10 @@ class PathTraceWork {
   /* Allocate working memory for execution. Must be called before init_execution(). */
   virtual void alloc_work_memory(){};
 
+  /* Add memory used by this work to the statistics: render buffers, and integrator state for
+   * devices which keep it in memory between kernels. */
+  virtual void collect_memory_statistics(NamedSizeStats *stats);
+
   /* Initialize execution of kernels.
    * Will ensure that all device queues are initialized for execution.
    *
@@ -73,6 +79,10 @@ class PathTraceWork {
    * to an every call of the `render_samples()`. */
   virtual void init_execution() = 0;
 
+  /* Set path guiding to train with radiance recorded at path vertices, or nullptr when no
+   * training is to happen. Only supported by the CPU. */
+  virtual void set_guiding(PathGuiding * /*guiding*/){};
+
   /* Render given number of samples as a synchronous blocking call.
    * The samples are added to the render buffer associated with this work. */
   virtual void render_samples(RenderStatistics &statistics, int start_sample, int samples_num) = 0;
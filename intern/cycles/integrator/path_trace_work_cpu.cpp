@@ -22,10 +22,12 @@
 #include "kernel/kernel_path_state.h"
 
 #include "integrator/pass_accessor_cpu.h"
+#include "integrator/path_guiding.h"
 #include "integrator/path_trace_display.h"
 
 #include "render/buffers.h"
 #include "render/scene.h"
+#include "render/stats.h"
 
 #include "util/util_atomic.h"
 #include "util/util_logging.h"
@@ -69,6 +71,11 @@ void PathTraceWorkCPU::init_execution()
   device_->get_cpu_kernel_thread_globals(kernel_thread_globals_);
 }
 
+void PathTraceWorkCPU::set_guiding(PathGuiding *guiding)
+{
+  guiding_ = guiding;
+}
+
 void PathTraceWorkCPU::render_samples(RenderStatistics &statistics,
                                       int start_sample,
                                       int samples_num)
@@ -77,19 +84,27 @@ void PathTraceWorkCPU::render_samples(RenderStatistics &statistics,
   const int64_t image_height = effective_buffer_params_.height;
   const int64_t total_pixels_num = image_width * image_height;
 
+  /* Only schedule work over pixels which did not converge yet, so that late samples of adaptive
+   * sampling are distributed evenly across threads instead of over mostly converged ranges. */
+  const bool use_active_pixels = use_active_pixels_ &&
+                                 !active_pixels_params_.modified(effective_buffer_params_);
+  const int *pixel_indices = use_active_pixels ? active_pixels_.data() : nullptr;
+  const int64_t total_work_size = use_active_pixels ? active_pixels_.size() : total_pixels_num;
+
   for (CPUKernelThreadGlobals &kernel_globals : kernel_thread_globals_) {
     kernel_globals.start_profiling();
   }
 
   tbb::task_arena local_arena = local_tbb_arena_create(device_);
   local_arena.execute([&]() {
-    tbb::parallel_for(int64_t(0), total_pixels_num, [&](int64_t work_index) {
+    tbb::parallel_for(int64_t(0), total_work_size, [&](int64_t work_index) {
       if (is_cancel_requested()) {
         return;
       }
 
-      const int y = work_index / image_width;
-      const int x = work_index - y * image_width;
+      const int64_t pixel_index = pixel_indices ? pixel_indices[work_index] : work_index;
+      const int y = pixel_index / image_width;
+      const int x = pixel_index - y * image_width;
 
       KernelWorkTile work_tile;
       work_tile.x = effective_buffer_params_.full_x + x;
@@ -157,10 +172,57 @@ void PathTraceWorkCPU::render_samples_full_pipeline(KernelGlobals *kernel_global
       kernels_.integrator_megakernel(kernel_globals, shadow_catcher_state, render_buffer);
     }
 
+    if (guiding_) {
+      guiding_record_path(state, shadow_catcher_state);
+    }
+
     ++sample_work_tile.start_sample;
   }
 }
 
+void PathTraceWorkCPU::collect_memory_statistics(NamedSizeStats *stats)
+{
+  PathTraceWork::collect_memory_statistics(stats);
+
+  /* Every thread keeps the state of a path and of its shadow catcher path on the stack while
+   * rendering. */
+  const size_t num_threads = kernel_thread_globals_.size();
+  const size_t state_size = num_threads * 2 * sizeof(IntegratorStateCPU);
+
+  const size_t globals_size = num_threads * sizeof(CPUKernelThreadGlobals) +
+                              active_pixels_.capacity() * sizeof(int);
+
+  const string &device_name = device_->info.description;
+  stats->add_entry(NamedSizeEntry(device_name + " integrator state", state_size));
+  stats->add_entry(NamedSizeEntry(device_name + " thread globals", globals_size));
+}
+
+void PathTraceWorkCPU::guiding_record_path(IntegratorStateCPU *state,
+                                           IntegratorStateCPU *shadow_catcher_state)
+{
+  const int num_vertices = state->path.guiding_num_vertices;
+
+  for (int i = 0; i < num_vertices; i++) {
+    const float pdf = state->guiding[i].pdf;
+    const float value = average(state->guiding[i].radiance) / pdf;
+
+    /* Directions sampled with a degenerate pdf would add infinite or NaN values to training. */
+    if (!(pdf > 0.0f) || !isfinite_safe(value)) {
+      continue;
+    }
+
+    guiding_->record(state->guiding[i].P, state->guiding[i].D, value);
+  }
+
+  state->path.guiding_num_vertices = 0;
+
+  /* The shadow catcher pass does not contribute to training, only discard its vertices. */
+  if (shadow_catcher_state) {
+    shadow_catcher_state->path.guiding_num_vertices = 0;
+    shadow_catcher_state->shadow_path.guiding_num_vertices = 0;
+  }
+}
+
 void PathTraceWorkCPU::copy_to_display(PathTraceDisplay *display,
                                        PassMode pass_mode,
                                        int num_samples)
@@ -201,12 +263,17 @@ bool PathTraceWorkCPU::copy_render_buffers_from_device()
 bool PathTraceWorkCPU::copy_render_buffers_to_device()
 {
   buffers_->buffer.copy_to_device();
+
+  /* Convergence of pixels might have changed. */
+  use_active_pixels_ = false;
+
   return true;
 }
 
 bool PathTraceWorkCPU::zero_render_buffers()
 {
   buffers_->zero();
+  use_active_pixels_ = false;
   return true;
 }
 
@@ -259,9 +326,71 @@ int PathTraceWorkCPU::adaptive_sampling_converge_filter_count_active(float thres
     });
   }
 
+  active_pixels_update();
+
   return num_active_pixels;
 }
 
+void PathTraceWorkCPU::active_pixels_update()
+{
+  const int full_x = effective_buffer_params_.full_x;
+  const int full_y = effective_buffer_params_.full_y;
+  const int width = effective_buffer_params_.width;
+  const int height = effective_buffer_params_.height;
+  const int offset = effective_buffer_params_.offset;
+  const int stride = effective_buffer_params_.stride;
+
+  const KernelFilm &kfilm = device_scene_->data.film;
+  const int64_t pass_stride = kfilm.pass_stride;
+  const int aux_w_offset = kfilm.pass_adaptive_aux_buffer + 3;
+
+  const float *render_buffer = buffers_->buffer.data();
+
+  /* Pixel is sampled further when its convergence flag is cleared, after the filter spread the
+   * flag of non-converged pixels to their neighbors. Same check as kernel_need_sample_pixel(). */
+  auto is_pixel_active = [&](int x, int y) {
+    const int64_t render_pixel_index = offset + full_x + x + int64_t(full_y + y) * stride;
+    return render_buffer[render_pixel_index * pass_stride + aux_w_offset] == 0.0f;
+  };
+
+  /* Count active pixels of every row, so that rows can write their indices in parallel. */
+  vector<int> row_offset(height + 1, 0);
+
+  tbb::task_arena local_arena = local_tbb_arena_create(device_);
+  local_arena.execute([&]() {
+    tbb::parallel_for(0, height, [&](int y) {
+      int num_row_pixels_active = 0;
+      for (int x = 0; x < width; ++x) {
+        num_row_pixels_active += is_pixel_active(x, y);
+      }
+      row_offset[y + 1] = num_row_pixels_active;
+    });
+  });
+
+  for (int y = 0; y < height; ++y) {
+    row_offset[y + 1] += row_offset[y];
+  }
+
+  active_pixels_.resize(row_offset[height]);
+
+  local_arena.execute([&]() {
+    tbb::parallel_for(0, height, [&](int y) {
+      int *pixel_index = active_pixels_.data() + row_offset[y];
+      for (int x = 0; x < width; ++x) {
+        if (is_pixel_active(x, y)) {
+          *pixel_index++ = y * width + x;
+        }
+      }
+    });
+  });
+
+  active_pixels_params_ = effective_buffer_params_;
+  use_active_pixels_ = true;
+
+  VLOG(3) << "Scheduling work over " << active_pixels_.size() << " of " << width * height
+          << " pixels which did not converge yet.";
+}
+
 void PathTraceWorkCPU::cryptomatte_postproces()
 {
   const int width = effective_buffer_params_.width;
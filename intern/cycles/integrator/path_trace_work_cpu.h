@@ -46,6 +46,10 @@ class PathTraceWorkCPU : public PathTraceWork {
 
   virtual void init_execution() override;
 
+  virtual void set_guiding(PathGuiding *guiding) override;
+
+  virtual void collect_memory_statistics(NamedSizeStats *stats) override;
+
   virtual void render_samples(RenderStatistics &statistics,
                               int start_sample,
                               int samples_num) override;
@@ -68,6 +72,13 @@ class PathTraceWorkCPU : public PathTraceWork {
                                     const KernelWorkTile &work_tile,
                                     const int samples_num);
 
+  /* Add radiance recorded at the vertices of a finished path to the path guiding training, and
+   * discard the vertices of its shadow catcher path. */
+  void guiding_record_path(IntegratorStateCPU *state, IntegratorStateCPU *shadow_catcher_state);
+
+  /* Gather pixels which are to be sampled further, after the adaptive sampling filter. */
+  void active_pixels_update();
+
   /* CPU kernels. */
   const CPUKernels &kernels_;
 
@@ -77,6 +88,19 @@ class PathTraceWorkCPU : public PathTraceWork {
    * accessing it, but some "localization" is required to decouple from kernel globals stored
    * on the device level. */
   vector<CPUKernelThreadGlobals> kernel_thread_globals_;
+
+  /* Path guiding which is being trained, nullptr when not training. */
+  PathGuiding *guiding_ = nullptr;
+
+  /* Compacted indices of pixels within the effective buffer which did not converge yet, in the
+   * scanline order. When adaptive sampling converged most of the image, work is only scheduled
+   * over these pixels so that all threads are kept busy with the remaining regions.
+   *
+   * Only valid for the buffer parameters it was gathered for, and until the render buffer is
+   * modified from outside of the path tracing. */
+  vector<int> active_pixels_;
+  BufferParams active_pixels_params_;
+  bool use_active_pixels_ = false;
 };
 
 CCL_NAMESPACE_END
@@ -22,6 +22,7 @@
 #include "integrator/pass_accessor_gpu.h"
 #include "render/buffers.h"
 #include "render/scene.h"
+#include "render/stats.h"
 #include "util/util_logging.h"
 #include "util/util_string.h"
 #include "util/util_tbb.h"
@@ -92,6 +93,27 @@ PathTraceWorkGPU::PathTraceWorkGPU(Device *device,
   min_num_active_paths_ = min(min_num_active_paths_, max_num_paths_ / 2);
 }
 
+void PathTraceWorkGPU::collect_memory_statistics(NamedSizeStats *stats)
+{
+  PathTraceWork::collect_memory_statistics(stats);
+
+  size_t state_size = 0;
+  for (auto &&soa_memory : integrator_state_soa_) {
+    state_size += soa_memory->memory_size();
+  }
+
+  const size_t queue_size = integrator_queue_counter_.memory_size() +
+                            integrator_shader_sort_counter_.memory_size() +
+                            integrator_shader_raytrace_sort_counter_.memory_size() +
+                            integrator_next_shadow_catcher_path_index_.memory_size() +
+                            queued_paths_.memory_size() + num_queued_paths_.memory_size() +
+                            work_tiles_.memory_size();
+
+  const string &device_name = device_->info.description;
+  stats->add_entry(NamedSizeEntry(device_name + " integrator state", state_size));
+  stats->add_entry(NamedSizeEntry(device_name + " integrator queues", queue_size));
+}
+
 void PathTraceWorkGPU::alloc_integrator_soa()
 {
   /* IntegrateState allocated as structure of arrays. */
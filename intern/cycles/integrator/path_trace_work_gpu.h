@@ -42,6 +42,7 @@ class PathTraceWorkGPU : public PathTraceWork {
                    bool *cancel_requested_flag);
 
   virtual void alloc_work_memory() override;
+  virtual void collect_memory_statistics(NamedSizeStats *stats) override;
   virtual void init_execution() override;
 
   virtual void render_samples(RenderStatistics &statistics,
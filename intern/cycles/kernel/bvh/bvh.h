@@ -42,6 +42,10 @@ CCL_NAMESPACE_BEGIN
 
 #  include "kernel/bvh/bvh_nodes.h"
 
+#  if defined(__BVH4__)
+#    include "kernel/bvh/bvh4_nodes.h"
+#  endif
+
 #  define BVH_FUNCTION_NAME bvh_intersect
 #  define BVH_FUNCTION_FEATURES 0
 #  include "kernel/bvh/bvh_traversal.h"
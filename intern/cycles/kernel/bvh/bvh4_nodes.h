@@ -0,0 +1,160 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Traversal of four-wide BVH nodes with quantized child bounds, see `bvh/bvh4.h` for the
+ * node layout. Only used by the CPU kernels. */
+
+#ifdef __KERNEL_SSE2__
+/* Convert four bytes packed into an unsigned integer to four floats. */
+ccl_device_forceinline ssef bvh4_unpack_bytes(const uint packed)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bytes = _mm_cvtsi32_si128((int)packed);
+  return ssef(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+#endif
+
+/* Intersect ray with the bounds of all children of the node.
+ * Returns bit mask of the intersected children, and distances to them. */
+ccl_device_forceinline int bvh4_node_intersect(ccl_global const KernelGlobals *kg,
+                                               const float3 P,
+                                               const float3 idir,
+                                               const float t,
+                                               const int node_addr,
+                                               const uint visibility,
+                                               float dist[4])
+{
+  const float4 cvisibility = kernel_tex_fetch(__bvh_nodes, node_addr + 1);
+  const float4 origin = kernel_tex_fetch(__bvh_nodes, node_addr + 2);
+  const float4 scale = kernel_tex_fetch(__bvh_nodes, node_addr + 3);
+  const float4 qxy = kernel_tex_fetch(__bvh_nodes, node_addr + 4);
+  const float4 qz = kernel_tex_fetch(__bvh_nodes, node_addr + 5);
+
+  int mask = 0;
+
+#ifdef __KERNEL_SSE2__
+  const ssef lower_x = ssef(origin.x) + bvh4_unpack_bytes(__float_as_uint(qxy.x)) * scale.x;
+  const ssef upper_x = ssef(origin.x) + bvh4_unpack_bytes(__float_as_uint(qxy.y)) * scale.x;
+  const ssef lower_y = ssef(origin.y) + bvh4_unpack_bytes(__float_as_uint(qxy.z)) * scale.y;
+  const ssef upper_y = ssef(origin.y) + bvh4_unpack_bytes(__float_as_uint(qxy.w)) * scale.y;
+  const ssef lower_z = ssef(origin.z) + bvh4_unpack_bytes(__float_as_uint(qz.x)) * scale.z;
+  const ssef upper_z = ssef(origin.z) + bvh4_unpack_bytes(__float_as_uint(qz.y)) * scale.z;
+
+  const ssef t_lower_x = (lower_x - ssef(P.x)) * idir.x;
+  const ssef t_upper_x = (upper_x - ssef(P.x)) * idir.x;
+  const ssef t_lower_y = (lower_y - ssef(P.y)) * idir.y;
+  const ssef t_upper_y = (upper_y - ssef(P.y)) * idir.y;
+  const ssef t_lower_z = (lower_z - ssef(P.z)) * idir.z;
+  const ssef t_upper_z = (upper_z - ssef(P.z)) * idir.z;
+
+  const ssef near = max(max(min(t_lower_x, t_upper_x), min(t_lower_y, t_upper_y)),
+                        max(min(t_lower_z, t_upper_z), ssef(0.0f)));
+  const ssef far = min(min(max(t_lower_x, t_upper_x), max(t_lower_y, t_upper_y)),
+                       min(max(t_lower_z, t_upper_z), ssef(t)));
+
+  const sseb hit = (near <= far);
+  storeu4f(dist, near);
+  mask = _mm_movemask_ps(hit.m128);
+#else
+  for (int i = 0; i < 4; ++i) {
+    const int shift = 8 * i;
+    const float lower_x = origin.x + ((__float_as_uint(qxy.x) >> shift) & 0xff) * scale.x;
+    const float upper_x = origin.x + ((__float_as_uint(qxy.y) >> shift) & 0xff) * scale.x;
+    const float lower_y = origin.y + ((__float_as_uint(qxy.z) >> shift) & 0xff) * scale.y;
+    const float upper_y = origin.y + ((__float_as_uint(qxy.w) >> shift) & 0xff) * scale.y;
+    const float lower_z = origin.z + ((__float_as_uint(qz.x) >> shift) & 0xff) * scale.z;
+    const float upper_z = origin.z + ((__float_as_uint(qz.y) >> shift) & 0xff) * scale.z;
+
+    const float t_lower_x = (lower_x - P.x) * idir.x;
+    const float t_upper_x = (upper_x - P.x) * idir.x;
+    const float t_lower_y = (lower_y - P.y) * idir.y;
+    const float t_upper_y = (upper_y - P.y) * idir.y;
+    const float t_lower_z = (lower_z - P.z) * idir.z;
+    const float t_upper_z = (upper_z - P.z) * idir.z;
+
+    const float near = max4(0.0f,
+                            min(t_lower_x, t_upper_x),
+                            min(t_lower_y, t_upper_y),
+                            min(t_lower_z, t_upper_z));
+    const float far = min4(t,
+                           max(t_lower_x, t_upper_x),
+                           max(t_lower_y, t_upper_y),
+                           max(t_lower_z, t_upper_z));
+    dist[i] = near;
+    mask |= (near <= far) ? (1 << i) : 0;
+  }
+#endif
+
+  /* Unused children have zero visibility, so they are never traversed. */
+  mask &= ((__float_as_uint(cvisibility.x) & visibility) ? 1 : 0) |
+          ((__float_as_uint(cvisibility.y) & visibility) ? 2 : 0) |
+          ((__float_as_uint(cvisibility.z) & visibility) ? 4 : 0) |
+          ((__float_as_uint(cvisibility.w) & visibility) ? 8 : 0);
+
+  return mask;
+}
+
+/* Traverse inner node: intersect its children, push all intersected children except the
+ * closest one on the stack, farthest first, and return address of the node to continue
+ * traversal with. */
+ccl_device_forceinline int bvh4_node_traverse(ccl_global const KernelGlobals *kg,
+                                              const float3 P,
+                                              const float3 idir,
+                                              const float t,
+                                              const int node_addr,
+                                              const uint visibility,
+                                              int *traversal_stack,
+                                              int *stack_ptr)
+{
+  float dist[4];
+  int mask = bvh4_node_intersect(kg, P, idir, t, node_addr, visibility, dist);
+
+  if (mask == 0) {
+    /* No child was intersected. */
+    return traversal_stack[(*stack_ptr)--];
+  }
+
+  const float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 0);
+  const int child[4] = {__float_as_int(cnodes.x),
+                        __float_as_int(cnodes.y),
+                        __float_as_int(cnodes.z),
+                        __float_as_int(cnodes.w)};
+
+  /* Sort intersected children by distance, closest first. */
+  int hit_child[4];
+  float hit_dist[4];
+  int num_hits = 0;
+  while (mask) {
+    const int i = __bsf((uint32_t)mask);
+    mask &= mask - 1;
+
+    int j = num_hits++;
+    for (; j > 0 && hit_dist[j - 1] > dist[i]; --j) {
+      hit_child[j] = hit_child[j - 1];
+      hit_dist[j] = hit_dist[j - 1];
+    }
+    hit_child[j] = child[i];
+    hit_dist[j] = dist[i];
+  }
+
+  for (int i = num_hits - 1; i > 0; --i) {
+    ++(*stack_ptr);
+    kernel_assert(*stack_ptr < BVH_STACK_SIZE);
+    traversal_stack[*stack_ptr] = hit_child[i];
+  }
+
+  return hit_child[0];
+}
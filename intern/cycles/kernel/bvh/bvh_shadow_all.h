@@ -84,6 +84,14 @@ ccl_device_inline
     do {
       /* traverse internal nodes */
       while (node_addr >= 0 && node_addr != ENTRYPOINT_SENTINEL) {
+#if defined(__BVH4__)
+        if (kernel_data.bvh.bvh_layout == BVH_LAYOUT_BVH4) {
+          node_addr = bvh4_node_traverse(
+              kg, P, idir, t_max_current, node_addr, visibility, traversal_stack, &stack_ptr);
+          continue;
+        }
+#endif
+
         int node_addr_child1, traverse_mask;
         float dist[2];
         float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 0);
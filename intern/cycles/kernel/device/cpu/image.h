@@ -22,6 +22,9 @@
 #  include <nanovdb/util/SampleFromVoxels.h>
 #endif
 
+#include "util/util_hash.h"
+#include "util/util_texture_cache.h"
+
 CCL_NAMESPACE_BEGIN
 
 /* Make template functions private so symbols don't conflict between kernels with different
@@ -44,6 +47,32 @@ ccl_device_inline float frac(float x, int *ix)
   return x - (float)i;
 }
 
+/* Fetch a texel from 2D image data, decoding block compressed data. */
+template<typename T> struct TextureFetch {
+  static ccl_always_inline const T &fetch(const T *data, int x, int y, int width)
+  {
+    return data[x + y * width];
+  }
+};
+
+template<typename T, typename DecodedT> struct TextureBlockFetch {
+  static ccl_always_inline DecodedT fetch(const T *data, int x, int y, int width)
+  {
+    const int width_blocks = (width + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+    const T &block = data[(x / TEXTURE_BLOCK_SIZE) + (y / TEXTURE_BLOCK_SIZE) * width_blocks];
+    return texture_block_decode(
+        block, (x % TEXTURE_BLOCK_SIZE) + (y % TEXTURE_BLOCK_SIZE) * TEXTURE_BLOCK_SIZE);
+  }
+};
+
+template<>
+struct TextureFetch<TextureBlockHalf> : public TextureBlockFetch<TextureBlockHalf, float> {
+};
+
+template<>
+struct TextureFetch<TextureBlockHalf4> : public TextureBlockFetch<TextureBlockHalf4, float4> {
+};
+
 template<typename T> struct TextureInterpolator {
 
   static ccl_always_inline float4 read(float4 r)
@@ -98,7 +127,7 @@ template<typename T> struct TextureInterpolator {
     if (x < 0 || y < 0 || x >= width || y >= height) {
       return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
     }
-    return read(data[y * width + x]);
+    return read(TextureFetch<T>::fetch(data, x, y, width));
   }
 
   static ccl_always_inline int wrap_periodic(int x, int width)
@@ -142,7 +171,7 @@ template<typename T> struct TextureInterpolator {
         kernel_assert(0);
         return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
     }
-    return read(data[ix + iy * width]);
+    return read(TextureFetch<T>::fetch(data, ix, iy, width));
   }
 
   static ccl_always_inline float4 interp_linear(const TextureInfo &info, float x, float y)
@@ -581,12 +610,281 @@ template<typename T> struct NanoVDBInterpolator {
 };
 #endif
 
+/* Interpolation of images in the texture cache, with pixels looked up in tiles that are loaded
+ * on demand. */
+template<typename T> struct TextureCacheInterpolator {
+  /* Reads pixels from one mipmap level. Neighboring pixels are most likely in the same tile, so
+   * the last tile is kept to avoid looking it up again. */
+  struct LevelReader {
+    TextureCacheImage *image;
+    int level;
+    int width, height;
+    uint thread_hash;
+
+    int tile_x, tile_y, tile_width;
+    const T *tile;
+
+    ccl_always_inline LevelReader(TextureCacheImage *image, const int level, const uint thread_hash)
+        : image(image),
+          level(level),
+          width(image->levels[level].width),
+          height(image->levels[level].height),
+          thread_hash(thread_hash),
+          tile_x(-1),
+          tile_y(-1),
+          tile_width(0),
+          tile(NULL)
+    {
+    }
+
+    ccl_always_inline float4 read(const int x, const int y)
+    {
+      const int tx = x >> TEXTURE_CACHE_TILE_SIZE_LOG2;
+      const int ty = y >> TEXTURE_CACHE_TILE_SIZE_LOG2;
+      if (tx != tile_x || ty != tile_y) {
+        tile = (const T *)image->tile(level, tx, ty, thread_hash);
+        tile_x = tx;
+        tile_y = ty;
+        tile_width = min(TEXTURE_CACHE_TILE_SIZE, width - (tx << TEXTURE_CACHE_TILE_SIZE_LOG2));
+      }
+      const int ix = x & (TEXTURE_CACHE_TILE_SIZE - 1);
+      const int iy = y & (TEXTURE_CACHE_TILE_SIZE - 1);
+      return TextureInterpolator<T>::read(tile[iy * tile_width + ix]);
+    }
+
+    ccl_always_inline float4 read_clip(const int x, const int y)
+    {
+      if (x < 0 || y < 0 || x >= width || y >= height) {
+        return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+      }
+      return read(x, y);
+    }
+  };
+
+  static ccl_always_inline int wrap_periodic(int x, int width)
+  {
+    return TextureInterpolator<T>::wrap_periodic(x, width);
+  }
+
+  static ccl_always_inline int wrap_clamp(int x, int width)
+  {
+    return TextureInterpolator<T>::wrap_clamp(x, width);
+  }
+
+  static ccl_always_inline float4 interp_closest(LevelReader &reader,
+                                                 const TextureInfo &info,
+                                                 float x,
+                                                 float y)
+  {
+    const int width = reader.width;
+    const int height = reader.height;
+    int ix, iy;
+    frac(x * (float)width, &ix);
+    frac(y * (float)height, &iy);
+    switch (info.extension) {
+      case EXTENSION_REPEAT:
+        ix = wrap_periodic(ix, width);
+        iy = wrap_periodic(iy, height);
+        break;
+      case EXTENSION_CLIP:
+        if (x < 0.0f || y < 0.0f || x > 1.0f || y > 1.0f) {
+          return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+        }
+        ATTR_FALLTHROUGH;
+      case EXTENSION_EXTEND:
+        ix = wrap_clamp(ix, width);
+        iy = wrap_clamp(iy, height);
+        break;
+      default:
+        kernel_assert(0);
+        return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    return reader.read(ix, iy);
+  }
+
+  static ccl_always_inline float4 interp_linear(LevelReader &reader,
+                                                const TextureInfo &info,
+                                                float x,
+                                                float y)
+  {
+    const int width = reader.width;
+    const int height = reader.height;
+    int ix, iy, nix, niy;
+    const float tx = frac(x * (float)width - 0.5f, &ix);
+    const float ty = frac(y * (float)height - 0.5f, &iy);
+    switch (info.extension) {
+      case EXTENSION_REPEAT:
+        ix = wrap_periodic(ix, width);
+        iy = wrap_periodic(iy, height);
+        nix = wrap_periodic(ix + 1, width);
+        niy = wrap_periodic(iy + 1, height);
+        break;
+      case EXTENSION_CLIP:
+        nix = ix + 1;
+        niy = iy + 1;
+        break;
+      case EXTENSION_EXTEND:
+        nix = wrap_clamp(ix + 1, width);
+        niy = wrap_clamp(iy + 1, height);
+        ix = wrap_clamp(ix, width);
+        iy = wrap_clamp(iy, height);
+        break;
+      default:
+        kernel_assert(0);
+        return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    return (1.0f - ty) * (1.0f - tx) * reader.read_clip(ix, iy) +
+           (1.0f - ty) * tx * reader.read_clip(nix, iy) +
+           ty * (1.0f - tx) * reader.read_clip(ix, niy) + ty * tx * reader.read_clip(nix, niy);
+  }
+
+  static ccl_always_inline float4 interp_cubic(LevelReader &reader,
+                                               const TextureInfo &info,
+                                               float x,
+                                               float y)
+  {
+    const int width = reader.width;
+    const int height = reader.height;
+    int ix, iy, nix, niy;
+    const float tx = frac(x * (float)width - 0.5f, &ix);
+    const float ty = frac(y * (float)height - 0.5f, &iy);
+    int pix, piy, nnix, nniy;
+    switch (info.extension) {
+      case EXTENSION_REPEAT:
+        ix = wrap_periodic(ix, width);
+        iy = wrap_periodic(iy, height);
+        pix = wrap_periodic(ix - 1, width);
+        piy = wrap_periodic(iy - 1, height);
+        nix = wrap_periodic(ix + 1, width);
+        niy = wrap_periodic(iy + 1, height);
+        nnix = wrap_periodic(ix + 2, width);
+        nniy = wrap_periodic(iy + 2, height);
+        break;
+      case EXTENSION_CLIP:
+        pix = ix - 1;
+        piy = iy - 1;
+        nix = ix + 1;
+        niy = iy + 1;
+        nnix = ix + 2;
+        nniy = iy + 2;
+        break;
+      case EXTENSION_EXTEND:
+        pix = wrap_clamp(ix - 1, width);
+        piy = wrap_clamp(iy - 1, height);
+        nix = wrap_clamp(ix + 1, width);
+        niy = wrap_clamp(iy + 1, height);
+        nnix = wrap_clamp(ix + 2, width);
+        nniy = wrap_clamp(iy + 2, height);
+        ix = wrap_clamp(ix, width);
+        iy = wrap_clamp(iy, height);
+        break;
+      default:
+        kernel_assert(0);
+        return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    const int xc[4] = {pix, ix, nix, nnix};
+    const int yc[4] = {piy, iy, niy, nniy};
+    float u[4], v[4];
+#define DATA(x, y) (reader.read_clip(xc[x], yc[y]))
+#define TERM(col) \
+  (v[col] * \
+   (u[0] * DATA(0, col) + u[1] * DATA(1, col) + u[2] * DATA(2, col) + u[3] * DATA(3, col)))
+
+    SET_CUBIC_SPLINE_WEIGHTS(u, tx);
+    SET_CUBIC_SPLINE_WEIGHTS(v, ty);
+
+    return TERM(0) + TERM(1) + TERM(2) + TERM(3);
+#undef TERM
+#undef DATA
+  }
+
+  static ccl_always_inline float4 interp_level(LevelReader &reader,
+                                               const TextureInfo &info,
+                                               float x,
+                                               float y)
+  {
+    switch (info.interpolation) {
+      case INTERPOLATION_CLOSEST:
+        return interp_closest(reader, info, x, y);
+      case INTERPOLATION_LINEAR:
+        return interp_linear(reader, info, x, y);
+      default:
+        return interp_cubic(reader, info, x, y);
+    }
+  }
+
+  static ccl_always_inline float4
+  interp(const KernelGlobals *kg, const TextureInfo &info, float x, float y, float lod)
+  {
+    TextureCacheImage *image = (TextureCacheImage *)info.cache;
+
+    /* Every thread has its own kernel globals, use them to spread hit counting over multiple
+     * counters. */
+    const uint thread_hash = hash_uint((uint)(((uintptr_t)kg) >> 4));
+
+    lod = clamp(lod, (float)image->min_level, (float)(image->num_levels - 1));
+
+    if (info.interpolation == INTERPOLATION_CLOSEST) {
+      LevelReader reader(image, (int)(lod + 0.5f), thread_hash);
+      return interp_level(reader, info, x, y);
+    }
+
+    /* Blend between two mipmap levels, to avoid visible transitions. */
+    const int level = (int)lod;
+    const float t = lod - (float)level;
+
+    LevelReader reader(image, level, thread_hash);
+    float4 result = interp_level(reader, info, x, y);
+
+    if (t > 0.0f) {
+      LevelReader next_reader(image, level + 1, thread_hash);
+      result = (1.0f - t) * result + t * interp_level(next_reader, info, x, y);
+    }
+
+    return result;
+  }
+};
+
 #undef SET_CUBIC_SPLINE_WEIGHTS
 
+ccl_device float4 kernel_tex_image_interp_cache(const KernelGlobals *kg,
+                                                const TextureInfo &info,
+                                                float x,
+                                                float y,
+                                                float lod)
+{
+  switch (info.data_type) {
+    case IMAGE_DATA_TYPE_HALF:
+      return TextureCacheInterpolator<half>::interp(kg, info, x, y, lod);
+    case IMAGE_DATA_TYPE_BYTE:
+      return TextureCacheInterpolator<uchar>::interp(kg, info, x, y, lod);
+    case IMAGE_DATA_TYPE_USHORT:
+      return TextureCacheInterpolator<uint16_t>::interp(kg, info, x, y, lod);
+    case IMAGE_DATA_TYPE_FLOAT:
+      return TextureCacheInterpolator<float>::interp(kg, info, x, y, lod);
+    case IMAGE_DATA_TYPE_HALF4:
+      return TextureCacheInterpolator<half4>::interp(kg, info, x, y, lod);
+    case IMAGE_DATA_TYPE_BYTE4:
+      return TextureCacheInterpolator<uchar4>::interp(kg, info, x, y, lod);
+    case IMAGE_DATA_TYPE_USHORT4:
+      return TextureCacheInterpolator<ushort4>::interp(kg, info, x, y, lod);
+    case IMAGE_DATA_TYPE_FLOAT4:
+      return TextureCacheInterpolator<float4>::interp(kg, info, x, y, lod);
+    default:
+      assert(0);
+      return make_float4(
+          TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
+  }
+}
+
 ccl_device float4 kernel_tex_image_interp(const KernelGlobals *kg, int id, float x, float y)
 {
   const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
 
+  if (info.cache) {
+    return kernel_tex_image_interp_cache(kg, info, x, y, 0.0f);
+  }
+
   switch (info.data_type) {
     case IMAGE_DATA_TYPE_HALF:
       return TextureInterpolator<half>::interp(info, x, y);
@@ -604,6 +902,10 @@ ccl_device float4 kernel_tex_image_interp(const KernelGlobals *kg, int id, float
       return TextureInterpolator<ushort4>::interp(info, x, y);
     case IMAGE_DATA_TYPE_FLOAT4:
       return TextureInterpolator<float4>::interp(info, x, y);
+    case IMAGE_DATA_TYPE_BLOCK_HALF:
+      return TextureInterpolator<TextureBlockHalf>::interp(info, x, y);
+    case IMAGE_DATA_TYPE_BLOCK_HALF4:
+      return TextureInterpolator<TextureBlockHalf4>::interp(info, x, y);
     default:
       assert(0);
       return make_float4(
@@ -611,6 +913,29 @@ ccl_device float4 kernel_tex_image_interp(const KernelGlobals *kg, int id, float
   }
 }
 
+/* Lookup with differentials of the texture coordinate, which are used to select the mipmap
+ * level for images in the texture cache. */
+ccl_device float4 kernel_tex_image_interp_diff(
+    const KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy)
+{
+  const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
+
+  if (!info.cache) {
+    return kernel_tex_image_interp(kg, id, x, y);
+  }
+
+  /* Size of the footprint in pixels of the full resolution level. */
+  const TextureCacheImage *image = (const TextureCacheImage *)info.cache;
+  const float width = (float)image->levels[0].width;
+  const float height = (float)image->levels[0].height;
+  const float dx_len_sq = sqr(dx.x * width) + sqr(dx.y * height);
+  const float dy_len_sq = sqr(dy.x * width) + sqr(dy.y * height);
+  const float footprint_sq = max(dx_len_sq, dy_len_sq);
+  const float lod = (footprint_sq > 1.0f) ? 0.5f * log2f(footprint_sq) : 0.0f;
+
+  return kernel_tex_image_interp_cache(kg, info, x, y, lod);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(const KernelGlobals *kg,
                                              int id,
                                              float3 P,
@@ -214,8 +214,8 @@ ccl_device float curve_thickness(ccl_global const KernelGlobals *kg,
     float4 P_curve[2];
 
     if (!(sd->type & PRIMITIVE_ALL_MOTION)) {
-      P_curve[0] = kernel_tex_fetch(__curve_keys, k0);
-      P_curve[1] = kernel_tex_fetch(__curve_keys, k1);
+      P_curve[0] = curve_key(kg, sd->prim, k0);
+      P_curve[1] = curve_key(kg, sd->prim, k1);
     }
     else {
       motion_curve_keys_linear(kg, sd->object, sd->prim, sd->time, k0, k1, P_curve);
@@ -239,8 +239,8 @@ ccl_device float3 curve_motion_center_location(ccl_global const KernelGlobals *k
 
   float4 P_curve[2];
 
-  P_curve[0] = kernel_tex_fetch(__curve_keys, k0);
-  P_curve[1] = kernel_tex_fetch(__curve_keys, k1);
+  P_curve[0] = curve_key(kg, sd->prim, k0);
+  P_curve[1] = curve_key(kg, sd->prim, k1);
 
   return float4_to_float3(P_curve[1]) * sd->u + float4_to_float3(P_curve[0]) * (1.0f - sd->u);
 }
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+CCL_NAMESPACE_BEGIN
+
+/* Curve Keys
+ *
+ * Keys are stored as a float4 of position and radius, or in 8 bytes when the scene uses quantized
+ * curve keys. Quantized positions and radius are 16 bit integers relative to the bounds of their
+ * curve. Bounds are stored as two float4 per curve: the minimum corner and radius, and the
+ * quantization steps. */
+
+#ifdef __HAIR__
+
+ccl_device_inline float4 curve_key(ccl_global const KernelGlobals *kg, int prim, int k)
+{
+  if (!kernel_data.bvh.curve_keys_quantized) {
+    return kernel_tex_fetch(__curve_keys, k);
+  }
+
+  const float4 bounds_min = kernel_tex_fetch(__curve_key_bounds, prim * 2);
+  const float4 bounds_step = kernel_tex_fetch(__curve_key_bounds, prim * 2 + 1);
+  const uint2 key = kernel_tex_fetch(__curve_keys_quantized, k);
+
+  return make_float4(bounds_min.x + (float)(key.x & 0xffff) * bounds_step.x,
+                     bounds_min.y + (float)(key.x >> 16) * bounds_step.y,
+                     bounds_min.z + (float)(key.y & 0xffff) * bounds_step.z,
+                     bounds_min.w + (float)(key.y >> 16) * bounds_step.w);
+}
+
+#endif
+
+CCL_NAMESPACE_END
@@ -28,6 +28,7 @@ CCL_NAMESPACE_BEGIN
 #ifdef __HAIR__
 
 ccl_device_inline void motion_curve_keys_for_step_linear(ccl_global const KernelGlobals *kg,
+                                                         int prim,
                                                          int offset,
                                                          int numkeys,
                                                          int numsteps,
@@ -38,8 +39,8 @@ ccl_device_inline void motion_curve_keys_for_step_linear(ccl_global const Kernel
 {
   if (step == numsteps) {
     /* center step: regular key location */
-    keys[0] = kernel_tex_fetch(__curve_keys, k0);
-    keys[1] = kernel_tex_fetch(__curve_keys, k1);
+    keys[0] = curve_key(kg, prim, k0);
+    keys[1] = curve_key(kg, prim, k1);
   }
   else {
     /* center step is not stored in this array */
@@ -78,8 +79,9 @@ ccl_device_inline void motion_curve_keys_linear(ccl_global const KernelGlobals *
   /* fetch key coordinates */
   float4 next_keys[2];
 
-  motion_curve_keys_for_step_linear(kg, offset, numkeys, numsteps, step, k0, k1, keys);
-  motion_curve_keys_for_step_linear(kg, offset, numkeys, numsteps, step + 1, k0, k1, next_keys);
+  motion_curve_keys_for_step_linear(kg, prim, offset, numkeys, numsteps, step, k0, k1, keys);
+  motion_curve_keys_for_step_linear(
+      kg, prim, offset, numkeys, numsteps, step + 1, k0, k1, next_keys);
 
   /* interpolate between steps */
   keys[0] = (1.0f - t) * keys[0] + t * next_keys[0];
@@ -87,6 +89,7 @@ ccl_device_inline void motion_curve_keys_linear(ccl_global const KernelGlobals *
 }
 
 ccl_device_inline void motion_curve_keys_for_step(ccl_global const KernelGlobals *kg,
+                                                  int prim,
                                                   int offset,
                                                   int numkeys,
                                                   int numsteps,
@@ -99,10 +102,10 @@ ccl_device_inline void motion_curve_keys_for_step(ccl_global const KernelGlobals
 {
   if (step == numsteps) {
     /* center step: regular key location */
-    keys[0] = kernel_tex_fetch(__curve_keys, k0);
-    keys[1] = kernel_tex_fetch(__curve_keys, k1);
-    keys[2] = kernel_tex_fetch(__curve_keys, k2);
-    keys[3] = kernel_tex_fetch(__curve_keys, k3);
+    keys[0] = curve_key(kg, prim, k0);
+    keys[1] = curve_key(kg, prim, k1);
+    keys[2] = curve_key(kg, prim, k2);
+    keys[3] = curve_key(kg, prim, k3);
   }
   else {
     /* center step is not stored in this array */
@@ -145,8 +148,9 @@ ccl_device_inline void motion_curve_keys(ccl_global const KernelGlobals *kg,
   /* fetch key coordinates */
   float4 next_keys[4];
 
-  motion_curve_keys_for_step(kg, offset, numkeys, numsteps, step, k0, k1, k2, k3, keys);
-  motion_curve_keys_for_step(kg, offset, numkeys, numsteps, step + 1, k0, k1, k2, k3, next_keys);
+  motion_curve_keys_for_step(kg, prim, offset, numkeys, numsteps, step, k0, k1, k2, k3, keys);
+  motion_curve_keys_for_step(
+      kg, prim, offset, numkeys, numsteps, step + 1, k0, k1, k2, k3, next_keys);
 
   /* interpolate between steps */
   keys[0] = (1.0f - t) * keys[0] + t * next_keys[0];
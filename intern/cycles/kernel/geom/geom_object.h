@@ -35,6 +35,14 @@ enum ObjectTransform {
 
 enum ObjectVectorTransform { OBJECT_PASS_MOTION_PRE = 0, OBJECT_PASS_MOTION_POST = 1 };
 
+/* Data shared by objects with the same geometry and settings */
+
+ccl_device_inline ccl_global const KernelObjectPrototype *object_prototype(
+    ccl_global const KernelGlobals *kg, int object)
+{
+  return &kernel_tex_fetch(__object_prototypes, kernel_tex_fetch(__objects, object).prototype);
+}
+
 /* Object to world space transformation */
 
 ccl_device_inline Transform object_fetch_transform(ccl_global const KernelGlobals *kg,
@@ -82,7 +90,7 @@ ccl_device_inline Transform object_fetch_transform_motion(ccl_global const Kerne
 {
   const uint motion_offset = kernel_tex_fetch(__objects, object).motion_offset;
   ccl_global const DecomposedTransform *motion = &kernel_tex_fetch(__object_motion, motion_offset);
-  const uint num_steps = kernel_tex_fetch(__objects, object).numsteps * 2 + 1;
+  const uint num_steps = object_prototype(kg, object)->numsteps * 2 + 1;
 
   Transform tfm;
   transform_motion_array_interpolate(&tfm, motion, num_steps, time);
@@ -275,8 +283,8 @@ ccl_device_inline float3 object_color(ccl_global const KernelGlobals *kg, int ob
   if (object == OBJECT_NONE)
     return make_float3(0.0f, 0.0f, 0.0f);
 
-  ccl_global const KernelObject *kobject = &kernel_tex_fetch(__objects, object);
-  return make_float3(kobject->color[0], kobject->color[1], kobject->color[2]);
+  ccl_global const KernelObjectPrototype *kprototype = object_prototype(kg, object);
+  return make_float3(kprototype->color[0], kprototype->color[1], kprototype->color[2]);
 }
 
 /* Pass ID number of object */
@@ -286,7 +294,7 @@ ccl_device_inline float object_pass_id(ccl_global const KernelGlobals *kg, int o
   if (object == OBJECT_NONE)
     return 0.0f;
 
-  return kernel_tex_fetch(__objects, object).pass_id;
+  return object_prototype(kg, object)->pass_id;
 }
 
 /* Per lamp random number for shader variation */
@@ -350,14 +358,16 @@ ccl_device_inline void object_motion_info(ccl_global const KernelGlobals *kg,
                                           ccl_private int *numverts,
                                           ccl_private int *numkeys)
 {
+  ccl_global const KernelObjectPrototype *kprototype = object_prototype(kg, object);
+
   if (numkeys) {
-    *numkeys = kernel_tex_fetch(__objects, object).numkeys;
+    *numkeys = kprototype->numkeys;
   }
 
   if (numsteps)
-    *numsteps = kernel_tex_fetch(__objects, object).numsteps;
+    *numsteps = kprototype->numsteps;
   if (numverts)
-    *numverts = kernel_tex_fetch(__objects, object).numverts;
+    *numverts = kprototype->numverts;
 }
 
 /* Offset to an objects patch map */
@@ -367,7 +377,7 @@ ccl_device_inline uint object_patch_map_offset(ccl_global const KernelGlobals *k
   if (object == OBJECT_NONE)
     return 0;
 
-  return kernel_tex_fetch(__objects, object).patch_map_offset;
+  return object_prototype(kg, object)->patch_map_offset;
 }
 
 /* Volume step size */
@@ -404,7 +414,7 @@ ccl_device_inline float object_cryptomatte_id(ccl_global const KernelGlobals *kg
   if (object == OBJECT_NONE)
     return 0.0f;
 
-  return kernel_tex_fetch(__objects, object).cryptomatte_object;
+  return object_prototype(kg, object)->cryptomatte_object;
 }
 
 ccl_device_inline float object_cryptomatte_asset_id(ccl_global const KernelGlobals *kg, int object)
@@ -412,7 +422,7 @@ ccl_device_inline float object_cryptomatte_asset_id(ccl_global const KernelGloba
   if (object == OBJECT_NONE)
     return 0;
 
-  return kernel_tex_fetch(__objects, object).cryptomatte_asset;
+  return object_prototype(kg, object)->cryptomatte_asset;
 }
 
 /* Particle data from which object was instanced */
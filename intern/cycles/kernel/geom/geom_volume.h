@@ -92,6 +92,115 @@ ccl_device float4 volume_attribute_float4(ccl_global const KernelGlobals *kg,
   }
 }
 
+/* Volume Occupancy
+ *
+ * Coarse grid of cells containing active voxels, used to step over empty space. Rays are
+ * transformed to cell coordinates once, and then walked through the grid cell by cell. */
+
+ccl_device_inline int volume_occupancy_grid(ccl_global const KernelGlobals *kg, const int object)
+{
+  if (object == OBJECT_NONE || !kernel_data.integrator.volume_skip_empty) {
+    return -1;
+  }
+  /* Without a single object space, the grid can't be used to find empty space. */
+  if (kernel_tex_fetch(__object_flag, object) & SD_OBJECT_MOTION) {
+    return -1;
+  }
+  return object_prototype(kg, object)->volume_occupancy;
+}
+
+ccl_device_inline void volume_occupancy_ray(ccl_global const KernelGlobals *kg,
+                                            const int grid,
+                                            const int object,
+                                            const float3 P,
+                                            const float3 D,
+                                            ccl_private float3 *cell_P,
+                                            ccl_private float3 *cell_D)
+{
+  const Transform itfm = object_fetch_transform(kg, object, OBJECT_INVERSE_TRANSFORM);
+  const Transform tfm = kernel_tex_fetch(__volume_occupancy, grid).tfm;
+  *cell_P = transform_point(&tfm, transform_point(&itfm, P));
+  *cell_D = transform_direction(&tfm, transform_direction(&itfm, D));
+}
+
+/* Distance along the ray at which it enters an occupied cell, starting from t. Returns t_max when
+ * there are no occupied cells before it. */
+ccl_device float volume_occupancy_next_occupied(ccl_global const KernelGlobals *kg,
+                                                const int grid,
+                                                const float3 cell_P,
+                                                const float3 cell_D,
+                                                const float t,
+                                                const float t_max)
+{
+  ccl_global const KernelVolumeOccupancy *occupancy = &kernel_tex_fetch(__volume_occupancy, grid);
+  const float P[3] = {cell_P.x, cell_P.y, cell_P.z};
+  const float D[3] = {cell_D.x, cell_D.y, cell_D.z};
+
+  /* Clip ray to the bounds of the grid. */
+  float t_enter = t, t_exit = t_max;
+  for (int axis = 0; axis < 3; axis++) {
+    const float res = (float)occupancy->resolution[axis];
+    if (D[axis] == 0.0f) {
+      if (P[axis] < 0.0f || P[axis] > res) {
+        return t_max;
+      }
+      continue;
+    }
+    const float inv_d = 1.0f / D[axis];
+    const float t0 = -P[axis] * inv_d;
+    const float t1 = (res - P[axis]) * inv_d;
+    t_enter = fmaxf(t_enter, fminf(t0, t1));
+    t_exit = fminf(t_exit, fmaxf(t0, t1));
+  }
+  if (t_enter >= t_exit) {
+    return t_max;
+  }
+
+  /* Walk through the cells along the ray. */
+  int cell[3], step[3];
+  float t_next[3], t_delta[3];
+  for (int axis = 0; axis < 3; axis++) {
+    const float p = P[axis] + D[axis] * t_enter;
+    cell[axis] = clamp((int)floorf(p), 0, occupancy->resolution[axis] - 1);
+    if (D[axis] > 0.0f) {
+      step[axis] = 1;
+      t_delta[axis] = 1.0f / D[axis];
+      t_next[axis] = t_enter + (cell[axis] + 1 - p) * t_delta[axis];
+    }
+    else if (D[axis] < 0.0f) {
+      step[axis] = -1;
+      t_delta[axis] = -1.0f / D[axis];
+      t_next[axis] = t_enter + (p - cell[axis]) * t_delta[axis];
+    }
+    else {
+      step[axis] = 0;
+      t_delta[axis] = FLT_MAX;
+      t_next[axis] = FLT_MAX;
+    }
+  }
+
+  float t_cell = t_enter;
+  while (t_cell < t_exit) {
+    const int index = cell[0] + occupancy->resolution[0] *
+                                    (cell[1] + occupancy->resolution[1] * cell[2]);
+    const uint bits = kernel_tex_fetch(__volume_occupancy_cells, occupancy->offset + index / 32);
+    if (bits & (1u << (index % 32))) {
+      return t_cell;
+    }
+
+    const int axis = (t_next[0] < t_next[1]) ? ((t_next[0] < t_next[2]) ? 0 : 2) :
+                                               ((t_next[1] < t_next[2]) ? 1 : 2);
+    cell[axis] += step[axis];
+    if (cell[axis] < 0 || cell[axis] >= occupancy->resolution[axis]) {
+      break;
+    }
+    t_cell = t_next[axis];
+    t_next[axis] += t_delta[axis];
+  }
+
+  return t_max;
+}
+
 #endif
 
 CCL_NAMESPACE_END
@@ -162,7 +162,7 @@ ccl_device void integrator_intersect_closest(INTEGRATOR_STATE_ARGS)
   if (path_state_ao_bounce(INTEGRATOR_STATE_PASS)) {
     ray.t = kernel_data.integrator.ao_bounces_distance;
 
-    const float object_ao_distance = kernel_tex_fetch(__objects, last_isect_object).ao_distance;
+    const float object_ao_distance = object_prototype(kg, last_isect_object)->ao_distance;
     if (object_ao_distance != 0.0f) {
       ray.t = object_ao_distance;
     }
@@ -19,6 +19,7 @@
 #include "kernel/kernel_accumulate.h"
 #include "kernel/kernel_emission.h"
 #include "kernel/kernel_light.h"
+#include "kernel/kernel_path_guiding.h"
 #include "kernel/kernel_shader.h"
 
 CCL_NAMESPACE_BEGIN
@@ -90,6 +91,10 @@ ccl_device_inline void integrate_light(INTEGRATOR_STATE_ARGS,
   /* Write to render buffer. */
   const float3 throughput = INTEGRATOR_STATE(path, throughput);
   kernel_accum_emission(INTEGRATOR_STATE_PASS, throughput, light_eval, render_buffer);
+
+#ifdef __PATH_GUIDING__
+  guiding_record_emission(INTEGRATOR_STATE_PASS, throughput * light_eval);
+#endif
 }
 
 ccl_device void integrator_shade_light(INTEGRATOR_STATE_ARGS,
@@ -19,6 +19,7 @@
 #include "kernel/integrator/integrator_shade_volume.h"
 #include "kernel/integrator/integrator_volume_stack.h"
 
+#include "kernel/kernel_path_guiding.h"
 #include "kernel/kernel_shader.h"
 
 CCL_NAMESPACE_BEGIN
@@ -95,7 +96,13 @@ ccl_device_inline void integrate_transparent_volume_shadow(INTEGRATOR_STATE_ARGS
     return integrator_state_read_shadow_volume_stack(INTEGRATOR_STATE_PASS, i);
   });
 
-  volume_shadow_heterogeneous(INTEGRATOR_STATE_PASS, &ray, shadow_sd, throughput, step_size);
+  const int occupancy_object = volume_stack_occupancy_object(
+      INTEGRATOR_STATE_PASS, [=](const int i) {
+        return integrator_state_read_shadow_volume_stack(INTEGRATOR_STATE_PASS, i);
+      });
+
+  volume_shadow_heterogeneous(
+      INTEGRATOR_STATE_PASS, &ray, shadow_sd, throughput, step_size, occupancy_object);
 }
 #  endif
 
@@ -175,6 +182,9 @@ ccl_device void integrator_shade_shadow(INTEGRATOR_STATE_ARGS,
   }
   else {
     kernel_accum_light(INTEGRATOR_STATE_PASS, render_buffer);
+#ifdef __PATH_GUIDING__
+    guiding_record_shadow(INTEGRATOR_STATE_PASS, INTEGRATOR_STATE(shadow_path, throughput));
+#endif
     INTEGRATOR_SHADOW_PATH_TERMINATE(DEVICE_KERNEL_INTEGRATOR_SHADE_SHADOW);
     return;
   }
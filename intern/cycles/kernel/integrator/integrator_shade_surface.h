@@ -20,6 +20,7 @@
 #include "kernel/kernel_emission.h"
 #include "kernel/kernel_light.h"
 #include "kernel/kernel_passes.h"
+#include "kernel/kernel_path_guiding.h"
 #include "kernel/kernel_path_state.h"
 #include "kernel/kernel_shader.h"
 
@@ -66,7 +67,7 @@ ccl_device_forceinline bool integrate_surface_holdout(INTEGRATOR_STATE_CONST_ARG
 #endif /* __HOLDOUT__ */
 
 #ifdef __EMISSION__
-ccl_device_forceinline void integrate_surface_emission(INTEGRATOR_STATE_CONST_ARGS,
+ccl_device_forceinline void integrate_surface_emission(INTEGRATOR_STATE_ARGS,
                                                        ccl_private const ShaderData *sd,
                                                        ccl_global float *ccl_restrict
                                                            render_buffer)
@@ -96,15 +97,34 @@ ccl_device_forceinline void integrate_surface_emission(INTEGRATOR_STATE_CONST_AR
 
   const float3 throughput = INTEGRATOR_STATE(path, throughput);
   kernel_accum_emission(INTEGRATOR_STATE_PASS, throughput, L, render_buffer);
+
+#  ifdef __PATH_GUIDING__
+  guiding_record_emission(INTEGRATOR_STATE_PASS, throughput * L);
+#  endif
 }
 #endif /* __EMISSION__ */
 
+/* Root of the path guiding directional distribution at the shading point, or -1 if directions
+ * are not guided. Only BSDFs that can be evaluated are guided, singular ones and BSSRDFs are
+ * always sampled directly. */
+ccl_device_forceinline int integrate_surface_guiding_root(ccl_global const KernelGlobals *kg,
+                                                          ccl_private const ShaderData *sd)
+{
+#ifdef __PATH_GUIDING__
+  if ((sd->flag & SD_BSDF_HAS_EVAL) && !(sd->flag & SD_BSSRDF)) {
+    return guiding_spatial_lookup(kg, sd->P);
+  }
+#endif
+  return -1;
+}
+
 #ifdef __EMISSION__
 /* Path tracing: sample point on light and evaluate light shader, then
  * queue shadow ray to be traced. */
 ccl_device_forceinline void integrate_surface_direct_light(INTEGRATOR_STATE_ARGS,
                                                            ccl_private ShaderData *sd,
-                                                           ccl_private const RNGState *rng_state)
+                                                           ccl_private const RNGState *rng_state,
+                                                           const int guiding_root)
 {
   /* Test if there is a light or BSDF that needs direct light. */
   if (!(kernel_data.integrator.use_direct_light && (sd->flag & SD_BSDF_HAS_EVAL))) {
@@ -145,9 +165,15 @@ ccl_device_forceinline void integrate_surface_direct_light(INTEGRATOR_STATE_ARGS
   const bool is_transmission = shader_bsdf_is_transmission(sd, ls.D);
 
   BsdfEval bsdf_eval ccl_optional_struct_init;
-  const float bsdf_pdf = shader_bsdf_eval(kg, sd, ls.D, is_transmission, &bsdf_eval, ls.shader);
+  float bsdf_pdf = shader_bsdf_eval(kg, sd, ls.D, is_transmission, &bsdf_eval, ls.shader);
   bsdf_eval_mul3(&bsdf_eval, light_eval / ls.pdf);
 
+#  ifdef __PATH_GUIDING__
+  if (guiding_root >= 0) {
+    bsdf_pdf = guiding_mixture_pdf(kg, guiding_root, ls.D, bsdf_pdf);
+  }
+#  endif
+
   if (ls.shader & SHADER_USE_MIS) {
     const float mis_weight = power_heuristic(ls.pdf, bsdf_pdf);
     bsdf_eval_mul(&bsdf_eval, mis_weight);
@@ -200,14 +226,54 @@ ccl_device_forceinline void integrate_surface_direct_light(INTEGRATOR_STATE_ARGS
     INTEGRATOR_STATE_WRITE(shadow_path, unshadowed_throughput) = throughput;
   }
 
+#  ifdef __PATH_GUIDING__
+  /* Light arriving here is incoming radiance for the vertices before this one. */
+  if (kernel_data.kernel_features & KERNEL_FEATURE_PATH_GUIDING) {
+    INTEGRATOR_STATE_WRITE(shadow_path, guiding_num_vertices) = INTEGRATOR_STATE(
+        path, guiding_num_vertices);
+  }
+#  endif
+
   /* Branch off shadow kernel. */
   INTEGRATOR_SHADOW_PATH_INIT(DEVICE_KERNEL_INTEGRATOR_INTERSECT_SHADOW);
 }
 #endif
 
+#ifdef __PATH_GUIDING__
+/* Sample direction from the path guiding distribution, and evaluate all BSDFs for it. */
+ccl_device_forceinline int integrate_surface_guiding_sample(ccl_global const KernelGlobals *kg,
+                                                            ccl_private ShaderData *sd,
+                                                            const int guiding_root,
+                                                            float randu,
+                                                            float randv,
+                                                            ccl_private BsdfEval *bsdf_eval,
+                                                            ccl_private float3 *omega_in,
+                                                            ccl_private float *pdf)
+{
+  float guide_pdf;
+  *omega_in = guiding_sample(kg, guiding_root, randu, randv, &guide_pdf);
+  if (guide_pdf == 0.0f) {
+    *pdf = 0.0f;
+    return LABEL_NONE;
+  }
+
+  const bool is_transmission = shader_bsdf_is_transmission(sd, *omega_in);
+  const float bsdf_pdf = shader_bsdf_eval(kg, sd, *omega_in, is_transmission, bsdf_eval, 0);
+
+  const float guiding_probability = kernel_data.integrator.guiding_probability;
+  *pdf = guiding_probability * guide_pdf + (1.0f - guiding_probability) * bsdf_pdf;
+
+  return ((is_transmission) ? LABEL_TRANSMIT : LABEL_REFLECT) |
+         ((is_zero(bsdf_eval->glossy)) ? LABEL_DIFFUSE : LABEL_GLOSSY);
+}
+#endif
+
 /* Path tracing: bounce off or through surface with new direction. */
 ccl_device_forceinline int integrate_surface_bsdf_bssrdf_bounce(
-    INTEGRATOR_STATE_ARGS, ccl_private ShaderData *sd, ccl_private const RNGState *rng_state)
+    INTEGRATOR_STATE_ARGS,
+    ccl_private ShaderData *sd,
+    ccl_private const RNGState *rng_state,
+    const int guiding_root)
 {
   /* Sample BSDF or BSSRDF. */
   if (!(sd->flag & (SD_BSDF | SD_BSSRDF))) {
@@ -216,24 +282,59 @@ ccl_device_forceinline int integrate_surface_bsdf_bssrdf_bounce(
 
   float bsdf_u, bsdf_v;
   path_state_rng_2D(kg, rng_state, PRNG_BSDF_U, &bsdf_u, &bsdf_v);
-  ccl_private const ShaderClosure *sc = shader_bsdf_bssrdf_pick(sd, &bsdf_u);
 
-#ifdef __SUBSURFACE__
-  /* BSSRDF closure, we schedule subsurface intersection kernel. */
-  if (CLOSURE_IS_BSSRDF(sc->type)) {
-    return subsurface_bounce(INTEGRATOR_STATE_PASS, sd, sc);
-  }
-#endif
-
-  /* BSDF closure, sample direction. */
   float bsdf_pdf;
   BsdfEval bsdf_eval ccl_optional_struct_init;
   float3 bsdf_omega_in ccl_optional_struct_init;
   differential3 bsdf_domega_in ccl_optional_struct_init;
   int label;
 
-  label = shader_bsdf_sample_closure(
-      kg, sd, sc, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+#ifdef __PATH_GUIDING__
+  const float guiding_probability = (guiding_root >= 0) ?
+                                        kernel_data.integrator.guiding_probability :
+                                        0.0f;
+
+  if (bsdf_u < guiding_probability) {
+    /* Guiding distribution, sample direction. */
+    label = integrate_surface_guiding_sample(kg,
+                                             sd,
+                                             guiding_root,
+                                             bsdf_u / guiding_probability,
+                                             bsdf_v,
+                                             &bsdf_eval,
+                                             &bsdf_omega_in,
+                                             &bsdf_pdf);
+    bsdf_domega_in = differential3_zero();
+  }
+  else
+#endif
+  {
+#ifdef __PATH_GUIDING__
+    bsdf_u = (bsdf_u - guiding_probability) / (1.0f - guiding_probability);
+#endif
+
+    ccl_private const ShaderClosure *sc = shader_bsdf_bssrdf_pick(sd, &bsdf_u);
+
+#ifdef __SUBSURFACE__
+    /* BSSRDF closure, we schedule subsurface intersection kernel. */
+    if (CLOSURE_IS_BSSRDF(sc->type)) {
+      return subsurface_bounce(INTEGRATOR_STATE_PASS, sd, sc);
+    }
+#endif
+
+    /* BSDF closure, sample direction. */
+    label = shader_bsdf_sample_closure(
+        kg, sd, sc, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+
+#ifdef __PATH_GUIDING__
+    if (guiding_root >= 0 && bsdf_pdf != 0.0f) {
+      /* Singular closures can not be sampled by the guiding distribution. */
+      bsdf_pdf = (label & (LABEL_SINGULAR | LABEL_TRANSPARENT)) ?
+                     (1.0f - guiding_probability) * bsdf_pdf :
+                     guiding_mixture_pdf(kg, guiding_root, bsdf_omega_in, bsdf_pdf);
+    }
+#endif
+  }
 
   if (bsdf_pdf == 0.0f || bsdf_eval_is_zero(&bsdf_eval)) {
     return LABEL_NONE;
@@ -274,6 +375,12 @@ ccl_device_forceinline int integrate_surface_bsdf_bssrdf_bounce(
                                                       INTEGRATOR_STATE(path, min_ray_pdf));
   }
 
+#ifdef __PATH_GUIDING__
+  if (!(label & (LABEL_SINGULAR | LABEL_TRANSPARENT))) {
+    guiding_record_vertex(INTEGRATOR_STATE_PASS, sd->P, normalize(bsdf_omega_in), bsdf_pdf);
+  }
+#endif
+
   path_state_next(INTEGRATOR_STATE_PASS, label);
   return label;
 }
@@ -439,9 +546,12 @@ ccl_device bool integrate_surface(INTEGRATOR_STATE_ARGS,
     kernel_write_shadow_catcher_bounce_data(INTEGRATOR_STATE_PASS, &sd, render_buffer);
 #endif
 
+    /* Path guiding distribution, shared by direct light and the bounce. */
+    const int guiding_root = integrate_surface_guiding_root(kg, &sd);
+
     /* Direct light. */
     PROFILING_EVENT(PROFILING_SHADE_SURFACE_DIRECT_LIGHT);
-    integrate_surface_direct_light(INTEGRATOR_STATE_PASS, &sd, &rng_state);
+    integrate_surface_direct_light(INTEGRATOR_STATE_PASS, &sd, &rng_state, guiding_root);
 
 #if defined(__AO__) && defined(__SHADER_RAYTRACE__)
     /* Ambient occlusion pass. */
@@ -456,7 +566,7 @@ ccl_device bool integrate_surface(INTEGRATOR_STATE_ARGS,
 
     PROFILING_EVENT(PROFILING_SHADE_SURFACE_INDIRECT_LIGHT);
     continue_path_label = integrate_surface_bsdf_bssrdf_bounce(
-        INTEGRATOR_STATE_PASS, &sd, &rng_state);
+        INTEGRATOR_STATE_PASS, &sd, &rng_state, guiding_root);
 #ifdef __VOLUME__
   }
   else {
@@ -20,6 +20,7 @@
 #include "kernel/kernel_emission.h"
 #include "kernel/kernel_light.h"
 #include "kernel/kernel_passes.h"
+#include "kernel/kernel_path_guiding.h"
 #include "kernel/kernel_path_state.h"
 #include "kernel/kernel_shader.h"
 
@@ -188,7 +189,8 @@ ccl_device void volume_shadow_heterogeneous(INTEGRATOR_STATE_ARGS,
                                             ccl_private Ray *ccl_restrict ray,
                                             ccl_private ShaderData *ccl_restrict sd,
                                             ccl_private float3 *ccl_restrict throughput,
-                                            const float object_step_size)
+                                            const float object_step_size,
+                                            const int occupancy_object)
 {
   /* Load random number state. */
   RNGState rng_state;
@@ -217,7 +219,29 @@ ccl_device void volume_shadow_heterogeneous(INTEGRATOR_STATE_ARGS,
 
   float3 sum = zero_float3();
 
+  /* Empty space skipping. */
+  const int occupancy_grid = volume_occupancy_grid(kg, occupancy_object);
+  float3 cell_P = zero_float3(), cell_D = zero_float3();
+  if (occupancy_grid != -1) {
+    volume_occupancy_ray(kg, occupancy_grid, occupancy_object, ray->P, ray->D, &cell_P, &cell_D);
+  }
+
   for (int i = 0; i < max_steps; i++) {
+    /* skip ahead to the step containing the next occupied cell */
+    if (occupancy_grid != -1) {
+      const float t_occupied = volume_occupancy_next_occupied(
+          kg, occupancy_grid, cell_P, cell_D, t, ray->t);
+      if (t_occupied >= ray->t) {
+        tp = *throughput * exp3(sum);
+        break;
+      }
+      const int occupied_step = (int)floorf(t_occupied / step_size - steps_offset) + 1;
+      if (occupied_step > i) {
+        i = occupied_step;
+        t = (i - 1 + steps_offset) * step_size;
+      }
+    }
+
     /* advance to new position */
     float new_t = min(ray->t, (i + steps_offset) * step_size);
     float dt = new_t - t;
@@ -516,6 +540,7 @@ ccl_device_forceinline void volume_integrate_heterogeneous(
     ccl_private const RNGState *rng_state,
     ccl_global float *ccl_restrict render_buffer,
     const float object_step_size,
+    const int occupancy_object,
     const VolumeSampleMethod direct_sample_method,
     const float3 equiangular_light_P,
     ccl_private VolumeIntegrateResult &result)
@@ -577,7 +602,29 @@ ccl_device_forceinline void volume_integrate_heterogeneous(
 #  endif
   float3 accum_emission = zero_float3();
 
+  /* Empty space skipping. */
+  const int occupancy_grid = volume_occupancy_grid(kg, occupancy_object);
+  float3 cell_P = zero_float3(), cell_D = zero_float3();
+  if (occupancy_grid != -1) {
+    volume_occupancy_ray(kg, occupancy_grid, occupancy_object, ray->P, ray->D, &cell_P, &cell_D);
+  }
+
   for (int i = 0; i < max_steps; i++) {
+    /* Skip ahead to the step containing the next occupied cell. Steps through empty cells have
+     * no extinction, scattering or emission, so leaving them out does not change the result. */
+    if (occupancy_grid != -1) {
+      const float t_occupied = volume_occupancy_next_occupied(
+          kg, occupancy_grid, cell_P, cell_D, vstate.start_t, ray->t);
+      if (t_occupied >= ray->t) {
+        break;
+      }
+      const int occupied_step = (int)floorf(t_occupied / step_size - steps_offset) + 1;
+      if (occupied_step > i) {
+        i = occupied_step;
+        vstate.start_t = (i - 1 + steps_offset) * step_size;
+      }
+    }
+
     /* Advance to new position */
     vstate.end_t = min(ray->t, (i + steps_offset) * step_size);
     const float shade_t = vstate.start_t + (vstate.end_t - vstate.start_t) * step_shade_offset;
@@ -656,6 +703,10 @@ ccl_device_forceinline void volume_integrate_heterogeneous(
   if (!is_zero(accum_emission)) {
     kernel_accum_emission(
         INTEGRATOR_STATE_PASS, result.indirect_throughput, accum_emission, render_buffer);
+
+#  ifdef __PATH_GUIDING__
+    guiding_record_emission(INTEGRATOR_STATE_PASS, result.indirect_throughput * accum_emission);
+#  endif
   }
 
 #  ifdef __DENOISING_FEATURES__
@@ -751,7 +802,14 @@ ccl_device_forceinline void integrate_volume_direct_light(
 
   /* Evaluate BSDF. */
   BsdfEval phase_eval ccl_optional_struct_init;
-  const float phase_pdf = shader_volume_phase_eval(kg, sd, phases, ls->D, &phase_eval);
+  float phase_pdf = shader_volume_phase_eval(kg, sd, phases, ls->D, &phase_eval);
+
+#    ifdef __PATH_GUIDING__
+  const int guiding_root = guiding_spatial_lookup(kg, P);
+  if (guiding_root >= 0) {
+    phase_pdf = guiding_mixture_pdf(kg, guiding_root, ls->D, phase_pdf);
+  }
+#    endif
 
   if (ls->shader & SHADER_USE_MIS) {
     float mis_weight = power_heuristic(ls->pdf, phase_pdf);
@@ -798,6 +856,13 @@ ccl_device_forceinline void integrate_volume_direct_light(
     INTEGRATOR_STATE_WRITE(shadow_path, unshadowed_throughput) = throughput;
   }
 
+#    ifdef __PATH_GUIDING__
+  if (kernel_data.kernel_features & KERNEL_FEATURE_PATH_GUIDING) {
+    INTEGRATOR_STATE_WRITE(shadow_path, guiding_num_vertices) = INTEGRATOR_STATE(
+        path, guiding_num_vertices);
+  }
+#    endif
+
   integrator_state_copy_volume_stack_to_shadow(INTEGRATOR_STATE_PASS);
 
   /* Branch off shadow kernel. */
@@ -817,21 +882,54 @@ ccl_device_forceinline bool integrate_volume_phase_scatter(
   float phase_u, phase_v;
   path_state_rng_2D(kg, rng_state, PRNG_BSDF_U, &phase_u, &phase_v);
 
-  /* Phase closure, sample direction. */
   float phase_pdf;
   BsdfEval phase_eval ccl_optional_struct_init;
   float3 phase_omega_in ccl_optional_struct_init;
   differential3 phase_domega_in ccl_optional_struct_init;
+  int label = LABEL_VOLUME_SCATTER;
+
+#  ifdef __PATH_GUIDING__
+  const int guiding_root = guiding_spatial_lookup(kg, sd->P);
+  const float guiding_probability = (guiding_root >= 0) ?
+                                        kernel_data.integrator.guiding_probability :
+                                        0.0f;
+
+  if (phase_u < guiding_probability) {
+    /* Guiding distribution, sample direction. */
+    float guide_pdf;
+    phase_omega_in = guiding_sample(
+        kg, guiding_root, phase_u / guiding_probability, phase_v, &guide_pdf);
+    phase_domega_in = differential3_zero();
+
+    phase_pdf = shader_volume_phase_eval(kg, sd, phases, phase_omega_in, &phase_eval);
+    phase_pdf = (guide_pdf != 0.0f) ? guiding_probability * guide_pdf +
+                                          (1.0f - guiding_probability) * phase_pdf :
+                                      0.0f;
+  }
+  else
+#  endif
+  {
+#  ifdef __PATH_GUIDING__
+    phase_u = (phase_u - guiding_probability) / (1.0f - guiding_probability);
+#  endif
 
-  const int label = shader_volume_phase_sample(kg,
-                                               sd,
-                                               phases,
-                                               phase_u,
-                                               phase_v,
-                                               &phase_eval,
-                                               &phase_omega_in,
-                                               &phase_domega_in,
-                                               &phase_pdf);
+    /* Phase closure, sample direction. */
+    label = shader_volume_phase_sample(kg,
+                                       sd,
+                                       phases,
+                                       phase_u,
+                                       phase_v,
+                                       &phase_eval,
+                                       &phase_omega_in,
+                                       &phase_domega_in,
+                                       &phase_pdf);
+
+#  ifdef __PATH_GUIDING__
+    if (guiding_root >= 0 && phase_pdf != 0.0f) {
+      phase_pdf = guiding_mixture_pdf(kg, guiding_root, phase_omega_in, phase_pdf);
+    }
+#  endif
+  }
 
   if (phase_pdf == 0.0f || bsdf_eval_is_zero(&phase_eval)) {
     return false;
@@ -862,6 +960,10 @@ ccl_device_forceinline bool integrate_volume_phase_scatter(
   INTEGRATOR_STATE_WRITE(path, min_ray_pdf) = fminf(phase_pdf,
                                                     INTEGRATOR_STATE(path, min_ray_pdf));
 
+#  ifdef __PATH_GUIDING__
+  guiding_record_vertex(INTEGRATOR_STATE_PASS, sd->P, normalize(phase_omega_in), phase_pdf);
+#  endif
+
   path_state_next(INTEGRATOR_STATE_PASS, label);
   return true;
 }
@@ -898,6 +1000,9 @@ ccl_device VolumeIntegrateEvent volume_integrate(INTEGRATOR_STATE_ARGS,
   const float step_size = volume_stack_step_size(INTEGRATOR_STATE_PASS, [=](const int i) {
     return integrator_state_read_volume_stack(INTEGRATOR_STATE_PASS, i);
   });
+  const int occupancy_object = volume_stack_occupancy_object(
+      INTEGRATOR_STATE_PASS,
+      [=](const int i) { return integrator_state_read_volume_stack(INTEGRATOR_STATE_PASS, i); });
 
   /* TODO: expensive to zero closures? */
   VolumeIntegrateResult result = {};
@@ -907,6 +1012,7 @@ ccl_device VolumeIntegrateEvent volume_integrate(INTEGRATOR_STATE_ARGS,
                                  &rng_state,
                                  render_buffer,
                                  step_size,
+                                 occupancy_object,
                                  direct_sample_method,
                                  ls.P,
                                  result);
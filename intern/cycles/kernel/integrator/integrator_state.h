@@ -68,6 +68,10 @@ CCL_NAMESPACE_BEGIN
 #  define INTEGRATOR_SHADOW_ISECT_SIZE INTEGRATOR_SHADOW_ISECT_SIZE_GPU
 #endif
 
+/* Path guiding is only supported on the CPU, the GPU size is a placeholder. */
+#define INTEGRATOR_GUIDING_NUM_VERTICES_CPU 16
+#define INTEGRATOR_GUIDING_NUM_VERTICES_GPU 1
+
 /* Data structures */
 
 /* Integrator State
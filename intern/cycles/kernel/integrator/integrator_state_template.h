@@ -66,6 +66,8 @@ KERNEL_STRUCT_MEMBER(path, float3, denoising_feature_throughput, KERNEL_FEATURE_
 /* Shader sorting. */
 /* TODO: compress as uint16? or leave out entirely and recompute key in sorting code? */
 KERNEL_STRUCT_MEMBER(path, uint32_t, shader_sort_key, KERNEL_FEATURE_PATH_TRACING)
+/* Number of scattering vertices recorded for training path guiding. */
+KERNEL_STRUCT_MEMBER(path, uint16_t, guiding_num_vertices, KERNEL_FEATURE_PATH_GUIDING)
 KERNEL_STRUCT_END(path)
 
 /************************************** Ray ***********************************/
@@ -110,6 +112,22 @@ KERNEL_STRUCT_END_ARRAY(volume_stack,
                         KERNEL_STRUCT_VOLUME_STACK_SIZE,
                         KERNEL_STRUCT_VOLUME_STACK_SIZE)
 
+/***************************** Path Guiding Vertices **************************/
+
+/* Scattering vertices along the path, with the incoming radiance accumulated from light
+ * found further along the path. Used to train path guiding. */
+KERNEL_STRUCT_BEGIN(guiding)
+KERNEL_STRUCT_ARRAY_MEMBER(guiding, float3, P, KERNEL_FEATURE_PATH_GUIDING)
+KERNEL_STRUCT_ARRAY_MEMBER(guiding, float3, D, KERNEL_FEATURE_PATH_GUIDING)
+/* Path throughput after scattering at the vertex. */
+KERNEL_STRUCT_ARRAY_MEMBER(guiding, float3, throughput, KERNEL_FEATURE_PATH_GUIDING)
+KERNEL_STRUCT_ARRAY_MEMBER(guiding, float3, radiance, KERNEL_FEATURE_PATH_GUIDING)
+/* Probability density of sampling direction D. */
+KERNEL_STRUCT_ARRAY_MEMBER(guiding, float, pdf, KERNEL_FEATURE_PATH_GUIDING)
+KERNEL_STRUCT_END_ARRAY(guiding,
+                        INTEGRATOR_GUIDING_NUM_VERTICES_CPU,
+                        INTEGRATOR_GUIDING_NUM_VERTICES_GPU)
+
 /********************************* Shadow Path State **************************/
 
 KERNEL_STRUCT_BEGIN(shadow_path)
@@ -130,6 +148,8 @@ KERNEL_STRUCT_MEMBER(shadow_path, float3, unshadowed_throughput, KERNEL_FEATURE_
 KERNEL_STRUCT_MEMBER(shadow_path, float3, diffuse_glossy_ratio, KERNEL_FEATURE_LIGHT_PASSES)
 /* Number of intersections found by ray-tracing. */
 KERNEL_STRUCT_MEMBER(shadow_path, uint16_t, num_hits, KERNEL_FEATURE_PATH_TRACING)
+/* Number of path guiding vertices of the main path receiving the light contribution. */
+KERNEL_STRUCT_MEMBER(shadow_path, uint16_t, guiding_num_vertices, KERNEL_FEATURE_PATH_GUIDING)
 KERNEL_STRUCT_END(shadow_path)
 
 /********************************** Shadow Ray *******************************/
@@ -273,6 +273,12 @@ ccl_device_inline void integrator_state_shadow_catcher_split(INTEGRATOR_STATE_AR
   split_state->shadow_path = state->shadow_path;
 
   split_state->path.flag |= PATH_RAY_SHADOW_CATCHER_PASS;
+
+#  ifdef __PATH_GUIDING__
+  /* Guiding vertices are not copied, the shadow catcher pass does not contribute to training. */
+  split_state->path.guiding_num_vertices = 0;
+  split_state->shadow_path.guiding_num_vertices = 0;
+#  endif
 #endif
 }
 
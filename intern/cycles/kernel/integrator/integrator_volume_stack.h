@@ -134,6 +134,18 @@ ccl_device_inline void volume_stack_clean(INTEGRATOR_STATE_ARGS)
   }
 }
 
+/* Object whose occupancy grid can be used to skip empty space, which is only the case when it is
+ * the single volume in the stack. */
+template<typename StackReadOp>
+ccl_device int volume_stack_occupancy_object(INTEGRATOR_STATE_ARGS, StackReadOp stack_read)
+{
+  const VolumeStack entry = stack_read(0);
+  if (entry.shader == SHADER_NONE || stack_read(1).shader != SHADER_NONE) {
+    return OBJECT_NONE;
+  }
+  return (volume_occupancy_grid(kg, entry.object) != -1) ? entry.object : OBJECT_NONE;
+}
+
 template<typename StackReadOp>
 ccl_device float volume_stack_step_size(INTEGRATOR_STATE_ARGS, StackReadOp stack_read)
 {
@@ -72,16 +72,35 @@ ccl_device_inline float cmj_randfloat_simple(uint i, uint p)
   return cmj_hash_simple(i, p) * (1.0f / (float)0xFFFFFFFF);
 }
 
+/* Cranley-Patterson rotation from the tiled blue noise mask, so that the error of neighboring
+ * pixels is negatively correlated. The position of the pixel in the mask is stored in the low
+ * bits of the rng hash, every dimension looks up the mask at a different toroidal offset. */
+ccl_device_inline float blue_noise_shift(ccl_global const KernelGlobals *kg,
+                                         uint rng_hash,
+                                         uint dimension)
+{
+  const uint offset = cmj_hash_simple(dimension, kernel_data.integrator.seed);
+  const uint x = (rng_hash + offset) & (BLUE_NOISE_SIZE - 1);
+  const uint y = ((rng_hash >> BLUE_NOISE_SIZE_LOG2) + (offset >> 16)) & (BLUE_NOISE_SIZE - 1);
+
+  return kernel_tex_fetch(__blue_noise, y * BLUE_NOISE_SIZE + x);
+}
+
 ccl_device float pmj_sample_1D(ccl_global const KernelGlobals *kg,
                                uint sample,
                                uint rng_hash,
                                uint dimension)
 {
+  /* With blue noise all pixels share the same sequence, only rotated differently. */
+  const uint scramble_hash = (kernel_data.integrator.use_blue_noise) ?
+                                 kernel_data.integrator.seed :
+                                 rng_hash;
+
   /* Perform Owen shuffle of the sample number to reorder the samples. */
 #ifdef _SIMPLE_HASH_
-  const uint rv = cmj_hash_simple(dimension, rng_hash);
+  const uint rv = cmj_hash_simple(dimension, scramble_hash);
 #else /* Use a _REGULAR_HASH_. */
-  const uint rv = cmj_hash(dimension, rng_hash);
+  const uint rv = cmj_hash(dimension, scramble_hash);
 #endif
 #ifdef _XOR_SHUFFLE_
 #  warning "Using XOR shuffle."
@@ -103,11 +122,17 @@ ccl_device float pmj_sample_1D(ccl_global const KernelGlobals *kg,
 
 #ifndef _NO_CRANLEY_PATTERSON_ROTATION_
   /* Use Cranley-Patterson rotation to displace the sample pattern. */
+  float dx;
+  if (kernel_data.integrator.use_blue_noise) {
+    dx = blue_noise_shift(kg, rng_hash, d);
+  }
+  else {
 #  ifdef _SIMPLE_HASH_
-  float dx = cmj_randfloat_simple(d, rng_hash);
+    dx = cmj_randfloat_simple(d, rng_hash);
 #  else
-  float dx = cmj_randfloat(d, rng_hash);
+    dx = cmj_randfloat(d, rng_hash);
 #  endif
+  }
   /* Jitter sample locations and map back into [0 1]. */
   fx = fx + dx;
   fx = fx - floorf(fx);
@@ -125,11 +150,16 @@ ccl_device void pmj_sample_2D(ccl_global const KernelGlobals *kg,
                               ccl_private float *x,
                               ccl_private float *y)
 {
+  /* With blue noise all pixels share the same sequence, only rotated differently. */
+  const uint scramble_hash = (kernel_data.integrator.use_blue_noise) ?
+                                 kernel_data.integrator.seed :
+                                 rng_hash;
+
   /* Perform a shuffle on the sample number to reorder the samples. */
 #ifdef _SIMPLE_HASH_
-  const uint rv = cmj_hash_simple(dimension, rng_hash);
+  const uint rv = cmj_hash_simple(dimension, scramble_hash);
 #else /* Use a _REGULAR_HASH_. */
-  const uint rv = cmj_hash(dimension, rng_hash);
+  const uint rv = cmj_hash(dimension, scramble_hash);
 #endif
 #ifdef _XOR_SHUFFLE_
 #  warning "Using XOR shuffle."
@@ -149,13 +179,20 @@ ccl_device void pmj_sample_2D(ccl_global const KernelGlobals *kg,
 
 #ifndef _NO_CRANLEY_PATTERSON_ROTATION_
   /* Use Cranley-Patterson rotation to displace the sample pattern. */
+  float dx, dy;
+  if (kernel_data.integrator.use_blue_noise) {
+    dx = blue_noise_shift(kg, rng_hash, d);
+    dy = blue_noise_shift(kg, rng_hash, d + 1);
+  }
+  else {
 #  ifdef _SIMPLE_HASH_
-  float dx = cmj_randfloat_simple(d, rng_hash);
-  float dy = cmj_randfloat_simple(d + 1, rng_hash);
+    dx = cmj_randfloat_simple(d, rng_hash);
+    dy = cmj_randfloat_simple(d + 1, rng_hash);
 #  else
-  float dx = cmj_randfloat(d, rng_hash);
-  float dy = cmj_randfloat(d + 1, rng_hash);
+    dx = cmj_randfloat(d, rng_hash);
+    dy = cmj_randfloat(d + 1, rng_hash);
 #  endif
+  }
   /* Jitter sample locations and map back to the unit square [0 1]x[0 1]. */
   float sx = fx + dx;
   float sy = fy + dy;
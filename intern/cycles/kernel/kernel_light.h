@@ -19,6 +19,7 @@
 #include "geom/geom.h"
 
 #include "kernel_light_background.h"
+#include "kernel_light_tree.h"
 #include "kernel_montecarlo.h"
 #include "kernel_projection.h"
 #include "kernel_types.h"
@@ -51,6 +52,7 @@ ccl_device_inline bool light_sample(ccl_global const KernelGlobals *kg,
                                     const float randv,
                                     const float3 P,
                                     const int path_flag,
+                                    const float pdf_selection,
                                     ccl_private LightSample *ls)
 {
   const ccl_global KernelLight *klight = &kernel_tex_fetch(__lights, lamp);
@@ -204,11 +206,24 @@ ccl_device_inline bool light_sample(ccl_global const KernelGlobals *kg,
     }
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= pdf_selection;
 
   return (ls->pdf > 0.0f);
 }
 
+/* Probability of selecting a lamp that is not a distant light, from position P. */
+ccl_device_inline float light_select_pdf(ccl_global const KernelGlobals *kg,
+                                         const float3 P,
+                                         const int lamp)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    const int index = kernel_data.integrator.num_distribution -
+                      kernel_data.integrator.num_all_lights + lamp;
+    return light_tree_pdf(kg, P, index);
+  }
+  return kernel_data.integrator.pdf_lights;
+}
+
 ccl_device bool lights_intersect(ccl_global const KernelGlobals *ccl_restrict kg,
                                  ccl_private const Ray *ccl_restrict ray,
                                  ccl_private Intersection *ccl_restrict isect,
@@ -455,7 +470,7 @@ ccl_device bool light_sample_from_intersection(ccl_global const KernelGlobals *c
     return false;
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= light_select_pdf(kg, ray_P, lamp);
 
   return true;
 }
@@ -492,12 +507,34 @@ ccl_device_inline bool triangle_world_space_vertices(
   return has_motion;
 }
 
-ccl_device_inline float triangle_light_pdf_area(ccl_global const KernelGlobals *kg,
+/* Probability of selecting a mesh light triangle from position P, as a density over the area of
+ * the triangle at the center of the shutter. */
+ccl_device_inline float triangle_light_select_pdf(ccl_global const KernelGlobals *kg,
+                                                  const float3 P,
+                                                  const int object,
+                                                  const int prim)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    const int index = light_tree_triangle_index(kg, object, prim);
+    if (index == -1) {
+      return 0.0f;
+    }
+    const uint leaf = kernel_tex_fetch(__light_tree_emitter_nodes, index);
+    if (leaf == ~0u) {
+      return 0.0f;
+    }
+    const float area = kernel_tex_fetch(__light_tree_nodes, leaf).area;
+    return light_tree_pdf(kg, P, index) / area;
+  }
+  return kernel_data.integrator.pdf_triangles;
+}
+
+ccl_device_inline float triangle_light_pdf_area(const float pdf_triangles,
                                                 const float3 Ng,
                                                 const float3 I,
                                                 float t)
 {
-  float pdf = kernel_data.integrator.pdf_triangles;
+  float pdf = pdf_triangles;
   float cos_pi = fabsf(dot(Ng, I));
 
   if (cos_pi == 0.0f)
@@ -524,10 +561,12 @@ ccl_device_forceinline float triangle_light_pdf(ccl_global const KernelGlobals *
   const float3 N = cross(e0, e1);
   const float distance_to_plane = fabsf(dot(N, sd->I * t)) / dot(N, N);
 
+  /* sd contains the point on the light source
+   * calculate Px, the point that we're shading */
+  const float3 Px = sd->P + sd->I * t;
+  const float pdf_triangles = triangle_light_select_pdf(kg, Px, sd->object, sd->prim);
+
   if (longest_edge_squared > distance_to_plane * distance_to_plane) {
-    /* sd contains the point on the light source
-     * calculate Px, the point that we're shading */
-    const float3 Px = sd->P + sd->I * t;
     const float3 v0_p = V[0] - Px;
     const float3 v1_p = V[1] - Px;
     const float3 v2_p = V[2] - Px;
@@ -555,12 +594,12 @@ ccl_device_forceinline float triangle_light_pdf(ccl_global const KernelGlobals *
       else {
         area = 0.5f * len(N);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = area * pdf_triangles;
       return pdf / solid_angle;
     }
   }
   else {
-    float pdf = triangle_light_pdf_area(kg, sd->Ng, sd->I, t);
+    float pdf = triangle_light_pdf_area(pdf_triangles, sd->Ng, sd->I, t);
     if (has_motion) {
       const float area = 0.5f * len(N);
       if (UNLIKELY(area == 0.0f)) {
@@ -584,6 +623,7 @@ ccl_device_forceinline void triangle_light_sample(ccl_global const KernelGlobals
                                                   float randu,
                                                   float randv,
                                                   float time,
+                                                  const float pdf_triangles,
                                                   ccl_private LightSample *ls,
                                                   const float3 P)
 {
@@ -709,7 +749,7 @@ ccl_device_forceinline void triangle_light_sample(ccl_global const KernelGlobals
         triangle_world_space_vertices(kg, object, prim, -1.0f, V);
         area = triangle_area(V[0], V[1], V[2]);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = area * pdf_triangles;
       ls->pdf = pdf / solid_angle;
     }
   }
@@ -731,7 +771,7 @@ ccl_device_forceinline void triangle_light_sample(ccl_global const KernelGlobals
     ls->P = u * V[0] + v * V[1] + t * V[2];
     /* compute incoming direction, distance and pdf */
     ls->D = normalize_len(ls->P - P, &ls->t);
-    ls->pdf = triangle_light_pdf_area(kg, ls->Ng, -ls->D, ls->t);
+    ls->pdf = triangle_light_pdf_area(pdf_triangles, ls->Ng, -ls->D, ls->t);
     if (has_motion && area != 0.0f) {
       /* scale the PDF.
        * area = the area the sample was taken from
@@ -803,8 +843,21 @@ ccl_device_noinline bool light_distribution_sample(ccl_global const KernelGlobal
                                                    const int path_flag,
                                                    ccl_private LightSample *ls)
 {
-  /* Sample light index from distribution. */
-  const int index = light_distribution_sample(kg, &randu);
+  /* Sample light index from distribution or light tree. */
+  int index;
+  float pdf_selection;
+
+  if (kernel_data.integrator.use_light_tree) {
+    index = light_tree_sample(kg, P, &randu, &pdf_selection);
+    if (index == -1) {
+      return false;
+    }
+  }
+  else {
+    index = light_distribution_sample(kg, &randu);
+    pdf_selection = kernel_data.integrator.pdf_lights;
+  }
+
   ccl_global const KernelLightDistribution *kdistribution = &kernel_tex_fetch(__light_distribution,
                                                                               index);
   const int prim = kdistribution->prim;
@@ -819,8 +872,16 @@ ccl_device_noinline bool light_distribution_sample(ccl_global const KernelGlobal
       return false;
     }
 
+    /* Selection probability as a density over the triangle area. */
+    float pdf_triangles = kernel_data.integrator.pdf_triangles;
+    if (kernel_data.integrator.use_light_tree) {
+      const uint leaf = kernel_tex_fetch(__light_tree_emitter_nodes, index);
+      pdf_triangles = pdf_selection / kernel_tex_fetch(__light_tree_nodes, leaf).area;
+    }
+
     const int shader_flag = kdistribution->mesh_light.shader_flag;
-    triangle_light_sample<in_volume_segment>(kg, prim, object, randu, randv, time, ls, P);
+    triangle_light_sample<in_volume_segment>(
+        kg, prim, object, randu, randv, time, pdf_triangles, ls, P);
     ls->shader |= shader_flag;
     return (ls->pdf > 0.0f);
   }
@@ -831,7 +892,8 @@ ccl_device_noinline bool light_distribution_sample(ccl_global const KernelGlobal
     return false;
   }
 
-  return light_sample<in_volume_segment>(kg, lamp, randu, randv, P, path_flag, ls);
+  return light_sample<in_volume_segment>(
+      kg, lamp, randu, randv, P, path_flag, pdf_selection, ls);
 }
 
 ccl_device_inline bool light_distribution_sample_from_volume_segment(
@@ -866,13 +928,22 @@ ccl_device_inline bool light_distribution_sample_new_position(ccl_global const K
                                                               const float3 P,
                                                               ccl_private LightSample *ls)
 {
-  /* Sample a new position on the same light, for volume sampling. */
+  /* Sample a new position on the same light, for volume sampling. With the light tree the
+   * selection probability is evaluated at the new position, to match the probability used for
+   * multiple importance sampling when the light is hit. */
   if (ls->type == LIGHT_TRIANGLE) {
-    triangle_light_sample<false>(kg, ls->prim, ls->object, randu, randv, time, ls, P);
+    const float pdf_triangles = triangle_light_select_pdf(kg, P, ls->object, ls->prim);
+    triangle_light_sample<false>(
+        kg, ls->prim, ls->object, randu, randv, time, pdf_triangles, ls, P);
     return (ls->pdf > 0.0f);
   }
   else {
-    return light_sample<false>(kg, ls->lamp, randu, randv, P, 0, ls);
+    if (ls->type == LIGHT_DISTANT || ls->type == LIGHT_BACKGROUND) {
+      return light_sample<false>(
+          kg, ls->lamp, randu, randv, P, 0, kernel_data.integrator.pdf_lights, ls);
+    }
+    return light_sample<false>(
+        kg, ls->lamp, randu, randv, P, 0, light_select_pdf(kg, P, ls->lamp), ls);
   }
 }
 
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "kernel_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Many light sampling based on:
+ *
+ * Alejandro Conty Estevez and Christopher Kulla.
+ * Importance Sampling of Many Lights with Adaptive Tree Splitting.
+ *
+ * Lights are selected by walking down a tree of clusters, choosing a child proportional to an
+ * estimate of its contribution to the shading point. The estimate only depends on the position
+ * of the shading point, so that the same probability can be computed for emitters hit by BSDF
+ * rays. Distant and background lights are not in the tree, and are selected uniformly with
+ * a fixed probability. */
+
+ccl_device float light_tree_node_importance(const float3 P,
+                                            ccl_global const KernelLightTreeNode *knode)
+{
+  const float3 bbox_min = make_float3(knode->bbox_min[0], knode->bbox_min[1], knode->bbox_min[2]);
+  const float3 bbox_max = make_float3(knode->bbox_max[0], knode->bbox_max[1], knode->bbox_max[2]);
+  const float3 centroid = 0.5f * (bbox_min + bbox_max);
+  const float radius_sq = 0.25f * len_squared(bbox_max - bbox_min);
+
+  float distance;
+  const float3 D = normalize_len(centroid - P, &distance);
+  const float distance_sq = distance * distance;
+
+  /* Inside the bounding sphere the orientation bounds are no help, and the distance is clamped
+   * to avoid too much importance for clusters close to the shading point. */
+  if (distance_sq <= radius_sq) {
+    return knode->energy / max(radius_sq, 1e-8f);
+  }
+
+  const float3 axis = make_float3(knode->axis[0], knode->axis[1], knode->axis[2]);
+  float cos_theta = -dot(axis, D);
+  if (knode->two_sided) {
+    cos_theta = fabsf(cos_theta);
+  }
+
+  /* Smallest angle between the axis and the direction towards any point in the bounds. */
+  const float theta = fast_acosf(clamp(cos_theta, -1.0f, 1.0f));
+  const float theta_u = fast_asinf(sqrtf(radius_sq / distance_sq));
+  const float theta_prime = max(theta - knode->theta_o - theta_u, 0.0f);
+
+  if (theta_prime > knode->theta_e) {
+    return 0.0f;
+  }
+
+  return knode->energy * fast_cosf(theta_prime) / max(distance_sq, 1e-8f);
+}
+
+/* Select an emitter in the tree or one of the distant lights. Returns the light distribution
+ * index of the emitter and the probability of selecting it, or -1 if no light contributes. */
+ccl_device int light_tree_sample(ccl_global const KernelGlobals *kg,
+                                 const float3 P,
+                                 ccl_private float *randu,
+                                 ccl_private float *pdf)
+{
+  const float pdf_tree = kernel_data.integrator.pdf_light_tree;
+  float r = *randu;
+
+  if (r >= pdf_tree) {
+    /* Distant lights, uniformly. */
+    const int num_distant = kernel_data.integrator.num_light_tree_distant;
+    if (num_distant == 0) {
+      return -1;
+    }
+
+    r = (r - pdf_tree) / (1.0f - pdf_tree) * num_distant;
+    const int i = clamp((int)r, 0, num_distant - 1);
+
+    *randu = min(r - i, 1.0f);
+    *pdf = kernel_data.integrator.pdf_lights;
+    return kernel_tex_fetch(__light_tree_distant_lights, i);
+  }
+
+  r /= pdf_tree;
+  float pdf_select = pdf_tree;
+  int index = 0;
+
+  /* Walk down the tree, reusing the random number to pick children. */
+  ccl_global const KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, 0);
+  while (knode->child >= 0) {
+    const int left = index + 1;
+    const int right = knode->child;
+    const float importance_left = light_tree_node_importance(
+        P, &kernel_tex_fetch(__light_tree_nodes, left));
+    const float importance_right = light_tree_node_importance(
+        P, &kernel_tex_fetch(__light_tree_nodes, right));
+    const float importance = importance_left + importance_right;
+
+    if (!(importance > 0.0f)) {
+      return -1;
+    }
+
+    const float prob_left = importance_left / importance;
+    if (r < prob_left) {
+      index = left;
+      r = r / prob_left;
+      pdf_select *= prob_left;
+    }
+    else {
+      index = right;
+      r = (r - prob_left) / (1.0f - prob_left);
+      pdf_select *= 1.0f - prob_left;
+    }
+
+    r = min(r, 1.0f);
+    knode = &kernel_tex_fetch(__light_tree_nodes, index);
+  }
+
+  *randu = r;
+  *pdf = pdf_select;
+  return ~knode->child;
+}
+
+/* Probability of selecting the emitter with the given light distribution index from P. */
+ccl_device float light_tree_pdf(ccl_global const KernelGlobals *kg,
+                                const float3 P,
+                                const int index)
+{
+  /* Emitters without contribution are not in the tree and never selected. Distant lights are
+   * not in the tree either, but use pdf_lights instead. */
+  const uint leaf = kernel_tex_fetch(__light_tree_emitter_nodes, index);
+  if (leaf == ~0u) {
+    return 0.0f;
+  }
+
+  /* Walk up the tree, multiplying the probabilities of picking each node on the way. */
+  float pdf = kernel_data.integrator.pdf_light_tree;
+  int node = (int)leaf;
+
+  while (node != 0) {
+    const int parent = kernel_tex_fetch(__light_tree_nodes, node).parent;
+    const int left = parent + 1;
+    const int right = kernel_tex_fetch(__light_tree_nodes, parent).child;
+
+    const float importance_left = light_tree_node_importance(
+        P, &kernel_tex_fetch(__light_tree_nodes, left));
+    const float importance_right = light_tree_node_importance(
+        P, &kernel_tex_fetch(__light_tree_nodes, right));
+    const float importance = importance_left + importance_right;
+
+    if (!(importance > 0.0f)) {
+      return 0.0f;
+    }
+
+    pdf *= ((node == left) ? importance_left : importance_right) / importance;
+    node = parent;
+  }
+
+  return pdf;
+}
+
+/* Light distribution index of a mesh light triangle. */
+ccl_device int light_tree_triangle_index(ccl_global const KernelGlobals *kg,
+                                         const int object,
+                                         const int prim)
+{
+  /* Emitters of an object are contiguous and sorted by primitive. */
+  const uint2 emitters = kernel_tex_fetch(__light_tree_object_emitters, object);
+  const int end = (int)(emitters.x + emitters.y);
+  int first = (int)emitters.x;
+  int len = (int)emitters.y;
+
+  while (len > 0) {
+    const int half_len = len >> 1;
+    const int middle = first + half_len;
+
+    if (kernel_tex_fetch(__light_distribution, middle).prim < prim) {
+      first = middle + 1;
+      len = len - half_len - 1;
+    }
+    else {
+      len = half_len;
+    }
+  }
+
+  if (first < end && kernel_tex_fetch(__light_distribution, first).prim == prim) {
+    return first;
+  }
+  return -1;
+}
+
+CCL_NAMESPACE_END
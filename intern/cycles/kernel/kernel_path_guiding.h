@@ -0,0 +1,248 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "kernel_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Path Guiding
+ *
+ * Spatio-directional radiance distribution based on:
+ *
+ * Thomas Müller, Markus Gross and Jan Novák.
+ * Practical Path Guiding for Efficient Light-Transport Simulation.
+ *
+ * A binary tree over space stores a quadtree over directions in each leaf, learned from the
+ * incoming radiance recorded at path vertices of previous samples. Directions are sampled from
+ * a mixture of the guiding distribution and the BSDF or phase function, with probability
+ * guiding_probability for the guiding distribution. */
+
+#ifdef __PATH_GUIDING__
+
+/* Equal area cylindrical mapping between unit directions and the unit square, so that the
+ * density over solid angle is the density over the square divided by 4 pi. */
+ccl_device_inline float2 guiding_direction_to_square(const float3 D)
+{
+  const float cos_theta = clamp(D.z, -1.0f, 1.0f);
+  float phi = atan2f(D.y, D.x);
+  if (phi < 0.0f) {
+    phi += M_2PI_F;
+  }
+
+  return make_float2(clamp((cos_theta + 1.0f) * 0.5f, 0.0f, 1.0f),
+                     clamp(phi * M_1_2PI_F, 0.0f, 1.0f));
+}
+
+ccl_device_inline float3 guiding_square_to_direction(const float2 p)
+{
+  const float cos_theta = 2.0f * p.x - 1.0f;
+  const float sin_theta = safe_sqrtf(1.0f - cos_theta * cos_theta);
+  const float phi = M_2PI_F * p.y;
+
+  return make_float3(sin_theta * cosf(phi), sin_theta * sinf(phi), cos_theta);
+}
+
+/* Root of the directional quadtree at P, or -1 if there is no guiding distribution there. */
+ccl_device int guiding_spatial_lookup(ccl_global const KernelGlobals *kg, const float3 P)
+{
+  if (!kernel_data.integrator.use_guiding) {
+    return -1;
+  }
+
+  ccl_global const KernelGuidingSpatialNode *knode = &kernel_tex_fetch(__guiding_spatial_nodes,
+                                                                        0);
+  while (knode->child >= 0) {
+    const float p = (knode->axis == 0) ? P.x : (knode->axis == 1) ? P.y : P.z;
+    const int index = knode->child + ((p < knode->split) ? 0 : 1);
+    knode = &kernel_tex_fetch(__guiding_spatial_nodes, index);
+  }
+
+  return knode->directional_root;
+}
+
+/* Sample a direction from the quadtree, reusing the random numbers to pick quadrants. */
+ccl_device float3 guiding_sample(ccl_global const KernelGlobals *kg,
+                                 const int root,
+                                 float randu,
+                                 float randv,
+                                 ccl_private float *pdf)
+{
+  float2 origin = make_float2(0.0f, 0.0f);
+  float size = 1.0f;
+  float pdf_square = 1.0f;
+  int index = root;
+
+  while (true) {
+    ccl_global const KernelGuidingDirectionalNode *knode = &kernel_tex_fetch(
+        __guiding_directional_nodes, index);
+    const float total = knode->energy[0] + knode->energy[1] + knode->energy[2] +
+                        knode->energy[3];
+    if (!(total > 0.0f)) {
+      break;
+    }
+
+    /* Pick the left or right half, then the quadrant within that half. */
+    const float prob_left = (knode->energy[0] + knode->energy[2]) / total;
+    int qx;
+    if (randu < prob_left) {
+      qx = 0;
+      randu = randu / prob_left;
+    }
+    else {
+      qx = 1;
+      randu = (randu - prob_left) / (1.0f - prob_left);
+    }
+
+    const float energy_half = knode->energy[qx] + knode->energy[qx + 2];
+    const float prob_bottom = knode->energy[qx] / energy_half;
+    int qy;
+    if (randv < prob_bottom) {
+      qy = 0;
+      randv = randv / prob_bottom;
+    }
+    else {
+      qy = 1;
+      randv = (randv - prob_bottom) / (1.0f - prob_bottom);
+    }
+
+    randu = min(randu, 1.0f);
+    randv = min(randv, 1.0f);
+
+    const int quadrant = qx + 2 * qy;
+    pdf_square *= 4.0f * knode->energy[quadrant] / total;
+    size *= 0.5f;
+    origin += make_float2((float)qx, (float)qy) * size;
+
+    if (knode->child[quadrant] < 0) {
+      break;
+    }
+    index = knode->child[quadrant];
+  }
+
+  *pdf = pdf_square * (1.0f / M_4PI_F);
+  return guiding_square_to_direction(origin + make_float2(randu, randv) * size);
+}
+
+/* Density over solid angle of sampling direction D from the quadtree. */
+ccl_device float guiding_pdf(ccl_global const KernelGlobals *kg, const int root, const float3 D)
+{
+  float2 p = guiding_direction_to_square(D);
+  float pdf = 1.0f / M_4PI_F;
+  int index = root;
+
+  while (true) {
+    ccl_global const KernelGuidingDirectionalNode *knode = &kernel_tex_fetch(
+        __guiding_directional_nodes, index);
+    const float total = knode->energy[0] + knode->energy[1] + knode->energy[2] +
+                        knode->energy[3];
+    if (!(total > 0.0f)) {
+      return 0.0f;
+    }
+
+    const int qx = (p.x >= 0.5f) ? 1 : 0;
+    const int qy = (p.y >= 0.5f) ? 1 : 0;
+    const int quadrant = qx + 2 * qy;
+    pdf *= 4.0f * knode->energy[quadrant] / total;
+
+    if (knode->child[quadrant] < 0 || pdf == 0.0f) {
+      break;
+    }
+
+    p = p * 2.0f - make_float2((float)qx, (float)qy);
+    index = knode->child[quadrant];
+  }
+
+  return pdf;
+}
+
+/* Density of sampling direction D from the mixture of the guiding distribution and the BSDF or
+ * phase function, given the density of the latter. */
+ccl_device_inline float guiding_mixture_pdf(ccl_global const KernelGlobals *kg,
+                                            const int root,
+                                            const float3 D,
+                                            const float bsdf_pdf)
+{
+  const float guiding_probability = kernel_data.integrator.guiding_probability;
+  return guiding_probability * guiding_pdf(kg, root, D) +
+         (1.0f - guiding_probability) * bsdf_pdf;
+}
+
+/* Record a scattering vertex for training, once the path throughput was updated. */
+ccl_device_inline void guiding_record_vertex(INTEGRATOR_STATE_ARGS,
+                                             const float3 P,
+                                             const float3 D,
+                                             const float pdf)
+{
+  if (!(kernel_data.kernel_features & KERNEL_FEATURE_PATH_GUIDING)) {
+    return;
+  }
+
+  /* The shadow catcher pass does not contribute to training. */
+  if (INTEGRATOR_STATE(path, flag) & PATH_RAY_SHADOW_CATCHER_PASS) {
+    return;
+  }
+
+  const int index = INTEGRATOR_STATE(path, guiding_num_vertices);
+  if (index >= INTEGRATOR_GUIDING_NUM_VERTICES_CPU) {
+    return;
+  }
+
+  INTEGRATOR_STATE_ARRAY_WRITE(guiding, index, P) = P;
+  INTEGRATOR_STATE_ARRAY_WRITE(guiding, index, D) = D;
+  INTEGRATOR_STATE_ARRAY_WRITE(guiding, index, throughput) = INTEGRATOR_STATE(path, throughput);
+  INTEGRATOR_STATE_ARRAY_WRITE(guiding, index, radiance) = zero_float3();
+  INTEGRATOR_STATE_ARRAY_WRITE(guiding, index, pdf) = pdf;
+  INTEGRATOR_STATE_WRITE(path, guiding_num_vertices) = index + 1;
+}
+
+/* Add light found along the path to the incoming radiance of the first num_vertices vertices.
+ * Contribution is the light multiplied by the full path throughput. */
+ccl_device_inline void guiding_record_contribution(INTEGRATOR_STATE_ARGS,
+                                                   const float3 contribution,
+                                                   const int num_vertices)
+{
+  if (!(kernel_data.kernel_features & KERNEL_FEATURE_PATH_GUIDING)) {
+    return;
+  }
+
+  for (int i = 0; i < num_vertices; i++) {
+    const float3 throughput = INTEGRATOR_STATE_ARRAY(guiding, i, throughput);
+    INTEGRATOR_STATE_ARRAY_WRITE(guiding, i, radiance) += safe_divide_float3_float3(contribution,
+                                                                                    throughput);
+  }
+}
+
+ccl_device_inline void guiding_record_emission(INTEGRATOR_STATE_ARGS, const float3 contribution)
+{
+  if (kernel_data.kernel_features & KERNEL_FEATURE_PATH_GUIDING) {
+    guiding_record_contribution(
+        INTEGRATOR_STATE_PASS, contribution, INTEGRATOR_STATE(path, guiding_num_vertices));
+  }
+}
+
+ccl_device_inline void guiding_record_shadow(INTEGRATOR_STATE_ARGS, const float3 contribution)
+{
+  if (kernel_data.kernel_features & KERNEL_FEATURE_PATH_GUIDING) {
+    guiding_record_contribution(
+        INTEGRATOR_STATE_PASS, contribution, INTEGRATOR_STATE(shadow_path, guiding_num_vertices));
+  }
+}
+
+#endif /* __PATH_GUIDING__ */
+
+CCL_NAMESPACE_END
@@ -75,11 +75,16 @@ ccl_device_forceinline float path_rng_1D(ccl_global const KernelGlobals *kg,
   /* Cranly-Patterson rotation using rng seed */
   float shift;
 
-  /* Hash rng with dimension to solve correlation issues.
-   * See T38710, T50116.
-   */
-  uint tmp_rng = cmj_hash_simple(dimension, rng_hash);
-  shift = tmp_rng * (1.0f / (float)0xFFFFFFFF);
+  if (kernel_data.integrator.use_blue_noise) {
+    shift = blue_noise_shift(kg, rng_hash, dimension);
+  }
+  else {
+    /* Hash rng with dimension to solve correlation issues.
+     * See T38710, T50116.
+     */
+    uint tmp_rng = cmj_hash_simple(dimension, rng_hash);
+    shift = tmp_rng * (1.0f / (float)0xFFFFFFFF);
+  }
 
   return r + shift - floorf(r + shift);
 #endif
@@ -146,7 +151,15 @@ ccl_device_inline uint path_rng_hash_init(ccl_global const KernelGlobals *ccl_re
                                           const int x,
                                           const int y)
 {
-  const uint rng_hash = hash_iqnt2d(x, y) ^ kernel_data.integrator.seed;
+  uint rng_hash = hash_iqnt2d(x, y) ^ kernel_data.integrator.seed;
+
+  if (kernel_data.integrator.use_blue_noise) {
+    /* Store the position of the pixel in the blue noise mask in the low bits, the remaining
+     * bits keep other random number streams of neighboring pixels decorrelated. */
+    const uint mask_bits = 2 * BLUE_NOISE_SIZE_LOG2;
+    rng_hash = (rng_hash & ~((1u << mask_bits) - 1u)) |
+               ((y & (BLUE_NOISE_SIZE - 1)) << BLUE_NOISE_SIZE_LOG2) | (x & (BLUE_NOISE_SIZE - 1));
+  }
 
 #ifdef __DEBUG_CORRELATION__
   srand48(rng_hash + sample);
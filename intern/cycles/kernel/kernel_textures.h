@@ -30,11 +30,16 @@ KERNEL_TEX(float2, __prim_time)
 
 /* objects */
 KERNEL_TEX(KernelObject, __objects)
+KERNEL_TEX(KernelObjectPrototype, __object_prototypes)
 KERNEL_TEX(Transform, __object_motion_pass)
 KERNEL_TEX(DecomposedTransform, __object_motion)
 KERNEL_TEX(uint, __object_flag)
 KERNEL_TEX(float, __object_volume_step)
 
+/* volumes */
+KERNEL_TEX(KernelVolumeOccupancy, __volume_occupancy)
+KERNEL_TEX(uint, __volume_occupancy_cells)
+
 /* cameras */
 KERNEL_TEX(DecomposedTransform, __camera_motion)
 
@@ -49,6 +54,8 @@ KERNEL_TEX(float4, __tri_verts)
 /* curves */
 KERNEL_TEX(KernelCurve, __curves)
 KERNEL_TEX(float4, __curve_keys)
+KERNEL_TEX(uint2, __curve_keys_quantized)
+KERNEL_TEX(float4, __curve_key_bounds)
 KERNEL_TEX(KernelCurveSegment, __curve_segments)
 
 /* patches */
@@ -67,6 +74,16 @@ KERNEL_TEX(KernelLight, __lights)
 KERNEL_TEX(float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, __light_background_conditional_cdf)
 
+/* light tree */
+KERNEL_TEX(KernelLightTreeNode, __light_tree_nodes)
+KERNEL_TEX(uint, __light_tree_emitter_nodes)
+KERNEL_TEX(uint2, __light_tree_object_emitters)
+KERNEL_TEX(uint, __light_tree_distant_lights)
+
+/* path guiding */
+KERNEL_TEX(KernelGuidingSpatialNode, __guiding_spatial_nodes)
+KERNEL_TEX(KernelGuidingDirectionalNode, __guiding_directional_nodes)
+
 /* particles */
 KERNEL_TEX(KernelParticle, __particles)
 
@@ -79,6 +96,7 @@ KERNEL_TEX(float, __lookup_table)
 
 /* sobol */
 KERNEL_TEX(float, __sample_pattern_lut)
+KERNEL_TEX(float, __blue_noise)
 
 /* image textures */
 KERNEL_TEX(TextureInfo, __texture_info)
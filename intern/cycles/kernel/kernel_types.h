@@ -100,6 +100,9 @@ CCL_NAMESPACE_BEGIN
 #    define __OSL__
 #  endif
 #  define __VOLUME_RECORD_ALL__
+#  define __BVH4__
+#  define __TEXTURE_CACHE__
+#  define __PATH_GUIDING__
 #endif /* __KERNEL_CPU__ */
 
 #ifdef __KERNEL_OPTIX__
@@ -1159,6 +1162,7 @@ typedef struct KernelIntegrator {
 
   /* sampler */
   int sampling_pattern;
+  int use_blue_noise;
 
   /* volume render */
   int use_volumes;
@@ -1167,8 +1171,19 @@ typedef struct KernelIntegrator {
 
   int has_shadow_catcher;
 
-  /* padding */
-  int pad1, pad2;
+  /* light tree */
+  int use_light_tree;
+  int num_light_tree_distant;
+  float pdf_light_tree;
+
+  /* path guiding */
+  int use_guiding;
+  float guiding_probability;
+
+  /* skip empty cells of volume occupancy grids */
+  int volume_skip_empty;
+
+  int pad1, pad2, pad3;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1180,10 +1195,11 @@ typedef enum KernelBVHLayout {
   BVH_LAYOUT_OPTIX = (1 << 2),
   BVH_LAYOUT_MULTI_OPTIX = (1 << 3),
   BVH_LAYOUT_MULTI_OPTIX_EMBREE = (1 << 4),
+  BVH_LAYOUT_BVH4 = (1 << 5),
 
   /* Default BVH layout to use for CPU. */
   BVH_LAYOUT_AUTO = BVH_LAYOUT_EMBREE,
-  BVH_LAYOUT_ALL = BVH_LAYOUT_BVH2 | BVH_LAYOUT_EMBREE | BVH_LAYOUT_OPTIX,
+  BVH_LAYOUT_ALL = BVH_LAYOUT_BVH2 | BVH_LAYOUT_EMBREE | BVH_LAYOUT_OPTIX | BVH_LAYOUT_BVH4,
 } KernelBVHLayout;
 
 typedef struct KernelBVH {
@@ -1194,6 +1210,8 @@ typedef struct KernelBVH {
   int bvh_layout;
   int use_bvh_steps;
   int curve_subdivisions;
+  int curve_keys_quantized;
+  int pad3, pad4, pad5;
 
   /* Custom BVH */
 #ifdef __KERNEL_OPTIX__
@@ -1243,39 +1261,61 @@ static_assert_align(KernelData, 16);
 
 /* Kernel data structures. */
 
+/* Per object data. Data which is the same for many objects, like instances of the same geometry
+ * in a scattered scene, is stored once in KernelObjectPrototype, to keep memory usage low for
+ * scenes with millions of objects. */
 typedef struct KernelObject {
   Transform tfm;
   Transform itfm;
 
   float volume_density;
-  float pass_id;
   float random_number;
-  float color[3];
   int particle_index;
+  uint motion_offset;
 
   float dupli_generated[3];
+  uint attribute_map_offset;
+
   float dupli_uv[2];
+  uint visibility;
+  int prototype;
+
+  /* Read for every hit and BSDF evaluation, so not moved to the prototype. */
+  int primitive_type;
+  float shadow_terminator_shading_offset;
+  float shadow_terminator_geometry_offset;
+  int pad1;
+} KernelObject;
+static_assert_align(KernelObject, 16);
+
+typedef struct KernelObjectPrototype {
+  float color[3];
+  float pass_id;
 
   int numkeys;
   int numsteps;
   int numverts;
-
   uint patch_map_offset;
-  uint attribute_map_offset;
-  uint motion_offset;
 
   float cryptomatte_object;
   float cryptomatte_asset;
-
-  float shadow_terminator_shading_offset;
-  float shadow_terminator_geometry_offset;
-
   float ao_distance;
+  int volume_occupancy;
+} KernelObjectPrototype;
+static_assert_align(KernelObjectPrototype, 16);
+
+/* Coarse grid of a volume object, with one bit per cell telling whether any voxel in the cell is
+ * active. The volume shader is assumed to be zero outside of active voxels, the same assumption
+ * the volume mesh is built with. */
+typedef struct KernelVolumeOccupancy {
+  /* Object space to cell coordinates. */
+  Transform tfm;
 
-  uint visibility;
-  int primitive_type;
-} KernelObject;
-static_assert_align(KernelObject, 16);
+  int resolution[3];
+  /* Offset of the first cell in the occupancy bits. */
+  int offset;
+} KernelVolumeOccupancy;
+static_assert_align(KernelVolumeOccupancy, 16);
 
 typedef struct KernelCurve {
   int shader_id;
@@ -1352,6 +1392,47 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+/* Light tree node, bounding the position, emission direction and energy of the emitters below
+ * it. Emission directions are bounded by a cone around axis with angle theta_o, with emission
+ * falling off up to theta_e beyond that. Two sided nodes also bound the mirrored directions. */
+typedef struct KernelLightTreeNode {
+  float bbox_min[3];
+  float bbox_max[3];
+  float axis[3];
+  float theta_o;
+  float theta_e;
+  float energy;
+
+  /* For inner nodes the index of the second child, the first child directly follows the node.
+   * For leaf nodes the light distribution index of the emitter, stored as ~index. */
+  int child;
+  int parent;
+  int two_sided;
+
+  /* Area of mesh light triangles at the center of the shutter. */
+  float area;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
+/* Path guiding spatial binary tree node. Inner nodes split the bounds along axis at split, with
+ * both children stored next to each other starting at child. Leaf nodes have child -1, and the
+ * index of the root of their directional quadtree, or -1 when no radiance was recorded yet. */
+typedef struct KernelGuidingSpatialNode {
+  int child;
+  int axis;
+  float split;
+  int directional_root;
+} KernelGuidingSpatialNode;
+static_assert_align(KernelGuidingSpatialNode, 16);
+
+/* Path guiding directional quadtree node, over the cylindrical mapping of the sphere of
+ * directions. Energy and child node index for each of the four quadrants, -1 for leaves. */
+typedef struct KernelGuidingDirectionalNode {
+  float energy[4];
+  int child[4];
+} KernelGuidingDirectionalNode;
+static_assert_align(KernelGuidingDirectionalNode, 16);
+
 typedef struct KernelParticle {
   int index;
   float age;
@@ -1418,6 +1499,10 @@ static_assert_align(KernelShaderEvalInput, 16);
 #define NUM_PMJ_SAMPLES ((NUM_PMJ_DIVISIONS) * (NUM_PMJ_DIVISIONS))
 #define NUM_PMJ_PATTERNS 1
 
+/* Size of the tiled blue noise mask used to decorrelate samples between pixels. */
+#define BLUE_NOISE_SIZE_LOG2 6
+#define BLUE_NOISE_SIZE (1 << BLUE_NOISE_SIZE_LOG2)
+
 /* Device kernels.
  *
  * Identifier for kernels that can be executed in device queues.
@@ -1544,6 +1629,9 @@ enum KernelFeatureFlag : unsigned int {
 
   /* Shadow render pass. */
   KERNEL_FEATURE_SHADOW_PASS = (1U << 22U),
+
+  /* Path guiding, CPU only. */
+  KERNEL_FEATURE_PATH_GUIDING = (1U << 23U),
 };
 
 /* Shader node feature mask, to specialize shader evaluation for kernels. */
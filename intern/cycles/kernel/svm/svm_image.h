@@ -16,15 +16,25 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4
-svm_image_texture(ccl_global const KernelGlobals *kg, int id, float x, float y, uint flags)
+ccl_device float4 svm_image_texture(ccl_global const KernelGlobals *kg,
+                                   int id,
+                                   float x,
+                                   float y,
+                                   float2 dx,
+                                   float2 dy,
+                                   uint flags)
 {
   if (id == -1) {
     return make_float4(
         TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
   }
 
+#ifdef __TEXTURE_CACHE__
+  /* Texture coordinate differentials select the mipmap level in the texture cache. */
+  float4 r = kernel_tex_image_interp_diff(kg, id, x, y, dx, dy);
+#else
   float4 r = kernel_tex_image_interp(kg, id, x, y);
+#endif
   const float alpha = r.w;
 
   if ((flags & NODE_IMAGE_ALPHA_UNASSOCIATE) && alpha != 1.0f && alpha != 0.0f) {
@@ -45,6 +55,35 @@ ccl_device_inline float3 texco_remap_square(float3 co)
   return (co - make_float3(0.5f, 0.5f, 0.5f)) * 2.0f;
 }
 
+ccl_device_inline float2 svm_image_texco(float3 co, uint projection)
+{
+  if (projection == NODE_IMAGE_PROJ_SPHERE) {
+    return map_to_sphere(texco_remap_square(co));
+  }
+  else if (projection == NODE_IMAGE_PROJ_TUBE) {
+    return map_to_tube(texco_remap_square(co));
+  }
+  else {
+    return make_float2(co.x, co.y);
+  }
+}
+
+/* Difference between texture coordinates, taking into account that sphere and tube
+ * projections wrap around in the horizontal direction. */
+ccl_device_inline float2 svm_image_texco_diff(float2 a, float2 b, uint projection)
+{
+  float2 d = a - b;
+  if (projection == NODE_IMAGE_PROJ_SPHERE || projection == NODE_IMAGE_PROJ_TUBE) {
+    if (d.x > 0.5f) {
+      d.x -= 1.0f;
+    }
+    else if (d.x < -0.5f) {
+      d.x += 1.0f;
+    }
+  }
+  return d;
+}
+
 ccl_device_noinline int svm_node_tex_image(ccl_global const KernelGlobals *kg,
                                            ccl_private ShaderData *sd,
                                            ccl_private float *stack,
@@ -52,21 +91,21 @@ ccl_device_noinline int svm_node_tex_image(ccl_global const KernelGlobals *kg,
                                            int offset)
 {
   uint co_offset, out_offset, alpha_offset, flags;
+  uint projection, dx_offset, dy_offset;
 
   svm_unpack_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &flags);
+  svm_unpack_node_uchar3(node.w, &projection, &dx_offset, &dy_offset);
 
   float3 co = stack_load_float3(stack, co_offset);
-  float2 tex_co;
-  if (node.w == NODE_IMAGE_PROJ_SPHERE) {
-    co = texco_remap_square(co);
-    tex_co = map_to_sphere(co);
-  }
-  else if (node.w == NODE_IMAGE_PROJ_TUBE) {
-    co = texco_remap_square(co);
-    tex_co = map_to_tube(co);
-  }
-  else {
-    tex_co = make_float2(co.x, co.y);
+  float2 tex_co = svm_image_texco(co, projection);
+
+  /* Differentials from texture coordinates evaluated at shifted positions. */
+  float2 tex_dx = zero_float2(), tex_dy = zero_float2();
+  if (stack_valid(dx_offset) && stack_valid(dy_offset)) {
+    const float2 tex_co_dx = svm_image_texco(stack_load_float3(stack, dx_offset), projection);
+    const float2 tex_co_dy = svm_image_texco(stack_load_float3(stack, dy_offset), projection);
+    tex_dx = svm_image_texco_diff(tex_co_dx, tex_co, projection);
+    tex_dy = svm_image_texco_diff(tex_co_dy, tex_co, projection);
   }
 
   /* TODO(lukas): Consider moving tile information out of the SVM node.
@@ -112,7 +151,7 @@ ccl_device_noinline int svm_node_tex_image(ccl_global const KernelGlobals *kg,
     id = -num_nodes;
   }
 
-  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, flags);
+  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, tex_dx, tex_dy, flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -206,15 +245,15 @@ ccl_device_noinline void svm_node_tex_image_box(ccl_global const KernelGlobals *
   /* Map so that no textures are flipped, rotation is somewhat arbitrary. */
   if (weight.x > 0.0f) {
     float2 uv = make_float2((signed_N.x < 0.0f) ? 1.0f - co.y : co.y, co.z);
-    f += weight.x * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.x * svm_image_texture(kg, id, uv.x, uv.y, zero_float2(), zero_float2(), flags);
   }
   if (weight.y > 0.0f) {
     float2 uv = make_float2((signed_N.y > 0.0f) ? 1.0f - co.x : co.x, co.z);
-    f += weight.y * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.y * svm_image_texture(kg, id, uv.x, uv.y, zero_float2(), zero_float2(), flags);
   }
   if (weight.z > 0.0f) {
     float2 uv = make_float2((signed_N.z > 0.0f) ? 1.0f - co.y : co.y, co.x);
-    f += weight.z * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.z * svm_image_texture(kg, id, uv.x, uv.y, zero_float2(), zero_float2(), flags);
   }
 
   if (stack_valid(out_offset))
@@ -244,7 +283,7 @@ ccl_device_noinline void svm_node_tex_environment(ccl_global const KernelGlobals
   else
     uv = direction_to_mirrorball(co);
 
-  float4 f = svm_image_texture(kg, id, uv.x, uv.y, flags);
+  float4 f = svm_image_texture(kg, id, uv.x, uv.y, zero_float2(), zero_float2(), flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
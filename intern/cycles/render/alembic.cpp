@@ -40,7 +40,7 @@ CCL_NAMESPACE_BEGIN
 
 template<typename SchemaType>
 static vector<FaceSetShaderIndexPair> parse_face_sets_for_shader_assignment(
-    SchemaType &schema, const array<Node *> &used_shaders)
+    SchemaType &schema, const vector<ustring> &shader_names)
 {
   vector<FaceSetShaderIndexPair> result;
 
@@ -54,15 +54,15 @@ static vector<FaceSetShaderIndexPair> parse_face_sets_for_shader_assignment(
   for (const std::string &face_set_name : face_set_names) {
     int shader_index = 0;
 
-    for (Node *node : used_shaders) {
-      if (node->name == face_set_name) {
+    for (const ustring &shader_name : shader_names) {
+      if (shader_name == face_set_name) {
         break;
       }
 
       ++shader_index;
     }
 
-    if (shader_index >= used_shaders.size()) {
+    if (shader_index >= shader_names.size()) {
       /* use the first shader instead if none was found */
       shader_index = 0;
     }
@@ -81,6 +81,8 @@ static vector<FaceSetShaderIndexPair> parse_face_sets_for_shader_assignment(
 
 void CachedData::clear()
 {
+  is_animated = false;
+
   attributes.clear();
   curve_first_key.clear();
   curve_keys.clear();
@@ -449,6 +451,40 @@ bool AlembicObject::has_data_loaded() const
   return data_loaded;
 }
 
+void AlembicObject::update_read_params(AlembicProcedural *proc)
+{
+  read_params.shader_names.clear();
+  for (Node *node : get_used_shaders()) {
+    read_params.shader_names.push_back(node->name);
+  }
+
+  read_params.requested_attributes = get_requested_attributes();
+  read_params.ignore_subdivision = get_ignore_subdivision();
+  read_params.radius_scale = get_radius_scale();
+  read_params.default_radius = proc->get_default_radius();
+}
+
+void AlembicObject::load_data_in_cache(CachedData &cached_data,
+                                       AlembicProcedural *proc,
+                                       Progress &progress)
+{
+  if (schema_type == POLY_MESH) {
+    IPolyMesh polymesh(iobject, Alembic::Abc::kWrapExisting);
+    IPolyMeshSchema schema = polymesh.getSchema();
+    load_data_in_cache(cached_data, proc, schema, progress);
+  }
+  else if (schema_type == CURVES) {
+    ICurves curves(iobject, Alembic::Abc::kWrapExisting);
+    ICurvesSchema schema = curves.getSchema();
+    load_data_in_cache(cached_data, proc, schema, progress);
+  }
+  else if (schema_type == SUBD) {
+    ISubD subd_mesh(iobject, Alembic::Abc::kWrapExisting);
+    ISubDSchema schema = subd_mesh.getSchema();
+    load_data_in_cache(cached_data, proc, schema, progress);
+  }
+}
+
 void AlembicObject::load_data_in_cache(CachedData &cached_data,
                                        AlembicProcedural *proc,
                                        IPolyMeshSchema &schema,
@@ -469,7 +505,7 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
   data.face_indices = schema.getFaceIndicesProperty();
   data.normals = schema.getNormalsParam();
   data.num_samples = schema.getNumSamples();
-  data.shader_face_sets = parse_face_sets_for_shader_assignment(schema, get_used_shaders());
+  data.shader_face_sets = parse_face_sets_for_shader_assignment(schema, read_params.shader_names);
 
   read_geometry_data(proc, cached_data, data, progress);
 
@@ -480,14 +516,13 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
   /* Use the schema as the base compound property to also be able to look for top level properties.
    */
   read_attributes(
-      proc, cached_data, schema, schema.getUVsParam(), get_requested_attributes(), progress);
+      proc, cached_data, schema, schema.getUVsParam(), read_params.requested_attributes, progress);
 
   if (progress.get_cancel()) {
     return;
   }
 
   cached_data.invalidate_last_loaded_time(true);
-  data_loaded = true;
 }
 
 void AlembicObject::load_data_in_cache(CachedData &cached_data,
@@ -502,7 +537,7 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
 
   cached_data.clear();
 
-  if (this->get_ignore_subdivision()) {
+  if (read_params.ignore_subdivision) {
     PolyMeshSchemaData data;
     data.topology_variance = schema.getTopologyVariance();
     data.time_sampling = schema.getTimeSampling();
@@ -511,7 +546,8 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
     data.face_indices = schema.getFaceIndicesProperty();
     data.num_samples = schema.getNumSamples();
     data.velocities = schema.getVelocitiesProperty();
-    data.shader_face_sets = parse_face_sets_for_shader_assignment(schema, get_used_shaders());
+    data.shader_face_sets = parse_face_sets_for_shader_assignment(schema,
+                                                                  read_params.shader_names);
 
     read_geometry_data(proc, cached_data, data, progress);
 
@@ -521,11 +557,14 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
 
     /* Use the schema as the base compound property to also be able to look for top level
      * properties. */
-    read_attributes(
-        proc, cached_data, schema, schema.getUVsParam(), get_requested_attributes(), progress);
+    read_attributes(proc,
+                    cached_data,
+                    schema,
+                    schema.getUVsParam(),
+                    read_params.requested_attributes,
+                    progress);
 
     cached_data.invalidate_last_loaded_time(true);
-    data_loaded = true;
     return;
   }
 
@@ -547,7 +586,7 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
   data.holes = schema.getHolesProperty();
   data.subdivision_scheme = schema.getSubdivisionSchemeProperty();
   data.velocities = schema.getVelocitiesProperty();
-  data.shader_face_sets = parse_face_sets_for_shader_assignment(schema, get_used_shaders());
+  data.shader_face_sets = parse_face_sets_for_shader_assignment(schema, read_params.shader_names);
 
   read_geometry_data(proc, cached_data, data, progress);
 
@@ -558,10 +597,9 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
   /* Use the schema as the base compound property to also be able to look for top level properties.
    */
   read_attributes(
-      proc, cached_data, schema, schema.getUVsParam(), get_requested_attributes(), progress);
+      proc, cached_data, schema, schema.getUVsParam(), read_params.requested_attributes, progress);
 
   cached_data.invalidate_last_loaded_time(true);
-  data_loaded = true;
 }
 
 void AlembicObject::load_data_in_cache(CachedData &cached_data,
@@ -588,8 +626,8 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
   data.topology_variance = schema.getTopologyVariance();
   data.num_samples = schema.getNumSamples();
   data.num_vertices = schema.getNumVerticesProperty();
-  data.default_radius = proc->get_default_radius();
-  data.radius_scale = get_radius_scale();
+  data.default_radius = read_params.default_radius;
+  data.radius_scale = read_params.radius_scale;
 
   read_geometry_data(proc, cached_data, data, progress);
 
@@ -600,10 +638,9 @@ void AlembicObject::load_data_in_cache(CachedData &cached_data,
   /* Use the schema as the base compound property to also be able to look for top level properties.
    */
   read_attributes(
-      proc, cached_data, schema, schema.getUVsParam(), get_requested_attributes(), progress);
+      proc, cached_data, schema, schema.getUVsParam(), read_params.requested_attributes, progress);
 
   cached_data.invalidate_last_loaded_time(true);
-  data_loaded = true;
 }
 
 void AlembicObject::setup_transform_cache(CachedData &cached_data, float scale)
@@ -750,6 +787,8 @@ AlembicProcedural::AlembicProcedural() : Procedural(get_node_type())
 
 AlembicProcedural::~AlembicProcedural()
 {
+  prefetch_cancel();
+
   ccl::set<Geometry *> geometries_set;
   ccl::set<Object *> objects_set;
   ccl::set<AlembicObject *> abc_objects_set;
@@ -823,6 +862,18 @@ void AlembicProcedural::generate(Scene *scene, Progress &progress)
     return;
   }
 
+  /* The prefetched data is read with the old settings and shaders. */
+  if (need_shader_updates || need_data_updates || objects_is_modified() ||
+      default_radius_is_modified() || frame_rate_is_modified() || frame_offset_is_modified() ||
+      use_prefetch_is_modified() || prefetch_cache_size_is_modified()) {
+    prefetch_cancel();
+  }
+
+  /* Frames of the caches map to other times. */
+  if (frame_rate_is_modified() || frame_offset_is_modified()) {
+    cache_end_frame_ = cache_start_frame_ - 1.0f;
+  }
+
   if (!archive.valid()) {
     Alembic::AbcCoreFactory::IFactory factory;
     factory.setPolicy(Alembic::Abc::ErrorHandler::kQuietNoopPolicy);
@@ -841,7 +892,7 @@ void AlembicProcedural::generate(Scene *scene, Progress &progress)
     objects_loaded = true;
   }
 
-  const chrono_t frame_time = (chrono_t)((frame - frame_offset) / frame_rate);
+  const chrono_t frame_time = frame_to_time(frame);
 
   /* Clear the subdivision caches as the data is stored differently. */
   for (Node *node : objects) {
@@ -862,12 +913,14 @@ void AlembicProcedural::generate(Scene *scene, Progress &progress)
         AlembicObject *object = static_cast<AlembicObject *>(node);
         object->clear_cache();
       }
+
+      cache_end_frame_ = cache_start_frame_ - 1.0f;
     }
   }
 
   if (prefetch_cache_size_is_modified()) {
-    /* Check whether the current memory usage fits in the new requested size,
-     * abort the render if it is any higher. */
+    /* Check whether the current memory usage fits in the new requested size, only keep the data
+     * for the current frame if it is any higher. */
     size_t memory_used = 0ul;
     for (Node *node : objects) {
       AlembicObject *object = static_cast<AlembicObject *>(node);
@@ -875,8 +928,12 @@ void AlembicProcedural::generate(Scene *scene, Progress &progress)
     }
 
     if (memory_used > get_prefetch_cache_size_in_bytes()) {
-      progress.set_error("Error: Alembic Procedural memory limit reached");
-      return;
+      for (Node *node : objects) {
+        AlembicObject *object = static_cast<AlembicObject *>(node);
+        object->clear_cache();
+      }
+
+      cache_end_frame_ = cache_start_frame_ - 1.0f;
     }
   }
 
@@ -891,7 +948,7 @@ void AlembicProcedural::generate(Scene *scene, Progress &progress)
 
     /* skip constant objects */
     if (object->is_constant() && !object->is_modified() && !object->need_shader_update &&
-        !scale_is_modified()) {
+        !object->cache_data_changed && !scale_is_modified()) {
       continue;
     }
 
@@ -906,9 +963,12 @@ void AlembicProcedural::generate(Scene *scene, Progress &progress)
     }
 
     object->need_shader_update = false;
+    object->cache_data_changed = false;
     object->clear_modified();
   }
 
+  last_frame_ = frame;
+
   clear_modified();
 }
 
@@ -1357,6 +1417,20 @@ void AlembicProcedural::walk_hierarchy(
 
 void AlembicProcedural::build_caches(Progress &progress)
 {
+  const chrono_t frame_time = frame_to_time(frame);
+
+  if (frame < cache_start_frame_ || frame > cache_end_frame_) {
+    if (frame >= prefetch_start_frame_ && frame <= prefetch_end_frame_) {
+      prefetch_swap();
+    }
+    else {
+      /* Only read the current frame, the following ones are read by the prefetcher. */
+      prefetch_cancel();
+      cache_start_frame_ = frame;
+      cache_end_frame_ = frame;
+    }
+  }
+
   size_t memory_used = 0;
 
   for (Node *node : objects) {
@@ -1366,56 +1440,68 @@ void AlembicProcedural::build_caches(Progress &progress)
       return;
     }
 
-    if (object->schema_type == AlembicObject::POLY_MESH) {
-      if (!object->has_data_loaded()) {
-        IPolyMesh polymesh(object->iobject, Alembic::Abc::kWrapExisting);
-        IPolyMeshSchema schema = polymesh.getSchema();
-        object->load_data_in_cache(object->get_cached_data(), this, schema, progress);
+    if (object->schema_type == AlembicObject::INVALID) {
+      continue;
+    }
+
+    CachedData &cached_data = object->get_cached_data();
+
+    bool need_load = !object->has_data_loaded() || !cached_data.has_data_for_time(frame_time);
+    if (object->schema_type == AlembicObject::CURVES) {
+      need_load |= default_radius_is_modified() || object->radius_scale_is_modified();
+    }
+
+    if (need_load) {
+      /* Avoid reading the archive from multiple threads. */
+      prefetch_cancel();
+
+      object->update_read_params(this);
+      set_cache_frame_range(cached_data, cache_start_frame_, cache_end_frame_);
+      object->load_data_in_cache(cached_data, this, progress);
+
+      if (progress.get_cancel()) {
+        return;
       }
-      else if (object->need_shader_update) {
+
+      object->data_loaded = true;
+      object->cache_data_changed = true;
+    }
+    else if (object->need_shader_update && object->schema_type != AlembicObject::CURVES) {
+      prefetch_cancel();
+
+      object->update_read_params(this);
+
+      if (object->schema_type == AlembicObject::POLY_MESH) {
         IPolyMesh polymesh(object->iobject, Alembic::Abc::kWrapExisting);
         IPolyMeshSchema schema = polymesh.getSchema();
         read_attributes(this,
-                        object->get_cached_data(),
+                        cached_data,
                         schema,
                         schema.getUVsParam(),
-                        object->get_requested_attributes(),
+                        object->read_params.requested_attributes,
                         progress);
       }
-    }
-    else if (object->schema_type == AlembicObject::CURVES) {
-      if (!object->has_data_loaded() || default_radius_is_modified() ||
-          object->radius_scale_is_modified()) {
-        ICurves curves(object->iobject, Alembic::Abc::kWrapExisting);
-        ICurvesSchema schema = curves.getSchema();
-        object->load_data_in_cache(object->get_cached_data(), this, schema, progress);
-      }
-    }
-    else if (object->schema_type == AlembicObject::SUBD) {
-      if (!object->has_data_loaded()) {
-        ISubD subd_mesh(object->iobject, Alembic::Abc::kWrapExisting);
-        ISubDSchema schema = subd_mesh.getSchema();
-        object->load_data_in_cache(object->get_cached_data(), this, schema, progress);
-      }
-      else if (object->need_shader_update) {
+      else {
         ISubD subd_mesh(object->iobject, Alembic::Abc::kWrapExisting);
         ISubDSchema schema = subd_mesh.getSchema();
         read_attributes(this,
-                        object->get_cached_data(),
+                        cached_data,
                         schema,
                         schema.getUVsParam(),
-                        object->get_requested_attributes(),
+                        object->read_params.requested_attributes,
                         progress);
       }
     }
 
-    if (scale_is_modified() || object->get_cached_data().transforms.size() == 0) {
-      object->setup_transform_cache(object->get_cached_data(), scale);
+    if (scale_is_modified() || cached_data.transforms.size() == 0) {
+      object->setup_transform_cache(cached_data, scale);
     }
 
-    memory_used += object->get_cached_data().memory_used();
+    memory_used += cached_data.memory_used();
 
-    if (use_prefetch) {
+    /* Windows of multiple frames are sized to fit, so only abort when the data for the current
+     * frame alone does not fit. */
+    if (use_prefetch && cache_start_frame_ == cache_end_frame_) {
       if (memory_used > get_prefetch_cache_size_in_bytes()) {
         progress.set_error("Error: Alembic Procedural memory limit reached");
         return;
@@ -1424,6 +1510,122 @@ void AlembicProcedural::build_caches(Progress &progress)
   }
 
   VLOG(1) << "AlembicProcedural memory usage : " << string_human_readable_size(memory_used);
+
+  if (use_prefetch) {
+    prefetch_start(memory_used);
+  }
+}
+
+void AlembicProcedural::set_cache_frame_range(CachedData &cached_data,
+                                              float start,
+                                              float end) const
+{
+  cached_data.start_time = frame_to_time(start);
+  cached_data.end_time = frame_to_time(end + 1.0f);
+}
+
+void AlembicProcedural::prefetch_start(size_t memory_used)
+{
+  if (prefetch_start_frame_ <= prefetch_end_frame_) {
+    return;
+  }
+
+  /* Fit the window in half of the cache size, the other half being used by the current data.
+   * The memory used by a frame is estimated from the cached frames. */
+  const float num_cached_frames = cache_end_frame_ - cache_start_frame_ + 1.0f;
+  const size_t frame_memory = max(static_cast<size_t>(memory_used / num_cached_frames),
+                                  static_cast<size_t>(1));
+  const float num_frames = max(
+      floorf(static_cast<float>(get_prefetch_cache_size_in_bytes() / 2 / frame_memory)), 1.0f);
+
+  if (frame >= last_frame_) {
+    prefetch_start_frame_ = cache_end_frame_ + 1.0f;
+    prefetch_end_frame_ = min(cache_end_frame_ + num_frames, end_frame);
+  }
+  else {
+    prefetch_start_frame_ = max(cache_start_frame_ - num_frames, start_frame);
+    prefetch_end_frame_ = cache_start_frame_ - 1.0f;
+  }
+
+  if (prefetch_start_frame_ > prefetch_end_frame_) {
+    return;
+  }
+
+  vector<AlembicObject *> prefetch_objects;
+
+  for (Node *node : objects) {
+    AlembicObject *object = static_cast<AlembicObject *>(node);
+
+    /* Constant data is valid for the new frames as well. */
+    if (object->schema_type == AlembicObject::INVALID || object->instance_of ||
+        !object->get_cached_data().is_animated) {
+      continue;
+    }
+
+    object->update_read_params(this);
+    set_cache_frame_range(object->prefetched_data_, prefetch_start_frame_, prefetch_end_frame_);
+    prefetch_objects.push_back(object);
+  }
+
+  if (prefetch_objects.empty()) {
+    return;
+  }
+
+  VLOG(1) << "AlembicProcedural prefetching frames " << prefetch_start_frame_ << " to "
+          << prefetch_end_frame_;
+
+  prefetch_pool_.push([this, prefetch_objects]() {
+    for (AlembicObject *object : prefetch_objects) {
+      if (prefetch_progress_.get_cancel()) {
+        return;
+      }
+
+      object->load_data_in_cache(object->prefetched_data_, this, prefetch_progress_);
+    }
+  });
+}
+
+void AlembicProcedural::prefetch_swap()
+{
+  prefetch_pool_.wait();
+
+  for (Node *node : objects) {
+    AlembicObject *object = static_cast<AlembicObject *>(node);
+
+    if (object->prefetched_data_.end_time <= object->prefetched_data_.start_time) {
+      continue;
+    }
+
+    swap(object->cached_data_, object->prefetched_data_);
+
+    /* Free the data of the old frames. */
+    object->prefetched_data_.clear();
+    object->prefetched_data_.start_time = 0.0;
+    object->prefetched_data_.end_time = 0.0;
+
+    object->cached_data_.invalidate_last_loaded_time();
+    object->cache_data_changed = true;
+  }
+
+  cache_start_frame_ = prefetch_start_frame_;
+  cache_end_frame_ = prefetch_end_frame_;
+  prefetch_end_frame_ = prefetch_start_frame_ - 1.0f;
+}
+
+void AlembicProcedural::prefetch_cancel()
+{
+  prefetch_progress_.set_cancel("Cancelled");
+  prefetch_pool_.wait();
+  prefetch_progress_.reset();
+
+  for (Node *node : objects) {
+    AlembicObject *object = static_cast<AlembicObject *>(node);
+    object->prefetched_data_.clear();
+    object->prefetched_data_.start_time = 0.0;
+    object->prefetched_data_.end_time = 0.0;
+  }
+
+  prefetch_end_frame_ = prefetch_start_frame_ - 1.0f;
 }
 
 CCL_NAMESPACE_END
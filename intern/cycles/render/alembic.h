@@ -19,7 +19,10 @@
 #include "graph/node.h"
 #include "render/attribute.h"
 #include "render/procedural.h"
+#include "util/util_algorithm.h"
+#include "util/util_progress.h"
 #include "util/util_set.h"
+#include "util/util_task.h"
 #include "util/util_transform.h"
 #include "util/util_vector.h"
 
@@ -290,9 +293,24 @@ template<typename T> class DataStore {
  private:
   const TimeIndexPair &get_index_for_time(double time) const
   {
-    std::pair<size_t, Alembic::Abc::chrono_t> index_pair;
-    index_pair = time_sampling.getNearIndex(time, index_data_map.size());
-    return index_data_map[index_pair.first];
+    /* Only the samples within the time range of the cache are stored, so the index of the sample
+     * in the time sampling can not be used to index the map. Look up the entry nearest in time
+     * instead, the entries are stored in chronological order. */
+    auto it = std::lower_bound(
+        index_data_map.begin(),
+        index_data_map.end(),
+        time,
+        [](const TimeIndexPair &pair, double value) { return pair.time < value; });
+
+    if (it == index_data_map.end()) {
+      return index_data_map.back();
+    }
+
+    if (it != index_data_map.begin() && (time - (it - 1)->time) <= (it->time - time)) {
+      --it;
+    }
+
+    return *it;
   }
 };
 
@@ -337,6 +355,21 @@ struct CachedData {
 
   vector<CachedAttribute> attributes{};
 
+  /* Range of time in seconds for which the data is read from the archive, as only the samples
+   * within it are loaded. The range is to be set before reading the data, and is kept on clear().
+   */
+  double start_time = 0.0;
+  double end_time = 0.0;
+
+  /* Set when any of the read properties has more than a single sample in the archive, otherwise
+   * the data is valid for any time. */
+  bool is_animated = false;
+
+  bool has_data_for_time(double time) const
+  {
+    return !is_animated || (time >= start_time && time < end_time);
+  }
+
   void clear();
 
   CachedAttribute &add_attribute(const ustring &name,
@@ -392,6 +425,10 @@ class AlembicObject : public Node {
   void set_object(Object *object);
   Object *get_object();
 
+  /* Read the data for the time range of the cached data, using the read parameters. Safe to be
+   * called from a background thread, as long as the parameters are not being updated. */
+  void load_data_in_cache(CachedData &cached_data, AlembicProcedural *proc, Progress &progress);
+
   void load_data_in_cache(CachedData &cached_data,
                           AlembicProcedural *proc,
                           Alembic::AbcGeom::IPolyMeshSchema &schema,
@@ -418,6 +455,24 @@ class AlembicObject : public Node {
 
   bool need_shader_update = true;
 
+  /* Set when the cached data was replaced with the data for another range of frames, so that the
+   * sockets are updated even if the data is constant within the range. */
+  bool cache_data_changed = false;
+
+  /* Copy of the sockets and of the scene data needed to read the data from the archive, gathered
+   * on the main thread so that the data can be prefetched while the scene is synchronized. */
+  struct ReadParams {
+    vector<ustring> shader_names;
+    AttributeRequestSet requested_attributes;
+    bool ignore_subdivision = false;
+    float radius_scale = 1.0f;
+    float default_radius = 0.0f;
+  };
+
+  ReadParams read_params;
+
+  void update_read_params(AlembicProcedural *proc);
+
   AlembicObject *instance_of = nullptr;
 
   Alembic::AbcCoreAbstract::TimeSamplingPtr xform_time_sampling;
@@ -440,6 +495,8 @@ class AlembicObject : public Node {
   void clear_cache()
   {
     cached_data_.clear();
+    prefetched_data_.clear();
+    data_loaded = false;
   }
 
   Object *object = nullptr;
@@ -448,6 +505,9 @@ class AlembicObject : public Node {
 
   CachedData cached_data_;
 
+  /* Data read in the background for the frames which are to be rendered next. */
+  CachedData prefetched_data_;
+
   void setup_transform_cache(CachedData &cached_data, float scale);
 
   AttributeRequestSet get_requested_attributes();
@@ -458,9 +518,12 @@ class AlembicObject : public Node {
  * Every object desired to be rendered should be passed as an AlembicObject through the objects
  * socket.
  *
- * This procedural will load the data set for the entire animation in memory on the first frame,
- * and directly set the data for the new frames on the created Nodes if needed. This allows for
- * faster updates between frames as it avoids reseeking the data on disk.
+ * This procedural only reads the data for the current frame on the first invocation. When
+ * prefetching is enabled, the data for the following frames is read in the background into a
+ * second cache, in windows of as many frames as fit in half of the prefetch cache size. When the
+ * current frame moves into the prefetched window the caches are swapped and the data of the old
+ * window is freed, so the data for new frames is directly set on the created Nodes without
+ * reseeking it on disk, while the memory usage stays bounded.
  */
 class AlembicProcedural : public Procedural {
   Alembic::AbcGeom::IArchive archive;
@@ -502,8 +565,8 @@ class AlembicProcedural : public Procedural {
   /* Cache controls */
   NODE_SOCKET_API(bool, use_prefetch)
 
-  /* Memory limit for the cache, if the data does not fit within this limit, rendering is aborted.
-   */
+  /* Memory limit for the cache in megabytes. The prefetched frames are limited to fit within it,
+   * if the data for the current frame does not fit, rendering is aborted. */
   NODE_SOCKET_API(int, prefetch_cache_size)
 
   AlembicProcedural();
@@ -561,6 +624,37 @@ class AlembicProcedural : public Procedural {
     /* prefetch_cache_size is in megabytes, so convert to bytes. */
     return static_cast<size_t>(prefetch_cache_size) * 1024 * 1024;
   }
+
+  /* Time in seconds at which the data for the given frame is looked up. */
+  double frame_to_time(float frame_) const
+  {
+    return static_cast<double>((frame_ - frame_offset) / frame_rate);
+  }
+
+  /* Set the time range of the cached data to the given range of frames. */
+  void set_cache_frame_range(CachedData &cached_data, float start, float end) const;
+
+  /* Start reading the data for the window of frames following the cached ones in the direction
+   * of the playback, unless already done. */
+  void prefetch_start(size_t memory_used);
+
+  /* Wait for the prefetched data, and swap it with the cached data of the objects. */
+  void prefetch_swap();
+
+  /* Stop reading and free the prefetched data. */
+  void prefetch_cancel();
+
+  /* Range of frames for which the objects hold cached data, and for which data is prefetched. */
+  float cache_start_frame_ = 0.0f;
+  float cache_end_frame_ = -1.0f;
+  float prefetch_start_frame_ = 0.0f;
+  float prefetch_end_frame_ = -1.0f;
+
+  /* Frame of the previous invocation, to detect the direction of the playback. */
+  float last_frame_ = 0.0f;
+
+  DedicatedTaskPool prefetch_pool_;
+  Progress prefetch_progress_;
 };
 
 CCL_NAMESPACE_END
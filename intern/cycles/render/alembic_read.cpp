@@ -32,8 +32,9 @@ static float3 make_float3_from_yup(const V3f &v)
   return make_float3(v.x, -v.z, v.y);
 }
 
-/* get the sample times to load data for the given the start and end frame of the procedural */
-static set<chrono_t> get_relevant_sample_times(AlembicProcedural *proc,
+/* get the sample times to load data for the time range of the cached data, and tag the data as
+ * animated if there is more than one sample */
+static set<chrono_t> get_relevant_sample_times(CachedData &cached_data,
                                                const TimeSampling &time_sampling,
                                                size_t num_samples)
 {
@@ -44,26 +45,16 @@ static set<chrono_t> get_relevant_sample_times(AlembicProcedural *proc,
     return result;
   }
 
-  double start_frame;
-  double end_frame;
+  cached_data.is_animated = true;
 
-  if (proc->get_use_prefetch()) {
-    // load the data for the entire animation
-    start_frame = static_cast<double>(proc->get_start_frame());
-    end_frame = static_cast<double>(proc->get_end_frame());
-  }
-  else {
-    // load the data for the current frame
-    start_frame = static_cast<double>(proc->get_frame());
-    end_frame = start_frame;
-  }
+  const size_t start_index =
+      time_sampling.getFloorIndex(cached_data.start_time, num_samples).first;
+  size_t end_index = time_sampling.getCeilIndex(cached_data.end_time, num_samples).first;
 
-  const double frame_rate = static_cast<double>(proc->get_frame_rate());
-  const double start_time = start_frame / frame_rate;
-  const double end_time = (end_frame + 1) / frame_rate;
-
-  const size_t start_index = time_sampling.getFloorIndex(start_time, num_samples).first;
-  const size_t end_index = time_sampling.getCeilIndex(end_time, num_samples).first;
+  /* Include the last sample when the range extends past it. */
+  if (time_sampling.getSampleTime(end_index) < cached_data.end_time) {
+    ++end_index;
+  }
 
   for (size_t i = start_index; i < end_index; ++i) {
     result.insert(time_sampling.getSampleTime(i));
@@ -83,7 +74,7 @@ static void read_data_loop(AlembicProcedural *proc,
                            Progress &progress)
 {
   const std::set<chrono_t> times = get_relevant_sample_times(
-      proc, *params.time_sampling, params.num_samples);
+      cached_data, *params.time_sampling, params.num_samples);
 
   cached_data.set_time_sampling(*params.time_sampling);
 
@@ -824,7 +815,7 @@ static void read_attribute_loop(AlembicProcedural *proc,
                                 AttributeStandard std = ATTR_STD_NONE)
 {
   const std::set<chrono_t> times = get_relevant_sample_times(
-      proc, *param.getTimeSampling(), param.getNumSamples());
+      cache, *param.getTimeSampling(), param.getNumSamples());
 
   if (times.empty()) {
     return;
@@ -42,13 +42,18 @@ bool BakeManager::get_baking() const
 
 void BakeManager::set(Scene *scene, const std::string &object_name_)
 {
+  /* Object index may have changed, but kernels and film are the same for baking another image of
+   * the same object. */
+  need_update_ = true;
+  if (object_name == object_name_) {
+    return;
+  }
+
   object_name = object_name_;
 
   /* create device and update scene */
   scene->film->tag_modified();
   scene->integrator->tag_update(scene, Integrator::UPDATE_ALL);
-
-  need_update_ = true;
 }
 
 void BakeManager::device_update(Device * /*device*/,
@@ -16,6 +16,7 @@
 
 #include "bvh/bvh.h"
 #include "bvh/bvh2.h"
+#include "bvh/bvh4.h"
 
 #include "device/device.h"
 
@@ -44,6 +45,10 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Refit scene BVH is rebuilt when its estimated traversal cost grows by more than this factor
+ * compared to the cost right after building it. */
+static const float BVH_REFIT_MAX_COST_RATIO = 1.5f;
+
 /* Geometry */
 
 NODE_ABSTRACT_DEFINE(Geometry)
@@ -190,8 +195,13 @@ bool Geometry::has_true_displacement() const
   return false;
 }
 
-void Geometry::compute_bvh(
-    Device *device, DeviceScene *dscene, SceneParams *params, Progress *progress, int n, int total)
+void Geometry::compute_bvh(Device *device,
+                           DeviceScene *dscene,
+                           SceneParams *params,
+                           BVHCache *bvh_cache,
+                           Progress *progress,
+                           int n,
+                           int total)
 {
   if (progress->get_cancel())
     return;
@@ -241,6 +251,7 @@ void Geometry::compute_bvh(
       bparams.num_motion_curve_steps = params->num_bvh_time_steps;
       bparams.bvh_type = params->bvh_type;
       bparams.curve_subdivisions = params->curve_subdivisions();
+      bparams.cache = bvh_cache;
 
       delete bvh;
       bvh = BVH::create(bparams, geometry, objects, device);
@@ -617,6 +628,7 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
         for (size_t k = 0; k < size; k++) {
           attr_uchar4[offset + k] = data[k];
         }
+        attr_uchar4.tag_modified(offset, size);
       }
       attr_uchar4_offset += size;
     }
@@ -629,6 +641,7 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
         for (size_t k = 0; k < size; k++) {
           attr_float[offset + k] = data[k];
         }
+        attr_float.tag_modified(offset, size);
       }
       attr_float_offset += size;
     }
@@ -641,6 +654,7 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
         for (size_t k = 0; k < size; k++) {
           attr_float2[offset + k] = data[k];
         }
+        attr_float2.tag_modified(offset, size);
       }
       attr_float2_offset += size;
     }
@@ -653,6 +667,7 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
         for (size_t k = 0; k < size * 3; k++) {
           attr_float3[offset + k] = (&tfm->x)[k];
         }
+        attr_float3.tag_modified(offset, size * 3);
       }
       attr_float3_offset += size * 3;
     }
@@ -665,6 +680,7 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
         for (size_t k = 0; k < size; k++) {
           attr_float3[offset + k] = data[k];
         }
+        attr_float3.tag_modified(offset, size);
       }
       attr_float3_offset += size;
     }
@@ -1089,9 +1105,17 @@ void GeometryManager::device_update_mesh(Device *,
                                dscene->tri_patch.need_realloc() ||
                                dscene->tri_patch_uv.need_realloc();
 
+    vector<Mesh *> meshes;
     foreach (Geometry *geom, scene->geometry) {
       if (geom->geometry_type == Geometry::MESH || geom->geometry_type == Geometry::VOLUME) {
-        Mesh *mesh = static_cast<Mesh *>(geom);
+        meshes.push_back(static_cast<Mesh *>(geom));
+      }
+    }
+
+    /* Pack meshes in parallel, each mesh only writes to its own range of the arrays. */
+    parallel_for(blocked_range<size_t>(0, meshes.size()), [&](const blocked_range<size_t> &r) {
+      for (size_t i = r.begin(); i != r.end(); i++) {
+        Mesh *mesh = meshes[i];
 
         if (mesh->shader_is_modified() || mesh->smooth_is_modified() ||
             mesh->triangles_is_modified() || copy_all_data) {
@@ -1109,9 +1133,33 @@ void GeometryManager::device_update_mesh(Device *,
                            &tri_patch[mesh->prim_offset],
                            &tri_patch_uv[mesh->vert_offset]);
         }
+      }
+    });
 
-        if (progress.get_cancel())
-          return;
+    if (progress.get_cancel())
+      return;
+
+    /* Tag the packed ranges, so only those are copied to the device when the arrays were not
+     * reallocated. */
+    foreach (Mesh *mesh, meshes) {
+      const size_t num_triangles = mesh->num_triangles();
+      const size_t num_verts = mesh->verts.size();
+
+      if (mesh->shader_is_modified() || mesh->smooth_is_modified() ||
+          mesh->triangles_is_modified()) {
+        dscene->tri_shader.tag_modified(mesh->prim_offset, num_triangles);
+      }
+
+      if (mesh->verts_is_modified()) {
+        dscene->tri_vnormal.tag_modified(mesh->vert_offset, num_verts);
+      }
+
+      if (mesh->verts_is_modified() || mesh->triangles_is_modified() ||
+          mesh->vert_patch_uv_is_modified()) {
+        dscene->tri_verts.tag_modified(mesh->prim_offset * 3, num_triangles * 3);
+        dscene->tri_vindex.tag_modified(mesh->prim_offset, num_triangles);
+        dscene->tri_patch.tag_modified(mesh->prim_offset, num_triangles);
+        dscene->tri_patch_uv.tag_modified(mesh->vert_offset, num_verts);
       }
     }
 
@@ -1129,17 +1177,34 @@ void GeometryManager::device_update_mesh(Device *,
   if (curve_segment_size != 0) {
     progress.set_status("Updating Mesh", "Copying Curves to device");
 
-    float4 *curve_keys = dscene->curve_keys.alloc(curve_key_size);
+    const bool use_quantized_keys = dscene->data.bvh.curve_keys_quantized;
+
+    float4 *curve_keys = (use_quantized_keys) ? NULL : dscene->curve_keys.alloc(curve_key_size);
+    uint2 *curve_keys_quantized = (use_quantized_keys) ?
+                                      dscene->curve_keys_quantized.alloc(curve_key_size) :
+                                      NULL;
+    float4 *curve_key_bounds = (use_quantized_keys) ?
+                                   dscene->curve_key_bounds.alloc(curve_size * 2) :
+                                   NULL;
     KernelCurve *curves = dscene->curves.alloc(curve_size);
     KernelCurveSegment *curve_segments = dscene->curve_segments.alloc(curve_segment_size);
 
     const bool copy_all_data = dscene->curve_keys.need_realloc() ||
+                               dscene->curve_keys_quantized.need_realloc() ||
+                               dscene->curve_key_bounds.need_realloc() ||
                                dscene->curves.need_realloc() ||
                                dscene->curve_segments.need_realloc();
 
+    vector<Hair *> hairs;
     foreach (Geometry *geom, scene->geometry) {
       if (geom->is_hair()) {
-        Hair *hair = static_cast<Hair *>(geom);
+        hairs.push_back(static_cast<Hair *>(geom));
+      }
+    }
+
+    parallel_for(blocked_range<size_t>(0, hairs.size()), [&](const blocked_range<size_t> &r) {
+      for (size_t i = r.begin(); i != r.end(); i++) {
+        Hair *hair = hairs[i];
 
         bool curve_keys_co_modified = hair->curve_radius_is_modified() ||
                                       hair->curve_keys_is_modified();
@@ -1151,15 +1216,33 @@ void GeometryManager::device_update_mesh(Device *,
         }
 
         hair->pack_curves(scene,
-                          &curve_keys[hair->curve_key_offset],
+                          (curve_keys) ? &curve_keys[hair->curve_key_offset] : NULL,
+                          (curve_keys_quantized) ? &curve_keys_quantized[hair->curve_key_offset] :
+                                                   NULL,
+                          (curve_key_bounds) ? &curve_key_bounds[hair->prim_offset * 2] : NULL,
                           &curves[hair->prim_offset],
                           &curve_segments[hair->curve_segment_offset]);
-        if (progress.get_cancel())
-          return;
+      }
+    });
+
+    if (progress.get_cancel())
+      return;
+
+    foreach (Hair *hair, hairs) {
+      if (hair->curve_radius_is_modified() || hair->curve_keys_is_modified() ||
+          hair->curve_shader_is_modified() || hair->curve_first_key_is_modified()) {
+        dscene->curve_keys.tag_modified(hair->curve_key_offset, hair->get_curve_keys().size());
+        dscene->curve_keys_quantized.tag_modified(hair->curve_key_offset,
+                                                  hair->get_curve_keys().size());
+        dscene->curve_key_bounds.tag_modified(hair->prim_offset * 2, hair->num_curves() * 2);
+        dscene->curves.tag_modified(hair->prim_offset, hair->num_curves());
+        dscene->curve_segments.tag_modified(hair->curve_segment_offset, hair->num_segments());
       }
     }
 
     dscene->curve_keys.copy_to_device_if_modified();
+    dscene->curve_keys_quantized.copy_to_device_if_modified();
+    dscene->curve_key_bounds.copy_to_device_if_modified();
     dscene->curves.copy_to_device_if_modified();
     dscene->curve_segments.copy_to_device_if_modified();
   }
@@ -1191,6 +1274,7 @@ void GeometryManager::device_update_mesh(Device *,
 void GeometryManager::device_update_bvh(Device *device,
                                         DeviceScene *dscene,
                                         Scene *scene,
+                                        const bool instance_bvh_modified,
                                         Progress &progress)
 {
   /* bvh build */
@@ -1207,16 +1291,65 @@ void GeometryManager::device_update_bvh(Device *device,
   bparams.num_motion_curve_steps = scene->params.num_bvh_time_steps;
   bparams.bvh_type = scene->params.bvh_type;
   bparams.curve_subdivisions = scene->params.curve_subdivisions();
+  bparams.cache = (bvh_cache.enabled()) ? &bvh_cache : NULL;
 
   VLOG(1) << "Using " << bvh_layout_name(bparams.bvh_layout) << " layout.";
 
-  const bool can_refit = scene->bvh != nullptr &&
-                         (bparams.bvh_layout == BVHLayout::BVH_LAYOUT_OPTIX);
+  /* BVH4 is packed by the BVH2 code-path, into the same arrays. */
+  const bool has_bvh2_layout = (bparams.bvh_layout == BVH_LAYOUT_BVH2 ||
+                                bparams.bvh_layout == BVH_LAYOUT_BVH4);
+
+  /* When the same objects are traced with the same number of primitives the scene BVH is refit
+   * instead of rebuilt, which is common for rigid body and deformation only changes between
+   * frames of an animation rendered with persistent data. The packed BVH2 contains copies of
+   * instance BVHs, so it is rebuilt when those changed. */
+  vector<SceneBVHObject> bvh_objects;
+  bvh_objects.reserve(scene->objects.size());
+  foreach (Object *object, scene->objects) {
+    const Geometry *geom = object->get_geometry();
+    SceneBVHObject bvh_object;
+    bvh_object.geometry = geom;
+    bvh_object.num_primitives = (geom->is_hair()) ?
+                                    static_cast<const Hair *>(geom)->num_segments() :
+                                    static_cast<const Mesh *>(geom)->num_triangles();
+    bvh_object.is_instanced = geom->is_instanced();
+    bvh_object.is_traceable = object->is_traceable();
+    bvh_objects.push_back(bvh_object);
+  }
+
+  bool can_refit = false;
+  if (scene->bvh != nullptr) {
+    if (bparams.bvh_layout == BVH_LAYOUT_OPTIX) {
+      can_refit = true;
+    }
+    else if (has_bvh2_layout || bparams.bvh_layout == BVH_LAYOUT_EMBREE) {
+      can_refit = bvh_objects == scene_bvh_objects &&
+                  !(has_bvh2_layout && instance_bvh_modified) &&
+                  scene->params.num_bvh_time_steps == 0;
+    }
+  }
 
   BVH *bvh = scene->bvh;
   if (!scene->bvh) {
     bvh = scene->bvh = BVH::create(bparams, scene->geometry, scene->objects, device);
   }
+  else {
+    bvh->geometry = scene->geometry;
+    bvh->objects = scene->objects;
+  }
+
+  if (can_refit && has_bvh2_layout) {
+    /* Take back the packed arrays handed to the device after the previous build. */
+    PackedBVH &bvh_pack = static_cast<BVH2 *>(bvh)->pack;
+    dscene->bvh_nodes.give_data(bvh_pack.nodes);
+    dscene->bvh_leaf_nodes.give_data(bvh_pack.leaf_nodes);
+    dscene->prim_type.give_data(bvh_pack.prim_type);
+    dscene->prim_visibility.give_data(bvh_pack.prim_visibility);
+    dscene->prim_index.give_data(bvh_pack.prim_index);
+    dscene->prim_object.give_data(bvh_pack.prim_object);
+  }
+
+  VLOG(1) << (can_refit ? "Refitting" : "Building") << " scene BVH.";
 
   device->build_bvh(bvh, progress, can_refit);
 
@@ -1224,7 +1357,21 @@ void GeometryManager::device_update_bvh(Device *device,
     return;
   }
 
-  const bool has_bvh2_layout = (bparams.bvh_layout == BVH_LAYOUT_BVH2);
+  if (can_refit && has_bvh2_layout) {
+    /* Rebuild when refitting degraded the tree too much. */
+    const BVH2 *bvh2 = static_cast<BVH2 *>(bvh);
+    if (bvh2->get_node_cost() > bvh2->get_build_node_cost() * BVH_REFIT_MAX_COST_RATIO) {
+      VLOG(1) << "Rebuilding scene BVH, refit cost " << bvh2->get_node_cost()
+              << " exceeds build cost " << bvh2->get_build_node_cost() << ".";
+      device->build_bvh(bvh, progress, false);
+
+      if (progress.get_cancel()) {
+        return;
+      }
+    }
+  }
+
+  scene_bvh_objects = std::move(bvh_objects);
 
   PackedBVH pack;
   if (has_bvh2_layout) {
@@ -1517,6 +1664,8 @@ void GeometryManager::device_update_preprocess(Device *device, Scene *scene, Pro
     if (device_update_flags & DEVICE_CURVE_DATA_NEEDS_REALLOC) {
       dscene->curves.tag_realloc();
       dscene->curve_keys.tag_realloc();
+      dscene->curve_keys_quantized.tag_realloc();
+      dscene->curve_key_bounds.tag_realloc();
       dscene->curve_segments.tag_realloc();
     }
   }
@@ -1529,47 +1678,24 @@ void GeometryManager::device_update_preprocess(Device *device, Scene *scene, Pro
     dscene->attributes_map.tag_realloc();
     dscene->attributes_float.tag_realloc();
   }
-  else if (device_update_flags & ATTR_FLOAT_MODIFIED) {
-    dscene->attributes_float.tag_modified();
-  }
 
   if (device_update_flags & ATTR_FLOAT2_NEEDS_REALLOC) {
     dscene->attributes_map.tag_realloc();
     dscene->attributes_float2.tag_realloc();
   }
-  else if (device_update_flags & ATTR_FLOAT2_MODIFIED) {
-    dscene->attributes_float2.tag_modified();
-  }
 
   if (device_update_flags & ATTR_FLOAT3_NEEDS_REALLOC) {
     dscene->attributes_map.tag_realloc();
     dscene->attributes_float3.tag_realloc();
   }
-  else if (device_update_flags & ATTR_FLOAT3_MODIFIED) {
-    dscene->attributes_float3.tag_modified();
-  }
 
   if (device_update_flags & ATTR_UCHAR4_NEEDS_REALLOC) {
     dscene->attributes_map.tag_realloc();
     dscene->attributes_uchar4.tag_realloc();
   }
-  else if (device_update_flags & ATTR_UCHAR4_MODIFIED) {
-    dscene->attributes_uchar4.tag_modified();
-  }
 
-  if (device_update_flags & DEVICE_MESH_DATA_MODIFIED) {
-    /* if anything else than vertices or shaders are modified, we would need to reallocate, so
-     * these are the only arrays that can be updated */
-    dscene->tri_verts.tag_modified();
-    dscene->tri_vnormal.tag_modified();
-    dscene->tri_shader.tag_modified();
-  }
-
-  if (device_update_flags & DEVICE_CURVE_DATA_MODIFIED) {
-    dscene->curve_keys.tag_modified();
-    dscene->curves.tag_modified();
-    dscene->curve_segments.tag_modified();
-  }
+  /* Modified mesh, curve and attribute data that does not need reallocation is tagged per
+   * geometry when packing, so that only the modified ranges are copied to the device. */
 
   need_flags_update = false;
 }
@@ -1648,6 +1774,100 @@ void GeometryManager::device_update_volume_images(Device *device, Scene *scene,
   pool.wait_work();
 }
 
+void GeometryManager::device_update_volume_occupancy(DeviceScene *dscene,
+                                                     Scene *scene,
+                                                     Progress &progress)
+{
+  bool volume_modified = (update_flags & (GEOMETRY_ADDED | GEOMETRY_REMOVED)) != 0;
+  size_t num_grids = 0;
+  size_t num_cells = 0;
+
+  foreach (Geometry *geom, scene->geometry) {
+    if (geom->geometry_type != Geometry::VOLUME) {
+      continue;
+    }
+
+    Volume *volume = static_cast<Volume *>(geom);
+    volume_modified |= volume->is_modified();
+
+    if (volume->occupancy_cells.size()) {
+      num_grids++;
+      num_cells += volume->occupancy_cells.size();
+    }
+  }
+
+  if (!volume_modified && !dscene->volume_occupancy.need_realloc()) {
+    return;
+  }
+
+  progress.set_status("Updating Mesh", "Copying Volume Occupancy to device");
+
+  KernelVolumeOccupancy *kgrids = dscene->volume_occupancy.alloc(max(num_grids, (size_t)1));
+  uint *kcells = dscene->volume_occupancy_cells.alloc(max(num_cells, (size_t)1));
+
+  /* Keep the arrays valid for the kernel when there are no grids. */
+  memset(kgrids, 0, sizeof(KernelVolumeOccupancy));
+  kcells[0] = 0;
+
+  int grid_index = 0;
+  size_t cells_offset = 0;
+
+  foreach (Geometry *geom, scene->geometry) {
+    if (geom->geometry_type != Geometry::VOLUME) {
+      continue;
+    }
+
+    Volume *volume = static_cast<Volume *>(geom);
+
+    if (volume->occupancy_cells.size() == 0) {
+      volume->occupancy_index = -1;
+      continue;
+    }
+
+    KernelVolumeOccupancy &kgrid = kgrids[grid_index];
+    kgrid.tfm = volume->occupancy_tfm;
+    kgrid.resolution[0] = volume->occupancy_resolution.x;
+    kgrid.resolution[1] = volume->occupancy_resolution.y;
+    kgrid.resolution[2] = volume->occupancy_resolution.z;
+    kgrid.offset = cells_offset;
+
+    std::copy_n(volume->occupancy_cells.data(),
+                volume->occupancy_cells.size(),
+                kcells + cells_offset);
+
+    volume->occupancy_index = grid_index++;
+    cells_offset += volume->occupancy_cells.size();
+  }
+
+  dscene->volume_occupancy.copy_to_device();
+  dscene->volume_occupancy_cells.copy_to_device();
+}
+
+/* Only the native BVH decodes quantized curve keys, Embree and OptiX keep their own copy of the
+ * keys at full precision, so there is no memory to save and their curves would not match.
+ * Quantized keys take 8 bytes per key plus 32 bytes of bounds per curve, against 16 bytes per
+ * key at full precision, so they only save memory with more than 4 keys per curve on average. */
+static bool use_quantized_curve_keys(const Scene *scene, const BVHLayout bvh_layout)
+{
+  if (!scene->params.use_quantized_curve_keys ||
+      !(bvh_layout == BVH_LAYOUT_BVH2 || bvh_layout == BVH_LAYOUT_BVH4)) {
+    return false;
+  }
+
+  size_t curve_size = 0;
+  size_t curve_key_size = 0;
+
+  foreach (const Geometry *geom, scene->geometry) {
+    if (geom->is_hair()) {
+      const Hair *hair = static_cast<const Hair *>(geom);
+      curve_size += hair->num_curves();
+      curve_key_size += hair->get_curve_keys().size();
+    }
+  }
+
+  return curve_key_size > curve_size * 4;
+}
+
 void GeometryManager::device_update(Device *device,
                                     DeviceScene *dscene,
                                     Scene *scene,
@@ -1765,11 +1985,21 @@ void GeometryManager::device_update(Device *device,
   }
 
   /* Device update. */
-  device_free(device, dscene, false);
-
   const BVHLayout bvh_layout = BVHParams::best_bvh_layout(scene->params.bvh_layout,
                                                           device->get_bvh_layout_mask());
   mesh_calc_offset(scene, bvh_layout);
+
+  /* Switching between full precision and quantized keys needs the other arrays allocated. */
+  const bool curve_keys_quantized = use_quantized_curve_keys(scene, bvh_layout);
+  if (curve_keys_quantized != (bool)dscene->data.bvh.curve_keys_quantized) {
+    dscene->curve_keys.tag_realloc();
+    dscene->curve_keys_quantized.tag_realloc();
+    dscene->curve_key_bounds.tag_realloc();
+  }
+  dscene->data.bvh.curve_keys_quantized = curve_keys_quantized;
+
+  device_free(device, dscene, false);
+
   if (true_displacement_used) {
     scoped_callback_timer timer([scene](double time) {
       if (scene->update_stats) {
@@ -1789,6 +2019,7 @@ void GeometryManager::device_update(Device *device,
         scene->update_stats->geometry.times.add_entry({"device_update (attributes)", time});
       }
     });
+    device_update_volume_occupancy(dscene, scene, progress);
     device_update_attributes(device, dscene, scene, progress);
     if (progress.get_cancel()) {
       return;
@@ -1858,6 +2089,7 @@ void GeometryManager::device_update(Device *device,
    * change. */
   bool need_update_scene_bvh = (scene->bvh == nullptr ||
                                 (update_flags & (TRANSFORM_MODIFIED | VISIBILITY_MODIFIED)) != 0);
+  bool instance_bvh_modified = false;
   {
     scoped_callback_timer timer([scene](double time) {
       if (scene->update_stats) {
@@ -1866,12 +2098,24 @@ void GeometryManager::device_update(Device *device,
     });
     TaskPool pool;
 
+    bvh_cache.set_directory(scene->params.bvh_cache_directory,
+                            ((size_t)scene->params.bvh_cache_size) * 1024 * 1024 * 1024);
+    BVHCache *cache = (bvh_cache.enabled()) ? &bvh_cache : NULL;
+
     size_t i = 0;
     foreach (Geometry *geom, scene->geometry) {
       if (geom->is_modified() || geom->need_update_bvh_for_offset) {
         need_update_scene_bvh = true;
-        pool.push(function_bind(
-            &Geometry::compute_bvh, geom, device, dscene, &scene->params, &progress, i, num_bvh));
+        instance_bvh_modified |= geom->need_build_bvh(bvh_layout);
+        pool.push(function_bind(&Geometry::compute_bvh,
+                                geom,
+                                device,
+                                dscene,
+                                &scene->params,
+                                cache,
+                                &progress,
+                                i,
+                                num_bvh));
         if (geom->need_build_bvh(bvh_layout)) {
           i++;
         }
@@ -1914,7 +2158,7 @@ void GeometryManager::device_update(Device *device,
         scene->update_stats->geometry.times.add_entry({"device_update (build scene BVH)", time});
       }
     });
-    device_update_bvh(device, dscene, scene, progress);
+    device_update_bvh(device, dscene, scene, instance_bvh_modified, progress);
     if (progress.get_cancel()) {
       return;
     }
@@ -1978,6 +2222,8 @@ void GeometryManager::device_update(Device *device,
   dscene->tri_patch_uv.clear_modified();
   dscene->curves.clear_modified();
   dscene->curve_keys.clear_modified();
+  dscene->curve_keys_quantized.clear_modified();
+  dscene->curve_key_bounds.clear_modified();
   dscene->curve_segments.clear_modified();
   dscene->patches.clear_modified();
   dscene->attributes_map.clear_modified();
@@ -2005,6 +2251,8 @@ void GeometryManager::device_free(Device *device, DeviceScene *dscene, bool forc
   dscene->tri_patch_uv.free_if_need_realloc(force_free);
   dscene->curves.free_if_need_realloc(force_free);
   dscene->curve_keys.free_if_need_realloc(force_free);
+  dscene->curve_keys_quantized.free_if_need_realloc(force_free);
+  dscene->curve_key_bounds.free_if_need_realloc(force_free);
   dscene->curve_segments.free_if_need_realloc(force_free);
   dscene->patches.free_if_need_realloc(force_free);
   dscene->attributes_map.free_if_need_realloc(force_free);
@@ -2012,6 +2260,8 @@ void GeometryManager::device_free(Device *device, DeviceScene *dscene, bool forc
   dscene->attributes_float2.free_if_need_realloc(force_free);
   dscene->attributes_float3.free_if_need_realloc(force_free);
   dscene->attributes_uchar4.free_if_need_realloc(force_free);
+  dscene->volume_occupancy.free_if_need_realloc(force_free);
+  dscene->volume_occupancy_cells.free_if_need_realloc(force_free);
 
   /* Signal for shaders like displacement not to do ray tracing. */
   dscene->data.bvh.bvh_layout = BVH_LAYOUT_NONE;
@@ -2050,6 +2300,79 @@ void GeometryManager::collect_statistics(const Scene *scene, RenderStats *stats)
     stats->mesh.geometry.add_entry(
         NamedSizeEntry(string(geometry->name.c_str()), geometry->get_total_size_in_bytes()));
   }
+
+  const BVH *bvh = scene->bvh;
+  if (bvh && (bvh->params.bvh_layout == BVH_LAYOUT_BVH2 ||
+              bvh->params.bvh_layout == BVH_LAYOUT_BVH4)) {
+    const PackedBVH &pack = static_cast<const BVH2 *>(bvh)->pack;
+    stats->mesh.bvh_layout = bvh_layout_name(bvh->params.bvh_layout);
+    stats->mesh.bvh_inner_nodes_size = pack.nodes.size() * sizeof(int4);
+    stats->mesh.bvh_leaf_nodes_size = pack.leaf_nodes.size() * sizeof(int4);
+    stats->mesh.bvh_binary_inner_nodes_size =
+        (bvh->params.bvh_layout == BVH_LAYOUT_BVH4) ?
+            static_cast<const BVH4 *>(bvh)->binary_inner_nodes_size() :
+            stats->mesh.bvh_inner_nodes_size;
+  }
+
+  if (bvh_cache.enabled()) {
+    bvh_cache.collect_statistics(&stats->mesh);
+  }
+}
+
+static void collect_attribute_memory(NamedMemoryEntry *entry,
+                                     const AttributeSet &attributes,
+                                     const char *prefix)
+{
+  foreach (const Attribute &attr, attributes.attributes) {
+    entry->add_part(prefix + attr.name.string(), attr.buffer.size());
+  }
+}
+
+void GeometryManager::collect_memory_statistics(Scene *scene, MemoryStats *stats)
+{
+  foreach (Geometry *geom, scene->geometry) {
+    const string info = (geom->has_motion_blur()) ?
+                            string_printf("%u motion steps", geom->get_motion_steps()) :
+                            "";
+    NamedMemoryEntry entry(geom->name.string(), info);
+
+    /* Arrays like vertices, triangles and curve keys, other settings are negligible. */
+    foreach (const SocketType &socket, geom->type->inputs) {
+      if (socket.is_array()) {
+        entry.add_part(socket.name.string(), geom->get_size_in_bytes(socket));
+      }
+    }
+
+    /* Motion steps are stored as attributes too. */
+    collect_attribute_memory(&entry, geom->attributes, "attribute ");
+    if (geom->is_mesh()) {
+      const Mesh *mesh = static_cast<const Mesh *>(geom);
+      collect_attribute_memory(&entry, mesh->subd_attributes, "subd attribute ");
+    }
+    else if (geom->is_hair()) {
+      /* Keys are packed for the device, optionally quantized with bounds per curve. */
+      const Hair *hair = static_cast<const Hair *>(geom);
+      const size_t packed_keys_size = (scene->dscene.data.bvh.curve_keys_quantized) ?
+                                          hair->num_keys() * sizeof(uint2) +
+                                              hair->num_curves() * 2 * sizeof(float4) :
+                                          hair->num_keys() * sizeof(float4);
+      entry.add_part("packed curve keys", packed_keys_size);
+    }
+
+    stats->geometry.push_back(entry);
+  }
+
+  /* Packed BVH2 arrays, for Embree and OptiX only the primitive arrays are used. */
+  DeviceScene *dscene = &scene->dscene;
+  stats->bvh.add_entry(NamedSizeEntry("nodes", dscene->bvh_nodes.memory_size()));
+  stats->bvh.add_entry(NamedSizeEntry("leaf nodes", dscene->bvh_leaf_nodes.memory_size()));
+  stats->bvh.add_entry(NamedSizeEntry("object nodes", dscene->object_node.memory_size()));
+  stats->bvh.add_entry(NamedSizeEntry("primitive types", dscene->prim_type.memory_size()));
+  stats->bvh.add_entry(
+      NamedSizeEntry("primitive visibility", dscene->prim_visibility.memory_size()));
+  stats->bvh.add_entry(NamedSizeEntry("primitive indices", dscene->prim_index.memory_size()));
+  stats->bvh.add_entry(NamedSizeEntry("primitive objects", dscene->prim_object.memory_size()));
+  stats->bvh.add_entry(NamedSizeEntry("primitive times", dscene->prim_time.memory_size()));
 }
 
 CCL_NAMESPACE_END
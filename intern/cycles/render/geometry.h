@@ -19,6 +19,7 @@
 
 #include "graph/node.h"
 
+#include "bvh/bvh_cache.h"
 #include "bvh/bvh_params.h"
 
 #include "render/attribute.h"
@@ -36,6 +37,7 @@ class Device;
 class DeviceScene;
 class Mesh;
 class Progress;
+class MemoryStats;
 class RenderStats;
 class Scene;
 class SceneParams;
@@ -121,6 +123,7 @@ class Geometry : public Node {
   void compute_bvh(Device *device,
                    DeviceScene *dscene,
                    SceneParams *params,
+                   BVHCache *bvh_cache,
                    Progress *progress,
                    int n,
                    int total);
@@ -217,6 +220,7 @@ class GeometryManager {
 
   /* Statistics */
   void collect_statistics(const Scene *scene, RenderStats *stats);
+  void collect_memory_statistics(Scene *scene, MemoryStats *stats);
 
  protected:
   bool displace(Device *device, DeviceScene *dscene, Scene *scene, Mesh *mesh, Progress &progress);
@@ -245,12 +249,37 @@ class GeometryManager {
                                 Scene *scene,
                                 Progress &progress);
 
-  void device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress &progress);
+  void device_update_bvh(Device *device,
+                         DeviceScene *dscene,
+                         Scene *scene,
+                         const bool instance_bvh_modified,
+                         Progress &progress);
 
   void device_update_displacement_images(Device *device, Scene *scene, Progress &progress);
 
   void device_update_volume_images(Device *device, Scene *scene, Progress &progress);
 
+  void device_update_volume_occupancy(DeviceScene *dscene, Scene *scene, Progress &progress);
+
+  /* Object as seen by the scene BVH. When all objects are the same as when the scene BVH was
+   * built, it can be refit rather than rebuilt. */
+  struct SceneBVHObject {
+    const Geometry *geometry;
+    size_t num_primitives;
+    bool is_instanced;
+    bool is_traceable;
+
+    bool operator==(const SceneBVHObject &other) const
+    {
+      return geometry == other.geometry && num_primitives == other.num_primitives &&
+             is_instanced == other.is_instanced && is_traceable == other.is_traceable;
+    }
+  };
+
+  vector<SceneBVHObject> scene_bvh_objects;
+
+  BVHCache bvh_cache;
+
  private:
   static void update_attribute_element_offset(Geometry *geom,
                                               device_vector<float> &attr_float,
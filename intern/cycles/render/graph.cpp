@@ -383,6 +383,9 @@ void ShaderGraph::finalize(Scene *scene, bool do_bump, bool do_simplify, bool bu
     if (do_bump)
       bump_from_displacement(bump_in_object_space);
 
+    if (scene->image_manager->use_texture_cache(scene) && !scene->shader_manager->use_osl())
+      add_image_differentials();
+
     ShaderInput *surface_in = output()->input("Surface");
     ShaderInput *volume_in = output()->input("Volume");
 
@@ -954,6 +957,58 @@ void ShaderGraph::refine_bump_nodes()
   }
 }
 
+void ShaderGraph::add_image_differentials()
+{
+  /* The texture cache selects mipmap levels based on texture coordinate differentials. We
+   * get those the same way as bump mapping does, by making two copies of the subgraph that
+   * computes the texture coordinates, evaluated at positions shifted by the ray
+   * differentials. */
+  vector<ImageTextureNode *> image_nodes;
+
+  foreach (ShaderNode *node, nodes) {
+    if (node->type != ImageTextureNode::get_node_type()) {
+      continue;
+    }
+    /* Nodes already used for evaluating bump at shifted positions use the full resolution. */
+    if (node->bump == SHADER_BUMP_DX || node->bump == SHADER_BUMP_DY) {
+      continue;
+    }
+
+    ImageTextureNode *image_node = (ImageTextureNode *)node;
+    if (image_node->get_projection() == NODE_IMAGE_PROJ_BOX || !node->input("Vector")->link) {
+      continue;
+    }
+
+    image_nodes.push_back(image_node);
+  }
+
+  foreach (ImageTextureNode *node, image_nodes) {
+    ShaderInput *vector_in = node->input("Vector");
+    ShaderNodeSet nodes_vector;
+    ShaderNodeMap nodes_dx;
+    ShaderNodeMap nodes_dy;
+
+    find_dependencies(nodes_vector, vector_in);
+
+    copy_nodes(nodes_vector, nodes_dx);
+    copy_nodes(nodes_vector, nodes_dy);
+
+    foreach (NodePair &pair, nodes_dx)
+      pair.second->bump = SHADER_BUMP_DX;
+    foreach (NodePair &pair, nodes_dy)
+      pair.second->bump = SHADER_BUMP_DY;
+
+    ShaderOutput *out = vector_in->link;
+    connect(nodes_dx[out->parent]->output(out->name()), node->input("Vector_dx"));
+    connect(nodes_dy[out->parent]->output(out->name()), node->input("Vector_dy"));
+
+    foreach (NodePair &pair, nodes_dx)
+      add(pair.second);
+    foreach (NodePair &pair, nodes_dy)
+      add(pair.second);
+  }
+}
+
 void ShaderGraph::bump_from_displacement(bool use_object_space)
 {
   /* generate bump mapping automatically from displacement. bump mapping is
@@ -263,6 +263,12 @@ class ShaderNode : public Node {
    * is to be handled in the subclass.
    */
   virtual bool equals(const ShaderNode &other);
+
+  /* Append state which is not stored in sockets but affects the compiled shader, like image
+   * slots, to the hash used for caching compiled shaders. */
+  virtual void hash_compile_state(MD5Hash & /*md5*/)
+  {
+  }
 };
 
 /* Node definition utility macros */
@@ -368,6 +374,7 @@ class ShaderGraph : public NodeOwner {
   void break_cycles(ShaderNode *node, vector<bool> &visited, vector<bool> &on_stack);
   void bump_from_displacement(bool use_object_space);
   void refine_bump_nodes();
+  void add_image_differentials();
   void expand();
   void default_inputs(bool do_osl);
   void transform_multi_closure(ShaderNode *node, ShaderOutput *weight_out, bool volume);
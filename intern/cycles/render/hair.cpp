@@ -464,15 +464,65 @@ void Hair::apply_transform(const Transform &tfm, const bool apply_to_motion)
   }
 }
 
+/* Quantize the keys of a curve to 16 bit positions relative to its bounds, using the full range
+ * along each axis, and a 16 bit radius relative to the range of radii of the curve. Writes two
+ * float4 of bounds: the minimum corner and radius, and the quantization steps. Must match
+ * curve_key() in the kernel. */
+static void pack_curve_keys_quantized(const float3 *keys,
+                                      const float *radius,
+                                      const int num_keys,
+                                      uint2 *r_keys,
+                                      float4 *r_bounds)
+{
+  BoundBox bounds = BoundBox::empty;
+  float min_radius = FLT_MAX;
+  float max_radius = 0.0f;
+
+  for (int k = 0; k < num_keys; k++) {
+    bounds.grow(keys[k]);
+    min_radius = min(min_radius, fabsf(radius[k]));
+    max_radius = max(max_radius, fabsf(radius[k]));
+  }
+
+  if (!bounds.valid()) {
+    r_bounds[0] = zero_float4();
+    r_bounds[1] = zero_float4();
+    return;
+  }
+
+  const float3 step = bounds.size() / 65535.0f;
+  const float3 inv_step = make_float3((step.x > 0.0f) ? 1.0f / step.x : 0.0f,
+                                      (step.y > 0.0f) ? 1.0f / step.y : 0.0f,
+                                      (step.z > 0.0f) ? 1.0f / step.z : 0.0f);
+  const float radius_step = (max_radius - min_radius) / 65535.0f;
+  const float inv_radius_step = (radius_step > 0.0f) ? 1.0f / radius_step : 0.0f;
+
+  r_bounds[0] = make_float4(bounds.min.x, bounds.min.y, bounds.min.z, min_radius);
+  r_bounds[1] = make_float4(step.x, step.y, step.z, radius_step);
+
+  for (int k = 0; k < num_keys; k++) {
+    const float3 q = (keys[k] - bounds.min) * inv_step;
+    const float q_radius = (fabsf(radius[k]) - min_radius) * inv_radius_step;
+    const uint x = (uint)clamp((int)(q.x + 0.5f), 0, 65535);
+    const uint y = (uint)clamp((int)(q.y + 0.5f), 0, 65535);
+    const uint z = (uint)clamp((int)(q.z + 0.5f), 0, 65535);
+    const uint r = (uint)clamp((int)(q_radius + 0.5f), 0, 65535);
+
+    r_keys[k] = make_uint2(x | (y << 16), z | (r << 16));
+  }
+}
+
 void Hair::pack_curves(Scene *scene,
                        float4 *curve_key_co,
+                       uint2 *curve_key_quantized,
+                       float4 *curve_key_bounds,
                        KernelCurve *curves,
                        KernelCurveSegment *curve_segments)
 {
   size_t curve_keys_size = curve_keys.size();
 
   /* pack curve keys */
-  if (curve_keys_size) {
+  if (curve_keys_size && curve_key_co) {
     float3 *keys_ptr = curve_keys.data();
     float *radius_ptr = curve_radius.data();
 
@@ -499,6 +549,14 @@ void Hair::pack_curves(Scene *scene,
     curves[i].num_keys = curve.num_keys;
     curves[i].type = type;
 
+    if (curve_key_quantized) {
+      pack_curve_keys_quantized(&curve_keys[curve.first_key],
+                                &curve_radius[curve.first_key],
+                                curve.num_keys,
+                                &curve_key_quantized[curve.first_key],
+                                &curve_key_bounds[i * 2]);
+    }
+
     for (int k = 0; k < curve.num_segments(); ++k, ++index) {
       curve_segments[index].prim = prim_offset + i;
       curve_segments[index].type = PRIMITIVE_PACK_SEGMENT(type, k);
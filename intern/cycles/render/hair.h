@@ -147,8 +147,12 @@ class Hair : public Geometry {
   void get_uv_tiles(ustring map, unordered_set<int> &tiles) override;
 
   /* BVH */
+  /* Keys are packed to either curve_key_co, or quantized to curve_key_quantized along with the
+   * bounds of each curve. */
   void pack_curves(Scene *scene,
                    float4 *curve_key_co,
+                   uint2 *curve_key_quantized,
+                   float4 *curve_key_bounds,
                    KernelCurve *curve,
                    KernelCurveSegment *curve_segments);
 
@@ -21,6 +21,7 @@
 #include "render/image_vdb.h"
 #include "render/scene.h"
 #include "render/stats.h"
+#include "render/texture_cache.h"
 
 #include "util/util_foreach.h"
 #include "util/util_image.h"
@@ -77,6 +78,10 @@ const char *name_from_type(ImageDataType type)
       return "nanovdb_float";
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT3:
       return "nanovdb_float3";
+    case IMAGE_DATA_TYPE_BLOCK_HALF4:
+      return "block_half4";
+    case IMAGE_DATA_TYPE_BLOCK_HALF:
+      return "block_half";
     case IMAGE_DATA_NUM_TYPES:
       assert(!"System enumerator type, should never be used");
       return "";
@@ -85,6 +90,54 @@ const char *name_from_type(ImageDataType type)
   return "";
 }
 
+/* Largest value that can be represented as half float. */
+const float HALF_FLOAT_MAX = 65504.0f;
+
+/* Compress one channel of a block of float pixels, pixels outside the image are clamped to the
+ * edge of the image. */
+void texture_block_encode(const float *pixels,
+                          const int channels,
+                          const int channel,
+                          const int width,
+                          const int height,
+                          const int block_x,
+                          const int block_y,
+                          TextureBlockHalf &block)
+{
+  float values[TEXTURE_BLOCK_SIZE * TEXTURE_BLOCK_SIZE];
+  float lo = FLT_MAX;
+  float hi = -FLT_MAX;
+
+  for (int j = 0; j < TEXTURE_BLOCK_SIZE; j++) {
+    for (int i = 0; i < TEXTURE_BLOCK_SIZE; i++) {
+      const int x = min(block_x * TEXTURE_BLOCK_SIZE + i, width - 1);
+      const int y = min(block_y * TEXTURE_BLOCK_SIZE + j, height - 1);
+      const float value = pixels[((size_t)y * width + x) * channels + channel];
+
+      values[j * TEXTURE_BLOCK_SIZE + i] = value;
+      lo = min(lo, value);
+      hi = max(hi, value);
+    }
+  }
+
+  block.endpoints[0] = float_to_half(lo);
+  block.endpoints[1] = float_to_half(hi);
+
+  /* Compute indices for the endpoints as they are decoded, to not add the error of their
+   * quantization to every texel. */
+  const float decoded_lo = half_to_float(block.endpoints[0]);
+  const float decoded_hi = half_to_float(block.endpoints[1]);
+  const float scale = (decoded_hi > decoded_lo) ? 15.0f / (decoded_hi - decoded_lo) : 0.0f;
+
+  block.indices[0] = 0;
+  block.indices[1] = 0;
+
+  for (int i = 0; i < TEXTURE_BLOCK_SIZE * TEXTURE_BLOCK_SIZE; i++) {
+    const uint index = (uint)clamp((int)((values[i] - decoded_lo) * scale + 0.5f), 0, 15);
+    block.indices[i >> 3] |= index << ((i & 7) * 4);
+  }
+}
+
 }  // namespace
 
 /* Image Handle */
@@ -274,6 +327,25 @@ ImageLoader::ImageLoader()
 {
 }
 
+bool ImageLoader::load_region_metadata(const ImageMetaData & /*metadata*/,
+                                       int & /*num_miplevels*/,
+                                       bool & /*is_tiled*/)
+{
+  return false;
+}
+
+bool ImageLoader::load_pixels_region(const ImageMetaData & /*metadata*/,
+                                     const int /*miplevel*/,
+                                     const int /*x*/,
+                                     const int /*y*/,
+                                     const int /*width*/,
+                                     const int /*height*/,
+                                     void * /*pixels*/,
+                                     const bool /*associate_alpha*/)
+{
+  return false;
+}
+
 ustring ImageLoader::osl_filepath() const
 {
   return ustring();
@@ -301,6 +373,8 @@ ImageManager::ImageManager(const DeviceInfo &info)
   need_update_ = true;
   osl_texture_system = NULL;
   animation_frame = 0;
+  has_texture_cache = (info.type == DEVICE_CPU);
+  has_block_compression = (info.type == DEVICE_CPU);
 
   /* Set image limits */
   features.has_half_float = info.has_half_images;
@@ -444,6 +518,7 @@ int ImageManager::add_image_slot(ImageLoader *loader,
   img->builtin = builtin;
   img->users = 1;
   img->mem = NULL;
+  img->cache_image = NULL;
 
   images[slot] = img;
 
@@ -486,54 +561,22 @@ static bool image_associate_alpha(ImageManager::Image *img)
            img->params.alpha_type == IMAGE_ALPHA_CHANNEL_PACKED);
 }
 
-template<TypeDesc::BASETYPE FileFormat, typename StorageType>
-bool ImageManager::file_load_image(Image *img, int texture_limit)
+static bool image_is_rgba(const ImageDataType type)
 {
-  /* Ignore empty images. */
-  if (!(img->metadata.channels > 0)) {
-    return false;
-  }
-
-  /* Get metadata. */
-  int width = img->metadata.width;
-  int height = img->metadata.height;
-  int depth = img->metadata.depth;
-  int components = img->metadata.channels;
-
-  /* Read pixels. */
-  vector<StorageType> pixels_storage;
-  StorageType *pixels;
-  const size_t max_size = max(max(width, height), depth);
-  if (max_size == 0) {
-    /* Don't bother with empty images. */
-    return false;
-  }
-
-  /* Allocate memory as needed, may be smaller to resize down. */
-  if (texture_limit > 0 && max_size > texture_limit) {
-    pixels_storage.resize(((size_t)width) * height * depth * 4);
-    pixels = &pixels_storage[0];
-  }
-  else {
-    thread_scoped_lock device_lock(device_mutex);
-    pixels = (StorageType *)img->mem->alloc(width, height, depth);
-  }
-
-  if (pixels == NULL) {
-    /* Could be that we've run out of memory. */
-    return false;
-  }
-
-  const size_t num_pixels = ((size_t)width) * height * depth;
-  img->loader->load_pixels(
-      img->metadata, pixels, num_pixels * components, image_associate_alpha(img));
+  return (type == IMAGE_DATA_TYPE_FLOAT4 || type == IMAGE_DATA_TYPE_HALF4 ||
+          type == IMAGE_DATA_TYPE_BYTE4 || type == IMAGE_DATA_TYPE_USHORT4);
+}
 
+/* Convert pixels as loaded from the file to the layout used for rendering. */
+template<TypeDesc::BASETYPE FileFormat, typename StorageType>
+static void image_process_pixels(const ImageManager::Image *img,
+                                 StorageType *pixels,
+                                 const size_t num_pixels)
+{
   /* The kernel can handle 1 and 4 channel images. Anything that is not a single
    * channel image is converted to RGBA format. */
-  bool is_rgba = (img->metadata.type == IMAGE_DATA_TYPE_FLOAT4 ||
-                  img->metadata.type == IMAGE_DATA_TYPE_HALF4 ||
-                  img->metadata.type == IMAGE_DATA_TYPE_BYTE4 ||
-                  img->metadata.type == IMAGE_DATA_TYPE_USHORT4);
+  const bool is_rgba = image_is_rgba(img->metadata.type);
+  const int components = img->metadata.channels;
 
   if (is_rgba) {
     const StorageType one = util_image_cast_from_float<StorageType>(1.0f);
@@ -607,6 +650,52 @@ bool ImageManager::file_load_image(Image *img, int texture_limit)
       }
     }
   }
+}
+
+template<TypeDesc::BASETYPE FileFormat, typename StorageType>
+bool ImageManager::file_load_image(Image *img, int texture_limit)
+{
+  /* Ignore empty images. */
+  if (!(img->metadata.channels > 0)) {
+    return false;
+  }
+
+  /* Get metadata. */
+  int width = img->metadata.width;
+  int height = img->metadata.height;
+  int depth = img->metadata.depth;
+  int components = img->metadata.channels;
+
+  /* Read pixels. */
+  vector<StorageType> pixels_storage;
+  StorageType *pixels;
+  const size_t max_size = max(max(width, height), depth);
+  if (max_size == 0) {
+    /* Don't bother with empty images. */
+    return false;
+  }
+
+  /* Allocate memory as needed, may be smaller to resize down. */
+  if (texture_limit > 0 && max_size > texture_limit) {
+    pixels_storage.resize(((size_t)width) * height * depth * 4);
+    pixels = &pixels_storage[0];
+  }
+  else {
+    thread_scoped_lock device_lock(device_mutex);
+    pixels = (StorageType *)img->mem->alloc(width, height, depth);
+  }
+
+  if (pixels == NULL) {
+    /* Could be that we've run out of memory. */
+    return false;
+  }
+
+  const size_t num_pixels = ((size_t)width) * height * depth;
+  img->loader->load_pixels(
+      img->metadata, pixels, num_pixels * components, image_associate_alpha(img));
+
+  const bool is_rgba = image_is_rgba(img->metadata.type);
+  image_process_pixels<FileFormat>(img, pixels, num_pixels);
 
   /* Scale image down if needed. */
   if (pixels_storage.size() > 0) {
@@ -642,6 +731,199 @@ bool ImageManager::file_load_image(Image *img, int texture_limit)
   return true;
 }
 
+template<TypeDesc::BASETYPE FileFormat, typename StorageType>
+bool ImageManager::file_load_pixels_region(
+    Image *img, int miplevel, int x, int y, int width, int height, StorageType *pixels)
+{
+  if (!img->loader->load_pixels_region(
+          img->metadata, miplevel, x, y, width, height, pixels, image_associate_alpha(img))) {
+    return false;
+  }
+
+  image_process_pixels<FileFormat>(img, pixels, ((size_t)width) * height);
+  return true;
+}
+
+bool ImageManager::file_load_image_region(
+    Image *img, int miplevel, int x, int y, int width, int height, void *pixels)
+{
+  switch (img->metadata.type) {
+    case IMAGE_DATA_TYPE_FLOAT4:
+    case IMAGE_DATA_TYPE_FLOAT:
+      return file_load_pixels_region<TypeDesc::FLOAT, float>(
+          img, miplevel, x, y, width, height, (float *)pixels);
+    case IMAGE_DATA_TYPE_BYTE4:
+    case IMAGE_DATA_TYPE_BYTE:
+      return file_load_pixels_region<TypeDesc::UINT8, uchar>(
+          img, miplevel, x, y, width, height, (uchar *)pixels);
+    case IMAGE_DATA_TYPE_HALF4:
+    case IMAGE_DATA_TYPE_HALF:
+      return file_load_pixels_region<TypeDesc::HALF, half>(
+          img, miplevel, x, y, width, height, (half *)pixels);
+    case IMAGE_DATA_TYPE_USHORT4:
+    case IMAGE_DATA_TYPE_USHORT:
+      return file_load_pixels_region<TypeDesc::USHORT, uint16_t>(
+          img, miplevel, x, y, width, height, (uint16_t *)pixels);
+    default:
+      return false;
+  }
+}
+
+bool ImageManager::device_load_image_cached(Scene *scene, Image *img)
+{
+  const ImageMetaData &metadata = img->metadata;
+
+  /* Only 2D images from files, builtin images are already in memory in the host application. */
+  if (img->builtin || metadata.depth > 1 || !(metadata.channels > 0) ||
+      metadata.type == IMAGE_DATA_TYPE_NANOVDB_FLOAT ||
+      metadata.type == IMAGE_DATA_TYPE_NANOVDB_FLOAT3) {
+    return false;
+  }
+
+  int num_miplevels = 0;
+  bool is_tiled = false;
+  if (!img->loader->load_region_metadata(metadata, num_miplevels, is_tiled)) {
+    return false;
+  }
+
+  img->cache_image = texture_cache->add_image(
+      img->loader->name(),
+      metadata.type,
+      metadata.width,
+      metadata.height,
+      num_miplevels,
+      is_tiled,
+      scene->params.texture_limit,
+      function_bind(&ImageManager::file_load_image_region, this, img, _1, _2, _3, _4, _5, _6));
+
+  /* Kernels look up tiles through the cache, the texture itself is only a placeholder. */
+  thread_scoped_lock device_lock(device_mutex);
+  void *pixels = img->mem->alloc(1, 1);
+  memset(pixels, 0, img->mem->memory_size());
+  img->mem->info.cache = (uint64_t)img->cache_image;
+  img->mem->copy_to_device();
+
+  return true;
+}
+
+void ImageManager::device_compress_image(Scene *scene, Image *img)
+{
+  const ImageCompression compression = scene->params.texture_compression;
+  device_texture *mem = img->mem;
+  const ImageDataType type = (ImageDataType)mem->info.data_type;
+
+  /* Only 2D float images, volumes are read back as float to build their mesh. */
+  if (compression == IMAGE_COMPRESSION_NONE || mem->host_pointer == NULL ||
+      mem->data_depth > 1 || !(type == IMAGE_DATA_TYPE_FLOAT4 || type == IMAGE_DATA_TYPE_FLOAT)) {
+    return;
+  }
+
+  const bool use_block = (compression == IMAGE_COMPRESSION_BLOCK && has_block_compression);
+  if (!use_block && !features.has_half_float) {
+    return;
+  }
+
+  const int channels = (type == IMAGE_DATA_TYPE_FLOAT4) ? 4 : 1;
+  const int width = mem->data_width;
+  const int height = max(mem->data_height, (size_t)1);
+  const size_t num_values = (size_t)width * height * channels;
+  const float *pixels = (const float *)mem->host_pointer;
+
+  /* Keep full float precision if the values don't fit. */
+  for (size_t i = 0; i < num_values; i++) {
+    if (!(fabsf(pixels[i]) <= HALF_FLOAT_MAX)) {
+      VLOG(2) << "Image " << img->loader->name() << " out of half float range, not compressed.";
+      return;
+    }
+  }
+
+  ImageDataType new_type;
+  if (use_block) {
+    new_type = (channels == 4) ? IMAGE_DATA_TYPE_BLOCK_HALF4 : IMAGE_DATA_TYPE_BLOCK_HALF;
+  }
+  else {
+    new_type = (channels == 4) ? IMAGE_DATA_TYPE_HALF4 : IMAGE_DATA_TYPE_HALF;
+  }
+
+  img->mem_name = string_printf("__tex_image_%s_%03d", name_from_type(new_type), mem->slot);
+
+  device_texture *new_mem = new device_texture(mem->device,
+                                               img->mem_name.c_str(),
+                                               mem->slot,
+                                               new_type,
+                                               (InterpolationType)mem->info.interpolation,
+                                               (ExtensionType)mem->info.extension);
+  new_mem->info.use_transform_3d = mem->info.use_transform_3d;
+  new_mem->info.transform_3d = mem->info.transform_3d;
+
+  void *new_pixels;
+  {
+    thread_scoped_lock device_lock(device_mutex);
+    new_pixels = new_mem->alloc(mem->data_width, mem->data_height, mem->data_depth);
+  }
+
+  /* Encode, and measure the error introduced by it. */
+  double error_sum = 0.0;
+  float error_max = 0.0f;
+
+  if (use_block) {
+    const int width_blocks = divide_up(width, TEXTURE_BLOCK_SIZE);
+    const int height_blocks = divide_up(height, TEXTURE_BLOCK_SIZE);
+    TextureBlockHalf *blocks = (TextureBlockHalf *)new_pixels;
+
+    for (int by = 0; by < height_blocks; by++) {
+      for (int bx = 0; bx < width_blocks; bx++) {
+        for (int c = 0; c < channels; c++) {
+          texture_block_encode(pixels,
+                               channels,
+                               c,
+                               width,
+                               height,
+                               bx,
+                               by,
+                               blocks[(by * width_blocks + bx) * channels + c]);
+        }
+      }
+    }
+
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        const int i = (y % TEXTURE_BLOCK_SIZE) * TEXTURE_BLOCK_SIZE + (x % TEXTURE_BLOCK_SIZE);
+        const size_t block = (y / TEXTURE_BLOCK_SIZE) * width_blocks + (x / TEXTURE_BLOCK_SIZE);
+
+        for (int c = 0; c < channels; c++) {
+          const float value = pixels[((size_t)y * width + x) * channels + c];
+          const float error = fabsf(texture_block_decode(blocks[block * channels + c], i) -
+                                    value);
+          error_sum += (double)error * error;
+          error_max = max(error_max, error);
+        }
+      }
+    }
+  }
+  else {
+    half *half_pixels = (half *)new_pixels;
+
+    for (size_t i = 0; i < num_values; i++) {
+      half_pixels[i] = float_to_half(pixels[i]);
+
+      const float error = fabsf(half_to_float(half_pixels[i]) - pixels[i]);
+      error_sum += (double)error * error;
+      error_max = max(error_max, error);
+    }
+  }
+
+  VLOG(1) << "Compressed image " << img->loader->name() << " from " << name_from_type(type)
+          << " to " << name_from_type(new_type) << ", "
+          << string_human_readable_size(mem->memory_size()) << " to "
+          << string_human_readable_size(new_mem->memory_size()) << ", RMS error "
+          << sqrt(error_sum / num_values) << ", max error " << error_max << ".";
+
+  thread_scoped_lock device_lock(device_mutex);
+  delete img->mem;
+  img->mem = new_mem;
+}
+
 void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Progress *progress)
 {
   if (progress->get_cancel()) {
@@ -661,6 +943,10 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   img->mem_name = string_printf("__tex_image_%s_%03d", name_from_type(type), slot);
 
   /* Free previous texture in slot. */
+  if (img->cache_image) {
+    texture_cache->remove_image(img->cache_image);
+    img->cache_image = NULL;
+  }
   if (img->mem) {
     thread_scoped_lock device_lock(device_mutex);
     delete img->mem;
@@ -672,6 +958,12 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   img->mem->info.use_transform_3d = img->metadata.use_transform_3d;
   img->mem->info.transform_3d = img->metadata.transform_3d;
 
+  /* Load tiles on demand through the texture cache when possible. */
+  if (use_texture_cache(scene) && device_load_image_cached(scene, img)) {
+    img->need_load = false;
+    return;
+  }
+
   /* Create new texture. */
   if (type == IMAGE_DATA_TYPE_FLOAT4) {
     if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
@@ -768,6 +1060,8 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   }
 #endif
 
+  device_compress_image(scene, img);
+
   {
     thread_scoped_lock device_lock(device_mutex);
     img->mem->copy_to_device();
@@ -794,6 +1088,10 @@ void ImageManager::device_free_image(Device *, int slot)
 #endif
   }
 
+  if (img->cache_image) {
+    texture_cache->remove_image(img->cache_image);
+  }
+
   if (img->mem) {
     thread_scoped_lock device_lock(device_mutex);
     delete img->mem;
@@ -816,6 +1114,10 @@ void ImageManager::device_update(Device *device, Scene *scene, Progress &progres
     }
   });
 
+  if (use_texture_cache(scene) && !texture_cache) {
+    texture_cache = make_unique<TextureCache>();
+  }
+
   TaskPool pool;
   for (size_t slot = 0; slot < images.size(); slot++) {
     Image *img = images[slot];
@@ -884,11 +1186,60 @@ void ImageManager::device_free(Device *device)
   images.clear();
 }
 
+bool ImageManager::use_texture_cache(const Scene *scene) const
+{
+  return has_texture_cache && scene->params.texture_cache_size > 0;
+}
+
+void ImageManager::texture_cache_evict(Scene *scene)
+{
+  if (!texture_cache) {
+    return;
+  }
+
+  /* Files opened for loading tiles stay open until the image is freed, reopening them after
+   * every render pass would be more expensive than the tiles read in between. */
+  texture_cache->evict(((size_t)scene->params.texture_cache_size) * 1024 * 1024);
+}
+
 void ImageManager::collect_statistics(RenderStats *stats)
 {
   foreach (const Image *image, images) {
-    stats->image.textures.add_entry(
-        NamedSizeEntry(image->loader->name(), image->mem->memory_size()));
+    /* Memory of images in the texture cache is reported by the cache. */
+    if (!image->cache_image) {
+      stats->image.textures.add_entry(
+          NamedSizeEntry(image->loader->name(), image->mem->memory_size()));
+    }
+  }
+
+  if (texture_cache) {
+    texture_cache->collect_statistics(&stats->image);
+  }
+}
+
+void ImageManager::collect_memory_statistics(MemoryStats *stats)
+{
+  foreach (Image *image, images) {
+    if (image == NULL || image->mem == NULL) {
+      continue;
+    }
+
+    device_texture *mem = image->mem;
+    string info = string_printf("%zux%zu", mem->data_width, mem->data_height);
+    if (mem->data_depth > 1) {
+      info += string_printf("x%zu", mem->data_depth);
+    }
+    info += string_printf(" %s", name_from_type((ImageDataType)mem->info.data_type));
+
+    NamedMemoryEntry entry(image->loader->name(), info);
+    if (image->cache_image) {
+      /* Tiles are loaded on demand, their memory is shared by all images in the cache. */
+      entry.info += ", texture cache";
+    }
+    else {
+      entry.add_part("pixels", mem->memory_size());
+    }
+    stats->images.push_back(entry);
   }
 }
 
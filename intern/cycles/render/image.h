@@ -35,9 +35,12 @@ class ImageHandle;
 class ImageKey;
 class ImageMetaData;
 class ImageManager;
+class MemoryStats;
 class Progress;
 class RenderStats;
 class Scene;
+class TextureCache;
+class TextureCacheImage;
 class ColorSpaceProcessor;
 class VDBImageLoader;
 
@@ -97,6 +100,17 @@ class ImageMetaData {
   void detect_colorspace();
 };
 
+/* Reduced precision storage of 2D float textures, to save memory. */
+enum ImageCompression {
+  IMAGE_COMPRESSION_NONE = 0,
+  /* Store as half float, when all values are in the half float range. */
+  IMAGE_COMPRESSION_HALF = 1,
+  /* Store block compressed on the CPU, and as half float on other devices. */
+  IMAGE_COMPRESSION_BLOCK = 2,
+
+  IMAGE_COMPRESSION_NUM_TYPES,
+};
+
 /* Information about supported features that Image loaders can use. */
 class ImageDeviceFeatures {
  public:
@@ -120,6 +134,23 @@ class ImageLoader {
                            const size_t pixels_size,
                            const bool associate_alpha) = 0;
 
+  /* Optional support for loading regions of the image, used by the texture cache to load tiles
+   * on demand. Gets the number of mipmap levels stored in the file, and whether the file is
+   * tiled so that small regions can be read without decoding full scanlines. */
+  virtual bool load_region_metadata(const ImageMetaData &metadata,
+                                    int &num_miplevels,
+                                    bool &is_tiled);
+
+  /* Load region of a mipmap level, with the same pixel layout as load_pixels(). */
+  virtual bool load_pixels_region(const ImageMetaData &metadata,
+                                  const int miplevel,
+                                  const int x,
+                                  const int y,
+                                  const int width,
+                                  const int height,
+                                  void *pixels,
+                                  const bool associate_alpha);
+
   /* Name for logs and stats. */
   virtual string name() const = 0;
 
@@ -194,7 +225,12 @@ class ImageManager {
   void set_osl_texture_system(void *texture_system);
   bool set_animation_frame_update(int frame);
 
+  /* Texture cache for loading image tiles on demand, only supported on the CPU. */
+  bool use_texture_cache(const Scene *scene) const;
+  void texture_cache_evict(Scene *scene);
+
   void collect_statistics(RenderStats *stats);
+  void collect_memory_statistics(MemoryStats *stats);
 
   void tag_update();
 
@@ -213,6 +249,9 @@ class ImageManager {
     string mem_name;
     device_texture *mem;
 
+    /* Set when tiles are loaded on demand through the texture cache. */
+    TextureCacheImage *cache_image;
+
     int users;
     thread_mutex mutex;
   };
@@ -229,6 +268,10 @@ class ImageManager {
   vector<Image *> images;
   void *osl_texture_system;
 
+  bool has_texture_cache;
+  bool has_block_compression;
+  unique_ptr<TextureCache> texture_cache;
+
   int add_image_slot(ImageLoader *loader, const ImageParams &params, const bool builtin);
   void add_image_user(int slot);
   void remove_image_user(int slot);
@@ -238,6 +281,14 @@ class ImageManager {
   template<TypeDesc::BASETYPE FileFormat, typename StorageType>
   bool file_load_image(Image *img, int texture_limit);
 
+  template<TypeDesc::BASETYPE FileFormat, typename StorageType>
+  bool file_load_pixels_region(
+      Image *img, int miplevel, int x, int y, int width, int height, StorageType *pixels);
+  bool file_load_image_region(
+      Image *img, int miplevel, int x, int y, int width, int height, void *pixels);
+  bool device_load_image_cached(Scene *scene, Image *img);
+  void device_compress_image(Scene *scene, Image *img);
+
   void device_load_image(Device *device, Scene *scene, int slot, Progress *progress);
   void device_free_image(Device *device, int slot);
 
@@ -103,6 +103,30 @@ bool OIIOImageLoader::load_metadata(const ImageDeviceFeatures &features, ImageMe
   return true;
 }
 
+/* CMYK to RGBA. */
+template<typename StorageType>
+static void oiio_cmyk_to_rgba(const unique_ptr<ImageInput> &in,
+                              const int components,
+                              const size_t num_pixels,
+                              StorageType *pixels)
+{
+  const bool cmyk = strcmp(in->format_name(), "jpeg") == 0 && components == 4;
+  if (cmyk) {
+    const StorageType one = util_image_cast_from_float<StorageType>(1.0f);
+
+    for (size_t i = num_pixels - 1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+      float c = util_image_cast_to_float(pixels[i * 4 + 0]);
+      float m = util_image_cast_to_float(pixels[i * 4 + 1]);
+      float y = util_image_cast_to_float(pixels[i * 4 + 2]);
+      float k = util_image_cast_to_float(pixels[i * 4 + 3]);
+      pixels[i * 4 + 0] = util_image_cast_from_float<StorageType>((1.0f - c) * (1.0f - k));
+      pixels[i * 4 + 1] = util_image_cast_from_float<StorageType>((1.0f - m) * (1.0f - k));
+      pixels[i * 4 + 2] = util_image_cast_from_float<StorageType>((1.0f - y) * (1.0f - k));
+      pixels[i * 4 + 3] = one;
+    }
+  }
+}
+
 template<TypeDesc::BASETYPE FileFormat, typename StorageType>
 static void oiio_load_pixels(const ImageMetaData &metadata,
                              const unique_ptr<ImageInput> &in,
@@ -144,23 +168,7 @@ static void oiio_load_pixels(const ImageMetaData &metadata,
     tmppixels.clear();
   }
 
-  /* CMYK to RGBA. */
-  const bool cmyk = strcmp(in->format_name(), "jpeg") == 0 && components == 4;
-  if (cmyk) {
-    const StorageType one = util_image_cast_from_float<StorageType>(1.0f);
-
-    const size_t num_pixels = ((size_t)width) * height * depth;
-    for (size_t i = num_pixels - 1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-      float c = util_image_cast_to_float(pixels[i * 4 + 0]);
-      float m = util_image_cast_to_float(pixels[i * 4 + 1]);
-      float y = util_image_cast_to_float(pixels[i * 4 + 2]);
-      float k = util_image_cast_to_float(pixels[i * 4 + 3]);
-      pixels[i * 4 + 0] = util_image_cast_from_float<StorageType>((1.0f - c) * (1.0f - k));
-      pixels[i * 4 + 1] = util_image_cast_from_float<StorageType>((1.0f - m) * (1.0f - k));
-      pixels[i * 4 + 2] = util_image_cast_from_float<StorageType>((1.0f - y) * (1.0f - k));
-      pixels[i * 4 + 3] = one;
-    }
-  }
+  oiio_cmyk_to_rgba(in, components, ((size_t)width) * height * depth, pixels);
 }
 
 bool OIIOImageLoader::load_pixels(const ImageMetaData &metadata,
@@ -211,6 +219,8 @@ bool OIIOImageLoader::load_pixels(const ImageMetaData &metadata,
       break;
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT:
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT3:
+    case IMAGE_DATA_TYPE_BLOCK_HALF4:
+    case IMAGE_DATA_TYPE_BLOCK_HALF:
     case IMAGE_DATA_NUM_TYPES:
       break;
   }
@@ -219,6 +229,185 @@ bool OIIOImageLoader::load_pixels(const ImageMetaData &metadata,
   return true;
 }
 
+bool OIIOImageLoader::load_region_metadata(const ImageMetaData &metadata,
+                                           int &num_miplevels,
+                                           bool &is_tiled)
+{
+  if (metadata.depth > 1 || !path_exists(filepath.string()) ||
+      path_is_directory(filepath.string())) {
+    return false;
+  }
+
+  unique_ptr<ImageInput> in(ImageInput::create(filepath.string()));
+  if (!in) {
+    return false;
+  }
+
+  ImageSpec spec;
+  if (!in->open(filepath.string(), spec)) {
+    return false;
+  }
+
+  is_tiled = (spec.tile_width > 0 && spec.tile_height > 0);
+
+  /* Count mipmap levels with the dimensions the texture cache expects. */
+  int width = spec.width;
+  int height = spec.height;
+  num_miplevels = 0;
+  while (in->seek_subimage(0, num_miplevels)) {
+    const ImageSpec &level_spec = in->spec();
+    if (level_spec.width != width || level_spec.height != height) {
+      break;
+    }
+    num_miplevels++;
+    width = max(1, width >> 1);
+    height = max(1, height >> 1);
+  }
+
+  in->close();
+  return num_miplevels > 0;
+}
+
+template<TypeDesc::BASETYPE FileFormat, typename StorageType>
+static bool oiio_load_pixels_region(const ImageMetaData &metadata,
+                                    const unique_ptr<ImageInput> &in,
+                                    const int miplevel,
+                                    const int x,
+                                    const int y,
+                                    const int width,
+                                    const int height,
+                                    StorageType *pixels)
+{
+  if (!in->seek_subimage(0, miplevel)) {
+    return false;
+  }
+
+  const ImageSpec &spec = in->spec();
+  const int components = min(metadata.channels, 4);
+
+  /* Images are stored bottom to top, while files are top to bottom. */
+  const int xbegin = spec.x + x;
+  const int ybegin = spec.y + spec.height - (y + height);
+
+  /* Read whole scanlines, or for tiled files the region aligned to tiles of the file. */
+  int read_xbegin = spec.x, read_xend = spec.x + spec.width;
+  int read_ybegin = ybegin, read_yend = ybegin + height;
+  if (spec.tile_width > 0 && spec.tile_height > 0) {
+    read_xbegin = spec.x + ((xbegin - spec.x) / spec.tile_width) * spec.tile_width;
+    read_xend = min(spec.x + spec.width,
+                    spec.x + divide_up(xbegin + width - spec.x, spec.tile_width) *
+                                 spec.tile_width);
+    read_ybegin = spec.y + ((ybegin - spec.y) / spec.tile_height) * spec.tile_height;
+    read_yend = min(spec.y + spec.height,
+                    spec.y + divide_up(ybegin + height - spec.y, spec.tile_height) *
+                                 spec.tile_height);
+  }
+
+  const int read_width = read_xend - read_xbegin;
+  vector<StorageType> readpixels(((size_t)read_width) * (read_yend - read_ybegin) * components);
+
+  bool ok;
+  if (spec.tile_width > 0 && spec.tile_height > 0) {
+    ok = in->read_tiles(0,
+                        miplevel,
+                        read_xbegin,
+                        read_xend,
+                        read_ybegin,
+                        read_yend,
+                        0,
+                        1,
+                        0,
+                        components,
+                        FileFormat,
+                        readpixels.data());
+  }
+  else {
+    ok = in->read_scanlines(
+        0, miplevel, read_ybegin, read_yend, 0, 0, components, FileFormat, readpixels.data());
+  }
+
+  if (!ok) {
+    return false;
+  }
+
+  for (int j = 0; j < height; j++) {
+    const int file_y = ybegin + height - 1 - j;
+    memcpy(pixels + ((size_t)j) * width * components,
+           readpixels.data() +
+               (((size_t)(file_y - read_ybegin)) * read_width + (xbegin - read_xbegin)) *
+                   components,
+           ((size_t)width) * components * sizeof(StorageType));
+  }
+
+  oiio_cmyk_to_rgba(in, metadata.channels, ((size_t)width) * height, pixels);
+  return true;
+}
+
+bool OIIOImageLoader::load_pixels_region(const ImageMetaData &metadata,
+                                         const int miplevel,
+                                         const int x,
+                                         const int y,
+                                         const int width,
+                                         const int height,
+                                         void *pixels,
+                                         const bool associate_alpha)
+{
+  /* Keep the file open, as the texture cache loads many regions one after the other. */
+  if (!region_in) {
+    region_in = unique_ptr<ImageInput>(ImageInput::create(filepath.string()));
+    if (!region_in) {
+      return false;
+    }
+
+    ImageSpec spec = ImageSpec();
+    ImageSpec config = ImageSpec();
+
+    if (!associate_alpha) {
+      config.attribute("oiio:UnassociatedAlpha", 1);
+    }
+
+    if (!region_in->open(filepath.string(), spec, config)) {
+      region_in.reset();
+      return false;
+    }
+  }
+
+  switch (metadata.type) {
+    case IMAGE_DATA_TYPE_BYTE:
+    case IMAGE_DATA_TYPE_BYTE4:
+      return oiio_load_pixels_region<TypeDesc::UINT8, uchar>(
+          metadata, region_in, miplevel, x, y, width, height, (uchar *)pixels);
+    case IMAGE_DATA_TYPE_USHORT:
+    case IMAGE_DATA_TYPE_USHORT4:
+      return oiio_load_pixels_region<TypeDesc::USHORT, uint16_t>(
+          metadata, region_in, miplevel, x, y, width, height, (uint16_t *)pixels);
+    case IMAGE_DATA_TYPE_HALF:
+    case IMAGE_DATA_TYPE_HALF4:
+      return oiio_load_pixels_region<TypeDesc::HALF, half>(
+          metadata, region_in, miplevel, x, y, width, height, (half *)pixels);
+    case IMAGE_DATA_TYPE_FLOAT:
+    case IMAGE_DATA_TYPE_FLOAT4:
+      return oiio_load_pixels_region<TypeDesc::FLOAT, float>(
+          metadata, region_in, miplevel, x, y, width, height, (float *)pixels);
+    case IMAGE_DATA_TYPE_NANOVDB_FLOAT:
+    case IMAGE_DATA_TYPE_NANOVDB_FLOAT3:
+    case IMAGE_DATA_TYPE_BLOCK_HALF4:
+    case IMAGE_DATA_TYPE_BLOCK_HALF:
+    case IMAGE_DATA_NUM_TYPES:
+      break;
+  }
+
+  return false;
+}
+
+void OIIOImageLoader::cleanup()
+{
+  if (region_in) {
+    region_in->close();
+    region_in.reset();
+  }
+}
+
 string OIIOImageLoader::name() const
 {
   return path_filename(filepath.string());
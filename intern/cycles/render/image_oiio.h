@@ -19,6 +19,8 @@
 
 #include "render/image.h"
 
+#include "util/util_image.h"
+
 CCL_NAMESPACE_BEGIN
 
 class OIIOImageLoader : public ImageLoader {
@@ -33,14 +35,32 @@ class OIIOImageLoader : public ImageLoader {
                    const size_t pixels_size,
                    const bool associate_alpha) override;
 
+  bool load_region_metadata(const ImageMetaData &metadata,
+                            int &num_miplevels,
+                            bool &is_tiled) override;
+
+  bool load_pixels_region(const ImageMetaData &metadata,
+                          const int miplevel,
+                          const int x,
+                          const int y,
+                          const int width,
+                          const int height,
+                          void *pixels,
+                          const bool associate_alpha) override;
+
   string name() const override;
 
   ustring osl_filepath() const override;
 
+  void cleanup() override;
+
   bool equals(const ImageLoader &other) const override;
 
  protected:
   ustring filepath;
+
+  /* File kept open for loading regions. */
+  unique_ptr<ImageInput> region_in;
 };
 
 CCL_NAMESPACE_END
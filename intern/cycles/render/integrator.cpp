@@ -58,6 +58,7 @@ NODE_DEFINE(Integrator)
 
   SOCKET_INT(volume_max_steps, "Volume Max Steps", 1024);
   SOCKET_FLOAT(volume_step_rate, "Volume Step Rate", 1.0f);
+  SOCKET_BOOLEAN(volume_skip_empty, "Volume Skip Empty", true);
 
   SOCKET_BOOLEAN(caustics_reflective, "Reflective Caustics", true);
   SOCKET_BOOLEAN(caustics_refractive, "Refractive Caustics", true);
@@ -75,11 +76,16 @@ NODE_DEFINE(Integrator)
   SOCKET_INT(adaptive_min_samples, "Adaptive Min Samples", 0);
 
   SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+  SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
+
+  SOCKET_BOOLEAN(use_guiding, "Use Guiding", false);
+  SOCKET_INT(guiding_training_samples, "Guiding Training Samples", 128);
 
   static NodeEnum sampling_pattern_enum;
   sampling_pattern_enum.insert("sobol", SAMPLING_PATTERN_SOBOL);
   sampling_pattern_enum.insert("pmj", SAMPLING_PATTERN_PMJ);
   SOCKET_ENUM(sampling_pattern, "Sampling Pattern", sampling_pattern_enum, SAMPLING_PATTERN_SOBOL);
+  SOCKET_BOOLEAN(use_blue_noise, "Use Blue Noise", false);
 
   static NodeEnum denoiser_type_enum;
   denoiser_type_enum.insert("optix", DENOISER_OPTIX);
@@ -142,6 +148,10 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
     dscene->sample_pattern_lut.tag_realloc();
   }
 
+  if (!use_blue_noise) {
+    dscene->blue_noise.tag_realloc();
+  }
+
   device_free(device, dscene);
 
   /* integrator parameters */
@@ -176,6 +186,7 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 
   kintegrator->volume_max_steps = volume_max_steps;
   kintegrator->volume_step_rate = volume_step_rate;
+  kintegrator->volume_skip_empty = volume_skip_empty;
 
   kintegrator->caustics_reflective = caustics_reflective;
   kintegrator->caustics_refractive = caustics_refractive;
@@ -198,6 +209,11 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
     kintegrator->light_inv_rr_threshold = 0.0f;
   }
 
+  /* Path guiding is only implemented for the CPU, where the distribution is trained alongside
+   * rendering. Half of the scattering directions are sampled from it. */
+  kintegrator->use_guiding = use_guiding && device->info.type == DEVICE_CPU;
+  kintegrator->guiding_probability = 0.5f;
+
   /* sobol directions table */
   int max_samples = max_bounce + transparent_max_bounce + 3 + VOLUME_BOUNDS_MAX +
                     max(BSSRDF_MAX_HITS, BSSRDF_MAX_BOUNCES);
@@ -230,15 +246,27 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
     }
   }
 
+  /* Blue noise mask to decorrelate the sample sequences of neighboring pixels. It does not
+   * depend on any other setting, so is only generated once. */
+  kintegrator->use_blue_noise = use_blue_noise;
+
+  if (use_blue_noise && dscene->blue_noise.size() == 0) {
+    float *mask = dscene->blue_noise.alloc(BLUE_NOISE_SIZE * BLUE_NOISE_SIZE);
+    blue_noise_generate(mask, BLUE_NOISE_SIZE, 0);
+    dscene->blue_noise.copy_to_device();
+  }
+
   kintegrator->has_shadow_catcher = scene->has_shadow_catcher();
 
   dscene->sample_pattern_lut.clear_modified();
+  dscene->blue_noise.clear_modified();
   clear_modified();
 }
 
 void Integrator::device_free(Device *, DeviceScene *dscene, bool force_free)
 {
   dscene->sample_pattern_lut.free_if_need_realloc(force_free);
+  dscene->blue_noise.free_if_need_realloc(force_free);
 }
 
 void Integrator::tag_update(Scene *scene, uint32_t flag)
@@ -266,6 +294,10 @@ void Integrator::tag_update(Scene *scene, uint32_t flag)
     scene->object_manager->tag_update(scene, ObjectManager::MOTION_BLUR_MODIFIED);
     scene->camera->tag_modified();
   }
+
+  if (use_light_tree_is_modified()) {
+    scene->light_manager->tag_update(scene, LightManager::INTEGRATOR_MODIFIED);
+  }
 }
 
 AdaptiveSampling Integrator::get_adaptive_sampling() const
@@ -329,4 +361,14 @@ DenoiseParams Integrator::get_denoise_params() const
   return denoise_params;
 }
 
+GuidingParams Integrator::get_guiding_params() const
+{
+  GuidingParams guiding_params;
+
+  guiding_params.use = use_guiding;
+  guiding_params.training_samples = max(guiding_training_samples, 1);
+
+  return guiding_params;
+}
+
 CCL_NAMESPACE_END
@@ -22,6 +22,7 @@
 #include "device/device_denoise.h" /* For the parameters and type enum. */
 #include "graph/node.h"
 #include "integrator/adaptive_sampling.h"
+#include "integrator/path_guiding.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -50,6 +51,7 @@ class Integrator : public Node {
 
   NODE_SOCKET_API(int, volume_max_steps)
   NODE_SOCKET_API(float, volume_step_rate)
+  NODE_SOCKET_API(bool, volume_skip_empty)
 
   NODE_SOCKET_API(bool, caustics_reflective)
   NODE_SOCKET_API(bool, caustics_refractive)
@@ -69,12 +71,17 @@ class Integrator : public Node {
   NODE_SOCKET_API(int, start_sample)
 
   NODE_SOCKET_API(float, light_sampling_threshold)
+  NODE_SOCKET_API(bool, use_light_tree)
+
+  NODE_SOCKET_API(bool, use_guiding)
+  NODE_SOCKET_API(int, guiding_training_samples)
 
   NODE_SOCKET_API(bool, use_adaptive_sampling)
   NODE_SOCKET_API(int, adaptive_min_samples)
   NODE_SOCKET_API(float, adaptive_threshold)
 
   NODE_SOCKET_API(SamplingPattern, sampling_pattern)
+  NODE_SOCKET_API(bool, use_blue_noise)
 
   NODE_SOCKET_API(bool, use_denoise);
   NODE_SOCKET_API(DenoiserType, denoiser_type);
@@ -103,6 +110,7 @@ class Integrator : public Node {
 
   AdaptiveSampling get_adaptive_sampling() const;
   DenoiseParams get_denoise_params() const;
+  GuidingParams get_guiding_params() const;
 };
 
 CCL_NAMESPACE_END
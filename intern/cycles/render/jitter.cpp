@@ -25,6 +25,8 @@
 
 #include "render/jitter.h"
 
+#include "util/util_math.h"
+
 #include <math.h>
 #include <vector>
 
@@ -266,6 +268,140 @@ static void shuffle(float2 points[], int size, int rng_seed)
   }
 }
 
+/* Blue noise mask, based on "The void-and-cluster method for dither array generation" by
+ * Robert Ulichney. Every pixel of the mask gets a unique rank, such that the pixels below any
+ * rank are spread out as evenly as possible, wrapping around the edges so the mask tiles. */
+class BlueNoiseGenerator {
+ public:
+  static void generate(float mask[], int size, int rng_seed)
+  {
+    BlueNoiseGenerator g(size);
+    const int num_pixels = g.num_pixels;
+    std::vector<int> rank(num_pixels);
+
+    /* Start from a tenth of the pixels at random, relaxed by moving the pixel in the tightest
+     * cluster to the largest void until that no longer changes anything. */
+    const int num_initial = max(num_pixels / 10, 1);
+    int rng_index = 0;
+    for (int n = 0; n < num_initial;) {
+      const int i = min((int)(cmj_randfloat(++rng_index, rng_seed) * num_pixels), num_pixels - 1);
+      if (!g.pattern[i]) {
+        g.set(i, true);
+        n++;
+      }
+    }
+
+    for (int iteration = 0; iteration < num_pixels; iteration++) {
+      const int cluster = g.find(true, true);
+      g.set(cluster, false);
+      const int largest_void = g.find(false, false);
+      g.set(largest_void, true);
+
+      if (largest_void == cluster) {
+        break;
+      }
+    }
+
+    const std::vector<bool> initial_pattern = g.pattern;
+    const std::vector<float> initial_energy = g.energy;
+
+    /* Rank the initial pixels by removing the tightest cluster. */
+    for (int r = num_initial - 1; r >= 0; r--) {
+      const int i = g.find(true, true);
+      g.set(i, false);
+      rank[i] = r;
+    }
+
+    g.pattern = initial_pattern;
+    g.energy = initial_energy;
+
+    /* Fill the largest void up to half of the pixels. */
+    for (int r = num_initial; r < num_pixels / 2; r++) {
+      const int i = g.find(false, false);
+      g.set(i, true);
+      rank[i] = r;
+    }
+
+    /* Beyond half the roles are reversed, fill the tightest cluster of unset pixels. */
+    std::fill(g.energy.begin(), g.energy.end(), 0.0f);
+    for (int i = 0; i < num_pixels; i++) {
+      if (!g.pattern[i]) {
+        g.splat(i, 1.0f);
+      }
+    }
+
+    for (int r = num_pixels / 2; r < num_pixels; r++) {
+      const int i = g.find(false, true);
+      g.pattern[i] = true;
+      g.splat(i, -1.0f);
+      rank[i] = r;
+    }
+
+    for (int i = 0; i < num_pixels; i++) {
+      mask[i] = (rank[i] + 0.5f) / num_pixels;
+    }
+  }
+
+ protected:
+  BlueNoiseGenerator(int size)
+      : size(size),
+        num_pixels(size * size),
+        pattern(num_pixels, false),
+        energy(num_pixels, 0.0f),
+        filter(num_pixels)
+  {
+    /* Gaussian energy filter, sigma of 1.5 as recommended in the paper. */
+    const float sigma = 1.5f;
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++) {
+        const int dx = min(x, size - x);
+        const int dy = min(y, size - y);
+        filter[y * size + x] = expf(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+      }
+    }
+  }
+
+  void set(int i, bool value)
+  {
+    pattern[i] = value;
+    splat(i, (value) ? 1.0f : -1.0f);
+  }
+
+  /* Add the filter centered at pixel i to the energy of all pixels. */
+  void splat(int i, float weight)
+  {
+    const int ix = i % size;
+    const int iy = i / size;
+
+    for (int y = 0; y < size; y++) {
+      const int fy = (y - iy + size) % size;
+      for (int x = 0; x < size; x++) {
+        const int fx = (x - ix + size) % size;
+        energy[y * size + x] += weight * filter[fy * size + fx];
+      }
+    }
+  }
+
+  /* Pixel with the highest or lowest energy among set or unset pixels. */
+  int find(bool value, bool highest) const
+  {
+    int best = -1;
+    for (int i = 0; i < num_pixels; i++) {
+      if (pattern[i] == value &&
+          (best == -1 || (highest ? energy[i] > energy[best] : energy[i] < energy[best]))) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  int size;
+  int num_pixels;
+  std::vector<bool> pattern;
+  std::vector<float> energy;
+  std::vector<float> filter;
+};
+
 void progressive_multi_jitter_generate_2D(float2 points[], int size, int rng_seed)
 {
   PMJ_Generator::generate_2D(points, size, rng_seed);
@@ -278,4 +414,9 @@ void progressive_multi_jitter_02_generate_2D(float2 points[], int size, int rng_
   shuffle(points, size, rng_seed);
 }
 
+void blue_noise_generate(float mask[], int size, int rng_seed)
+{
+  BlueNoiseGenerator::generate(mask, size, rng_seed);
+}
+
 CCL_NAMESPACE_END
@@ -21,6 +21,7 @@
 #include "render/graph.h"
 #include "render/integrator.h"
 #include "render/light.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/nodes.h"
 #include "render/object.h"
@@ -36,6 +37,7 @@
 #include "util/util_path.h"
 #include "util/util_progress.h"
 #include "util/util_task.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -527,6 +529,179 @@ void LightManager::device_update_distribution(Device *,
   }
 }
 
+void LightManager::device_update_tree(Device *,
+                                      DeviceScene *dscene,
+                                      Scene *scene,
+                                      Progress &progress)
+{
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+
+  kintegrator->use_light_tree = false;
+  kintegrator->num_light_tree_distant = 0;
+  kintegrator->pdf_light_tree = 0.0f;
+
+  if (!scene->integrator->get_use_light_tree() || !kintegrator->use_direct_light) {
+    return;
+  }
+
+  progress.set_status("Updating Lights", "Building light tree");
+
+  scoped_timer timer;
+
+  const int num_distribution = kintegrator->num_distribution;
+  const KernelLightDistribution *distribution = dscene->light_distribution.data();
+
+  vector<Light *> enabled_lights;
+  foreach (Light *light, scene->lights) {
+    if (light->is_enabled) {
+      enabled_lights.push_back(light);
+    }
+  }
+
+  vector<LightTreeEmitter> emitters;
+  emitters.reserve(num_distribution);
+
+  uint *distant_lights = dscene->light_tree_distant_lights.alloc(enabled_lights.size() + 1);
+  uint2 *object_emitters = dscene->light_tree_object_emitters.alloc(scene->objects.size());
+  uint num_distant = 0;
+
+  Shader *last_shader = NULL;
+  float last_strength = 1.0f;
+
+  for (size_t i = 0; i < scene->objects.size(); i++) {
+    object_emitters[i] = make_uint2(0, 0);
+  }
+
+  for (int index = 0; index < num_distribution; index++) {
+    const KernelLightDistribution &kdistribution = distribution[index];
+
+    LightTreeEmitter emitter;
+    emitter.bbox = BoundBox::empty;
+    emitter.area = 0.0f;
+    emitter.distribution_index = index;
+
+    if (kdistribution.prim >= 0) {
+      /* Mesh light triangle, at the center of the shutter. */
+      const int object_id = kdistribution.mesh_light.object_id;
+      Object *object = scene->objects[object_id];
+      Mesh *mesh = static_cast<Mesh *>(object->get_geometry());
+      const int tri = kdistribution.prim - mesh->prim_offset;
+
+      if (object_emitters[object_id].y == 0) {
+        object_emitters[object_id].x = index;
+      }
+      object_emitters[object_id].y++;
+
+      Mesh::Triangle t = mesh->get_triangle(tri);
+      if (!t.valid(&mesh->get_verts()[0])) {
+        continue;
+      }
+
+      float3 p[3];
+      for (int k = 0; k < 3; k++) {
+        p[k] = mesh->get_verts()[t.v[k]];
+        if (!mesh->transform_applied) {
+          p[k] = transform_point(&object->get_tfm(), p[k]);
+        }
+        emitter.bbox.grow(p[k]);
+      }
+
+      float3 N = cross(p[1] - p[0], p[2] - p[0]);
+      const float area = 0.5f * len(N);
+      if (!(area > 0.0f)) {
+        continue;
+      }
+
+      /* Mesh lights emit on both sides, use the average emission if it's known in advance. */
+      const int shader_index = mesh->get_shader()[tri];
+      Shader *shader = (shader_index < mesh->get_used_shaders().size()) ?
+                           static_cast<Shader *>(mesh->get_used_shaders()[shader_index]) :
+                           scene->default_surface;
+      if (shader != last_shader) {
+        float3 emission;
+        last_shader = shader;
+        last_strength = (shader->is_constant_emission(&emission)) ? average(emission) : 1.0f;
+      }
+      const float strength = last_strength;
+
+      emitter.cone = LightTreeCone(N / (2.0f * area), 0.0f, M_PI_2_F, true);
+      emitter.energy = M_PI_F * area * strength;
+      emitter.area = area;
+    }
+    else {
+      Light *light = enabled_lights[~kdistribution.prim];
+      const float strength = average(light->get_strength());
+
+      if (light->light_type == LIGHT_DISTANT || light->light_type == LIGHT_BACKGROUND) {
+        distant_lights[num_distant++] = index;
+        continue;
+      }
+      else if (light->light_type == LIGHT_AREA) {
+        const float3 axisu = light->axisu * (light->sizeu * light->size);
+        const float3 axisv = light->axisv * (light->sizev * light->size);
+        for (int k = 0; k < 4; k++) {
+          emitter.bbox.grow(light->co + ((k & 1) ? 0.5f : -0.5f) * axisu +
+                            ((k & 2) ? 0.5f : -0.5f) * axisv);
+        }
+        emitter.cone = LightTreeCone(safe_normalize(light->dir), 0.0f, M_PI_2_F, false);
+        emitter.energy = M_PI_4_F * strength;
+      }
+      else {
+        emitter.bbox.grow(light->co, light->size);
+        if (light->light_type == LIGHT_SPOT) {
+          emitter.cone = LightTreeCone(
+              safe_normalize(light->dir), 0.5f * light->spot_angle, 0.0f, false);
+        }
+        else {
+          emitter.cone = LightTreeCone(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F, false);
+        }
+        emitter.energy = strength;
+      }
+    }
+
+    if (emitter.energy > 0.0f && emitter.bbox.valid()) {
+      emitters.push_back(emitter);
+    }
+  }
+
+  if (progress.get_cancel()) {
+    return;
+  }
+
+  LightTree tree(emitters);
+
+  uint *emitter_nodes = dscene->light_tree_emitter_nodes.alloc(num_distribution);
+  for (int index = 0; index < num_distribution; index++) {
+    emitter_nodes[index] = ~0u;
+  }
+
+  const size_t num_nodes = tree.num_nodes();
+  KernelLightTreeNode *knodes = dscene->light_tree_nodes.alloc((num_nodes) ? num_nodes : 1);
+  if (num_nodes) {
+    tree.pack(knodes, emitter_nodes);
+  }
+  else {
+    memset(knodes, 0, sizeof(KernelLightTreeNode));
+  }
+
+  /* Distant lights are selected with the same probability as the whole tree. */
+  const float pdf_distant = (num_nodes) ? (float)num_distant / (num_distant + 1) : 1.0f;
+
+  kintegrator->use_light_tree = true;
+  kintegrator->num_light_tree_distant = num_distant;
+  kintegrator->pdf_light_tree = 1.0f - pdf_distant;
+  kintegrator->pdf_lights = (num_distant) ? pdf_distant / num_distant : 0.0f;
+
+  dscene->light_tree_nodes.copy_to_device();
+  dscene->light_tree_emitter_nodes.copy_to_device();
+  dscene->light_tree_object_emitters.copy_to_device();
+  dscene->light_tree_distant_lights.copy_to_device();
+
+  VLOG(1) << "Light tree built with " << emitters.size() << " emitters, " << num_nodes
+          << " nodes and " << num_distant << " distant lights in " << timer.get_time()
+          << " seconds.";
+}
+
 static void background_cdf(
     int start, int end, int res_x, int res_y, const vector<float3> *pixels, float2 *cond_cdf)
 {
@@ -992,6 +1167,10 @@ void LightManager::device_update(Device *device,
   if (progress.get_cancel())
     return;
 
+  device_update_tree(device, dscene, scene, progress);
+  if (progress.get_cancel())
+    return;
+
   if (need_update_background) {
     device_update_background(device, dscene, scene, progress);
     if (progress.get_cancel())
@@ -1010,6 +1189,10 @@ void LightManager::device_free(Device *, DeviceScene *dscene, const bool free_ba
 {
   dscene->light_distribution.free();
   dscene->lights.free();
+  dscene->light_tree_nodes.free();
+  dscene->light_tree_emitter_nodes.free();
+  dscene->light_tree_object_emitters.free();
+  dscene->light_tree_distant_lights.free();
   if (free_background) {
     dscene->light_background_marginal_cdf.free();
     dscene->light_background_conditional_cdf.free();
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Cone */
+
+LightTreeCone LightTreeCone::merge(const LightTreeCone &cone_a, const LightTreeCone &cone_b)
+{
+  /* Based on "Importance Sampling of Many Lights with Adaptive Tree Splitting", with the cone
+   * with the largest spread first. */
+  const bool swap_cones = cone_a.theta_o < cone_b.theta_o;
+  const LightTreeCone &a = (swap_cones) ? cone_b : cone_a;
+  const LightTreeCone &b = (swap_cones) ? cone_a : cone_b;
+
+  const bool two_sided = a.two_sided || b.two_sided;
+  const float theta_e = max(a.theta_e, b.theta_e);
+
+  /* Two sided cones can be flipped to be closer to the other cone. */
+  float3 b_axis = b.axis;
+  if (two_sided && dot(a.axis, b_axis) < 0.0f) {
+    b_axis = -b_axis;
+  }
+
+  const float theta_d = safe_acosf(dot(a.axis, b_axis));
+
+  if (min(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+    return LightTreeCone(a.axis, a.theta_o, theta_e, two_sided);
+  }
+
+  const float theta_o = 0.5f * (a.theta_o + theta_d + b.theta_o);
+  if (theta_o >= M_PI_F) {
+    return LightTreeCone(a.axis, M_PI_F, theta_e, two_sided);
+  }
+
+  /* Rotate the axis of a towards b. */
+  const float theta_r = theta_o - a.theta_o;
+  float3 ortho = b_axis - dot(a.axis, b_axis) * a.axis;
+  if (len_squared(ortho) < 1e-12f) {
+    /* Opposite axes, any rotation works. */
+    float3 unused;
+    make_orthonormals(a.axis, &ortho, &unused);
+  }
+  else {
+    ortho = normalize(ortho);
+  }
+
+  const float3 axis = normalize(cosf(theta_r) * a.axis + sinf(theta_r) * ortho);
+  return LightTreeCone(axis, theta_o, theta_e, two_sided);
+}
+
+float LightTreeCone::measure() const
+{
+  /* Integral of the cosine weighted solid angle of the cone. */
+  const float theta_w = min(theta_o + theta_e, M_PI_F);
+  const float cos_o = cosf(theta_o);
+  const float sin_o = sinf(theta_o);
+  const float measure = M_2PI_F * (1.0f - cos_o) +
+                        M_PI_2_F * (2.0f * theta_w * sin_o - cosf(theta_o - 2.0f * theta_w) -
+                                    2.0f * theta_o * sin_o + cos_o);
+  return (two_sided) ? 2.0f * measure : measure;
+}
+
+/* Tree */
+
+namespace {
+
+/* Bounds accumulated while building. */
+struct LightTreeBounds {
+  BoundBox bbox;
+  BoundBox centroid_bbox;
+  LightTreeCone cone;
+  float energy;
+  int count;
+
+  LightTreeBounds()
+      : bbox(BoundBox::empty), centroid_bbox(BoundBox::empty), energy(0.0f), count(0)
+  {
+  }
+
+  void add(const LightTreeEmitter &emitter)
+  {
+    bbox.grow(emitter.bbox);
+    centroid_bbox.grow(emitter.centroid());
+    cone = (count == 0) ? emitter.cone : LightTreeCone::merge(cone, emitter.cone);
+    energy += emitter.energy;
+    count++;
+  }
+
+  void add(const LightTreeBounds &other)
+  {
+    if (other.count == 0) {
+      return;
+    }
+    bbox.grow(other.bbox);
+    centroid_bbox.grow(other.centroid_bbox);
+    cone = (count == 0) ? other.cone : LightTreeCone::merge(cone, other.cone);
+    energy += other.energy;
+    count += other.count;
+  }
+
+  /* Surface area orientation heuristic. */
+  float cost() const
+  {
+    return energy * cone.measure() * bbox.safe_area();
+  }
+};
+
+}  // namespace
+
+static const int LIGHT_TREE_NUM_BUCKETS = 12;
+
+static int light_tree_bucket(const LightTreeEmitter &emitter,
+                             const BoundBox &centroid_bbox,
+                             const int dim)
+{
+  const float extent = centroid_bbox.max[dim] - centroid_bbox.min[dim];
+  const float t = (emitter.centroid()[dim] - centroid_bbox.min[dim]) / extent;
+  return clamp((int)(t * LIGHT_TREE_NUM_BUCKETS), 0, LIGHT_TREE_NUM_BUCKETS - 1);
+}
+
+LightTree::LightTree(vector<LightTreeEmitter> &emitters) : emitters(emitters)
+{
+  if (emitters.empty()) {
+    return;
+  }
+
+  nodes.reserve(2 * emitters.size() - 1);
+
+  /* Build depth first with an explicit stack, pushing the right range before the left range
+   * so that the left child is built next and directly follows its parent. */
+  vector<BuildRange> stack;
+  stack.push_back({0, (int)emitters.size(), -1, -1});
+
+  while (!stack.empty()) {
+    const BuildRange range = stack.back();
+    stack.pop_back();
+
+    const int index = (int)nodes.size();
+    if (range.right_of != -1) {
+      nodes[range.right_of].right_child = index;
+    }
+
+    LightTreeBounds bounds;
+    for (int i = range.begin; i < range.end; i++) {
+      bounds.add(emitters[i]);
+    }
+
+    Node node;
+    node.bbox = bounds.bbox;
+    node.cone = bounds.cone;
+    node.energy = bounds.energy;
+    node.parent = range.parent;
+    node.right_child = -1;
+    node.emitter = -1;
+
+    if (range.end - range.begin == 1) {
+      node.emitter = range.begin;
+      nodes.push_back(node);
+      continue;
+    }
+
+    nodes.push_back(node);
+
+    const int middle = split(range.begin, range.end, bounds.centroid_bbox);
+    stack.push_back({middle, range.end, index, index});
+    stack.push_back({range.begin, middle, index, -1});
+  }
+}
+
+int LightTree::split(int begin, int end, const BoundBox &centroid_bbox)
+{
+  const float3 extent = centroid_bbox.size();
+  const float max_extent = max3(extent);
+
+  float best_cost = FLT_MAX;
+  int best_dim = -1;
+  int best_bucket = 0;
+
+  for (int dim = 0; dim < 3; dim++) {
+    if (!(extent[dim] > 0.0f)) {
+      continue;
+    }
+
+    LightTreeBounds buckets[LIGHT_TREE_NUM_BUCKETS];
+    for (int i = begin; i < end; i++) {
+      buckets[light_tree_bucket(emitters[i], centroid_bbox, dim)].add(emitters[i]);
+    }
+
+    /* Sweep from the right to get the cost of all right sides. */
+    float right_cost[LIGHT_TREE_NUM_BUCKETS];
+    LightTreeBounds right;
+    for (int b = LIGHT_TREE_NUM_BUCKETS - 1; b > 0; b--) {
+      right.add(buckets[b]);
+      right_cost[b] = (right.count) ? right.cost() : 0.0f;
+    }
+
+    /* Penalize splitting along short axes, to avoid thin clusters. */
+    const float regularization = max_extent / extent[dim];
+
+    LightTreeBounds left;
+    for (int b = 1; b < LIGHT_TREE_NUM_BUCKETS; b++) {
+      left.add(buckets[b - 1]);
+      if (left.count == 0 || left.count == end - begin) {
+        continue;
+      }
+
+      const float cost = regularization * (left.cost() + right_cost[b]);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_dim = dim;
+        best_bucket = b;
+      }
+    }
+  }
+
+  int middle = begin;
+
+  if (best_dim != -1) {
+    const BoundBox &bbox = centroid_bbox;
+    const int dim = best_dim;
+    const int bucket = best_bucket;
+    middle = (int)(std::partition(emitters.begin() + begin,
+                                  emitters.begin() + end,
+                                  [&](const LightTreeEmitter &emitter) {
+                                    return light_tree_bucket(emitter, bbox, dim) < bucket;
+                                  }) -
+                   emitters.begin());
+  }
+
+  /* Emitters with identical centroids, split in the middle. */
+  if (middle == begin || middle == end) {
+    middle = (begin + end) / 2;
+  }
+
+  return middle;
+}
+
+void LightTree::pack(KernelLightTreeNode *knodes, uint *emitter_nodes) const
+{
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const Node &node = nodes[i];
+    KernelLightTreeNode &knode = knodes[i];
+
+    knode.bbox_min[0] = node.bbox.min.x;
+    knode.bbox_min[1] = node.bbox.min.y;
+    knode.bbox_min[2] = node.bbox.min.z;
+    knode.bbox_max[0] = node.bbox.max.x;
+    knode.bbox_max[1] = node.bbox.max.y;
+    knode.bbox_max[2] = node.bbox.max.z;
+    knode.axis[0] = node.cone.axis.x;
+    knode.axis[1] = node.cone.axis.y;
+    knode.axis[2] = node.cone.axis.z;
+    knode.theta_o = node.cone.theta_o;
+    knode.theta_e = node.cone.theta_e;
+    knode.energy = node.energy;
+    knode.parent = node.parent;
+    knode.two_sided = node.cone.two_sided;
+
+    if (node.emitter != -1) {
+      const LightTreeEmitter &emitter = emitters[node.emitter];
+      knode.child = ~emitter.distribution_index;
+      knode.area = emitter.area;
+      emitter_nodes[emitter.distribution_index] = (uint)i;
+    }
+    else {
+      knode.child = node.right_child;
+      knode.area = 0.0f;
+    }
+  }
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Orientation bounds of a cluster of emitters. All emitters emit into directions within
+ * theta_o + theta_e of the axis. Two sided cones emit around both axis and -axis. */
+struct LightTreeCone {
+  float3 axis;
+  float theta_o;
+  float theta_e;
+  bool two_sided;
+
+  LightTreeCone()
+      : axis(make_float3(0.0f, 0.0f, 1.0f)), theta_o(0.0f), theta_e(0.0f), two_sided(false)
+  {
+  }
+
+  LightTreeCone(const float3 &axis, float theta_o, float theta_e, bool two_sided)
+      : axis(axis), theta_o(theta_o), theta_e(theta_e), two_sided(two_sided)
+  {
+  }
+
+  /* Smallest cone containing both cones. */
+  static LightTreeCone merge(const LightTreeCone &a, const LightTreeCone &b);
+
+  /* Orientation measure used by the split heuristic. */
+  float measure() const;
+};
+
+/* Emitter in the tree, a mesh light triangle or a lamp that is not distant. */
+struct LightTreeEmitter {
+  BoundBox bbox;
+  LightTreeCone cone;
+  /* Estimate of the emitted power. */
+  float energy;
+  /* Area of triangles, for converting the selection probability to a density over the area. */
+  float area;
+  /* Index of the emitter in the light distribution. */
+  int distribution_index;
+
+  float3 centroid() const
+  {
+    return bbox.center();
+  }
+};
+
+/* Light Tree
+ *
+ * Bounding volume hierarchy over emitters with one emitter per leaf, built top down with the
+ * surface area orientation heuristic. Nodes are stored depth first, so that the left child of
+ * an inner node directly follows its parent. */
+class LightTree {
+ public:
+  explicit LightTree(vector<LightTreeEmitter> &emitters);
+
+  size_t num_nodes() const
+  {
+    return nodes.size();
+  }
+
+  /* Fill kernel nodes, and the leaf node index for each light distribution index. */
+  void pack(KernelLightTreeNode *knodes, uint *emitter_nodes) const;
+
+ protected:
+  struct Node {
+    BoundBox bbox;
+    LightTreeCone cone;
+    float energy;
+    int parent;
+    /* Right child for inner nodes, -1 for leaves. */
+    int right_child;
+    /* Emitter index for leaves. */
+    int emitter;
+  };
+
+  struct BuildRange {
+    int begin, end;
+    int parent;
+    /* Node whose right child must be set to the node built for this range, or -1. */
+    int right_of;
+  };
+
+  int split(int begin, int end, const BoundBox &centroid_bbox);
+
+  vector<LightTreeEmitter> &emitters;
+  vector<Node> nodes;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
@@ -155,6 +155,7 @@ NODE_DEFINE(Mesh)
   SOCKET_FLOAT(subd_dicing_rate, "Subdivision Dicing Rate", 0.0f)
   SOCKET_INT(subd_max_level, "Subdivision Dicing Rate", 0);
   SOCKET_TRANSFORM(subd_objecttoworld, "Subdivision Object Transform", transform_identity());
+  SOCKET_FLOAT(subd_dicing_reuse_tolerance, "Subdivision Dicing Reuse Tolerance", 0.0f);
 
   return type;
 }
@@ -172,6 +173,7 @@ SubdParams *Mesh::get_subd_params()
   subd_params->dicing_rate = subd_dicing_rate;
   subd_params->max_level = subd_max_level;
   subd_params->objecttoworld = subd_objecttoworld;
+  subd_params->reuse_tolerance = subd_dicing_reuse_tolerance;
 
   return subd_params;
 }
@@ -210,6 +212,7 @@ Mesh::~Mesh()
 {
   delete patch_table;
   delete subd_params;
+  delete subd_diced_topology;
 }
 
 void Mesh::resize_mesh(int numverts, int numtris)
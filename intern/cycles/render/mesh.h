@@ -46,6 +46,7 @@ class Scene;
 class SceneParams;
 class AttributeRequest;
 struct SubdParams;
+struct SubdDicedTopology;
 class DiagSplit;
 struct PackedPatchTable;
 
@@ -164,6 +165,9 @@ class Mesh : public Geometry {
   NODE_SOCKET_API(float, subd_dicing_rate)
   NODE_SOCKET_API(int, subd_max_level)
   NODE_SOCKET_API(Transform, subd_objecttoworld)
+  /* Relative change in screen size of the mesh up to which the diced topology of the previous
+   * tessellation is reused, zero to always dice again. */
+  NODE_SOCKET_API(float, subd_dicing_reuse_tolerance)
 
   AttributeSet subd_attributes;
 
@@ -193,6 +197,7 @@ class Mesh : public Geometry {
   friend class ObjectManager;
 
   SubdParams *subd_params = nullptr;
+  SubdDicedTopology *subd_diced_topology = nullptr;
 
  public:
   /* Functions */
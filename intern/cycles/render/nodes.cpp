@@ -31,6 +31,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_md5.h"
 #include "util/util_transform.h"
 
 #include "kernel/svm/svm_color_util.h"
@@ -206,6 +207,32 @@ void TextureMapping::compile(OSLCompiler &compiler)
   }
 }
 
+/* Image Slot Texture */
+
+static void image_handle_hash(ImageHandle &handle, MD5Hash &md5)
+{
+  const int num_tiles = handle.num_tiles();
+  md5.append((uint8_t *)&num_tiles, sizeof(num_tiles));
+
+  for (int i = 0; i < num_tiles; i++) {
+    const int slot = handle.svm_slot(i);
+    md5.append((uint8_t *)&slot, sizeof(slot));
+  }
+
+  if (num_tiles) {
+    /* Metadata can change when the image is reloaded into the same slot. */
+    const ImageMetaData metadata = handle.metadata();
+    const int compress_as_srgb = metadata.compress_as_srgb;
+    md5.append((uint8_t *)&compress_as_srgb, sizeof(compress_as_srgb));
+    md5.append(metadata.colorspace.string());
+  }
+}
+
+void ImageSlotTextureNode::hash_compile_state(MD5Hash &md5)
+{
+  image_handle_hash(handle, md5);
+}
+
 /* Image Texture */
 
 NODE_DEFINE(ImageTextureNode)
@@ -251,6 +278,9 @@ NODE_DEFINE(ImageTextureNode)
   SOCKET_BOOLEAN(animated, "Animated", false);
 
   SOCKET_IN_POINT(vector, "Vector", zero_float3(), SocketType::LINK_TEXTURE_UV);
+  /* Texture coordinates at positions shifted by ray differentials, for the texture cache. */
+  SOCKET_IN_POINT(vector_dx, "Vector_dx", zero_float3(), SocketType::SVM_INTERNAL);
+  SOCKET_IN_POINT(vector_dy, "Vector_dy", zero_float3(), SocketType::SVM_INTERNAL);
 
   SOCKET_OUT_COLOR(color, "Color");
   SOCKET_OUT_FLOAT(alpha, "Alpha");
@@ -394,6 +424,16 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
   }
 
   if (projection != NODE_IMAGE_PROJ_BOX) {
+    /* Texture coordinate differentials, only linked when using the texture cache. */
+    ShaderInput *vector_dx_in = input("Vector_dx");
+    ShaderInput *vector_dy_in = input("Vector_dy");
+    int vector_dx_offset = SVM_STACK_INVALID;
+    int vector_dy_offset = SVM_STACK_INVALID;
+    if (vector_dx_in->link && vector_dy_in->link) {
+      vector_dx_offset = tex_mapping.compile_begin(compiler, vector_dx_in);
+      vector_dy_offset = tex_mapping.compile_begin(compiler, vector_dy_in);
+    }
+
     /* If there only is one image (a very common case), we encode it as a negative value. */
     int num_nodes;
     if (handle.num_tiles() == 1) {
@@ -409,7 +449,7 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
                                              compiler.stack_assign_if_linked(color_out),
                                              compiler.stack_assign_if_linked(alpha_out),
                                              flags),
-                      projection);
+                      compiler.encode_uchar4(projection, vector_dx_offset, vector_dy_offset));
 
     if (num_nodes > 0) {
       for (int i = 0; i < num_nodes; i++) {
@@ -427,6 +467,11 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
         compiler.add_node(node.x, node.y, node.z, node.w);
       }
     }
+
+    if (vector_dx_offset != SVM_STACK_INVALID) {
+      tex_mapping.compile_end(compiler, vector_dy_in, vector_dy_offset);
+      tex_mapping.compile_end(compiler, vector_dx_in, vector_dx_offset);
+    }
   }
   else {
     assert(handle.num_tiles() == 1);
@@ -822,6 +867,11 @@ SkyTextureNode::SkyTextureNode() : TextureNode(get_node_type())
 {
 }
 
+void SkyTextureNode::hash_compile_state(MD5Hash &md5)
+{
+  image_handle_hash(handle, md5);
+}
+
 void SkyTextureNode::compile(SVMCompiler &compiler)
 {
   ShaderInput *vector_in = input("Vector");
@@ -1252,6 +1302,11 @@ IESLightNode::~IESLightNode()
   }
 }
 
+void IESLightNode::hash_compile_state(MD5Hash &md5)
+{
+  md5.append((uint8_t *)&slot, sizeof(slot));
+}
+
 void IESLightNode::get_slot()
 {
   assert(light_manager);
@@ -1796,6 +1851,11 @@ void PointDensityTextureNode::attributes(Shader *shader, AttributeRequestSet *at
   ShaderNode::attributes(shader, attributes);
 }
 
+void PointDensityTextureNode::hash_compile_state(MD5Hash &md5)
+{
+  image_handle_hash(handle, md5);
+}
+
 ImageParams PointDensityTextureNode::image_params() const
 {
   ImageParams params;
@@ -5937,6 +5997,12 @@ OutputAOVNode::OutputAOVNode() : ShaderNode(get_node_type())
   offset = -1;
 }
 
+void OutputAOVNode::hash_compile_state(MD5Hash &md5)
+{
+  const int state[2] = {offset, is_color};
+  md5.append((uint8_t *)state, sizeof(state));
+}
+
 void OutputAOVNode::simplify_settings(Scene *scene)
 {
   offset = scene->film->get_aov_offset(scene, name.string(), is_color);
@@ -97,6 +97,8 @@ class ImageSlotTextureNode : public TextureNode {
     return TextureNode::equals(other) && handle == other_node.handle;
   }
 
+  virtual void hash_compile_state(MD5Hash &md5);
+
   ImageHandle handle;
 };
 
@@ -128,6 +130,8 @@ class ImageTextureNode : public ImageSlotTextureNode {
   NODE_SOCKET_API(float, projection_blend)
   NODE_SOCKET_API(bool, animated)
   NODE_SOCKET_API(float3, vector)
+  NODE_SOCKET_API(float3, vector_dx)
+  NODE_SOCKET_API(float3, vector_dy)
   NODE_SOCKET_API_ARRAY(array<int>, tiles)
 
  protected:
@@ -182,6 +186,8 @@ class SkyTextureNode : public TextureNode {
   NODE_SOCKET_API(float3, vector)
   ImageHandle handle;
 
+  virtual void hash_compile_state(MD5Hash &md5);
+
   float get_sun_size()
   {
     /* Clamping for numerical precision. */
@@ -221,6 +227,8 @@ class OutputAOVNode : public ShaderNode {
     return false;
   }
 
+  virtual void hash_compile_state(MD5Hash &md5);
+
   int offset;
   bool is_color;
 };
@@ -382,6 +390,8 @@ class PointDensityTextureNode : public ShaderNode {
     const PointDensityTextureNode &other_node = (const PointDensityTextureNode &)other;
     return ShaderNode::equals(other) && handle == other_node.handle;
   }
+
+  virtual void hash_compile_state(MD5Hash &md5);
 };
 
 class IESLightNode : public TextureNode {
@@ -397,6 +407,8 @@ class IESLightNode : public TextureNode {
   NODE_SOCKET_API(float, strength)
   NODE_SOCKET_API(float3, vector)
 
+  virtual void hash_compile_state(MD5Hash &md5);
+
  private:
   LightManager *light_manager;
   int slot;
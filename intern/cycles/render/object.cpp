@@ -427,8 +427,6 @@ void ObjectManager::device_update_object_transform(UpdateObjectTransformState *s
   Transform tfm = ob->tfm;
   Transform itfm = transform_inverse(tfm);
 
-  float3 color = ob->color;
-  float pass_id = ob->pass_id;
   float random_number = (float)ob->random_id * (1.0f / (float)0xFFFFFFFF);
   int particle_index = (ob->particle_system) ?
                            ob->particle_index + state->particle_offset[ob->particle_system] :
@@ -437,14 +435,9 @@ void ObjectManager::device_update_object_transform(UpdateObjectTransformState *s
   kobject.tfm = tfm;
   kobject.itfm = itfm;
   kobject.volume_density = object_volume_density(tfm, geom);
-  kobject.color[0] = color.x;
-  kobject.color[1] = color.y;
-  kobject.color[2] = color.z;
-  kobject.pass_id = pass_id;
   kobject.random_number = random_number;
   kobject.particle_index = particle_index;
   kobject.motion_offset = 0;
-  kobject.ao_distance = ob->ao_distance;
 
   if (geom->get_use_motion_blur()) {
     state->have_motion = true;
@@ -500,37 +493,22 @@ void ObjectManager::device_update_object_transform(UpdateObjectTransformState *s
     }
   }
 
-  /* Dupli object coords and motion info. */
+  /* Dupli object coords. */
   kobject.dupli_generated[0] = ob->dupli_generated[0];
   kobject.dupli_generated[1] = ob->dupli_generated[1];
   kobject.dupli_generated[2] = ob->dupli_generated[2];
-  kobject.numkeys = (geom->geometry_type == Geometry::HAIR) ?
-                        static_cast<Hair *>(geom)->get_curve_keys().size() :
-                        0;
   kobject.dupli_uv[0] = ob->dupli_uv[0];
   kobject.dupli_uv[1] = ob->dupli_uv[1];
-  int totalsteps = geom->get_motion_steps();
-  kobject.numsteps = (totalsteps - 1) / 2;
-  kobject.numverts = (geom->geometry_type == Geometry::MESH ||
-                      geom->geometry_type == Geometry::VOLUME) ?
-                         static_cast<Mesh *>(geom)->get_verts().size() :
-                         0;
-  kobject.patch_map_offset = 0;
   kobject.attribute_map_offset = 0;
 
-  if (ob->asset_name_is_modified() || update_all) {
-    uint32_t hash_name = util_murmur_hash3(ob->name.c_str(), ob->name.length(), 0);
-    uint32_t hash_asset = util_murmur_hash3(ob->asset_name.c_str(), ob->asset_name.length(), 0);
-    kobject.cryptomatte_object = util_hash_to_float(hash_name);
-    kobject.cryptomatte_asset = util_hash_to_float(hash_asset);
-  }
+  kobject.visibility = ob->visibility_for_tracing();
+  kobject.prototype = 0;
 
+  kobject.primitive_type = geom->primitive_type();
   kobject.shadow_terminator_shading_offset = 1.0f /
                                              (1.0f - 0.5f * ob->shadow_terminator_shading_offset);
   kobject.shadow_terminator_geometry_offset = ob->shadow_terminator_geometry_offset;
-
-  kobject.visibility = ob->visibility_for_tracing();
-  kobject.primitive_type = geom->primitive_type();
+  kobject.pad1 = 0;
 
   /* Object flag. */
   if (ob->use_holdout) {
@@ -545,6 +523,138 @@ void ObjectManager::device_update_object_transform(UpdateObjectTransformState *s
   }
 }
 
+/* Settings stored in KernelObjectPrototype. Objects with the same key share the prototype, which
+ * for scattered instances means only one prototype for each instanced object. */
+
+struct ObjectPrototypeKey {
+  const Geometry *geometry;
+  ustring name;
+  ustring asset_name;
+  float3 color;
+  int pass_id;
+  float ao_distance;
+
+  explicit ObjectPrototypeKey(const Object *ob)
+      : geometry(ob->get_geometry()),
+        name(ob->name),
+        asset_name(ob->get_asset_name()),
+        color(ob->get_color()),
+        pass_id(ob->get_pass_id()),
+        ao_distance(ob->get_ao_distance())
+  {
+  }
+
+  bool operator==(const ObjectPrototypeKey &other) const
+  {
+    return geometry == other.geometry && name == other.name && asset_name == other.asset_name &&
+           color == other.color && pass_id == other.pass_id && ao_distance == other.ao_distance;
+  }
+};
+
+struct ObjectPrototypeKeyHash {
+  size_t operator()(const ObjectPrototypeKey &key) const
+  {
+    /* Strings are unique, so hashing their pointers is enough. */
+    const std::hash<const void *> hash;
+    return hash(key.geometry) ^ (hash(key.name.c_str()) * 31) ^
+           (hash(key.asset_name.c_str()) * 961);
+  }
+};
+
+static KernelObjectPrototype object_prototype(const Object *ob)
+{
+  const Geometry *geom = ob->get_geometry();
+  KernelObjectPrototype kprototype;
+
+  const float3 color = ob->get_color();
+  kprototype.color[0] = color.x;
+  kprototype.color[1] = color.y;
+  kprototype.color[2] = color.z;
+  kprototype.pass_id = ob->get_pass_id();
+
+  /* Motion info. */
+  kprototype.numkeys = (geom->geometry_type == Geometry::HAIR) ?
+                           static_cast<const Hair *>(geom)->get_curve_keys().size() :
+                           0;
+  kprototype.numsteps = (geom->get_motion_steps() - 1) / 2;
+  kprototype.numverts = (geom->geometry_type == Geometry::MESH ||
+                         geom->geometry_type == Geometry::VOLUME) ?
+                            static_cast<const Mesh *>(geom)->get_verts().size() :
+                            0;
+  kprototype.patch_map_offset = 0;
+
+  const ustring asset_name = ob->get_asset_name();
+  uint32_t hash_name = util_murmur_hash3(ob->name.c_str(), ob->name.length(), 0);
+  uint32_t hash_asset = util_murmur_hash3(asset_name.c_str(), asset_name.length(), 0);
+  kprototype.cryptomatte_object = util_hash_to_float(hash_name);
+  kprototype.cryptomatte_asset = util_hash_to_float(hash_asset);
+
+  kprototype.ao_distance = ob->get_ao_distance();
+  kprototype.volume_occupancy = -1;
+
+  return kprototype;
+}
+
+/* Compare the settings from object_prototype(), the patch map and volume occupancy are set after
+ * geometry is updated. */
+static bool object_prototype_settings_equal(const KernelObjectPrototype &a,
+                                            const KernelObjectPrototype &b)
+{
+  KernelObjectPrototype a_settings = a;
+  a_settings.patch_map_offset = b.patch_map_offset;
+  a_settings.volume_occupancy = b.volume_occupancy;
+  return memcmp(&a_settings, &b, sizeof(KernelObjectPrototype)) == 0;
+}
+
+void ObjectManager::device_update_prototypes(DeviceScene *dscene, Scene *scene)
+{
+  KernelObject *kobjects = dscene->objects.data();
+  vector<KernelObjectPrototype> prototypes;
+  unordered_map<ObjectPrototypeKey, int, ObjectPrototypeKeyHash> prototype_index;
+
+  /* Instances of the same object are usually next to each other, check the previous object
+   * first to avoid most of the hash map lookups. */
+  const Object *prev_ob = NULL;
+  int prev_index = 0;
+
+  foreach (Object *ob, scene->objects) {
+    if (prev_ob && ObjectPrototypeKey(ob) == ObjectPrototypeKey(prev_ob)) {
+      kobjects[ob->index].prototype = prev_index;
+      continue;
+    }
+
+    auto it = prototype_index.find(ObjectPrototypeKey(ob));
+    if (it == prototype_index.end()) {
+      it = prototype_index.emplace(ObjectPrototypeKey(ob), (int)prototypes.size()).first;
+      prototypes.push_back(object_prototype(ob));
+    }
+
+    kobjects[ob->index].prototype = it->second;
+    prev_ob = ob;
+    prev_index = it->second;
+  }
+
+  VLOG(1) << "Total " << prototypes.size() << " object prototypes for " << scene->objects.size()
+          << " objects.";
+
+  /* Prototypes only change when object settings or geometry change, not when objects are moved,
+   * so keep the device copy when they are the same. */
+  if (dscene->object_prototypes.size() == prototypes.size()) {
+    const KernelObjectPrototype *kprototypes = dscene->object_prototypes.data();
+    bool modified = false;
+    for (size_t i = 0; i < prototypes.size() && !modified; i++) {
+      modified = !object_prototype_settings_equal(prototypes[i], kprototypes[i]);
+    }
+    if (!modified) {
+      return;
+    }
+  }
+
+  KernelObjectPrototype *kprototypes = dscene->object_prototypes.alloc(prototypes.size());
+  std::copy(prototypes.begin(), prototypes.end(), kprototypes);
+  dscene->object_prototypes.tag_modified();
+}
+
 void ObjectManager::device_update_transforms(DeviceScene *dscene, Scene *scene, Progress &progress)
 {
   UpdateObjectTransformState state;
@@ -608,7 +718,10 @@ void ObjectManager::device_update_transforms(DeviceScene *dscene, Scene *scene,
     return;
   }
 
+  device_update_prototypes(dscene, scene);
+
   dscene->objects.copy_to_device_if_modified();
+  dscene->object_prototypes.copy_to_device_if_modified();
   if (state.need_motion == Scene::MOTION_PASS) {
     dscene->object_motion_pass.copy_to_device();
   }
@@ -620,6 +733,7 @@ void ObjectManager::device_update_transforms(DeviceScene *dscene, Scene *scene,
   dscene->data.bvh.have_curves = state.have_curves;
 
   dscene->objects.clear_modified();
+  dscene->object_prototypes.clear_modified();
   dscene->object_motion_pass.clear_modified();
   dscene->object_motion.clear_modified();
 }
@@ -634,6 +748,7 @@ void ObjectManager::device_update(Device *device,
 
   if (update_flags & (OBJECT_ADDED | OBJECT_REMOVED)) {
     dscene->objects.tag_realloc();
+    dscene->object_prototypes.tag_realloc();
     dscene->object_motion_pass.tag_realloc();
     dscene->object_motion.tag_realloc();
     dscene->object_flag.tag_realloc();
@@ -808,8 +923,10 @@ void ObjectManager::device_update_mesh_offsets(Device *, DeviceScene *dscene, Sc
   }
 
   KernelObject *kobjects = dscene->objects.data();
+  KernelObjectPrototype *kprototypes = dscene->object_prototypes.data();
 
   bool update = false;
+  bool update_prototypes = false;
 
   foreach (Object *object, scene->objects) {
     Geometry *geom = object->geometry;
@@ -821,12 +938,22 @@ void ObjectManager::device_update_mesh_offsets(Device *, DeviceScene *dscene, Sc
                                      mesh->patch_table->num_nodes * PATCH_NODE_SIZE) -
                                 mesh->patch_offset;
 
-        if (kobjects[object->index].patch_map_offset != patch_map_offset) {
-          kobjects[object->index].patch_map_offset = patch_map_offset;
-          update = true;
+        KernelObjectPrototype &kprototype = kprototypes[kobjects[object->index].prototype];
+        if (kprototype.patch_map_offset != patch_map_offset) {
+          kprototype.patch_map_offset = patch_map_offset;
+          update_prototypes = true;
         }
       }
     }
+    else if (geom->geometry_type == Geometry::VOLUME) {
+      Volume *volume = static_cast<Volume *>(geom);
+
+      KernelObjectPrototype &kprototype = kprototypes[kobjects[object->index].prototype];
+      if (kprototype.volume_occupancy != volume->occupancy_index) {
+        kprototype.volume_occupancy = volume->occupancy_index;
+        update_prototypes = true;
+      }
+    }
 
     size_t attr_map_offset = object->attr_map_offset;
 
@@ -844,11 +971,15 @@ void ObjectManager::device_update_mesh_offsets(Device *, DeviceScene *dscene, Sc
   if (update) {
     dscene->objects.copy_to_device();
   }
+  if (update_prototypes) {
+    dscene->object_prototypes.copy_to_device();
+  }
 }
 
 void ObjectManager::device_free(Device *, DeviceScene *dscene, bool force_free)
 {
   dscene->objects.free_if_need_realloc(force_free);
+  dscene->object_prototypes.free_if_need_realloc(force_free);
   dscene->object_motion_pass.free_if_need_realloc(force_free);
   dscene->object_motion.free_if_need_realloc(force_free);
   dscene->object_flag.free_if_need_realloc(force_free);
@@ -861,19 +992,14 @@ void ObjectManager::apply_static_transforms(DeviceScene *dscene, Scene *scene, P
   /* todo: create objects/geometry in right order! */
 
   /* counter geometry users */
-  map<Geometry *, int> geometry_users;
+  unordered_map<Geometry *, int> geometry_users;
   Scene::MotionType need_motion = scene->need_motion();
   bool motion_blur = need_motion == Scene::MOTION_BLUR;
   bool apply_to_motion = need_motion != Scene::MOTION_PASS;
   int i = 0;
 
   foreach (Object *object, scene->objects) {
-    map<Geometry *, int>::iterator it = geometry_users.find(object->geometry);
-
-    if (it == geometry_users.end())
-      geometry_users[object->geometry] = 1;
-    else
-      it->second++;
+    geometry_users[object->geometry]++;
   }
 
   if (progress.get_cancel())
@@ -994,4 +1120,56 @@ string ObjectManager::get_cryptomatte_assets(Scene *scene)
   return manifest;
 }
 
+void ObjectManager::collect_memory_statistics(Scene *scene, MemoryStats *stats)
+{
+  DeviceScene &dscene = scene->dscene;
+
+  /* Size of the device arrays with an element for every object. */
+  const size_t num_kernel_objects = dscene.objects.size();
+  const size_t kernel_object_size = (num_kernel_objects) ?
+                                        (dscene.objects.memory_size() +
+                                         dscene.object_flag.memory_size() +
+                                         dscene.object_volume_step.memory_size() +
+                                         dscene.object_motion_pass.memory_size()) /
+                                            num_kernel_objects :
+                                        0;
+
+  /* Prototypes are shared between instances, each instance counts its share. */
+  const size_t num_prototypes = dscene.object_prototypes.size();
+  vector<int> prototype_users(num_prototypes, 0);
+  for (size_t i = 0; i < num_kernel_objects; i++) {
+    const int prototype = dscene.objects.data()[i].prototype;
+    if (prototype >= 0 && (size_t)prototype < num_prototypes) {
+      prototype_users[prototype]++;
+    }
+  }
+
+  /* Geometry memory is shared between instances and reported separately. */
+  foreach (Object *ob, scene->objects) {
+    const Geometry *geom = ob->get_geometry();
+    NamedMemoryEntry entry(ob->name.string(),
+                           (geom) ? "geometry " + geom->name.string() : string());
+
+    entry.add_part("settings", ob->get_total_size_in_bytes());
+    entry.add_part("attributes", ob->attributes.size() * sizeof(ParamValue));
+
+    if (ob->index >= 0 && (size_t)ob->index < num_kernel_objects) {
+      entry.add_part("kernel object", kernel_object_size);
+
+      const int prototype = dscene.objects.data()[ob->index].prototype;
+      if (prototype >= 0 && (size_t)prototype < num_prototypes) {
+        entry.add_part("kernel prototype",
+                       sizeof(KernelObjectPrototype) / prototype_users[prototype]);
+      }
+    }
+
+    /* Motion is only stored in the device array when rendering motion blur. */
+    if (dscene.object_motion.size()) {
+      entry.add_part("kernel motion", ob->get_motion().size() * sizeof(DecomposedTransform));
+    }
+
+    stats->objects.push_back(entry);
+  }
+}
+
 CCL_NAMESPACE_END
@@ -38,6 +38,7 @@ CCL_NAMESPACE_BEGIN
 class Device;
 class DeviceScene;
 class Geometry;
+class MemoryStats;
 class ParticleSystem;
 class Progress;
 class Scene;
@@ -178,11 +179,14 @@ class ObjectManager {
   string get_cryptomatte_objects(Scene *scene);
   string get_cryptomatte_assets(Scene *scene);
 
+  void collect_memory_statistics(Scene *scene, MemoryStats *stats);
+
  protected:
   void device_update_object_transform(UpdateObjectTransformState *state,
                                       Object *ob,
                                       bool update_all);
   void device_update_object_transform_task(UpdateObjectTransformState *state);
+  void device_update_prototypes(DeviceScene *dscene, Scene *scene);
   bool device_update_object_transform_pop_work(UpdateObjectTransformState *state,
                                                int *start_index,
                                                int *num_objects);
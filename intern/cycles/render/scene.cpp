@@ -62,13 +62,18 @@ DeviceScene::DeviceScene(Device *device)
       tri_patch_uv(device, "__tri_patch_uv", MEM_GLOBAL),
       curves(device, "__curves", MEM_GLOBAL),
       curve_keys(device, "__curve_keys", MEM_GLOBAL),
+      curve_keys_quantized(device, "__curve_keys_quantized", MEM_GLOBAL),
+      curve_key_bounds(device, "__curve_key_bounds", MEM_GLOBAL),
       curve_segments(device, "__curve_segments", MEM_GLOBAL),
       patches(device, "__patches", MEM_GLOBAL),
       objects(device, "__objects", MEM_GLOBAL),
+      object_prototypes(device, "__object_prototypes", MEM_GLOBAL),
       object_motion_pass(device, "__object_motion_pass", MEM_GLOBAL),
       object_motion(device, "__object_motion", MEM_GLOBAL),
       object_flag(device, "__object_flag", MEM_GLOBAL),
       object_volume_step(device, "__object_volume_step", MEM_GLOBAL),
+      volume_occupancy(device, "__volume_occupancy", MEM_GLOBAL),
+      volume_occupancy_cells(device, "__volume_occupancy_cells", MEM_GLOBAL),
       camera_motion(device, "__camera_motion", MEM_GLOBAL),
       attributes_map(device, "__attributes_map", MEM_GLOBAL),
       attributes_float(device, "__attributes_float", MEM_GLOBAL),
@@ -79,11 +84,16 @@ DeviceScene::DeviceScene(Device *device)
       lights(device, "__lights", MEM_GLOBAL),
       light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_GLOBAL),
       light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_GLOBAL),
+      light_tree_nodes(device, "__light_tree_nodes", MEM_GLOBAL),
+      light_tree_emitter_nodes(device, "__light_tree_emitter_nodes", MEM_GLOBAL),
+      light_tree_object_emitters(device, "__light_tree_object_emitters", MEM_GLOBAL),
+      light_tree_distant_lights(device, "__light_tree_distant_lights", MEM_GLOBAL),
       particles(device, "__particles", MEM_GLOBAL),
       svm_nodes(device, "__svm_nodes", MEM_GLOBAL),
       shaders(device, "__shaders", MEM_GLOBAL),
       lookup_table(device, "__lookup_table", MEM_GLOBAL),
       sample_pattern_lut(device, "__sample_pattern_lut", MEM_GLOBAL),
+      blue_noise(device, "__blue_noise", MEM_GLOBAL),
       ies_lights(device, "__ies", MEM_GLOBAL)
 {
   memset((void *)&data, 0, sizeof(data));
@@ -476,6 +486,13 @@ void Scene::collect_statistics(RenderStats *stats)
   image_manager->collect_statistics(stats);
 }
 
+void Scene::collect_memory_statistics(MemoryStats *stats)
+{
+  geometry_manager->collect_memory_statistics(this, stats);
+  object_manager->collect_memory_statistics(this, stats);
+  image_manager->collect_memory_statistics(stats);
+}
+
 void Scene::enable_update_stats()
 {
   if (!update_stats) {
@@ -531,6 +548,10 @@ void Scene::update_kernel_features()
     kernel_features |= KERNEL_FEATURE_BAKING;
   }
 
+  if (integrator->get_use_guiding() && device->info.type == DEVICE_CPU) {
+    kernel_features |= KERNEL_FEATURE_PATH_GUIDING;
+  }
+
   kernel_features |= film->get_kernel_features(this);
 
   dscene.data.kernel_features = kernel_features;
@@ -595,6 +616,8 @@ static void log_kernel_features(const uint features)
           << string_from_bool(features & KERNEL_FEATURE_PATCH_EVALUATION) << "\n";
   VLOG(2) << "Use Shadow Catcher " << string_from_bool(features & KERNEL_FEATURE_SHADOW_CATCHER)
           << "\n";
+  VLOG(2) << "Use Path Guiding " << string_from_bool(features & KERNEL_FEATURE_PATH_GUIDING)
+          << "\n";
 }
 
 bool Scene::load_kernels(Progress &progress, bool lock_scene)
@@ -62,6 +62,7 @@ class ShaderManager;
 class Progress;
 class BakeManager;
 class BakeData;
+class MemoryStats;
 class RenderStats;
 class SceneUpdateStats;
 class Volume;
@@ -90,17 +91,24 @@ class DeviceScene {
 
   device_vector<KernelCurve> curves;
   device_vector<float4> curve_keys;
+  device_vector<uint2> curve_keys_quantized;
+  device_vector<float4> curve_key_bounds;
   device_vector<KernelCurveSegment> curve_segments;
 
   device_vector<uint> patches;
 
   /* objects */
   device_vector<KernelObject> objects;
+  device_vector<KernelObjectPrototype> object_prototypes;
   device_vector<Transform> object_motion_pass;
   device_vector<DecomposedTransform> object_motion;
   device_vector<uint> object_flag;
   device_vector<float> object_volume_step;
 
+  /* volumes */
+  device_vector<KernelVolumeOccupancy> volume_occupancy;
+  device_vector<uint> volume_occupancy_cells;
+
   /* cameras */
   device_vector<DecomposedTransform> camera_motion;
 
@@ -116,6 +124,10 @@ class DeviceScene {
   device_vector<KernelLight> lights;
   device_vector<float2> light_background_marginal_cdf;
   device_vector<float2> light_background_conditional_cdf;
+  device_vector<KernelLightTreeNode> light_tree_nodes;
+  device_vector<uint> light_tree_emitter_nodes;
+  device_vector<uint2> light_tree_object_emitters;
+  device_vector<uint> light_tree_distant_lights;
 
   /* particles */
   device_vector<KernelParticle> particles;
@@ -129,6 +141,7 @@ class DeviceScene {
 
   /* integrator */
   device_vector<float> sample_pattern_lut;
+  device_vector<float> blue_noise;
 
   /* ies lights */
   device_vector<float> ies_lights;
@@ -157,8 +170,22 @@ class SceneParams {
   int num_bvh_time_steps;
   int hair_subdivisions;
   CurveShapeType hair_shape;
+  /* Store curve keys in 8 instead of 16 bytes, quantized relative to the bounds of their curve.
+   * Only used with the native BVH layouts, and when it saves memory. */
+  bool use_quantized_curve_keys;
   int texture_limit;
 
+  /* Memory budget of the CPU texture cache in megabytes, zero to load full images. */
+  int texture_cache_size;
+
+  /* Reduced precision storage of float image textures. */
+  ImageCompression texture_compression;
+
+  /* Directory of the on-disk cache of built BVHs, shared between renders. Empty to disable. */
+  string bvh_cache_directory;
+  /* Maximum size of the BVH cache directory in gigabytes, zero for no limit. */
+  int bvh_cache_size;
+
   bool background;
 
   SceneParams()
@@ -171,7 +198,11 @@ class SceneParams {
     num_bvh_time_steps = 0;
     hair_subdivisions = 3;
     hair_shape = CURVE_RIBBON;
+    use_quantized_curve_keys = false;
     texture_limit = 0;
+    texture_cache_size = 0;
+    texture_compression = IMAGE_COMPRESSION_NONE;
+    bvh_cache_size = 16;
     background = true;
   }
 
@@ -183,7 +214,12 @@ class SceneParams {
              use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes &&
              num_bvh_time_steps == params.num_bvh_time_steps &&
              hair_subdivisions == params.hair_subdivisions && hair_shape == params.hair_shape &&
-             texture_limit == params.texture_limit);
+             use_quantized_curve_keys == params.use_quantized_curve_keys &&
+             texture_limit == params.texture_limit &&
+             texture_cache_size == params.texture_cache_size &&
+             texture_compression == params.texture_compression &&
+             bvh_cache_directory == params.bvh_cache_directory &&
+             bvh_cache_size == params.bvh_cache_size);
   }
 
   int curve_subdivisions()
@@ -271,6 +307,7 @@ class Scene : public NodeOwner {
   void device_free();
 
   void collect_statistics(RenderStats *stats);
+  void collect_memory_statistics(MemoryStats *stats);
 
   void enable_update_stats();
 
@@ -261,6 +261,12 @@ RenderWork Session::run_update_for_next_iteration()
     path_trace_->set_adaptive_sampling(adaptive_sampling);
   }
 
+  /* Update path guiding, restarting training when the scene was reset. */
+  {
+    const GuidingParams guiding_params = scene->integrator->get_guiding_params();
+    path_trace_->set_guiding_params(guiding_params, did_reset);
+  }
+
   render_scheduler_.set_num_samples(params.samples);
   render_scheduler_.set_time_limit(params.time_limit);
 
@@ -305,6 +311,9 @@ RenderWork Session::run_update_for_next_iteration()
       path_trace_->reset(buffer_params_, tile_params);
     }
 
+    /* No kernels are running at this point, so texture cache tiles can be freed safely. */
+    scene->image_manager->texture_cache_evict(scene);
+
     const int resolution = render_work.resolution_divider;
     const int width = max(1, buffer_params_.full_width / resolution);
     const int height = max(1, buffer_params_.full_height / resolution);
@@ -619,6 +628,15 @@ void Session::collect_statistics(RenderStats *render_stats)
   }
 }
 
+void Session::collect_memory_statistics(RenderStats *render_stats)
+{
+  thread_scoped_lock scene_lock(scene->mutex);
+
+  render_stats->has_memory = true;
+  scene->collect_memory_statistics(&render_stats->memory);
+  path_trace_->collect_memory_statistics(&render_stats->memory.integrator);
+}
+
 /* --------------------------------------------------------------------
  * Full-frame on-disk storage.
  */
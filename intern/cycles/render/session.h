@@ -151,6 +151,10 @@ class Session {
 
   void collect_statistics(RenderStats *stats);
 
+  /* Collect fine-grained memory statistics of the scene and render devices. This walks over the
+   * whole scene, so only do it when the statistics are requested. */
+  void collect_memory_statistics(RenderStats *stats);
+
   /* --------------------------------------------------------------------
    * Full-frame on-disk storage.
    */
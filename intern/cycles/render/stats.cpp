@@ -51,6 +51,82 @@ bool namedSampleCountPairComparator(const NamedSampleCountPair &a, const NamedSa
   return a.samples > b.samples;
 }
 
+bool namedMemoryEntryComparator(const NamedMemoryEntry &a, const NamedMemoryEntry &b)
+{
+  return a.total_size > b.total_size;
+}
+
+string json_size_entries(const vector<NamedSizeEntry> &entries, const string &indent)
+{
+  string result = "{";
+  for (size_t i = 0; i < entries.size(); i++) {
+    result += string_printf("%s\n%s  %s: %zu",
+                            (i) ? "," : "",
+                            indent.c_str(),
+                            string_to_json(entries[i].name).c_str(),
+                            entries[i].size);
+  }
+  return result + ((entries.empty()) ? "}" : "\n" + indent + "}");
+}
+
+string json_memory_entries(const vector<NamedMemoryEntry> &entries, const string &indent)
+{
+  string result = "[";
+  for (size_t i = 0; i < entries.size(); i++) {
+    const NamedMemoryEntry &entry = entries[i];
+    result += (i) ? ",\n" : "\n";
+    result += indent + "  {\n";
+    result += indent + "    \"name\": " + string_to_json(entry.name) + ",\n";
+    if (!entry.info.empty()) {
+      result += indent + "    \"info\": " + string_to_json(entry.info) + ",\n";
+    }
+    result += indent + string_printf("    \"total\": %zu,\n", entry.total_size);
+    result += indent + "    \"parts\": " + json_size_entries(entry.parts, indent + "    ") + "\n";
+    result += indent + "  }";
+  }
+  return result + ((entries.empty()) ? "]" : "\n" + indent + "]");
+}
+
+string json_size_stats(const NamedSizeStats &stats, const string &indent)
+{
+  string result = "{\n";
+  result += indent + string_printf("  \"total\": %zu,\n", stats.total_size);
+  result += indent + "  \"parts\": " + json_size_entries(stats.entries, indent + "  ") + "\n";
+  return result + indent + "}";
+}
+
+string memory_entries_report(vector<NamedMemoryEntry> &entries, int indent_level)
+{
+  const string indent(indent_level * kIndentNumSpaces, ' ');
+  const string double_indent = indent + indent;
+  size_t total_size = 0;
+  foreach (const NamedMemoryEntry &entry, entries) {
+    total_size += entry.total_size;
+  }
+
+  string result = string_printf("%sTotal memory: %s (%s)\n",
+                                indent.c_str(),
+                                string_human_readable_size(total_size).c_str(),
+                                string_human_readable_number(total_size).c_str());
+  sort(entries.begin(), entries.end(), namedMemoryEntryComparator);
+  foreach (NamedMemoryEntry &entry, entries) {
+    result += string_printf("%s%-32s %s%s%s\n",
+                            double_indent.c_str(),
+                            entry.name.c_str(),
+                            string_human_readable_size(entry.total_size).c_str(),
+                            (entry.info.empty()) ? "" : ", ",
+                            entry.info.c_str());
+    sort(entry.parts.begin(), entry.parts.end(), namedSizeEntryComparator);
+    foreach (const NamedSizeEntry &part, entry.parts) {
+      result += string_printf("%s  %-30s %s\n",
+                              double_indent.c_str(),
+                              part.name.c_str(),
+                              string_human_readable_size(part.size).c_str());
+    }
+  }
+  return result;
+}
+
 }  // namespace
 
 NamedSizeEntry::NamedSizeEntry() : name(""), size(0)
@@ -227,6 +303,13 @@ string NamedSampleCountStats::full_report(int indent_level)
 /* Mesh statistics. */
 
 MeshStats::MeshStats()
+    : bvh_inner_nodes_size(0),
+      bvh_leaf_nodes_size(0),
+      bvh_binary_inner_nodes_size(0),
+      use_bvh_cache(false),
+      bvh_cache_hits(0),
+      bvh_cache_misses(0),
+      bvh_cache_time_saved(0.0)
 {
 }
 
@@ -235,12 +318,44 @@ string MeshStats::full_report(int indent_level)
   const string indent(indent_level * kIndentNumSpaces, ' ');
   string result = "";
   result += indent + "Geometry:\n" + geometry.full_report(indent_level + 1);
+
+  const string double_indent = indent + indent;
+  if (!bvh_layout.empty()) {
+    result += indent + "BVH (" + bvh_layout + "):\n";
+    result += double_indent + "Inner nodes: " + string_human_readable_size(bvh_inner_nodes_size) +
+              "\n";
+    result += double_indent + "Leaf nodes: " + string_human_readable_size(bvh_leaf_nodes_size) +
+              "\n";
+    if (bvh_binary_inner_nodes_size != bvh_inner_nodes_size) {
+      result += double_indent + "Inner nodes as BVH2: " +
+                string_human_readable_size(bvh_binary_inner_nodes_size) + "\n";
+    }
+  }
+
+  if (use_bvh_cache) {
+    const uint64_t lookups = bvh_cache_hits + bvh_cache_misses;
+    const double hit_rate = (lookups) ? 100.0 * bvh_cache_hits / lookups : 0.0;
+
+    result += indent + "BVH Cache:\n";
+    result += double_indent + "Hits: " + to_string(bvh_cache_hits) +
+              string_printf(" (%.2f%%)\n", hit_rate);
+    result += double_indent + "Misses: " + to_string(bvh_cache_misses) + "\n";
+    result += double_indent + string_printf("Time saved: %.2fs\n", bvh_cache_time_saved);
+  }
+
   return result;
 }
 
 /* Image statistics. */
 
 ImageStats::ImageStats()
+    : use_texture_cache(false),
+      texture_cache_hits(0),
+      texture_cache_misses(0),
+      texture_cache_bytes_loaded(0),
+      texture_cache_evictions(0),
+      texture_cache_memory(0),
+      texture_cache_peak_memory(0)
 {
 }
 
@@ -249,14 +364,104 @@ string ImageStats::full_report(int indent_level)
   const string indent(indent_level * kIndentNumSpaces, ' ');
   string result = "";
   result += indent + "Textures:\n" + textures.full_report(indent_level + 1);
+
+  if (use_texture_cache) {
+    const string double_indent = indent + indent;
+    const uint64_t lookups = texture_cache_hits + texture_cache_misses;
+    const double hit_rate = (lookups) ? 100.0 * texture_cache_hits / lookups : 0.0;
+
+    result += indent + "Texture Cache:\n";
+    result += double_indent + "Hits: " + to_string(texture_cache_hits) +
+              string_printf(" (%.2f%%)\n", hit_rate);
+    result += double_indent + "Misses: " + to_string(texture_cache_misses) + "\n";
+    result += double_indent + "Loaded: " +
+              string_human_readable_size(texture_cache_bytes_loaded) + "\n";
+    result += double_indent + "Evicted tiles: " + to_string(texture_cache_evictions) + "\n";
+    result += double_indent + "Memory: " + string_human_readable_size(texture_cache_memory) +
+              " (peak " + string_human_readable_size(texture_cache_peak_memory) + ")\n";
+  }
+
+  return result;
+}
+
+/* Memory statistics. */
+
+NamedMemoryEntry::NamedMemoryEntry() : name(""), info(""), total_size(0)
+{
+}
+
+NamedMemoryEntry::NamedMemoryEntry(const string &name, const string &info)
+    : name(name), info(info), total_size(0)
+{
+}
+
+void NamedMemoryEntry::add_part(const string &part_name, size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+  total_size += size;
+  parts.push_back(NamedSizeEntry(part_name, size));
+}
+
+MemoryStats::MemoryStats()
+{
+}
+
+size_t MemoryStats::total_size() const
+{
+  size_t total = bvh.total_size + integrator.total_size;
+  foreach (const NamedMemoryEntry &entry, geometry) {
+    total += entry.total_size;
+  }
+  foreach (const NamedMemoryEntry &entry, objects) {
+    total += entry.total_size;
+  }
+  foreach (const NamedMemoryEntry &entry, images) {
+    total += entry.total_size;
+  }
+  return total;
+}
+
+string MemoryStats::full_report(int indent_level)
+{
+  const string indent(indent_level * kIndentNumSpaces, ' ');
+  string result = "";
+  result += string_printf("%sTotal memory: %s (%s)\n",
+                          indent.c_str(),
+                          string_human_readable_size(total_size()).c_str(),
+                          string_human_readable_number(total_size()).c_str());
+  result += indent + "Geometry:\n" + memory_entries_report(geometry, indent_level + 1);
+  result += indent + "Objects:\n" + memory_entries_report(objects, indent_level + 1);
+  result += indent + "Images:\n" + memory_entries_report(images, indent_level + 1);
+  result += indent + "BVH:\n" + bvh.full_report(indent_level + 1);
+  result += indent + "Integrator:\n" + integrator.full_report(indent_level + 1);
   return result;
 }
 
+string MemoryStats::json_report()
+{
+  sort(geometry.begin(), geometry.end(), namedMemoryEntryComparator);
+  sort(objects.begin(), objects.end(), namedMemoryEntryComparator);
+  sort(images.begin(), images.end(), namedMemoryEntryComparator);
+
+  string json = "{\n";
+  json += string_printf("  \"total\": %zu,\n", total_size());
+  json += "  \"geometry\": " + json_memory_entries(geometry, "  ") + ",\n";
+  json += "  \"objects\": " + json_memory_entries(objects, "  ") + ",\n";
+  json += "  \"images\": " + json_memory_entries(images, "  ") + ",\n";
+  json += "  \"bvh\": " + json_size_stats(bvh, "  ") + ",\n";
+  json += "  \"integrator\": " + json_size_stats(integrator, "  ") + "\n";
+  json += "}\n";
+  return json;
+}
+
 /* Overall statistics. */
 
 RenderStats::RenderStats()
 {
   has_profiling = false;
+  has_memory = false;
 }
 
 void RenderStats::collect_profiling(Scene *scene, Profiler &prof)
@@ -323,6 +528,9 @@ string RenderStats::full_report()
   else {
     result += "Profiling information not available (only works with CPU rendering)";
   }
+  if (has_memory) {
+    result += "\nMemory statistics:\n" + memory.full_report(1);
+  }
   return result;
 }
 
@@ -355,6 +563,7 @@ string SceneUpdateStats::full_report()
   result += "OSL:\n" + osl.full_report(1);
   result += "Particles:\n" + particles.full_report(1);
   result += "SVM:\n" + svm.full_report(1);
+  result += "SVM Compile:\n" + svm_compile.full_report(1);
   result += "Tables:\n" + tables.full_report(1);
   result += "Procedurals:\n" + procedurals.full_report(1);
   return result;
@@ -375,6 +584,7 @@ void SceneUpdateStats::clear()
   particles.times.clear();
   scene.times.clear();
   svm.times.clear();
+  svm_compile.times.clear();
   tables.times.clear();
   procedurals.times.clear();
 }
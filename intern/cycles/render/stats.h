@@ -160,6 +160,19 @@ class MeshStats {
    * memory like BVH.
    */
   NamedSizeStats geometry;
+
+  /* Packed nodes of the scene BVH, only for the BVH2 and BVH4 layouts. */
+  string bvh_layout;
+  size_t bvh_inner_nodes_size;
+  size_t bvh_leaf_nodes_size;
+  /* Size of the inner nodes in the BVH2 layout, for comparison with BVH4. */
+  size_t bvh_binary_inner_nodes_size;
+
+  /* On-disk cache of built BVHs. */
+  bool use_bvh_cache;
+  uint64_t bvh_cache_hits;
+  uint64_t bvh_cache_misses;
+  double bvh_cache_time_saved;
 };
 
 /* Statistics about images held in memory. */
@@ -171,6 +184,53 @@ class ImageStats {
   string full_report(int indent_level = 0);
 
   NamedSizeStats textures;
+
+  /* Texture cache, when image tiles are loaded on demand. */
+  bool use_texture_cache;
+  uint64_t texture_cache_hits;
+  uint64_t texture_cache_misses;
+  uint64_t texture_cache_bytes_loaded;
+  uint64_t texture_cache_evictions;
+  size_t texture_cache_memory;
+  size_t texture_cache_peak_memory;
+};
+
+/* Memory of a single item in the render database, split into named parts. */
+class NamedMemoryEntry {
+ public:
+  NamedMemoryEntry();
+  NamedMemoryEntry(const string &name, const string &info = "");
+
+  /* Add part of the memory, parts without any memory are skipped. */
+  void add_part(const string &part_name, size_t size);
+
+  string name;
+  /* Free-form description, like the resolution and format of an image. */
+  string info;
+  size_t total_size;
+  vector<NamedSizeEntry> parts;
+};
+
+/* Fine-grained memory statistics: per geometry, per object instance, per image, BVH arrays and
+ * integrator state. Only collected on request at the end of a render, so there is no cost when
+ * it is not used. */
+class MemoryStats {
+ public:
+  MemoryStats();
+
+  /* Generate full human-readable report. */
+  string full_report(int indent_level = 0);
+
+  /* Generate report as a JSON object. */
+  string json_report();
+
+  size_t total_size() const;
+
+  vector<NamedMemoryEntry> geometry;
+  vector<NamedMemoryEntry> objects;
+  vector<NamedMemoryEntry> images;
+  NamedSizeStats bvh;
+  NamedSizeStats integrator;
 };
 
 /* Render process statistics. */
@@ -185,12 +245,14 @@ class RenderStats {
   void collect_profiling(Scene *scene, Profiler &prof);
 
   bool has_profiling;
+  bool has_memory;
 
   MeshStats mesh;
   ImageStats image;
   NamedNestedSampleStats kernel;
   NamedSampleCountStats shaders;
   NamedSampleCountStats objects;
+  MemoryStats memory;
 };
 
 class UpdateTimeStats {
@@ -218,6 +280,8 @@ class SceneUpdateStats {
   UpdateTimeStats particles;
   UpdateTimeStats scene;
   UpdateTimeStats svm;
+  /* Compile time of each shader which was not found in the compiled shader cache. */
+  UpdateTimeStats svm_compile;
   UpdateTimeStats tables;
   UpdateTimeStats procedurals;
 
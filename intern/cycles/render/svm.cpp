@@ -28,6 +28,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_md5.h"
 #include "util/util_progress.h"
 #include "util/util_task.h"
 
@@ -47,26 +48,101 @@ void SVMShaderManager::reset(Scene * /*scene*/)
 {
 }
 
-static void host_compile_shader(Scene *scene,
-                                Shader *shader,
-                                Progress *progress,
-                                array<int4> *svm_nodes)
+void SVMShaderManager::CompiledShader::store(const Shader *shader, const array<int4> &nodes)
+{
+  svm_nodes = nodes;
+
+  has_surface = shader->has_surface;
+  has_surface_emission = shader->has_surface_emission;
+  has_surface_transparent = shader->has_surface_transparent;
+  has_surface_raytrace = shader->has_surface_raytrace;
+  has_volume = shader->has_volume;
+  has_displacement = shader->has_displacement;
+  has_surface_bssrdf = shader->has_surface_bssrdf;
+  has_bump = shader->has_bump;
+  has_bssrdf_bump = shader->has_bssrdf_bump;
+  has_surface_spatial_varying = shader->has_surface_spatial_varying;
+  has_volume_spatial_varying = shader->has_volume_spatial_varying;
+  has_volume_attribute_dependency = shader->has_volume_attribute_dependency;
+  has_integrator_dependency = shader->has_integrator_dependency;
+}
+
+void SVMShaderManager::CompiledShader::restore(Shader *shader, array<int4> &nodes) const
+{
+  nodes = svm_nodes;
+
+  shader->has_surface = has_surface;
+  shader->has_surface_emission = has_surface_emission;
+  shader->has_surface_transparent = has_surface_transparent;
+  shader->has_surface_raytrace = has_surface_raytrace;
+  shader->has_volume = has_volume;
+  shader->has_displacement = has_displacement;
+  shader->has_surface_bssrdf = has_surface_bssrdf;
+  shader->has_bump = has_bump;
+  shader->has_bssrdf_bump = has_bssrdf_bump;
+  shader->has_surface_spatial_varying = has_surface_spatial_varying;
+  shader->has_volume_spatial_varying = has_volume_spatial_varying;
+  shader->has_volume_attribute_dependency = has_volume_attribute_dependency;
+  shader->has_integrator_dependency = has_integrator_dependency;
+}
+
+void SVMShaderManager::host_compile_shader(Scene *scene,
+                                           Shader *shader,
+                                           Progress *progress,
+                                           int index)
 {
   if (progress->get_cancel()) {
     return;
   }
   assert(shader->graph);
 
-  svm_nodes->push_back_slow(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+  array<int4> &svm_nodes = shader_svm_nodes_[index];
+  const double time_start = time_dt();
 
   SVMCompiler::Summary summary;
   SVMCompiler compiler(scene);
   compiler.background = (shader == scene->background->get_shader(scene));
-  compiler.compile(shader, *svm_nodes, 0, &summary);
+  compiler.finalize(shader, &summary);
+
+  /* Reuse nodes compiled for the same graph, in this or the previous update. */
+  {
+    const string key = compiler.compile_hash(shader);
+
+    thread_scoped_lock lock(compile_cache_mutex_);
+    auto it = next_compile_cache_.find(key);
+    if (it == next_compile_cache_.end()) {
+      auto prev_it = compile_cache_.find(key);
+      if (prev_it != compile_cache_.end()) {
+        it = next_compile_cache_.insert(*prev_it).first;
+      }
+    }
+
+    if (it != next_compile_cache_.end()) {
+      it->second.restore(shader, svm_nodes);
+      return;
+    }
+  }
+
+  svm_nodes.push_back_slow(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+  compiler.compile(shader, svm_nodes, 0, &summary);
+
+  shader_compile_times_[index] = time_dt() - time_start;
 
   VLOG(2) << "Compilation summary:\n"
           << "Shader name: " << shader->name << "\n"
           << summary.full_report();
+
+  if (progress->get_cancel()) {
+    return;
+  }
+
+  /* Hash again, as compilation acquires image slots which are part of the hash. A shader with
+   * the same graph but without images loaded yet will then not use nodes with slots it does not
+   * hold a reference to. */
+  const string key = compiler.compile_hash(shader);
+
+  thread_scoped_lock lock(compile_cache_mutex_);
+  next_compile_cache_[key].store(shader, svm_nodes);
 }
 
 void SVMShaderManager::host_update_specific(Device * /*device*/, Scene *scene, Progress &progress)
@@ -87,12 +163,39 @@ void SVMShaderManager::host_update_specific(Device * /*device*/, Scene *scene, P
 
   /* Build all shaders. */
   TaskPool task_pool;
+  shader_svm_nodes_.clear();
   shader_svm_nodes_.resize(num_shaders);
+  shader_compile_times_.clear();
+  shader_compile_times_.resize(num_shaders, 0.0);
   for (int i = 0; i < num_shaders; i++) {
-    task_pool.push(function_bind(
-        host_compile_shader, scene, scene->shaders[i], &progress, &shader_svm_nodes_[i]));
+    task_pool.push(function_bind(&SVMShaderManager::host_compile_shader,
+                                 this,
+                                 scene,
+                                 scene->shaders[i],
+                                 &progress,
+                                 i));
   }
   task_pool.wait_work();
+
+  /* Keep only shaders used in this update, so the cache does not grow with every edit. */
+  compile_cache_.swap(next_compile_cache_);
+  next_compile_cache_.clear();
+
+  int num_compiled = 0;
+  for (int i = 0; i < num_shaders; i++) {
+    if (shader_compile_times_[i] == 0.0) {
+      continue;
+    }
+
+    num_compiled++;
+    if (scene->update_stats) {
+      scene->update_stats->svm_compile.times.add_entry(
+          {scene->shaders[i]->name.string(), shader_compile_times_[i]});
+    }
+  }
+
+  VLOG(1) << "Compiled " << num_compiled << " shaders, reused " << num_shaders - num_compiled
+          << " from cache.";
 }
 
 void SVMShaderManager::device_update_specific(Device *device,
@@ -198,6 +301,7 @@ SVMCompiler::SVMCompiler(Scene *scene) : scene(scene)
   background = false;
   mix_weight_offset = SVM_STACK_INVALID;
   compile_failed = false;
+  has_bump = false;
 }
 
 int SVMCompiler::stack_size(SocketType::Type type)
@@ -870,18 +974,20 @@ void SVMCompiler::compile_type(Shader *shader, ShaderGraph *graph, ShaderType ty
   }
 }
 
-void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Summary *summary)
+static bool shader_has_bump(Shader *shader)
 {
-  /* copy graph for shader with bump mapping */
   ShaderNode *output = shader->graph->output();
-  int start_num_svm_nodes = svm_nodes.size();
+  return (shader->get_displacement_method() != DISPLACE_TRUE) &&
+         output->input("Surface")->link && output->input("Displacement")->link;
+}
 
+void SVMCompiler::finalize(Shader *shader, Summary *summary)
+{
   const double time_start = time_dt();
 
-  bool has_bump = (shader->get_displacement_method() != DISPLACE_TRUE) &&
-                  output->input("Surface")->link && output->input("Displacement")->link;
+  /* Graph simplification may remove links to the output, so check for bump before. */
+  has_bump = shader_has_bump(shader);
 
-  /* finalize */
   {
     scoped_timer timer((summary != NULL) ? &summary->time_finalize : NULL);
     shader->graph->finalize(scene,
@@ -890,6 +996,46 @@ void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Sum
                             shader->get_displacement_method() == DISPLACE_BOTH);
   }
 
+  if (summary != NULL) {
+    summary->time_total += time_dt() - time_start;
+  }
+}
+
+string SVMCompiler::compile_hash(Shader *shader)
+{
+  MD5Hash md5;
+
+  const int state[4] = {background,
+                        shader->get_displacement_method(),
+                        shader->reference_count() != 0,
+                        has_bump};
+  md5.append((uint8_t *)state, sizeof(state));
+
+  foreach (ShaderNode *node, shader->graph->nodes) {
+    node->hash(md5);
+    node->hash_compile_state(md5);
+
+    const int node_state[3] = {node->id, node->bump, node->special_type};
+    md5.append((uint8_t *)node_state, sizeof(node_state));
+
+    foreach (ShaderInput *input, node->inputs) {
+      int link_id = (input->link) ? input->link->parent->id : -1;
+      md5.append((uint8_t *)&link_id, sizeof(link_id));
+      md5.append((input->link) ? input->link->name().c_str() : "");
+    }
+  }
+
+  return md5.get_hex();
+}
+
+void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Summary *summary)
+{
+  assert(shader->graph->finalized);
+
+  int start_num_svm_nodes = svm_nodes.size();
+
+  const double time_start = time_dt();
+
   current_shader = shader;
 
   shader->has_surface = false;
@@ -944,7 +1090,7 @@ void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Sum
 
   /* Fill in summary information. */
   if (summary != NULL) {
-    summary->time_total = time_dt() - time_start;
+    summary->time_total += time_dt() - time_start;
     summary->peak_stack_usage = max_stack_use;
     summary->num_svm_nodes = svm_nodes.size() - start_num_svm_nodes;
   }
@@ -22,6 +22,7 @@
 #include "render/shader.h"
 
 #include "util/util_array.h"
+#include "util/util_map.h"
 #include "util/util_set.h"
 #include "util/util_string.h"
 #include "util/util_thread.h"
@@ -55,11 +56,45 @@ class SVMShaderManager : public ShaderManager {
   void device_free(Device *device, DeviceScene *dscene, Scene *scene) override;
 
  protected:
+  /* Compiled shader, along with the shader information which is filled in by compilation. */
+  struct CompiledShader {
+    void store(const Shader *shader, const array<int4> &nodes);
+    void restore(Shader *shader, array<int4> &nodes) const;
+
+    array<int4> svm_nodes;
+
+    bool has_surface;
+    bool has_surface_emission;
+    bool has_surface_transparent;
+    bool has_surface_raytrace;
+    bool has_volume;
+    bool has_displacement;
+    bool has_surface_bssrdf;
+    bool has_bump;
+    bool has_bssrdf_bump;
+    bool has_surface_spatial_varying;
+    bool has_volume_spatial_varying;
+    bool has_volume_attribute_dependency;
+    bool has_integrator_dependency;
+  };
+
+  void host_compile_shader(Scene *scene, Shader *shader, Progress *progress, int index);
+
   /* Compiled shader nodes.
    *
    * The compilation happens in the `host_update_specific()`, and the `device_update_specific()`
    * moves these nodes to the device. */
   vector<array<int4>> shader_svm_nodes_;
+
+  /* Time spent compiling each shader, zero for shaders found in the cache. */
+  vector<double> shader_compile_times_;
+
+  /* Cache of compiled shaders, keyed by a hash of the finalized shader graph. Shaders whose graph
+   * did not change since the last update, or which have the same graph as another shader, reuse
+   * the compiled nodes. Only shaders compiled or reused in the last update are kept. */
+  unordered_map<string, CompiledShader> compile_cache_;
+  unordered_map<string, CompiledShader> next_compile_cache_;
+  thread_mutex compile_cache_mutex_;
 };
 
 /* Graph Compiler */
@@ -98,8 +133,14 @@ class SVMCompiler {
   };
 
   SVMCompiler(Scene *scene);
+
+  /* Finalize the shader graph, which must be done before compile(). */
+  void finalize(Shader *shader, Summary *summary = NULL);
   void compile(Shader *shader, array<int4> &svm_nodes, int index, Summary *summary = NULL);
 
+  /* Hash of the finalized shader graph and all other state the compiled nodes depend on. */
+  string compile_hash(Shader *shader);
+
   int stack_assign(ShaderOutput *output);
   int stack_assign(ShaderInput *input);
   int stack_assign_if_linked(ShaderInput *input);
@@ -234,6 +275,7 @@ class SVMCompiler {
   int max_stack_use;
   uint mix_weight_offset;
   bool compile_failed;
+  bool has_bump;
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,557 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/texture_cache.h"
+#include "render/stats.h"
+
+#include "util/util_aligned_malloc.h"
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_half.h"
+#include "util/util_image.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+int texture_cache_channels(const ImageDataType type)
+{
+  switch (type) {
+    case IMAGE_DATA_TYPE_FLOAT4:
+    case IMAGE_DATA_TYPE_BYTE4:
+    case IMAGE_DATA_TYPE_HALF4:
+    case IMAGE_DATA_TYPE_USHORT4:
+      return 4;
+    default:
+      return 1;
+  }
+}
+
+size_t texture_cache_channel_size(const ImageDataType type)
+{
+  switch (type) {
+    case IMAGE_DATA_TYPE_FLOAT4:
+    case IMAGE_DATA_TYPE_FLOAT:
+      return sizeof(float);
+    case IMAGE_DATA_TYPE_HALF4:
+    case IMAGE_DATA_TYPE_HALF:
+      return sizeof(half);
+    case IMAGE_DATA_TYPE_USHORT4:
+    case IMAGE_DATA_TYPE_USHORT:
+      return sizeof(uint16_t);
+    default:
+      return sizeof(uchar);
+  }
+}
+
+/* Box filter 2x2 pixels of the finer level into one pixel. Source pixels are looked up in the
+ * up to 2x2 tiles of the finer level which cover the destination tile. */
+template<typename T>
+void texture_cache_downsample(const TextureCacheLevel &src_level,
+                              const void *src_tiles[2][2],
+                              const int src_tile_x,
+                              const int src_tile_y,
+                              const int channels,
+                              const int x,
+                              const int y,
+                              const int width,
+                              const int height,
+                              T *pixels)
+{
+  for (int j = 0; j < height; j++) {
+    for (int i = 0; i < width; i++) {
+      float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+      for (int dj = 0; dj < 2; dj++) {
+        for (int di = 0; di < 2; di++) {
+          const int sx = min(2 * (x + i) + di, src_level.width - 1);
+          const int sy = min(2 * (y + j) + dj, src_level.height - 1);
+          const int tx = (sx >> TEXTURE_CACHE_TILE_SIZE_LOG2) - src_tile_x;
+          const int ty = (sy >> TEXTURE_CACHE_TILE_SIZE_LOG2) - src_tile_y;
+          const int tile_width = min(TEXTURE_CACHE_TILE_SIZE,
+                                     src_level.width - (sx & ~(TEXTURE_CACHE_TILE_SIZE - 1)));
+          const T *src = (const T *)src_tiles[ty][tx] +
+                         ((sy & (TEXTURE_CACHE_TILE_SIZE - 1)) * tile_width +
+                          (sx & (TEXTURE_CACHE_TILE_SIZE - 1))) *
+                             channels;
+
+          for (int c = 0; c < channels; c++) {
+            sum[c] += util_image_cast_to_float(src[c]);
+          }
+        }
+      }
+
+      T *dst = pixels + (j * width + i) * channels;
+      for (int c = 0; c < channels; c++) {
+        dst[c] = util_image_cast_from_float<T>(sum[c] * 0.25f);
+      }
+    }
+  }
+}
+
+template<typename T>
+void texture_cache_fill_missing(const int channels, const size_t num_pixels, T *pixels)
+{
+  const float missing[4] = {
+      TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A};
+
+  for (size_t i = 0; i < num_pixels; i++) {
+    for (int c = 0; c < channels; c++) {
+      pixels[i * channels + c] = util_image_cast_from_float<T>(missing[c]);
+    }
+  }
+}
+
+}  // namespace
+
+/* Texture Cache Image */
+
+class TextureCache::Image : public TextureCacheImage {
+ public:
+  Image(TextureCache *cache,
+        const string &name,
+        ImageDataType type,
+        int width,
+        int height,
+        int num_file_levels,
+        bool is_tiled,
+        int texture_limit,
+        const LoadRegionFunc &load_region)
+      : name(name),
+        cache(cache),
+        type(type),
+        channels(texture_cache_channels(type)),
+        pixel_size(texture_cache_channel_size(type) * texture_cache_channels(type)),
+        num_file_levels(num_file_levels),
+        is_tiled(is_tiled),
+        load_region(load_region),
+        memory_used(0)
+  {
+    state = &cache->state;
+
+    /* Mipmap chain down to a single pixel, with dimensions rounded down like OpenImageIO
+     * does, so levels stored in files can be used as is. */
+    for (num_levels = 0; num_levels < TEXTURE_CACHE_MAX_LEVELS; num_levels++) {
+      TextureCacheLevel &level = levels[num_levels];
+      level.width = width;
+      level.height = height;
+      level.tiles_x = divide_up(width, TEXTURE_CACHE_TILE_SIZE);
+      level.tiles_y = divide_up(height, TEXTURE_CACHE_TILE_SIZE);
+
+      const int num_tiles = level.tiles_x * level.tiles_y;
+      level.tiles = new std::atomic<const void *>[num_tiles]();
+      level.last_used = new std::atomic<uint>[num_tiles]();
+
+      if (texture_limit > 0 && max(width, height) > texture_limit) {
+        min_level = num_levels + 1;
+      }
+
+      if (width == 1 && height == 1) {
+        num_levels++;
+        break;
+      }
+
+      width = max(1, width >> 1);
+      height = max(1, height >> 1);
+    }
+
+    min_level = min(min_level, num_levels - 1);
+  }
+
+  ~Image()
+  {
+    for (int i = 0; i < num_levels; i++) {
+      delete[] levels[i].tiles;
+      delete[] levels[i].last_used;
+    }
+  }
+
+  void free_tile(const int level, const int index)
+  {
+    void *data = (void *)levels[level].tiles[index].exchange(NULL);
+    util_aligned_free(data);
+  }
+
+  string name;
+
+ protected:
+  const void *load_tile(const int level, const int tile_x, const int tile_y) override
+  {
+    const TextureCacheLevel &l = levels[level];
+    const int index = tile_y * l.tiles_x + tile_x;
+
+    cache->misses.fetch_add(1, std::memory_order_relaxed);
+
+    if (level < num_file_levels) {
+      /* Serialize file access, and check if another thread loaded the tile while we were
+       * waiting for the lock. */
+      thread_scoped_lock lock(mutex);
+
+      const void *data = l.tiles[index].load(std::memory_order_acquire);
+      if (data == NULL && load_tiles_from_file(level, tile_x, tile_y)) {
+        data = l.tiles[index].load(std::memory_order_acquire);
+      }
+      if (data != NULL) {
+        return data;
+      }
+    }
+
+    const int x = tile_x * TEXTURE_CACHE_TILE_SIZE;
+    const int y = tile_y * TEXTURE_CACHE_TILE_SIZE;
+    const int width = min(TEXTURE_CACHE_TILE_SIZE, l.width - x);
+    const int height = min(TEXTURE_CACHE_TILE_SIZE, l.height - y);
+    void *pixels = util_aligned_malloc(width * height * pixel_size, 16);
+
+    if (level > 0) {
+      generate_tile(level, tile_x, tile_y, x, y, width, height, pixels);
+    }
+    else {
+      /* Reading the file failed, use the same color as for missing images. */
+      switch (texture_cache_channel_size(type)) {
+        case sizeof(float):
+          texture_cache_fill_missing(channels, width * height, (float *)pixels);
+          break;
+        case sizeof(uint16_t):
+          if (type == IMAGE_DATA_TYPE_HALF || type == IMAGE_DATA_TYPE_HALF4) {
+            texture_cache_fill_missing(channels, width * height, (half *)pixels);
+          }
+          else {
+            texture_cache_fill_missing(channels, width * height, (uint16_t *)pixels);
+          }
+          break;
+        default:
+          texture_cache_fill_missing(channels, width * height, (uchar *)pixels);
+          break;
+      }
+    }
+
+    return publish_tile(level, index, pixels, width * height * pixel_size);
+  }
+
+  /* Get tile for internal use, without counting it as a hit. */
+  const void *find_or_load_tile(const int level, const int tile_x, const int tile_y)
+  {
+    const TextureCacheLevel &l = levels[level];
+    const void *data = l.tiles[tile_y * l.tiles_x + tile_x].load(std::memory_order_acquire);
+    return (data) ? data : load_tile(level, tile_x, tile_y);
+  }
+
+  /* Make tile available to kernels. If another thread was faster the given pixels are freed
+   * and the existing tile is returned. */
+  const void *publish_tile(const int level, const int index, void *pixels, const size_t size)
+  {
+    const void *expected = NULL;
+    if (!levels[level].tiles[index].compare_exchange_strong(
+            expected, pixels, std::memory_order_acq_rel)) {
+      util_aligned_free(pixels);
+      return expected;
+    }
+
+    cache->tile_loaded(this, level, index, size);
+    return pixels;
+  }
+
+  /* Read the tile from the file, or the full row of tiles for files which are not tiled. Must
+   * be called with the mutex locked. */
+  bool load_tiles_from_file(const int level, const int tile_x, const int tile_y)
+  {
+    const TextureCacheLevel &l = levels[level];
+    const int y = tile_y * TEXTURE_CACHE_TILE_SIZE;
+    const int height = min(TEXTURE_CACHE_TILE_SIZE, l.height - y);
+
+    if (is_tiled) {
+      const int x = tile_x * TEXTURE_CACHE_TILE_SIZE;
+      const int width = min(TEXTURE_CACHE_TILE_SIZE, l.width - x);
+      void *pixels = util_aligned_malloc(width * height * pixel_size, 16);
+
+      if (!load_region(level, x, y, width, height, pixels)) {
+        util_aligned_free(pixels);
+        return false;
+      }
+
+      publish_tile(level, tile_y * l.tiles_x + tile_x, pixels, width * height * pixel_size);
+      return true;
+    }
+
+    vector<uchar> row(((size_t)l.width) * height * pixel_size);
+    if (!load_region(level, 0, y, l.width, height, row.data())) {
+      return false;
+    }
+
+    for (int tx = 0; tx < l.tiles_x; tx++) {
+      const int index = tile_y * l.tiles_x + tx;
+      if (l.tiles[index].load(std::memory_order_acquire)) {
+        continue;
+      }
+
+      const int x = tx * TEXTURE_CACHE_TILE_SIZE;
+      const int width = min(TEXTURE_CACHE_TILE_SIZE, l.width - x);
+      uchar *pixels = (uchar *)util_aligned_malloc(width * height * pixel_size, 16);
+
+      for (int j = 0; j < height; j++) {
+        memcpy(pixels + ((size_t)j) * width * pixel_size,
+               row.data() + (((size_t)j) * l.width + x) * pixel_size,
+               width * pixel_size);
+      }
+
+      publish_tile(level, index, pixels, width * height * pixel_size);
+    }
+
+    return true;
+  }
+
+  /* Generate tile by downsampling the next finer level. */
+  void generate_tile(const int level,
+                     const int tile_x,
+                     const int tile_y,
+                     const int x,
+                     const int y,
+                     const int width,
+                     const int height,
+                     void *pixels)
+  {
+    const TextureCacheLevel &src_level = levels[level - 1];
+    const int src_tile_x = 2 * tile_x;
+    const int src_tile_y = 2 * tile_y;
+
+    const void *src_tiles[2][2] = {{NULL, NULL}, {NULL, NULL}};
+    for (int j = 0; j < 2; j++) {
+      for (int i = 0; i < 2; i++) {
+        if (src_tile_x + i < src_level.tiles_x && src_tile_y + j < src_level.tiles_y) {
+          src_tiles[j][i] = find_or_load_tile(level - 1, src_tile_x + i, src_tile_y + j);
+        }
+      }
+    }
+
+    switch (type) {
+      case IMAGE_DATA_TYPE_FLOAT4:
+      case IMAGE_DATA_TYPE_FLOAT:
+        texture_cache_downsample(src_level,
+                                 src_tiles,
+                                 src_tile_x,
+                                 src_tile_y,
+                                 channels,
+                                 x,
+                                 y,
+                                 width,
+                                 height,
+                                 (float *)pixels);
+        break;
+      case IMAGE_DATA_TYPE_HALF4:
+      case IMAGE_DATA_TYPE_HALF:
+        texture_cache_downsample(src_level,
+                                 src_tiles,
+                                 src_tile_x,
+                                 src_tile_y,
+                                 channels,
+                                 x,
+                                 y,
+                                 width,
+                                 height,
+                                 (half *)pixels);
+        break;
+      case IMAGE_DATA_TYPE_USHORT4:
+      case IMAGE_DATA_TYPE_USHORT:
+        texture_cache_downsample(src_level,
+                                 src_tiles,
+                                 src_tile_x,
+                                 src_tile_y,
+                                 channels,
+                                 x,
+                                 y,
+                                 width,
+                                 height,
+                                 (uint16_t *)pixels);
+        break;
+      default:
+        texture_cache_downsample(src_level,
+                                 src_tiles,
+                                 src_tile_x,
+                                 src_tile_y,
+                                 channels,
+                                 x,
+                                 y,
+                                 width,
+                                 height,
+                                 (uchar *)pixels);
+        break;
+    }
+  }
+
+  TextureCache *cache;
+  ImageDataType type;
+  int channels;
+  size_t pixel_size;
+  int num_file_levels;
+  bool is_tiled;
+  LoadRegionFunc load_region;
+  thread_mutex mutex;
+
+ public:
+  /* Protected by the cache mutex. */
+  size_t memory_used;
+};
+
+/* Texture Cache */
+
+TextureCache::TextureCache()
+    : memory_used(0), peak_memory_used(0), misses(0), bytes_loaded(0), evictions(0)
+{
+  state.epoch = 0;
+  for (int i = 0; i < TEXTURE_CACHE_NUM_COUNTERS; i++) {
+    state.hits[i].value = 0;
+  }
+}
+
+TextureCache::~TextureCache()
+{
+  while (!images.empty()) {
+    remove_image(images.back());
+  }
+}
+
+TextureCacheImage *TextureCache::add_image(const string &name,
+                                           const ImageDataType type,
+                                           const int width,
+                                           const int height,
+                                           const int num_file_levels,
+                                           const bool is_tiled,
+                                           const int texture_limit,
+                                           const LoadRegionFunc &load_region)
+{
+  Image *image = new Image(this,
+                           name,
+                           type,
+                           width,
+                           height,
+                           num_file_levels,
+                           is_tiled,
+                           texture_limit,
+                           load_region);
+
+  VLOG(2) << "Texture cache: added image " << name << " (" << width << "x" << height << ", "
+          << image->num_levels << " levels, " << num_file_levels << " in file"
+          << (is_tiled ? ", tiled" : "") << ").";
+
+  thread_scoped_lock lock(mutex);
+  images.push_back(image);
+  return image;
+}
+
+void TextureCache::remove_image(TextureCacheImage *image)
+{
+  thread_scoped_lock lock(mutex);
+
+  /* Free all tiles of the image. */
+  size_t num_loaded = 0;
+  for (size_t i = 0; i < loaded_tiles.size(); i++) {
+    if (loaded_tiles[i].image == image) {
+      free_tile(loaded_tiles[i]);
+    }
+    else {
+      loaded_tiles[num_loaded++] = loaded_tiles[i];
+    }
+  }
+  loaded_tiles.resize(num_loaded);
+
+  images.erase(std::remove(images.begin(), images.end(), image), images.end());
+  delete image;
+}
+
+void TextureCache::tile_loaded(Image *image, const int level, const int index, const size_t size)
+{
+  thread_scoped_lock lock(mutex);
+
+  LoadedTile tile = {image, level, index, size};
+  loaded_tiles.push_back(tile);
+
+  image->memory_used += size;
+  memory_used += size;
+  peak_memory_used = max(peak_memory_used, memory_used);
+  bytes_loaded += size;
+}
+
+void TextureCache::free_tile(const LoadedTile &tile)
+{
+  tile.image->free_tile(tile.level, tile.index);
+  tile.image->memory_used -= tile.size;
+  memory_used -= tile.size;
+}
+
+void TextureCache::evict(const size_t budget)
+{
+  thread_scoped_lock lock(mutex);
+
+  if (memory_used > budget) {
+    /* Sort tiles by the epoch in which they were last used, oldest first. */
+    vector<std::pair<uint, size_t>> order(loaded_tiles.size());
+    for (size_t i = 0; i < loaded_tiles.size(); i++) {
+      const LoadedTile &tile = loaded_tiles[i];
+      order[i] = std::make_pair(
+          tile.image->levels[tile.level].last_used[tile.index].load(std::memory_order_relaxed),
+          i);
+    }
+    std::sort(order.begin(), order.end());
+
+    vector<bool> evicted(loaded_tiles.size(), false);
+    size_t num_evicted = 0;
+    for (; num_evicted < order.size() && memory_used > budget; num_evicted++) {
+      free_tile(loaded_tiles[order[num_evicted].second]);
+      evicted[order[num_evicted].second] = true;
+    }
+
+    size_t num_loaded = 0;
+    for (size_t i = 0; i < loaded_tiles.size(); i++) {
+      if (!evicted[i]) {
+        loaded_tiles[num_loaded++] = loaded_tiles[i];
+      }
+    }
+    loaded_tiles.resize(num_loaded);
+
+    evictions += num_evicted;
+
+    VLOG(3) << "Texture cache: evicted " << num_evicted << " tiles, "
+            << string_human_readable_size(memory_used) << " in use.";
+  }
+
+  state.epoch++;
+}
+
+void TextureCache::collect_statistics(ImageStats *stats)
+{
+  thread_scoped_lock lock(mutex);
+
+  uint64_t hits = 0;
+  for (int i = 0; i < TEXTURE_CACHE_NUM_COUNTERS; i++) {
+    hits += state.hits[i].value.load(std::memory_order_relaxed);
+  }
+
+  foreach (const Image *image, images) {
+    stats->textures.add_entry(NamedSizeEntry(image->name, image->memory_used));
+  }
+
+  stats->use_texture_cache = true;
+  stats->texture_cache_hits = hits;
+  stats->texture_cache_misses = misses.load(std::memory_order_relaxed);
+  stats->texture_cache_bytes_loaded = bytes_loaded;
+  stats->texture_cache_evictions = evictions;
+  stats->texture_cache_memory = memory_used;
+  stats->texture_cache_peak_memory = peak_memory_used;
+}
+
+CCL_NAMESPACE_END
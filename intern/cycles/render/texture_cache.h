@@ -0,0 +1,97 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TEXTURE_CACHE_H__
+#define __TEXTURE_CACHE_H__
+
+#include "util/util_function.h"
+#include "util/util_string.h"
+#include "util/util_texture.h"
+#include "util/util_texture_cache.h"
+#include "util/util_thread.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class ImageStats;
+
+/* Texture Cache
+ *
+ * Keeps tiles of image mipmap levels in memory for CPU rendering, loading them when kernels
+ * first access them. Mipmap levels that are not stored in the image file are generated from
+ * the next finer level. When the memory used by tiles exceeds the budget, least recently used
+ * tiles are evicted between render passes. */
+class TextureCache {
+ public:
+  /* Load a region of a mipmap level into pixels, in the layout used for rendering. Returns
+   * false if the level is not stored in the file. */
+  typedef function<bool(int level, int x, int y, int width, int height, void *pixels)>
+      LoadRegionFunc;
+
+  TextureCache();
+  ~TextureCache();
+
+  /* Add image with the given dimensions and data type. Only the first num_file_levels
+   * levels are read from the file. For files which are not tiled, full rows of tiles are
+   * read at once since reading a region costs about as much as reading whole scanlines. */
+  TextureCacheImage *add_image(const string &name,
+                               ImageDataType type,
+                               int width,
+                               int height,
+                               int num_file_levels,
+                               bool is_tiled,
+                               int texture_limit,
+                               const LoadRegionFunc &load_region);
+  void remove_image(TextureCacheImage *image);
+
+  /* Evict least recently used tiles until memory usage is within the budget, and start a new
+   * epoch. Must only be called while no kernels are running. */
+  void evict(size_t budget);
+
+  void collect_statistics(ImageStats *stats);
+
+ protected:
+  class Image;
+
+  /* Reference to a loaded tile, for eviction. */
+  struct LoadedTile {
+    Image *image;
+    int level;
+    int index;
+    size_t size;
+  };
+
+  void tile_loaded(Image *image, int level, int index, size_t size);
+  void free_tile(const LoadedTile &tile);
+
+  TextureCacheState state;
+
+  thread_mutex mutex;
+  vector<Image *> images;
+  vector<LoadedTile> loaded_tiles;
+
+  size_t memory_used;
+  size_t peak_memory_used;
+  std::atomic<uint64_t> misses;
+  uint64_t bytes_loaded;
+  uint64_t evictions;
+
+  friend class Image;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __TEXTURE_CACHE_H__ */
@@ -41,6 +41,8 @@ static const char *ATTR_PASSES_COUNT = "cycles.passes.count";
 static const char *ATTR_PASS_SOCKET_PREFIX_FORMAT = "cycles.passes.%d.";
 static const char *ATTR_BUFFER_SOCKET_PREFIX = "cycles.buffer.";
 static const char *ATTR_DENOISE_SOCKET_PREFIX = "cycles.denoise.";
+static const char *ATTR_TILE_WIDTH = "cycles.tile.width";
+static const char *ATTR_TILE_HEIGHT = "cycles.tile.height";
 
 /* Global counter of ToleManager object instances. */
 static std::atomic<uint64_t> g_instance_index = 0;
@@ -333,6 +335,7 @@ TileManager::TileManager()
 
 TileManager::~TileManager()
 {
+  close_full_buffer_from_disk();
 }
 
 int TileManager::compute_render_tile_size(const int suggested_tile_size) const
@@ -377,6 +380,10 @@ void TileManager::update(const BufferParams &params, const Scene *scene)
   node_to_image_spec_atttributes(
       &write_state_.image_spec, &denoise_params, ATTR_DENOISE_SOCKET_PREFIX);
 
+  /* Render tile size allows to process the file tile by tile after rendering. */
+  write_state_.image_spec.attribute(ATTR_TILE_WIDTH, tile_size_.x);
+  write_state_.image_spec.attribute(ATTR_TILE_HEIGHT, tile_size_.y);
+
   if (adaptive_sampling.use) {
     overscan_ = 4;
   }
@@ -626,4 +633,129 @@ bool TileManager::read_full_buffer_from_disk(const string_view filename,
   return true;
 }
 
+bool TileManager::open_full_buffer_from_disk(const string_view filename,
+                                             BufferParams *buffer_params,
+                                             DenoiseParams *denoise_params,
+                                             int *num_tiles)
+{
+  close_full_buffer_from_disk();
+
+  unique_ptr<ImageInput> in(ImageInput::open(filename));
+  if (!in) {
+    LOG(ERROR) << "Error opening tile file " << filename;
+    return false;
+  }
+
+  const ImageSpec &image_spec = in->spec();
+
+  BufferParams params;
+  if (!buffer_params_from_image_spec_atttributes(&params, image_spec)) {
+    return false;
+  }
+
+  if (!node_from_image_spec_atttributes(denoise_params, image_spec, ATTR_DENOISE_SOCKET_PREFIX)) {
+    return false;
+  }
+
+  /* Files without render tile size are handled as a single tile covering the whole frame. */
+  int2 tile_size = make_int2(image_spec.get_int_attribute(ATTR_TILE_WIDTH, 0),
+                             image_spec.get_int_attribute(ATTR_TILE_HEIGHT, 0));
+  if (tile_size.x <= 0 || tile_size.y <= 0 || image_spec.tile_width == 0 ||
+      image_spec.tile_height == 0) {
+    tile_size = make_int2(params.width, params.height);
+  }
+
+  read_state_.tile_size = tile_size;
+  read_state_.num_tiles_x = divide_up(params.width, tile_size.x);
+  read_state_.num_tiles_y = divide_up(params.height, tile_size.y);
+  read_state_.buffer_params = params;
+  read_state_.tile_in = move(in);
+
+  *buffer_params = params;
+  *num_tiles = read_state_.num_tiles_x * read_state_.num_tiles_y;
+
+  VLOG(3) << "Opened tile file " << filename << " for streaming " << *num_tiles << " tiles.";
+
+  return true;
+}
+
+bool TileManager::read_tile_from_disk(const int tile_index,
+                                      const int overlap,
+                                      RenderBuffers *tile_buffers)
+{
+  if (!read_state_.tile_in) {
+    return false;
+  }
+
+  const ImageSpec &image_spec = read_state_.tile_in->spec();
+  const BufferParams &full_params = read_state_.buffer_params;
+  const int2 tile_size = read_state_.tile_size;
+
+  const int tile_index_y = tile_index / read_state_.num_tiles_x;
+  const int tile_index_x = tile_index - tile_index_y * read_state_.num_tiles_x;
+
+  const int window_x = tile_index_x * tile_size.x;
+  const int window_y = tile_index_y * tile_size.y;
+  const int window_width = min(tile_size.x, full_params.width - window_x);
+  const int window_height = min(tile_size.y, full_params.height - window_y);
+
+  /* Render tiles are aligned on image tiles, so extending them by whole image tiles keeps the
+   * region aligned as required by read_tiles(). */
+  const int overlap_x = (image_spec.tile_width != 0) ?
+                            align_up(overlap, image_spec.tile_width) :
+                            overlap;
+  const int overlap_y = (image_spec.tile_height != 0) ?
+                            align_up(overlap, image_spec.tile_height) :
+                            overlap;
+
+  const int x = max(0, window_x - overlap_x);
+  const int y = max(0, window_y - overlap_y);
+  const int width = min(full_params.width, window_x + window_width + overlap_x) - x;
+  const int height = min(full_params.height, window_y + window_height + overlap_y) - y;
+
+  BufferParams params = full_params;
+  params.width = width;
+  params.height = height;
+  params.full_x = full_params.full_x + x;
+  params.full_y = full_params.full_y + y;
+  params.window_x = window_x - x;
+  params.window_y = window_y - y;
+  params.window_width = window_width;
+  params.window_height = window_height;
+  params.update_offset_stride();
+
+  tile_buffers->reset(params);
+
+  VLOG(3) << "Read tile " << tile_index << " at " << window_x << ", " << window_y;
+
+  if (!read_state_.tile_in->read_tiles(0,
+                                       0,
+                                       x,
+                                       x + width,
+                                       y,
+                                       y + height,
+                                       0,
+                                       1,
+                                       TypeDesc::FLOAT,
+                                       tile_buffers->buffer.data())) {
+    LOG(ERROR) << "Error reading pixels from the tile file " << read_state_.tile_in->geterror();
+    return false;
+  }
+
+  return true;
+}
+
+void TileManager::close_full_buffer_from_disk()
+{
+  if (!read_state_.tile_in) {
+    return;
+  }
+
+  if (!read_state_.tile_in->close()) {
+    LOG(ERROR) << "Error closing tile file " << read_state_.tile_in->geterror();
+  }
+
+  read_state_.tile_in = nullptr;
+}
+
 CCL_NAMESPACE_END
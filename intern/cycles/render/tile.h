@@ -116,6 +116,24 @@ class TileManager {
                                   RenderBuffers *buffers,
                                   DenoiseParams *denoise_params);
 
+  /* Streaming access to the full frame render buffer on disk, one render tile at a time, so that
+   * the full frame is never held in memory.
+   *
+   * The buffer parameters are of the full frame, the number of tiles is based on the tile size
+   * used during rendering. Returns true on success. */
+  bool open_full_buffer_from_disk(string_view filename,
+                                  BufferParams *buffer_params,
+                                  DenoiseParams *denoise_params,
+                                  int *num_tiles);
+
+  /* Read render tile of the given index from the file opened by open_full_buffer_from_disk().
+   *
+   * The buffer contains the tile extended by at least the given number of pixels of overlap on
+   * every side within the frame, with the window set to the tile itself. */
+  bool read_tile_from_disk(int tile_index, int overlap, RenderBuffers *tile_buffers);
+
+  void close_full_buffer_from_disk();
+
   /* Compute valid tile size compatible with image saving. */
   int compute_render_tile_size(const int suggested_tile_size) const;
 
@@ -177,6 +195,17 @@ class TileManager {
 
     int num_tiles_written = 0;
   } write_state_;
+
+  /* State of streaming tiles from a file on disk. */
+  struct {
+    unique_ptr<ImageInput> tile_in;
+
+    BufferParams buffer_params;
+
+    int2 tile_size = make_int2(0, 0);
+    int num_tiles_x = 0;
+    int num_tiles_y = 0;
+  } read_state_;
 };
 
 CCL_NAMESPACE_END
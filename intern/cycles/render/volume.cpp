@@ -50,11 +50,18 @@ Volume::Volume() : Mesh(get_node_type(), Geometry::VOLUME)
   clipping = 0.001f;
   step_size = 0.0f;
   object_space = false;
+
+  occupancy_resolution = make_int3(0, 0, 0);
+  occupancy_tfm = transform_identity();
+  occupancy_index = -1;
 }
 
 void Volume::clear(bool preserve_shaders)
 {
   Mesh::clear(preserve_shaders, true);
+
+  occupancy_cells.clear();
+  occupancy_resolution = make_int3(0, 0, 0);
 }
 
 struct QuadData {
@@ -181,6 +188,8 @@ class VolumeMeshBuilder {
                              vector<int> &tris,
                              vector<float3> &face_normals);
 
+  void create_occupancy(Volume *volume);
+
   bool empty_grid() const;
 
 #ifdef WITH_OPENVDB
@@ -424,6 +433,91 @@ void VolumeMeshBuilder::convert_quads_to_tris(const vector<QuadData> &quads,
   }
 }
 
+/* Mark cells of a coarse grid which contain active voxels of the topology grid, including the
+ * padding for interpolation. Cells span VOLUME_OCCUPANCY_CELL_SIZE voxels, or more for large
+ * grids to keep memory usage bounded. */
+#define VOLUME_OCCUPANCY_CELL_SIZE 4
+#define VOLUME_OCCUPANCY_MAX_RESOLUTION 256
+
+void VolumeMeshBuilder::create_occupancy(Volume *volume)
+{
+#ifdef WITH_OPENVDB
+  /* Only linear transforms map cells to boxes in object space. */
+  const openvdb::math::Transform &grid_tfm = topology_grid->transform();
+  if (!grid_tfm.isLinear()) {
+    return;
+  }
+
+  /* Expand by one voxel, to be conservative about where the voxel is centered. */
+  openvdb::CoordBBox grid_bbox = topology_grid->evalActiveVoxelBoundingBox();
+  grid_bbox.expand(1);
+
+  const openvdb::Coord dim = grid_bbox.dim();
+  int cell_size = VOLUME_OCCUPANCY_CELL_SIZE;
+  while (dim.x() > cell_size * VOLUME_OCCUPANCY_MAX_RESOLUTION ||
+         dim.y() > cell_size * VOLUME_OCCUPANCY_MAX_RESOLUTION ||
+         dim.z() > cell_size * VOLUME_OCCUPANCY_MAX_RESOLUTION) {
+    cell_size *= 2;
+  }
+
+  const int3 resolution = make_int3(divide_up(dim.x(), cell_size),
+                                    divide_up(dim.y(), cell_size),
+                                    divide_up(dim.z(), cell_size));
+  const size_t num_cells = (size_t)resolution.x * resolution.y * resolution.z;
+
+  array<uint> &cells = volume->occupancy_cells;
+  cells.resize(divide_up(num_cells, 32));
+  memset(cells.data(), 0, cells.size() * sizeof(uint));
+
+  const openvdb::Coord origin = grid_bbox.min();
+
+  for (auto iter = topology_grid->cbeginValueOn(); iter; ++iter) {
+    openvdb::CoordBBox voxel_bbox;
+    iter.getBoundingBox(voxel_bbox);
+    voxel_bbox.expand(1);
+
+    const int3 min = make_int3((voxel_bbox.min().x() - origin.x()) / cell_size,
+                               (voxel_bbox.min().y() - origin.y()) / cell_size,
+                               (voxel_bbox.min().z() - origin.z()) / cell_size);
+    const int3 max = make_int3((voxel_bbox.max().x() - origin.x()) / cell_size,
+                               (voxel_bbox.max().y() - origin.y()) / cell_size,
+                               (voxel_bbox.max().z() - origin.z()) / cell_size);
+
+    for (int z = min.z; z <= max.z; z++) {
+      for (int y = min.y; y <= max.y; y++) {
+        for (int x = min.x; x <= max.x; x++) {
+          const size_t cell = x + resolution.x * ((size_t)y + resolution.y * (size_t)z);
+          cells[cell / 32] |= (1u << (cell % 32));
+        }
+      }
+    }
+  }
+
+  /* Object space to index space of the topology grid, then to cell coordinates. OpenVDB
+   * matrices transform row vectors. */
+  const openvdb::Mat4d m = grid_tfm.baseMap()->getAffineMap()->getMat4();
+  const Transform index_to_object = make_transform((float)m[0][0],
+                                                   (float)m[1][0],
+                                                   (float)m[2][0],
+                                                   (float)m[3][0],
+                                                   (float)m[0][1],
+                                                   (float)m[1][1],
+                                                   (float)m[2][1],
+                                                   (float)m[3][1],
+                                                   (float)m[0][2],
+                                                   (float)m[1][2],
+                                                   (float)m[2][2],
+                                                   (float)m[3][2]);
+  const Transform index_to_cell = transform_scale(make_float3(1.0f / cell_size)) *
+                                  transform_translate(-origin.x(), -origin.y(), -origin.z());
+
+  volume->occupancy_resolution = resolution;
+  volume->occupancy_tfm = index_to_cell * transform_inverse(index_to_object);
+#else
+  (void)volume;
+#endif
+}
+
 bool VolumeMeshBuilder::empty_grid() const
 {
 #ifdef WITH_OPENVDB
@@ -604,6 +698,7 @@ void GeometryManager::create_volume_mesh(Volume *volume, Progress &progress)
   vector<int> indices;
   vector<float3> face_normals;
   builder.create_mesh(vertices, indices, face_normals, face_overlap_avoidance);
+  builder.create_occupancy(volume);
 
   volume->reserve_mesh(vertices.size(), indices.size() / 3);
   volume->used_shaders.clear();
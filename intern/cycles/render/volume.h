@@ -32,6 +32,15 @@ class Volume : public Mesh {
   NODE_SOCKET_API(float, step_size)
   NODE_SOCKET_API(bool, object_space)
 
+  /* Occupancy grid built along with the volume mesh, one bit per cell. Empty when the grid could
+   * not be built, in which case the kernel steps through the whole volume. */
+  array<uint> occupancy_cells;
+  int3 occupancy_resolution;
+  /* Object space to cell coordinates. */
+  Transform occupancy_tfm;
+  /* Index in the device array, -1 when there is no occupancy grid. */
+  int occupancy_index;
+
   virtual void clear(bool preserve_shaders = false) override;
 };
 
@@ -29,6 +29,8 @@ EdgeDice::EdgeDice(const SubdParams &params_) : params(params_)
   mesh_P = NULL;
   mesh_N = NULL;
   vert_offset = 0;
+  tri_offset = 0;
+  vert_patch = NULL;
 
   params.mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 
@@ -45,8 +47,12 @@ void EdgeDice::reserve(int num_verts, int num_triangles)
   vert_offset = mesh->get_verts().size();
   tri_offset = mesh->num_triangles();
 
-  mesh->resize_mesh(mesh->get_verts().size() + num_verts, mesh->num_triangles());
-  mesh->reserve_mesh(mesh->get_verts().size() + num_verts, mesh->num_triangles() + num_triangles);
+  /* Triangles are written at known indices, so that subpatches can be diced in parallel. */
+  mesh->resize_mesh(mesh->get_verts().size() + num_verts, mesh->num_triangles() + num_triangles);
+  mesh->tag_triangles_modified();
+  mesh->tag_shader_modified();
+  mesh->tag_smooth_modified();
+  mesh->tag_triangle_patch_modified();
 
   Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 
@@ -67,19 +73,28 @@ void EdgeDice::set_vert(Patch *patch, int index, float2 uv)
   mesh_P[index] = P;
   mesh_N[index] = N;
   params.mesh->vert_patch_uv[index + vert_offset] = make_float2(uv.x, uv.y);
+
+  if (vert_patch) {
+    vert_patch[index] = patch->patch_index;
+  }
 }
 
-void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
+void EdgeDice::add_triangle(Patch *patch, int index, int v0, int v1, int v2)
 {
   Mesh *mesh = params.mesh;
+  const size_t tri = tri_offset + index;
 
-  mesh->add_triangle(v0 + vert_offset, v1 + vert_offset, v2 + vert_offset, patch->shader, true);
-  params.mesh->triangle_patch[params.mesh->num_triangles() - 1] = patch->patch_index;
+  assert(tri < mesh->num_triangles());
 
-  tri_offset++;
+  mesh->triangles[tri * 3 + 0] = v0 + vert_offset;
+  mesh->triangles[tri * 3 + 1] = v1 + vert_offset;
+  mesh->triangles[tri * 3 + 2] = v2 + vert_offset;
+  mesh->shader[tri] = patch->shader;
+  mesh->smooth[tri] = true;
+  mesh->triangle_patch[tri] = patch->patch_index;
 }
 
-void EdgeDice::stitch_triangles(Subpatch &sub, int edge)
+void EdgeDice::stitch_triangles(Subpatch &sub, int edge, int &triangle_index)
 {
   int Mu = max(sub.edge_u0.T, sub.edge_u1.T);
   int Mv = max(sub.edge_v0.T, sub.edge_v1.T);
@@ -122,7 +137,7 @@ void EdgeDice::stitch_triangles(Subpatch &sub, int edge)
         v2 = sub.get_vert_along_grid_edge(edge, ++i);
     }
 
-    add_triangle(sub.patch, v1, v0, v2);
+    add_triangle(sub.patch, triangle_index++, v1, v0, v2);
   }
 }
 
@@ -243,14 +258,16 @@ void QuadDice::add_grid(Subpatch &sub, int Mu, int Mv, int offset)
         int i3 = offset + i + j * (Mu - 1);
         int i4 = offset + (i - 1) + j * (Mu - 1);
 
-        add_triangle(sub.patch, i1, i2, i3);
-        add_triangle(sub.patch, i1, i3, i4);
+        int tri = sub.triangle_offset + ((i - 1) + (j - 1) * (Mu - 2)) * 2;
+
+        add_triangle(sub.patch, tri + 0, i1, i2, i3);
+        add_triangle(sub.patch, tri + 1, i1, i3, i4);
       }
     }
   }
 }
 
-void QuadDice::dice(Subpatch &sub)
+void QuadDice::dice_grid(Subpatch &sub)
 {
   /* compute inner grid size with scale factor */
   int Mu = max(sub.edge_u0.T, sub.edge_u1.T);
@@ -267,17 +284,30 @@ void QuadDice::dice(Subpatch &sub)
 
   /* inner grid */
   add_grid(sub, Mu, Mv, sub.inner_grid_vert_offset);
+}
 
-  /* sides */
+void QuadDice::dice_sides(Subpatch &sub)
+{
   set_side(sub, 0);
   set_side(sub, 1);
   set_side(sub, 2);
   set_side(sub, 3);
+}
+
+void QuadDice::dice_stitch(Subpatch &sub)
+{
+  int Mu = max(max(sub.edge_u0.T, sub.edge_u1.T), 2);
+  int Mv = max(max(sub.edge_v0.T, sub.edge_v1.T), 2);
+
+  /* stitching triangles follow the triangles of the inner grid */
+  int triangle_index = sub.triangle_offset + (Mu - 2) * (Mv - 2) * 2;
+
+  stitch_triangles(sub, 0, triangle_index);
+  stitch_triangles(sub, 1, triangle_index);
+  stitch_triangles(sub, 2, triangle_index);
+  stitch_triangles(sub, 3, triangle_index);
 
-  stitch_triangles(sub, 0);
-  stitch_triangles(sub, 1);
-  stitch_triangles(sub, 2);
-  stitch_triangles(sub, 3);
+  assert(triangle_index == sub.triangle_offset + sub.calc_num_triangles());
 }
 
 CCL_NAMESPACE_END
@@ -41,6 +41,7 @@ struct SubdParams {
   int split_threshold;
   float dicing_rate;
   int max_level;
+  float reuse_tolerance;
   Camera *camera;
   Transform objecttoworld;
 
@@ -53,6 +54,7 @@ struct SubdParams {
     split_threshold = 1;
     dicing_rate = 1.0f;
     max_level = 12;
+    reuse_tolerance = 0.0f;
     camera = NULL;
   }
 };
@@ -66,15 +68,17 @@ class EdgeDice {
   float3 *mesh_N;
   size_t vert_offset;
   size_t tri_offset;
+  /* Optional, receives the patch index of every diced vertex. */
+  int *vert_patch;
 
   explicit EdgeDice(const SubdParams &params);
 
   void reserve(int num_verts, int num_triangles);
 
   void set_vert(Patch *patch, int index, float2 uv);
-  void add_triangle(Patch *patch, int v0, int v1, int v2);
+  void add_triangle(Patch *patch, int index, int v0, int v1, int v2);
 
-  void stitch_triangles(Subpatch &sub, int edge);
+  void stitch_triangles(Subpatch &sub, int edge, int &triangle_index);
 };
 
 /* Quad EdgeDice */
@@ -95,7 +99,13 @@ class QuadDice : public EdgeDice {
   float quad_area(const float3 &a, const float3 &b, const float3 &c, const float3 &d);
   float scale_factor(Subpatch &sub, int Mu, int Mv);
 
-  void dice(Subpatch &sub);
+  /* Dicing is done in three passes over all subpatches. Inner grids and stitching triangles only
+   * write vertices and triangles owned by the subpatch and can be diced in parallel, vertices on
+   * the sides are shared with neighboring subpatches. Stitching reads the vertices of the other
+   * two passes. */
+  void dice_grid(Subpatch &sub);
+  void dice_sides(Subpatch &sub);
+  void dice_stitch(Subpatch &sub);
 };
 
 CCL_NAMESPACE_END
@@ -24,7 +24,10 @@
 #include "util/util_algorithm.h"
 #include "util/util_foreach.h"
 #include "util/util_hash.h"
+#include "util/util_logging.h"
 #include "util/util_math.h"
+#include "util/util_md5.h"
+#include "util/util_tbb.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -34,6 +37,7 @@ CCL_NAMESPACE_BEGIN
 #define DSPLIT_NON_UNIFORM -1
 #define STITCH_NGON_CENTER_VERT_INDEX_OFFSET 0x60000000
 #define STITCH_NGON_SPLIT_EDGE_CENTER_VERT_TAG (0x60000000 - 1)
+#define DSPLIT_FACES_PER_RANGE 256
 
 DiagSplit::DiagSplit(const SubdParams &params_) : params(params_)
 {
@@ -339,31 +343,177 @@ Edge *DiagSplit::alloc_edge()
 
 void DiagSplit::split_patches(Patch *patches, size_t patches_byte_stride)
 {
-  int patch_index = 0;
+  Mesh *mesh = params.mesh;
 
-  for (int f = 0; f < params.mesh->get_num_subd_faces(); f++) {
-    Mesh::SubdFace face = params.mesh->get_subd_face(f);
+  /* Reuse the topology diced by the previous tessellation if it is still a good fit. */
+  if (params.reuse_tolerance > 0.0f) {
+    if (!mesh->subd_diced_topology) {
+      mesh->subd_diced_topology = new SubdDicedTopology();
+    }
 
-    Patch *patch = (Patch *)(((char *)patches) + patch_index * patches_byte_stride);
+    topology = mesh->subd_diced_topology;
 
-    if (face.is_quad()) {
-      patch_index++;
+    const string key = topology_key();
+    const float scale = dicing_scale();
 
-      split_quad(face, patch);
+    if (key == topology->key && topology->dicing_scale > 0.0f &&
+        fabsf(scale / topology->dicing_scale - 1.0f) <= params.reuse_tolerance) {
+      VLOG(2) << "Reusing diced topology of mesh " << mesh->name << ".";
+      redice(patches, patches_byte_stride);
+      return;
     }
-    else {
-      patch_index += face.num_corners;
 
-      split_ngon(face, patch, patches_byte_stride);
+    topology->key = key;
+    topology->dicing_scale = scale;
+  }
+  else if (mesh->subd_diced_topology) {
+    delete mesh->subd_diced_topology;
+    mesh->subd_diced_topology = nullptr;
+  }
+
+  /* Faces only share edges through stitching keys, so ranges of faces are split independently.
+   * Each face allocates 4 verts per patch, which makes the vertex indices of a range known in
+   * advance and the result identical to splitting all faces in order. */
+  const int num_faces = mesh->get_num_subd_faces();
+  const int num_ranges = (int)divide_up(num_faces, DSPLIT_FACES_PER_RANGE);
+
+  vector<int> face_patch_index(num_faces + 1);
+  face_patch_index[0] = 0;
+
+  for (int f = 0; f < num_faces; f++) {
+    Mesh::SubdFace face = mesh->get_subd_face(f);
+    face_patch_index[f + 1] = face_patch_index[f] + (face.is_quad() ? 1 : face.num_corners);
+  }
+
+  face_ranges.clear();
+  face_ranges.resize(num_ranges);
+
+  parallel_for(0, num_ranges, [&](int range_index) {
+    const int range_begin = range_index * DSPLIT_FACES_PER_RANGE;
+    const int range_end = min(range_begin + DSPLIT_FACES_PER_RANGE, num_faces);
+
+    unique_ptr<DiagSplit> range = make_unique<DiagSplit>(params);
+    range->num_alloced_verts = face_patch_index[range_begin] * 4;
+
+    for (int f = range_begin; f < range_end; f++) {
+      Mesh::SubdFace face = mesh->get_subd_face(f);
+
+      Patch *patch = (Patch *)(((char *)patches) + face_patch_index[f] * patches_byte_stride);
+
+      if (face.is_quad()) {
+        range->split_quad(face, patch);
+      }
+      else {
+        range->split_ngon(face, patch, patches_byte_stride);
+      }
     }
+
+    face_ranges[range_index] = std::move(range);
+  });
+
+  num_alloced_verts = face_patch_index[num_faces] * 4;
+
+  foreach (unique_ptr<DiagSplit> &range, face_ranges) {
+    subpatches.insert(subpatches.end(), range->subpatches.begin(), range->subpatches.end());
   }
 
-  params.mesh->vert_to_stitching_key_map.clear();
-  params.mesh->vert_stitching_map.clear();
+  mesh->vert_to_stitching_key_map.clear();
+  mesh->vert_stitching_map.clear();
 
   post_split();
 }
 
+template<typename T> static void topology_key_append(MD5Hash &md5, const array<T> &data)
+{
+  md5.append((const uint8_t *)data.data(), data.size() * sizeof(T));
+}
+
+string DiagSplit::topology_key()
+{
+  const Mesh *mesh = params.mesh;
+  MD5Hash md5;
+
+  const int state[] = {(int)mesh->get_subdivision_type(),
+                       (int)mesh->get_verts().size(),
+                       (int)mesh->get_num_subd_faces(),
+                       params.ptex,
+                       params.test_steps,
+                       params.split_threshold,
+                       params.max_level};
+  md5.append((const uint8_t *)state, sizeof(state));
+  md5.append((const uint8_t *)&params.dicing_rate, sizeof(params.dicing_rate));
+
+  topology_key_append(md5, mesh->get_subd_start_corner());
+  topology_key_append(md5, mesh->get_subd_num_corners());
+  topology_key_append(md5, mesh->get_subd_shader());
+  topology_key_append(md5, mesh->get_subd_face_corners());
+  topology_key_append(md5, mesh->get_subd_creases_edge());
+  topology_key_append(md5, mesh->get_subd_creases_weight());
+
+  return md5.get_hex();
+}
+
+float DiagSplit::dicing_scale()
+{
+  /* Edge factors scale with the size of the mesh, in pixels when dicing for a camera. */
+  BoundBox bounds = BoundBox::empty;
+
+  foreach (const float3 &P, params.mesh->get_verts()) {
+    bounds.grow(params.camera ? transform_point(&params.objecttoworld, P) : P);
+  }
+
+  if (!bounds.valid()) {
+    return 0.0f;
+  }
+
+  float scale = len(bounds.size());
+
+  if (params.camera) {
+    scale /= params.camera->world_to_raster_size(bounds.center());
+  }
+
+  return scale;
+}
+
+void DiagSplit::redice(Patch *patches, size_t patches_byte_stride)
+{
+  Mesh *mesh = params.mesh;
+  const SubdDicedTopology &topology = *mesh->subd_diced_topology;
+
+  QuadDice dice(params);
+
+  const size_t num_verts = topology.vert_patch.size();
+  const size_t num_triangles = topology.shader.size();
+
+  dice.reserve(num_verts, num_triangles);
+
+  /* Only diced vertices move with the control mesh. */
+  parallel_for(blocked_range<size_t>(0, num_verts), [&](const blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); i++) {
+      if (topology.vert_patch[i] < 0) {
+        continue;
+      }
+
+      Patch *patch = (Patch *)(((char *)patches) + topology.vert_patch[i] * patches_byte_stride);
+      dice.EdgeDice::set_vert(patch, i, topology.vert_patch_uv[i]);
+    }
+  });
+
+  std::copy(topology.triangles.begin(),
+            topology.triangles.end(),
+            mesh->triangles.data() + dice.tri_offset * 3);
+  std::copy(topology.shader.begin(), topology.shader.end(), mesh->shader.data() + dice.tri_offset);
+  std::copy(topology.triangle_patch.begin(),
+            topology.triangle_patch.end(),
+            mesh->triangle_patch.data() + dice.tri_offset);
+  std::fill(mesh->smooth.data() + dice.tri_offset,
+            mesh->smooth.data() + dice.tri_offset + num_triangles,
+            true);
+
+  mesh->vert_to_stitching_key_map = topology.vert_to_stitching_key_map;
+  mesh->vert_stitching_map = topology.vert_stitching_map;
+}
+
 static Edge *create_edge_from_corner(DiagSplit *split,
                                      const Mesh *mesh,
                                      const Mesh::SubdFace &face,
@@ -607,14 +757,16 @@ void DiagSplit::post_split()
 
   /* All patches are now split, and all T values known. */
 
-  foreach (Edge &edge, edges) {
-    if (edge.second_vert_index < 0) {
-      edge.second_vert_index = alloc_verts(edge.T - 1);
-    }
+  foreach (unique_ptr<DiagSplit> &range, face_ranges) {
+    foreach (Edge &edge, range->edges) {
+      if (edge.second_vert_index < 0) {
+        edge.second_vert_index = alloc_verts(edge.T - 1);
+      }
 
-    if (edge.is_stitch_edge) {
-      num_stitch_verts = max(num_stitch_verts,
-                             max(edge.stitch_start_vert_index, edge.stitch_end_vert_index));
+      if (edge.is_stitch_edge) {
+        num_stitch_verts = max(num_stitch_verts,
+                               max(edge.stitch_start_vert_index, edge.stitch_end_vert_index));
+      }
     }
   }
 
@@ -630,86 +782,92 @@ void DiagSplit::post_split()
   typedef unordered_map<pair<int, int>, int, pair_hasher> edge_stitch_verts_map_t;
   edge_stitch_verts_map_t edge_stitch_verts_map;
 
-  foreach (Edge &edge, edges) {
-    if (edge.is_stitch_edge) {
-      if (edge.stitch_edge_T == 0) {
-        edge.stitch_edge_T = edge.T;
-      }
+  foreach (unique_ptr<DiagSplit> &range, face_ranges) {
+    foreach (Edge &edge, range->edges) {
+      if (edge.is_stitch_edge) {
+        if (edge.stitch_edge_T == 0) {
+          edge.stitch_edge_T = edge.T;
+        }
 
-      if (edge_stitch_verts_map.find(edge.stitch_edge_key) == edge_stitch_verts_map.end()) {
-        edge_stitch_verts_map[edge.stitch_edge_key] = num_stitch_verts;
-        num_stitch_verts += edge.stitch_edge_T - 1;
+        if (edge_stitch_verts_map.find(edge.stitch_edge_key) == edge_stitch_verts_map.end()) {
+          edge_stitch_verts_map[edge.stitch_edge_key] = num_stitch_verts;
+          num_stitch_verts += edge.stitch_edge_T - 1;
+        }
       }
     }
   }
 
   /* Set start and end indices for edges generated from a split. */
-  foreach (Edge &edge, edges) {
-    if (edge.start_vert_index < 0) {
-      /* Fix up offsets. */
-      if (edge.top_indices_decrease) {
-        edge.top_offset = edge.top->T - edge.top_offset;
+  foreach (unique_ptr<DiagSplit> &range, face_ranges) {
+    foreach (Edge &edge, range->edges) {
+      if (edge.start_vert_index < 0) {
+        /* Fix up offsets. */
+        if (edge.top_indices_decrease) {
+          edge.top_offset = edge.top->T - edge.top_offset;
+        }
+
+        edge.start_vert_index = edge.top->get_vert_along_edge(edge.top_offset);
       }
 
-      edge.start_vert_index = edge.top->get_vert_along_edge(edge.top_offset);
-    }
+      if (edge.end_vert_index < 0) {
+        if (edge.bottom_indices_decrease) {
+          edge.bottom_offset = edge.bottom->T - edge.bottom_offset;
+        }
 
-    if (edge.end_vert_index < 0) {
-      if (edge.bottom_indices_decrease) {
-        edge.bottom_offset = edge.bottom->T - edge.bottom_offset;
+        edge.end_vert_index = edge.bottom->get_vert_along_edge(edge.bottom_offset);
       }
-
-      edge.end_vert_index = edge.bottom->get_vert_along_edge(edge.bottom_offset);
     }
   }
 
   int vert_offset = params.mesh->verts.size();
 
   /* Add verts to stitching map. */
-  foreach (const Edge &edge, edges) {
-    if (edge.is_stitch_edge) {
-      int second_stitch_vert_index = edge_stitch_verts_map[edge.stitch_edge_key];
+  foreach (unique_ptr<DiagSplit> &range, face_ranges) {
+    foreach (const Edge &edge, range->edges) {
+      if (edge.is_stitch_edge) {
+        int second_stitch_vert_index = edge_stitch_verts_map[edge.stitch_edge_key];
 
-      for (int i = 0; i <= edge.T; i++) {
-        /* Get proper stitching key. */
-        int key;
+        for (int i = 0; i <= edge.T; i++) {
+          /* Get proper stitching key. */
+          int key;
 
-        if (i == 0) {
-          key = edge.stitch_start_vert_index;
-        }
-        else if (i == edge.T) {
-          key = edge.stitch_end_vert_index;
-        }
-        else {
-          key = second_stitch_vert_index + i - 1 + edge.stitch_offset;
-        }
-
-        if (key == STITCH_NGON_SPLIT_EDGE_CENTER_VERT_TAG) {
           if (i == 0) {
-            key = second_stitch_vert_index - 1 + edge.stitch_offset;
+            key = edge.stitch_start_vert_index;
           }
           else if (i == edge.T) {
-            key = second_stitch_vert_index - 1 + edge.T;
-          }
-        }
-        else if (key < 0 && edge.top) { /* ngon spoke edge */
-          int s = edge_stitch_verts_map[edge.top->stitch_edge_key];
-          if (edge.stitch_top_offset >= 0) {
-            key = s - 1 + edge.stitch_top_offset;
+            key = edge.stitch_end_vert_index;
           }
           else {
-            key = s - 1 + edge.top->stitch_edge_T + edge.stitch_top_offset;
+            key = second_stitch_vert_index + i - 1 + edge.stitch_offset;
           }
-        }
 
-        /* Get real vert index. */
-        int vert = edge.get_vert_along_edge(i) + vert_offset;
+          if (key == STITCH_NGON_SPLIT_EDGE_CENTER_VERT_TAG) {
+            if (i == 0) {
+              key = second_stitch_vert_index - 1 + edge.stitch_offset;
+            }
+            else if (i == edge.T) {
+              key = second_stitch_vert_index - 1 + edge.T;
+            }
+          }
+          else if (key < 0 && edge.top) { /* ngon spoke edge */
+            int s = edge_stitch_verts_map[edge.top->stitch_edge_key];
+            if (edge.stitch_top_offset >= 0) {
+              key = s - 1 + edge.stitch_top_offset;
+            }
+            else {
+              key = s - 1 + edge.top->stitch_edge_T + edge.stitch_top_offset;
+            }
+          }
+
+          /* Get real vert index. */
+          int vert = edge.get_vert_along_edge(i) + vert_offset;
 
-        /* Add to map */
-        if (params.mesh->vert_to_stitching_key_map.find(vert) ==
-            params.mesh->vert_to_stitching_key_map.end()) {
-          params.mesh->vert_to_stitching_key_map[vert] = key;
-          params.mesh->vert_stitching_map.insert({key, vert});
+          /* Add to map */
+          if (params.mesh->vert_to_stitching_key_map.find(vert) ==
+              params.mesh->vert_to_stitching_key_map.end()) {
+            params.mesh->vert_to_stitching_key_map[vert] = key;
+            params.mesh->vert_stitching_map.insert({key, vert});
+          }
         }
       }
     }
@@ -721,14 +879,6 @@ void DiagSplit::post_split()
   int num_verts = num_alloced_verts;
   int num_triangles = 0;
 
-  for (size_t i = 0; i < subpatches.size(); i++) {
-    subpatches[i].inner_grid_vert_offset = num_verts;
-    num_verts += subpatches[i].calc_num_inner_verts();
-    num_triangles += subpatches[i].calc_num_triangles();
-  }
-
-  dice.reserve(num_verts, num_triangles);
-
   for (size_t i = 0; i < subpatches.size(); i++) {
     Subpatch &sub = subpatches[i];
 
@@ -737,12 +887,59 @@ void DiagSplit::post_split()
     sub.edge_v0.T = max(sub.edge_v0.T, 1);
     sub.edge_v1.T = max(sub.edge_v1.T, 1);
 
-    dice.dice(sub);
+    sub.inner_grid_vert_offset = num_verts;
+    sub.triangle_offset = num_triangles;
+    num_verts += sub.calc_num_inner_verts();
+    num_triangles += sub.calc_num_triangles();
+  }
+
+  dice.reserve(num_verts, num_triangles);
+
+  if (topology) {
+    topology->vert_patch.assign(num_verts, -1);
+    dice.vert_patch = topology->vert_patch.data();
+  }
+
+  const blocked_range<size_t> range(0, subpatches.size(), 16);
+
+  parallel_for(range, [&](const blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); i++) {
+      dice.dice_grid(subpatches[i]);
+    }
+  });
+
+  /* Side vertices are set by every subpatch sharing them, in order to be deterministic. */
+  for (size_t i = 0; i < subpatches.size(); i++) {
+    dice.dice_sides(subpatches[i]);
+  }
+
+  parallel_for(range, [&](const blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); i++) {
+      dice.dice_stitch(subpatches[i]);
+    }
+  });
+
+  if (topology) {
+    Mesh *mesh = params.mesh;
+    const size_t vert_begin = dice.vert_offset;
+    const size_t tri_begin = dice.tri_offset;
+
+    topology->vert_patch_uv.assign(mesh->vert_patch_uv.data() + vert_begin,
+                                   mesh->vert_patch_uv.data() + vert_begin + num_verts);
+    topology->triangles.assign(mesh->triangles.data() + tri_begin * 3,
+                               mesh->triangles.data() + (tri_begin + num_triangles) * 3);
+    topology->shader.assign(mesh->shader.data() + tri_begin,
+                            mesh->shader.data() + tri_begin + num_triangles);
+    topology->triangle_patch.assign(mesh->triangle_patch.data() + tri_begin,
+                                    mesh->triangle_patch.data() + tri_begin + num_triangles);
+    topology->vert_to_stitching_key_map = mesh->vert_to_stitching_key_map;
+    topology->vert_stitching_map = mesh->vert_stitching_map;
   }
 
   /* Cleanup */
   subpatches.clear();
   edges.clear();
+  face_ranges.clear();
 }
 
 CCL_NAMESPACE_END
@@ -26,7 +26,10 @@
 #include "subd/subd_subpatch.h"
 
 #include "util/util_deque.h"
+#include "util/util_map.h"
+#include "util/util_string.h"
 #include "util/util_types.h"
+#include "util/util_unique_ptr.h"
 #include "util/util_vector.h"
 
 #include <deque>
@@ -36,6 +39,27 @@ CCL_NAMESPACE_BEGIN
 class Mesh;
 class Patch;
 
+/* Diced topology of a mesh, kept between tessellations. When the control mesh topology is
+ * unchanged and its size on screen is within a tolerance, as is common for deforming meshes in
+ * animations, splitting and dicing are skipped and only the diced vertices are evaluated again. */
+struct SubdDicedTopology {
+  /* Hash of the control mesh topology and dicing parameters. */
+  string key;
+  /* Size of the mesh relative to the dicing rate, when the topology was diced. */
+  float dicing_scale = 0.0f;
+
+  /* Patch and patch coordinates of diced vertices. */
+  vector<int> vert_patch;
+  vector<float2> vert_patch_uv;
+
+  vector<int> triangles;
+  vector<int> shader;
+  vector<int> triangle_patch;
+
+  unordered_map<int, int> vert_to_stitching_key_map;
+  unordered_multimap<int, int> vert_stitching_map;
+};
+
 class DiagSplit {
   SubdParams params;
 
@@ -43,6 +67,13 @@ class DiagSplit {
   /* `deque` is used so that element pointers remain valid when size is changed. */
   deque<Edge> edges;
 
+  /* Ranges of faces are split in parallel, each into its own edges and subpatches. The splits are
+   * kept until dicing is done, as subpatches reference their edges. */
+  vector<unique_ptr<DiagSplit>> face_ranges;
+
+  /* Topology to record the dicing into, when reuse is enabled. */
+  SubdDicedTopology *topology = nullptr;
+
   float3 to_world(Patch *patch, float2 uv);
   int T(Patch *patch, float2 Pstart, float2 Pend, bool recursive_resolve = false);
 
@@ -57,6 +88,10 @@ class DiagSplit {
   int num_alloced_verts = 0;
   int alloc_verts(int n); /* Returns start index of new verts. */
 
+  string topology_key();
+  float dicing_scale();
+  void redice(Patch *patches, size_t patches_byte_stride);
+
  public:
   Edge *alloc_edge();
 
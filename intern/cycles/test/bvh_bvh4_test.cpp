@@ -0,0 +1,114 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "bvh/bvh4.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_hash.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Dequantize the bounds of a child the same way as the kernel. */
+BoundBox bvh4_dequantize_bounds(const int4 data[BVH4_NODE_SIZE], const int child)
+{
+  const float3 origin = make_float3(
+      __int_as_float(data[2].x), __int_as_float(data[2].y), __int_as_float(data[2].z));
+  const float3 scale = make_float3(
+      __int_as_float(data[3].x), __int_as_float(data[3].y), __int_as_float(data[3].z));
+  const int shift = 8 * child;
+  const uint q[6] = {((uint)data[4].x >> shift) & 0xff,
+                     ((uint)data[4].y >> shift) & 0xff,
+                     ((uint)data[4].z >> shift) & 0xff,
+                     ((uint)data[4].w >> shift) & 0xff,
+                     ((uint)data[5].x >> shift) & 0xff,
+                     ((uint)data[5].y >> shift) & 0xff};
+
+  return BoundBox(make_float3(origin.x + q[0] * scale.x,
+                              origin.y + q[2] * scale.y,
+                              origin.z + q[4] * scale.z),
+                  make_float3(origin.x + q[1] * scale.x,
+                              origin.y + q[3] * scale.y,
+                              origin.z + q[5] * scale.z));
+}
+
+void expect_conservative_bounds(const BoundBox *bounds, const int num)
+{
+  int4 data[BVH4_NODE_SIZE];
+  memset(data, 0, sizeof(data));
+  bvh4_pack_node_bounds(bounds, num, data);
+
+  for (int i = 0; i < num; ++i) {
+    const BoundBox quantized = bvh4_dequantize_bounds(data, i);
+    for (int axis = 0; axis < 3; ++axis) {
+      ASSERT_LE(quantized.min[axis], bounds[i].min[axis]) << "child " << i << " axis " << axis;
+      ASSERT_GE(quantized.max[axis], bounds[i].max[axis]) << "child " << i << " axis " << axis;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(BVH4, quantized_bounds_contain_child_bounds)
+{
+  const float offsets[] = {0.0f, 1.0f, -1000.0f, 123456.0f};
+  const float sizes[] = {1e-4f, 1.0f, 100.0f, 1e4f};
+
+  uint seed = 0;
+  for (const float offset : offsets) {
+    for (const float size : sizes) {
+      for (int iteration = 0; iteration < 1000; ++iteration) {
+        const int num = 1 + hash_uint(seed++) % BVH4_NUM_CHILDREN;
+        BoundBox bounds[BVH4_NUM_CHILDREN];
+        for (int i = 0; i < num; ++i) {
+          const float3 center = make_float3(hash_uint_to_float(seed++) - 0.5f,
+                                            hash_uint_to_float(seed++) - 0.5f,
+                                            hash_uint_to_float(seed++) - 0.5f);
+          const float3 extent = make_float3(hash_uint_to_float(seed++),
+                                            hash_uint_to_float(seed++),
+                                            hash_uint_to_float(seed++)) *
+                                (1.0f / 16.0f);
+          bounds[i] = BoundBox((center - extent) * size + make_float3(offset),
+                               (center + extent) * size + make_float3(offset));
+        }
+        expect_conservative_bounds(bounds, num);
+      }
+    }
+  }
+}
+
+TEST(BVH4, quantized_bounds_of_flat_children)
+{
+  /* Children without extent along an axis, as for axis aligned quads. */
+  BoundBox bounds[BVH4_NUM_CHILDREN] = {
+      BoundBox(make_float3(0.0f, 0.0f, 0.0f), make_float3(1.0f, 1.0f, 0.0f)),
+      BoundBox(make_float3(1.0f, 0.0f, 0.0f), make_float3(2.0f, 1.0f, 0.0f)),
+      BoundBox(make_float3(0.0f, 1.0f, 0.0f), make_float3(1.0f, 2.0f, 0.0f)),
+      BoundBox(make_float3(1.0f, 1.0f, 0.0f), make_float3(2.0f, 2.0f, 0.0f)),
+  };
+  expect_conservative_bounds(bounds, BVH4_NUM_CHILDREN);
+
+  /* All children at the same point. */
+  const BoundBox point(make_float3(3.0f, -2.0f, 0.5f), make_float3(3.0f, -2.0f, 0.5f));
+  BoundBox points[BVH4_NUM_CHILDREN] = {point, point, point, point};
+  expect_conservative_bounds(points, BVH4_NUM_CHILDREN);
+}
+
+CCL_NAMESPACE_END
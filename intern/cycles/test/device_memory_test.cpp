@@ -0,0 +1,87 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device_memory.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+void expect_ranges_eq(const vector<device_memory_range> &ranges,
+                      const vector<device_memory_range> &expected)
+{
+  ASSERT_EQ(ranges.size(), expected.size());
+  for (size_t i = 0; i < ranges.size(); i++) {
+    EXPECT_EQ(ranges[i].offset, expected[i].offset) << "range " << i;
+    EXPECT_EQ(ranges[i].size, expected[i].size) << "range " << i;
+  }
+}
+
+}  // namespace
+
+TEST(device_memory_merge_ranges, empty)
+{
+  vector<device_memory_range> ranges;
+  device_memory_merge_ranges(ranges);
+  EXPECT_TRUE(ranges.empty());
+}
+
+TEST(device_memory_merge_ranges, single)
+{
+  vector<device_memory_range> ranges = {{10, 5}};
+  device_memory_merge_ranges(ranges);
+  expect_ranges_eq(ranges, {{10, 5}});
+}
+
+TEST(device_memory_merge_ranges, disjoint_unsorted)
+{
+  vector<device_memory_range> ranges = {{20, 5}, {0, 5}, {10, 5}};
+  device_memory_merge_ranges(ranges);
+  expect_ranges_eq(ranges, {{0, 5}, {10, 5}, {20, 5}});
+}
+
+TEST(device_memory_merge_ranges, adjacent)
+{
+  vector<device_memory_range> ranges = {{5, 5}, {0, 5}, {10, 2}};
+  device_memory_merge_ranges(ranges);
+  expect_ranges_eq(ranges, {{0, 12}});
+}
+
+TEST(device_memory_merge_ranges, overlapping)
+{
+  vector<device_memory_range> ranges = {{0, 10}, {5, 10}, {30, 4}, {32, 4}};
+  device_memory_merge_ranges(ranges);
+  expect_ranges_eq(ranges, {{0, 15}, {30, 6}});
+}
+
+TEST(device_memory_merge_ranges, contained)
+{
+  /* A range inside a previous one must not shrink the merged range. */
+  vector<device_memory_range> ranges = {{0, 100}, {10, 5}, {50, 10}, {100, 1}};
+  device_memory_merge_ranges(ranges);
+  expect_ranges_eq(ranges, {{0, 101}});
+}
+
+TEST(device_memory_merge_ranges, duplicate)
+{
+  vector<device_memory_range> ranges = {{7, 3}, {7, 3}, {7, 1}};
+  device_memory_merge_ranges(ranges);
+  expect_ranges_eq(ranges, {{7, 3}});
+}
+
+CCL_NAMESPACE_END
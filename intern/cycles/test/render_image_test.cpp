@@ -0,0 +1,171 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+#include "render/image.h"
+#include "render/scene.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_progress.h"
+#include "util/util_stats.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Image loader that is not builtin and supports loading regions, like files on disk. */
+class TestImageLoader : public ImageLoader {
+ public:
+  TestImageLoader(const string &name, const int width, const int height)
+      : name_(name), width_(width), height_(height)
+  {
+  }
+
+  bool load_metadata(const ImageDeviceFeatures & /*features*/, ImageMetaData &metadata) override
+  {
+    metadata.width = width_;
+    metadata.height = height_;
+    metadata.depth = 1;
+    metadata.channels = 4;
+    metadata.type = IMAGE_DATA_TYPE_FLOAT4;
+    return true;
+  }
+
+  bool load_pixels(const ImageMetaData & /*metadata*/,
+                   void *pixels,
+                   const size_t pixels_size,
+                   const bool /*associate_alpha*/) override
+  {
+    std::fill_n((float *)pixels, pixels_size, 0.5f);
+    return true;
+  }
+
+  bool load_region_metadata(const ImageMetaData & /*metadata*/,
+                            int &num_miplevels,
+                            bool &is_tiled) override
+  {
+    num_miplevels = 1;
+    is_tiled = true;
+    return true;
+  }
+
+  bool load_pixels_region(const ImageMetaData & /*metadata*/,
+                          const int /*miplevel*/,
+                          const int /*x*/,
+                          const int /*y*/,
+                          const int width,
+                          const int height,
+                          void *pixels,
+                          const bool /*associate_alpha*/) override
+  {
+    std::fill_n((float *)pixels, (size_t)width * height * 4, 0.5f);
+    return true;
+  }
+
+  string name() const override
+  {
+    return name_;
+  }
+
+  bool equals(const ImageLoader &other) const override
+  {
+    return name_ == ((const TestImageLoader &)other).name_;
+  }
+
+ private:
+  string name_;
+  int width_, height_;
+};
+
+}  // namespace
+
+class RenderImage : public testing::Test {
+ protected:
+  Stats stats;
+  Profiler profiler;
+  DeviceInfo device_info;
+  Device *device_cpu;
+  SceneParams scene_params;
+  Scene *scene;
+  Progress progress;
+
+  virtual void SetUp()
+  {
+    device_cpu = Device::create(device_info, stats, profiler);
+    scene = new Scene(scene_params, device_cpu);
+  }
+
+  virtual void TearDown()
+  {
+    delete scene;
+    delete device_cpu;
+  }
+
+  device_texture *load_image(const string &name, ImageHandle &handle)
+  {
+    handle = scene->image_manager->add_image(
+        new TestImageLoader(name, 64, 32), ImageParams(), false);
+    scene->image_manager->device_update(device_cpu, scene, progress);
+    return handle.image_memory();
+  }
+};
+
+/* Without a texture cache size the full image is loaded into device memory. */
+TEST_F(RenderImage, load_uncached)
+{
+  scene->params.texture_cache_size = 0;
+
+  ImageHandle handle;
+  device_texture *mem = load_image("uncached", handle);
+  ASSERT_NE(mem, nullptr);
+  EXPECT_EQ(mem->info.cache, 0);
+  EXPECT_EQ(mem->data_width, 64);
+  EXPECT_EQ(mem->data_height, 32);
+}
+
+/* With a texture cache size, tiles are loaded on demand and the texture is a placeholder. */
+TEST_F(RenderImage, load_cached)
+{
+  scene->params.texture_cache_size = 16;
+
+  ImageHandle handle;
+  device_texture *mem = load_image("cached", handle);
+  ASSERT_NE(mem, nullptr);
+  EXPECT_NE(mem->info.cache, 0);
+  EXPECT_EQ(mem->data_width, 1);
+  EXPECT_EQ(mem->data_height, 1);
+}
+
+/* The texture cache is kept once created, disabling it must still load images fully. */
+TEST_F(RenderImage, load_uncached_after_cache_disabled)
+{
+  scene->params.texture_cache_size = 16;
+  ImageHandle cached_handle;
+  EXPECT_NE(load_image("cached", cached_handle)->info.cache, 0);
+
+  scene->params.texture_cache_size = 0;
+  ImageHandle handle;
+  device_texture *mem = load_image("uncached", handle);
+  ASSERT_NE(mem, nullptr);
+  EXPECT_EQ(mem->info.cache, 0);
+  EXPECT_EQ(mem->data_width, 64);
+  EXPECT_EQ(mem->data_height, 32);
+}
+
+CCL_NAMESPACE_END
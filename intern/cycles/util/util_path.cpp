@@ -32,18 +32,21 @@ OIIO_NAMESPACE_USING
 #  define DIR_SEP '\\'
 #  define DIR_SEP_ALT '/'
 #  include <direct.h>
+#  include <sys/utime.h>
 #else
 #  define DIR_SEP '/'
 #  include <dirent.h>
 #  include <pwd.h>
 #  include <sys/types.h>
 #  include <unistd.h>
+#  include <utime.h>
 #endif
 
 #ifdef HAVE_SHLWAPI_H
 #  include <shlwapi.h>
 #endif
 
+#include "util/util_algorithm.h"
 #include "util/util_map.h"
 #include "util/util_windows.h"
 
@@ -750,6 +753,21 @@ bool path_remove(const string &path)
   return remove(path.c_str()) == 0;
 }
 
+bool path_rename(const string &from, const string &to)
+{
+  return rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool path_touch(const string &path)
+{
+#ifdef _WIN32
+  wstring path_wc = string_to_wstring(path);
+  return _wutime(path_wc.c_str(), NULL) == 0;
+#else
+  return utime(path.c_str(), NULL) == 0;
+#endif
+}
+
 FILE *path_fopen(const string &path, const string &mode)
 {
 #ifdef _WIN32
@@ -761,6 +779,52 @@ FILE *path_fopen(const string &path, const string &mode)
 #endif
 }
 
+void path_remove_least_recently_modified(const string &dir,
+                                         const string &extension,
+                                         const size_t max_size)
+{
+  if (!path_exists(dir)) {
+    return;
+  }
+
+  struct FileInfo {
+    uint64_t modified_time;
+    size_t size;
+    string path;
+  };
+  vector<FileInfo> files;
+  size_t total_size = 0;
+
+  directory_iterator it(dir), it_end;
+  for (; it != it_end; ++it) {
+    const string path = it->path();
+    path_stat_t st;
+    if (!string_endswith(path, extension) || path_stat(path, &st) != 0) {
+      continue;
+    }
+    files.push_back({(uint64_t)st.st_mtime, (size_t)st.st_size, path});
+    total_size += st.st_size;
+  }
+
+  if (total_size <= max_size) {
+    return;
+  }
+
+  sort(files.begin(), files.end(), [](const FileInfo &a, const FileInfo &b) {
+    return a.modified_time < b.modified_time;
+  });
+
+  for (const FileInfo &file : files) {
+    if (total_size <= max_size) {
+      break;
+    }
+    /* Removing may fail when another process removed the file first, or has it opened. */
+    if (path_remove(file.path)) {
+      total_size -= file.size;
+    }
+  }
+}
+
 void path_cache_clear_except(const string &name, const set<string> &except)
 {
   string dir = path_user_get("cache");
@@ -65,9 +65,17 @@ bool path_read_text(const string &path, string &text);
 
 /* File manipulation. */
 bool path_remove(const string &path);
+bool path_rename(const string &from, const string &to);
+/* Set the modification time of a file to the current time. */
+bool path_touch(const string &path);
 
 /* cache utility */
 void path_cache_clear_except(const string &name, const set<string> &except);
+/* Remove files with the given extension from a directory, least recently modified first, until
+ * their total size is at most max_size bytes. */
+void path_remove_least_recently_modified(const string &dir,
+                                         const string &extension,
+                                         const size_t max_size);
 
 CCL_NAMESPACE_END
 
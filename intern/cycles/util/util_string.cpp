@@ -265,4 +265,34 @@ string string_human_readable_number(size_t num)
   return p;
 }
 
+string string_to_json(const string &str)
+{
+  string result = "\"";
+  foreach (const char c, str) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      case '\t':
+        result += "\\t";
+        break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          result += string_printf("\\u%04x", c);
+        }
+        else {
+          result += c;
+        }
+        break;
+    }
+  }
+  return result + "\"";
+}
+
 CCL_NAMESPACE_END
@@ -79,6 +79,9 @@ string string_human_readable_size(size_t size);
 /* Make a string from a unit-less quantity in human readable form. */
 string string_human_readable_number(size_t num);
 
+/* Make a quoted JSON string literal, escaping special characters. */
+string string_to_json(const string &str);
+
 CCL_NAMESPACE_END
 
 #endif /* __UTIL_STRING_H__ */
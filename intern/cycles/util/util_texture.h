@@ -17,6 +17,7 @@
 #ifndef __UTIL_TEXTURE_H__
 #define __UTIL_TEXTURE_H__
 
+#include "util_half.h"
 #include "util_transform.h"
 
 CCL_NAMESPACE_BEGIN
@@ -50,10 +51,45 @@ typedef enum ImageDataType {
   IMAGE_DATA_TYPE_USHORT = 7,
   IMAGE_DATA_TYPE_NANOVDB_FLOAT = 8,
   IMAGE_DATA_TYPE_NANOVDB_FLOAT3 = 9,
+  IMAGE_DATA_TYPE_BLOCK_HALF4 = 10,
+  IMAGE_DATA_TYPE_BLOCK_HALF = 11,
 
   IMAGE_DATA_NUM_TYPES
 } ImageDataType;
 
+/* Block compressed textures, only supported on the CPU.
+ *
+ * Texels are stored in blocks of 4x4, with for every channel two half float endpoints and a
+ * 4 bit index per texel, interpolating linearly between the endpoints. */
+#define TEXTURE_BLOCK_SIZE 4
+
+typedef struct TextureBlockHalf {
+  half endpoints[2];
+  uint indices[2];
+} TextureBlockHalf;
+
+typedef struct TextureBlockHalf4 {
+  TextureBlockHalf channels[4];
+} TextureBlockHalf4;
+
+#ifndef __KERNEL_GPU__
+ccl_device_inline float texture_block_decode(const TextureBlockHalf &block, const int i)
+{
+  const uint index = (block.indices[i >> 3] >> ((i & 7) * 4)) & 0xF;
+  const float lo = half_to_float(block.endpoints[0]);
+  const float hi = half_to_float(block.endpoints[1]);
+  return lo + (hi - lo) * ((float)index * (1.0f / 15.0f));
+}
+
+ccl_device_inline float4 texture_block_decode(const TextureBlockHalf4 &block, const int i)
+{
+  return make_float4(texture_block_decode(block.channels[0], i),
+                     texture_block_decode(block.channels[1], i),
+                     texture_block_decode(block.channels[2], i),
+                     texture_block_decode(block.channels[3], i));
+}
+#endif
+
 /* Alpha types
  * How to treat alpha in images. */
 typedef enum ImageAlphaType {
@@ -83,6 +119,8 @@ typedef enum ExtensionType {
 typedef struct TextureInfo {
   /* Pointer, offset or texture depending on device. */
   uint64_t data;
+  /* Texture cache image on the CPU, when tiles are loaded on demand. */
+  uint64_t cache;
   /* Data Type */
   uint data_type;
   /* Interpolation and extension type. */
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2011-2021 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_TEXTURE_CACHE_H__
+#define __UTIL_TEXTURE_CACHE_H__
+
+#include <atomic>
+
+#include "util/util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Texture cache for CPU rendering.
+ *
+ * Images in the cache are stored as a chain of mipmap levels, each split into
+ * square tiles which are loaded the first time a kernel accesses them. This
+ * header contains the part that is shared between the CPU kernels, which look
+ * up tiles, and the TextureCache in the render module, which loads tiles and
+ * evicts them when the cache is over its memory budget. */
+
+#define TEXTURE_CACHE_TILE_SIZE_LOG2 6
+#define TEXTURE_CACHE_TILE_SIZE (1 << TEXTURE_CACHE_TILE_SIZE_LOG2)
+#define TEXTURE_CACHE_MAX_LEVELS 16
+#define TEXTURE_CACHE_NUM_COUNTERS 64
+
+typedef struct TextureCacheLevel {
+  /* Dimensions of the mipmap level in pixels and in tiles. */
+  int width, height;
+  int tiles_x, tiles_y;
+
+  /* Pixels of each tile, NULL when the tile is not loaded. Tiles on the right and top border
+   * are cropped to the level dimensions. */
+  std::atomic<const void *> *tiles;
+
+  /* Epoch in which each tile was last used, for least recently used eviction. */
+  std::atomic<uint> *last_used;
+} TextureCacheLevel;
+
+/* Hit counter, padded to its own cache line. Kernel threads increment one of several counters
+ * to avoid contention. */
+typedef struct alignas(64) TextureCacheCounter {
+  std::atomic<uint64_t> value;
+} TextureCacheCounter;
+
+/* State shared by all images in the cache. */
+typedef struct TextureCacheState {
+  /* Incremented by the cache at the end of every render pass. Tiles are only evicted between
+   * render passes, so kernels can use tile pointers without any locking. */
+  uint epoch;
+
+  TextureCacheCounter hits[TEXTURE_CACHE_NUM_COUNTERS];
+} TextureCacheState;
+
+class TextureCacheImage {
+ public:
+  TextureCacheImage() : num_levels(0), min_level(0), state(NULL)
+  {
+  }
+
+  virtual ~TextureCacheImage()
+  {
+  }
+
+  /* Return pixels of the tile, loading it on a cache miss. The thread hash is used to pick a
+   * hit counter. Safe to be called from multiple threads. */
+  ccl_always_inline const void *tile(const int level,
+                                     const int tile_x,
+                                     const int tile_y,
+                                     const uint thread_hash)
+  {
+    const TextureCacheLevel &l = levels[level];
+    const int index = tile_y * l.tiles_x + tile_x;
+
+    /* Only store when needed, to avoid threads writing to the same cache line all the time. */
+    if (l.last_used[index].load(std::memory_order_relaxed) != state->epoch) {
+      l.last_used[index].store(state->epoch, std::memory_order_relaxed);
+    }
+
+    const void *data = l.tiles[index].load(std::memory_order_acquire);
+    if (data == NULL) {
+      return load_tile(level, tile_x, tile_y);
+    }
+
+    state->hits[thread_hash % TEXTURE_CACHE_NUM_COUNTERS].value.fetch_add(
+        1, std::memory_order_relaxed);
+    return data;
+  }
+
+  /* Mipmap levels, the first one being the full resolution image. Levels below min_level are
+   * never accessed, to respect texture size limits. */
+  int num_levels;
+  int min_level;
+  TextureCacheLevel levels[TEXTURE_CACHE_MAX_LEVELS];
+
+ protected:
+  virtual const void *load_tile(const int level, const int tile_x, const int tile_y) = 0;
+
+  TextureCacheState *state;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_TEXTURE_CACHE_H__ */
@@ -1790,5 +1790,17 @@ void blo_do_versions_300(FileData *fd, Library *UNUSED(lib), Main *bmain)
       version_node_id(ntree, GEO_NODE_SET_MATERIAL, "GeometryNodeSetMaterial");
       version_node_id(ntree, GEO_NODE_SPLIT_EDGES, "GeometryNodeSplitEdges");
     }
+
+    if (!DNA_struct_elem_find(
+            fd->filesdna, "NodesModifierData", "int", "output_cache_memory_limit")) {
+      LISTBASE_FOREACH (Object *, ob, &bmain->objects) {
+        LISTBASE_FOREACH (ModifierData *, md, &ob->modifiers) {
+          if (md->type == eModifierType_Nodes) {
+            NodesModifierData *nmd = (NodesModifierData *)md;
+            nmd->output_cache_memory_limit = 1024;
+          }
+        }
+      }
+    }
   }
 }
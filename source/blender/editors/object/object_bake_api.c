@@ -949,7 +949,7 @@ static bool bake_targets_init_vertex_colors(BakeTargets *targets, Object *ob, Re
   bk_image->offset = 0;
   bk_image->image = NULL;
 
-  targets->num_pixels = bk_image->width * bk_image->height;
+  targets->num_pixels = (size_t)bk_image->width * (size_t)bk_image->height;
 
   return true;
 }
@@ -987,10 +987,10 @@ static void bake_targets_populate_pixels_vertex_colors(BakeTargets *targets,
                                                        BakePixel *pixel_array)
 {
   Mesh *me = ob->data;
-  const int num_pixels = targets->num_pixels;
+  const size_t num_pixels = targets->num_pixels;
 
   /* Initialize blank pixels. */
-  for (int i = 0; i < num_pixels; i++) {
+  for (size_t i = 0; i < num_pixels; i++) {
     BakePixel *pixel = &pixel_array[i];
 
     pixel->primitive_id = -1;
@@ -1445,22 +1445,27 @@ static int bake(const BakeAPIRender *bkr,
       goto cleanup;
     }
 
-    /* the baking itself */
+    /* the baking itself, all high poly objects with the same render engine */
+    Object **highpoly_objects = MEM_mallocN(sizeof(Object *) * tot_highpoly,
+                                            "bake high poly objects");
     for (i = 0; i < tot_highpoly; i++) {
-      ok = RE_bake_engine(re,
-                          depsgraph,
-                          highpoly[i].ob,
-                          i,
-                          pixel_array_high,
-                          &targets,
-                          bkr->pass_type,
-                          bkr->pass_filter,
-                          targets.result);
-      if (!ok) {
-        BKE_reportf(
-            reports, RPT_ERROR, "Error baking from object \"%s\"", highpoly[i].ob->id.name + 2);
-        goto cleanup;
-      }
+      highpoly_objects[i] = highpoly[i].ob;
+    }
+
+    ok = RE_bake_engine(re,
+                        depsgraph,
+                        highpoly_objects,
+                        tot_highpoly,
+                        pixel_array_high,
+                        &targets,
+                        bkr->pass_type,
+                        bkr->pass_filter,
+                        targets.result);
+    MEM_freeN(highpoly_objects);
+
+    if (!ok) {
+      BKE_report(reports, RPT_ERROR, "Error baking from selected objects");
+      goto cleanup;
     }
   }
   else {
@@ -1470,8 +1475,8 @@ static int bake(const BakeAPIRender *bkr,
     if (RE_bake_has_engine(re)) {
       ok = RE_bake_engine(re,
                           depsgraph,
-                          ob_low_eval,
-                          0,
+                          &ob_low_eval,
+                          1,
                           pixel_array_low,
                           &targets,
                           bkr->pass_type,
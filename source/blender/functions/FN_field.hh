@@ -391,6 +391,19 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
                                         const FieldContext &context,
                                         Span<GVMutableArray *> dst_varrays = {});
 
+/** Statistics of the cache of procedures that are built to evaluate fields. */
+struct FieldProcedureCacheStats {
+  int64_t hits = 0;
+  int64_t misses = 0;
+  /** Time in seconds spent building procedures for all misses. */
+  double build_time = 0.0;
+  /** Time in seconds that building the procedures for all hits would have taken. */
+  double time_saved = 0.0;
+};
+
+FieldProcedureCacheStats field_procedure_cache_stats();
+void field_procedure_cache_clear();
+
 /* -------------------------------------------------------------------- */
 /** \name Utility functions for simple field creation and evaluation
  * \{ */
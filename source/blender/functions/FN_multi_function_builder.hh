@@ -23,11 +23,134 @@
  */
 
 #include <functional>
+#include <tuple>
 
 #include "FN_multi_function.hh"
 
 namespace blender::fn {
 
+/**
+ * Input of an element function that is a span internally. Accessing an element does not require
+ * a virtual method call.
+ */
+template<typename T> struct DevirtualizedSpan {
+  const T *data;
+
+  const T &operator[](const int64_t index) const
+  {
+    return data[index];
+  }
+};
+
+/**
+ * Input of an element function that has the same value for every index.
+ */
+template<typename T> struct DevirtualizedSingle {
+  T value;
+
+  const T &operator[](const int64_t UNUSED(index)) const
+  {
+    return value;
+  }
+};
+
+/**
+ * Calls the element function for every index in the mask. When the mask is a range, this is a
+ * simple loop over plain arrays that the compiler can auto-vectorize.
+ */
+template<typename Out, typename ElementFuncT, typename... Inputs>
+inline void execute_element_fn_on_devirtualized(const IndexMask mask,
+                                                const ElementFuncT &element_fn,
+                                                Out *r_out,
+                                                const Inputs &...inputs)
+{
+  if (mask.is_range()) {
+    const IndexRange range = mask.as_range();
+    const int64_t end = range.one_after_last();
+    for (int64_t i = range.start(); i < end; i++) {
+      new (static_cast<void *>(r_out + i)) Out(element_fn(inputs[i]...));
+    }
+  }
+  else {
+    for (const int64_t i : mask.indices()) {
+      new (static_cast<void *>(r_out + i)) Out(element_fn(inputs[i]...));
+    }
+  }
+}
+
+template<typename Out, typename ElementFuncT, typename DevirtualizedTuple>
+inline bool try_execute_element_fn_devirtualized(const IndexMask mask,
+                                                 const ElementFuncT &element_fn,
+                                                 Out *r_out,
+                                                 const DevirtualizedTuple &devirtualized)
+{
+  std::apply(
+      [&](const auto &...inputs) {
+        execute_element_fn_on_devirtualized(mask, element_fn, r_out, inputs...);
+      },
+      devirtualized);
+  return true;
+}
+
+template<typename Out,
+         typename ElementFuncT,
+         typename DevirtualizedTuple,
+         typename T,
+         typename... VArrays>
+inline bool try_execute_element_fn_devirtualized(const IndexMask mask,
+                                                 const ElementFuncT &element_fn,
+                                                 Out *r_out,
+                                                 const DevirtualizedTuple &devirtualized,
+                                                 const VArray<T> &varray,
+                                                 const VArrays &...remaining_varrays)
+{
+  if (varray.is_single()) {
+    return try_execute_element_fn_devirtualized(
+        mask,
+        element_fn,
+        r_out,
+        std::tuple_cat(devirtualized,
+                       std::make_tuple(DevirtualizedSingle<T>{varray.get_internal_single()})),
+        remaining_varrays...);
+  }
+  if (varray.is_span()) {
+    return try_execute_element_fn_devirtualized(
+        mask,
+        element_fn,
+        r_out,
+        std::tuple_cat(devirtualized,
+                       std::make_tuple(DevirtualizedSpan<T>{varray.get_internal_span().data()})),
+        remaining_varrays...);
+  }
+  return false;
+}
+
+/**
+ * Computes the outputs of an element-wise function for all indices in the mask. When every input
+ * is a span or a single value internally, which is almost always the case, a version of the loop
+ * is used that does not call virtual methods and can be vectorized. Otherwise the inputs are
+ * accessed through the virtual arrays.
+ *
+ * A separate loop is instantiated for every combination of span and single inputs, so the number
+ * of instantiations grows exponentially with the number of inputs.
+ */
+template<typename Out, typename ElementFuncT, typename... Ins>
+inline void execute_element_fn_devirtualized(const IndexMask mask,
+                                             const ElementFuncT &element_fn,
+                                             MutableSpan<Out> r_out,
+                                             const VArray<Ins> &...inputs)
+{
+  if (try_execute_element_fn_devirtualized(
+          mask, element_fn, r_out.data(), std::tuple<>(), inputs...)) {
+    return;
+  }
+  /* It's probably not worth it to optimize just some of the inputs, because then the compiler
+   * still has to call into unknown code, which inhibits many compiler optimizations. */
+  mask.foreach_index([&](const int64_t i) {
+    new (static_cast<void *>(&r_out[i])) Out(element_fn(inputs[i]...));
+  });
+}
+
 /**
  * Generates a multi-function with the following parameters:
  * 1. single input (SI) of type In1
@@ -61,11 +184,7 @@ template<typename In1, typename Out1> class CustomMF_SI_SO : public MultiFunctio
   template<typename ElementFuncT> static FunctionT create_function(ElementFuncT element_fn)
   {
     return [=](IndexMask mask, const VArray<In1> &in1, MutableSpan<Out1> out1) {
-      /* Devirtualization results in a 2-3x speedup for some simple functions. */
-      devirtualize_varray(in1, [&](const auto &in1) {
-        mask.foreach_index(
-            [&](int i) { new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i])); });
-      });
+      execute_element_fn_devirtualized(mask, element_fn, out1, in1);
     };
   }
 
@@ -114,11 +233,7 @@ class CustomMF_SI_SI_SO : public MultiFunction {
                const VArray<In1> &in1,
                const VArray<In2> &in2,
                MutableSpan<Out1> out1) {
-      /* Devirtualization results in a 2-3x speedup for some simple functions. */
-      devirtualize_varray2(in1, in2, [&](const auto &in1, const auto &in2) {
-        mask.foreach_index(
-            [&](int i) { new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i], in2[i])); });
-      });
+      execute_element_fn_devirtualized(mask, element_fn, out1, in1, in2);
     };
   }
 
@@ -174,9 +289,7 @@ class CustomMF_SI_SI_SI_SO : public MultiFunction {
                const VArray<In2> &in2,
                const VArray<In3> &in3,
                MutableSpan<Out1> out1) {
-      mask.foreach_index([&](int i) {
-        new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i], in2[i], in3[i]));
-      });
+      execute_element_fn_devirtualized(mask, element_fn, out1, in1, in2, in3);
     };
   }
 
@@ -237,9 +350,7 @@ class CustomMF_SI_SI_SI_SI_SO : public MultiFunction {
                const VArray<In3> &in3,
                const VArray<In4> &in4,
                MutableSpan<Out1> out1) {
-      mask.foreach_index([&](int i) {
-        new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i], in2[i], in3[i], in4[i]));
-      });
+      execute_element_fn_devirtualized(mask, element_fn, out1, in1, in2, in3, in4);
     };
   }
 
@@ -24,14 +24,26 @@
 
 namespace blender::fn {
 
-/** A multi-function that executes a procedure internally. */
+/**
+ * A multi-function that executes a procedure internally.
+ *
+ * Large masks are split into chunks that go through the entire procedure before the next chunk is
+ * processed, so that intermediate values stay in the CPU cache. Chunks are processed in parallel.
+ */
 class MFProcedureExecutor : public MultiFunction {
  private:
   MFSignature signature_;
   const MFProcedure &procedure_;
+  int64_t chunk_size_;
+  bool chunking_supported_;
 
  public:
-  MFProcedureExecutor(std::string name, const MFProcedure &procedure);
+  /** Small enough for the intermediate values of typical procedures to fit in the L2 cache. */
+  static constexpr int64_t default_chunk_size = 4096;
+
+  MFProcedureExecutor(std::string name,
+                      const MFProcedure &procedure,
+                      int64_t chunk_size = default_chunk_size);
 
   void call(IndexMask mask, MFParams params, MFContext context) const override;
 };
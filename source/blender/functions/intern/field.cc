@@ -14,14 +14,16 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <mutex>
+
 #include "BLI_map.hh"
 #include "BLI_multi_value_map.hh"
 #include "BLI_set.hh"
 #include "BLI_stack.hh"
+#include "BLI_timeit.hh"
 #include "BLI_vector_set.hh"
 
 #include "FN_field.hh"
-#include "FN_multi_function_parallel.hh"
 
 namespace blender::fn {
 
@@ -141,11 +143,15 @@ static Set<GFieldRef> find_varying_fields(const FieldTreeInfo &field_tree_info,
 
 /**
  * Builds the #procedure so that it computes the the fields.
+ *
+ * \param get_fn: Gives the multi-function that the procedure calls for an operation.
  */
-static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
-                                                      ResourceScope &scope,
-                                                      const FieldTreeInfo &field_tree_info,
-                                                      Span<GFieldRef> output_fields)
+static void build_multi_function_procedure_for_fields(
+    MFProcedure &procedure,
+    ResourceScope &scope,
+    const FieldTreeInfo &field_tree_info,
+    Span<GFieldRef> output_fields,
+    FunctionRef<const MultiFunction &(const FieldOperation &operation)> get_fn)
 {
   MFProcedureBuilder builder{procedure};
   /* Every input, intermediate and output field corresponds to a variable in the procedure. */
@@ -192,7 +198,7 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
       else {
         /* All inputs variables are ready, now gather all variables that are used by the function
          * and call it. */
-        const MultiFunction &multi_function = operation.multi_function();
+        const MultiFunction &multi_function = get_fn(operation);
         Vector<MFVariable *> variables(multi_function.param_amount());
 
         int param_input_index = 0;
@@ -260,6 +266,262 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
   BLI_assert(procedure.validate());
 }
 
+/* --------------------------------------------------------------------
+ * Field Procedure Cache.
+ *
+ * The same field trees are often evaluated many times, e.g. on every frame or for every instance
+ * of a geometry, while the nodes of the tree and the multi-functions they reference are created
+ * anew every time. Procedures are cached based on the structure of the field tree, so that they
+ * can be reused for every tree with the same structure.
+ *
+ * Since the functions of the tree that a procedure was built for may be freed while the procedure
+ * is still cached, cached procedures do not call them directly. Instead every operation is called
+ * through a #FieldFunctionSlot, which forwards the call to the function of the corresponding
+ * operation in the field tree that is currently evaluated.
+ */
+
+/** Name of the global context that contains the functions of the evaluated field tree. */
+static const char *field_functions_context_name = "field_functions";
+
+/**
+ * Structure of a field tree, with every field node identified by the order in which it is first
+ * found. Two field trees with the same key can be evaluated with the same procedure.
+ */
+struct FieldTreeKey {
+  Vector<uint64_t> tokens;
+  uint64_t hash_value = 0;
+
+  uint64_t hash() const
+  {
+    return hash_value;
+  }
+
+  friend bool operator==(const FieldTreeKey &a, const FieldTreeKey &b)
+  {
+    return a.hash_value == b.hash_value && a.tokens.as_span() == b.tokens.as_span();
+  }
+};
+
+/** Field nodes of a field tree in the order that identifies them in a #FieldTreeKey. */
+struct FieldTreeNodes {
+  VectorSet<GFieldRef> nodes;
+  /** Multi-function of every node, null for inputs. */
+  Vector<const MultiFunction *> functions;
+};
+
+static void append_param_type_tokens(Vector<uint64_t> &tokens, const MFParamType &param_type)
+{
+  const MFDataType data_type = param_type.data_type();
+  const CPPType &type = (data_type.category() == MFDataType::Single) ?
+                            data_type.single_type() :
+                            data_type.vector_base_type();
+  tokens.append((uint64_t)param_type.category());
+  tokens.append((uint64_t)(uintptr_t)&type);
+}
+
+static FieldTreeKey build_field_tree_key(Span<GFieldRef> fields_to_evaluate,
+                                         Span<GFieldRef> output_fields,
+                                         FieldTreeNodes &r_tree_nodes)
+{
+  FieldTreeKey key;
+  Vector<uint64_t> &tokens = key.tokens;
+
+  /* Nodes are identified by the node itself, the output index is stored separately. */
+  auto node_id = [&](const GFieldRef &field) {
+    return r_tree_nodes.nodes.index_of(GFieldRef{field.node(), 0});
+  };
+
+  /* Add nodes in depth first order, so that the inputs of an operation always have an id when
+   * the operation is added. The structure of the entire tree matters, because the outputs of
+   * operations that are not used by any field are ignored in procedures. */
+  for (const GFieldRef &root_field : fields_to_evaluate) {
+    Stack<GFieldRef> fields_to_check;
+    fields_to_check.push(GFieldRef{root_field.node(), 0});
+    while (!fields_to_check.is_empty()) {
+      const GFieldRef field = fields_to_check.peek();
+      if (r_tree_nodes.nodes.contains(field)) {
+        fields_to_check.pop();
+        continue;
+      }
+      if (field.node().is_input()) {
+        const FieldInput &field_input = static_cast<const FieldInput &>(field.node());
+        tokens.append(0);
+        tokens.append((uint64_t)(uintptr_t)&field_input.cpp_type());
+        r_tree_nodes.nodes.add_new(field);
+        r_tree_nodes.functions.append(nullptr);
+        fields_to_check.pop();
+        continue;
+      }
+
+      const FieldOperation &operation = static_cast<const FieldOperation &>(field.node());
+      bool inputs_added = true;
+      for (const GField &input_field : operation.inputs()) {
+        if (!r_tree_nodes.nodes.contains(GFieldRef{input_field.node(), 0})) {
+          fields_to_check.push(GFieldRef{input_field.node(), 0});
+          inputs_added = false;
+        }
+      }
+      if (!inputs_added) {
+        continue;
+      }
+
+      const MultiFunction &fn = operation.multi_function();
+      tokens.append(1);
+      tokens.append(operation.inputs().size());
+      for (const GField &input_field : operation.inputs()) {
+        tokens.append(node_id(input_field));
+        tokens.append(input_field.node_output_index());
+      }
+      tokens.append(fn.param_amount());
+      for (const int param_index : fn.param_indices()) {
+        append_param_type_tokens(tokens, fn.param_type(param_index));
+      }
+      tokens.append(fn.depends_on_context());
+
+      r_tree_nodes.nodes.add_new(field);
+      r_tree_nodes.functions.append(&fn);
+      fields_to_check.pop();
+    }
+  }
+
+  tokens.append(2);
+  for (const GFieldRef &field : fields_to_evaluate) {
+    tokens.append(node_id(field));
+    tokens.append(field.node_output_index());
+  }
+  tokens.append(3);
+  for (const GFieldRef &field : output_fields) {
+    tokens.append(node_id(field));
+    tokens.append(field.node_output_index());
+  }
+
+  key.hash_value = 0;
+  for (const uint64_t token : tokens) {
+    key.hash_value = key.hash_value * 33 ^ get_default_hash(token);
+  }
+  return key;
+}
+
+/**
+ * Calls the multi-function of the operation with the given id in the field tree that is currently
+ * evaluated.
+ */
+class FieldFunctionSlot : public MultiFunction {
+ private:
+  MFSignature signature_;
+  int node_id_;
+
+ public:
+  FieldFunctionSlot(const MultiFunction &fn, const int node_id)
+      : signature_(fn.signature()), node_id_(node_id)
+  {
+    this->set_signature(&signature_);
+  }
+
+  void call(IndexMask mask, MFParams params, MFContext context) const override
+  {
+    const Span<const MultiFunction *> *functions =
+        context.get_global_context<Span<const MultiFunction *>>(field_functions_context_name);
+    BLI_assert(functions != nullptr);
+    (*functions)[node_id_]->call(mask, params, context);
+  }
+};
+
+struct CachedFieldProcedure {
+  /** Owns the function slots and other functions called by the procedure. */
+  ResourceScope scope;
+  MFProcedure procedure;
+  std::unique_ptr<MFProcedureExecutor> executor;
+  /** Time in seconds it took to build the procedure. */
+  double build_time;
+};
+
+class FieldProcedureCache {
+ private:
+  /** Limit the memory used by procedures of field trees that are not evaluated anymore. */
+  static constexpr int64_t max_size = 1024;
+
+  std::mutex mutex_;
+  Map<FieldTreeKey, std::shared_ptr<const CachedFieldProcedure>> procedures_;
+  FieldProcedureCacheStats stats_;
+
+ public:
+  std::shared_ptr<const CachedFieldProcedure> lookup_or_build(
+      const FieldTreeKey &key,
+      const FieldTreeNodes &tree_nodes,
+      const FieldTreeInfo &field_tree_info,
+      Span<GFieldRef> output_fields)
+  {
+    {
+      std::lock_guard lock{mutex_};
+      const std::shared_ptr<const CachedFieldProcedure> *cached = procedures_.lookup_ptr(key);
+      if (cached != nullptr) {
+        stats_.hits++;
+        stats_.time_saved += (*cached)->build_time;
+        return *cached;
+      }
+    }
+
+    /* Build outside of the lock, so that other threads are not blocked. When multiple threads
+     * build the same procedure, the last one ends up in the cache. */
+    const timeit::TimePoint start = timeit::Clock::now();
+
+    auto cached = std::make_shared<CachedFieldProcedure>();
+    build_multi_function_procedure_for_fields(
+        cached->procedure,
+        cached->scope,
+        field_tree_info,
+        output_fields,
+        [&](const FieldOperation &operation) -> const MultiFunction & {
+          const int node_id = tree_nodes.nodes.index_of(GFieldRef{operation, 0});
+          return cached->scope.construct<FieldFunctionSlot>(operation.multi_function(),
+                                                            node_id);
+        });
+    cached->executor = std::make_unique<MFProcedureExecutor>("Procedure", cached->procedure);
+
+    const timeit::Nanoseconds duration = timeit::Clock::now() - start;
+    cached->build_time = std::chrono::duration<double>(duration).count();
+
+    std::lock_guard lock{mutex_};
+    stats_.misses++;
+    stats_.build_time += cached->build_time;
+    if (procedures_.size() >= max_size) {
+      procedures_.clear();
+    }
+    procedures_.add_overwrite(key, cached);
+    return cached;
+  }
+
+  FieldProcedureCacheStats stats()
+  {
+    std::lock_guard lock{mutex_};
+    return stats_;
+  }
+
+  void clear()
+  {
+    std::lock_guard lock{mutex_};
+    procedures_.clear();
+    stats_ = {};
+  }
+};
+
+static FieldProcedureCache &get_field_procedure_cache()
+{
+  static FieldProcedureCache cache;
+  return cache;
+}
+
+FieldProcedureCacheStats field_procedure_cache_stats()
+{
+  return get_field_procedure_cache().stats();
+}
+
+void field_procedure_cache_clear()
+{
+  get_field_procedure_cache().clear();
+}
+
 /**
  * Evaluate fields in the given context. If possible, multiple fields should be evaluated together,
  * because that can be more efficient when they share common sub-fields.
@@ -342,19 +604,20 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
 
   /* Evaluate varying fields if necessary. */
   if (!varying_fields_to_evaluate.is_empty()) {
-    /* Build the procedure for those fields. */
-    MFProcedure procedure;
-    build_multi_function_procedure_for_fields(
-        procedure, scope, field_tree_info, varying_fields_to_evaluate);
-    MFProcedureExecutor procedure_executor{"Procedure", procedure};
-    /* Add multi threading capabilities to the field evaluation. */
-    const int grain_size = 10000;
-    fn::ParallelMultiFunction parallel_procedure_executor{procedure_executor, grain_size};
-    /* Utility variable to make easy to switch the executor. */
-    const MultiFunction &executor_fn = parallel_procedure_executor;
+    /* Get the procedure for those fields. */
+    FieldTreeNodes tree_nodes;
+    const FieldTreeKey key = build_field_tree_key(
+        fields_to_evaluate, varying_fields_to_evaluate, tree_nodes);
+    const std::shared_ptr<const CachedFieldProcedure> cached_procedure =
+        get_field_procedure_cache().lookup_or_build(
+            key, tree_nodes, field_tree_info, varying_fields_to_evaluate);
+    const Span<const MultiFunction *> functions = tree_nodes.functions;
+    /* The executor processes large masks in chunks on multiple threads. */
+    const MultiFunction &executor_fn = *cached_procedure->executor;
 
     MFParamsBuilder mf_params{executor_fn, &mask};
     MFContextBuilder mf_context;
+    mf_context.add_global_context(field_functions_context_name, &functions);
 
     /* Provide inputs to the procedure executor. */
     for (const GVArray *varray : field_context_inputs) {
@@ -399,16 +662,21 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
 
   /* Evaluate constant fields if necessary. */
   if (!constant_fields_to_evaluate.is_empty()) {
-    /* Build the procedure for those fields. */
-    MFProcedure procedure;
-    build_multi_function_procedure_for_fields(
-        procedure, scope, field_tree_info, constant_fields_to_evaluate);
-    MFProcedureExecutor procedure_executor{"Procedure", procedure};
+    /* Get the procedure for those fields. */
+    FieldTreeNodes tree_nodes;
+    const FieldTreeKey key = build_field_tree_key(
+        fields_to_evaluate, constant_fields_to_evaluate, tree_nodes);
+    const std::shared_ptr<const CachedFieldProcedure> cached_procedure =
+        get_field_procedure_cache().lookup_or_build(
+            key, tree_nodes, field_tree_info, constant_fields_to_evaluate);
+    const Span<const MultiFunction *> functions = tree_nodes.functions;
+    const MultiFunction &procedure_executor = *cached_procedure->executor;
     /* Run the code below even when the mask is empty, so that outputs are properly prepared.
      * Higher level code can detect this as well and just skip evaluating the field. */
     const int mask_size = mask.is_empty() ? 0 : 1;
     MFParamsBuilder mf_params{procedure_executor, mask_size};
     MFContextBuilder mf_context;
+    mf_context.add_global_context(field_functions_context_name, &functions);
 
     /* Provide inputs to the procedure executor. */
     for (const GVArray *varray : field_context_inputs) {
@@ -16,17 +16,26 @@
 
 #include "FN_multi_function_procedure_executor.hh"
 
+#include "BLI_enumerable_thread_specific.hh"
 #include "BLI_stack.hh"
+#include "BLI_task.hh"
 
 namespace blender::fn {
 
-MFProcedureExecutor::MFProcedureExecutor(std::string name, const MFProcedure &procedure)
-    : procedure_(procedure)
+MFProcedureExecutor::MFProcedureExecutor(std::string name,
+                                         const MFProcedure &procedure,
+                                         const int64_t chunk_size)
+    : procedure_(procedure), chunk_size_(chunk_size)
 {
   MFSignatureBuilder signature(std::move(name));
 
+  chunking_supported_ = true;
   for (const ConstMFParameter &param : procedure.params()) {
     signature.add(param.variable->name(), MFParamType(param.type, param.variable->data_type()));
+    if (param.variable->data_type().category() == MFDataType::Vector) {
+      /* Vector parameters can not be sliced yet. */
+      chunking_supported_ = false;
+    }
   }
 
   signature_ = signature.build();
@@ -75,8 +84,11 @@ struct VariableValue_Span : public VariableValue {
   static inline constexpr ValueType static_type = ValueType::Span;
   void *data;
   bool owned;
+  /* Number of elements that fit into an owned buffer. */
+  int64_t capacity;
 
-  VariableValue_Span(void *data, bool owned) : VariableValue(static_type), data(data), owned(owned)
+  VariableValue_Span(void *data, bool owned, int64_t capacity = 0)
+      : VariableValue(static_type), data(data), owned(owned), capacity(capacity)
   {
   }
 };
@@ -135,7 +147,8 @@ class VariableState;
 
 /**
  * The #ValueAllocator is responsible for providing memory for variables and their values. It also
- * manages the reuse of buffers to improve performance.
+ * manages the reuse of buffers to improve performance. When a mask is processed in chunks, every
+ * thread has its own allocator that is reused for all chunks it processes.
  */
 class ValueAllocator : NonCopyable, NonMovable {
  private:
@@ -146,9 +159,14 @@ class ValueAllocator : NonCopyable, NonMovable {
   /* Use stacks so that the most recently used buffers are reused first. This improves cache
    * efficiency. */
   std::array<Stack<VariableValue *>, tot_variable_value_types> values_free_lists_;
+
+  struct SpanBuffer {
+    void *data;
+    int64_t capacity;
+  };
   /* The integer key is the size of one element (e.g. 4 for an integer buffer). All buffers are
    * aligned to #min_alignment bytes. */
-  Map<int, Stack<void *>> span_buffers_free_list_;
+  Map<int, Stack<SpanBuffer>> span_buffers_free_list_;
 
  public:
   ValueAllocator() = default;
@@ -160,9 +178,9 @@ class ValueAllocator : NonCopyable, NonMovable {
         MEM_freeN(stack.pop());
       }
     }
-    for (Stack<void *> &stack : span_buffers_free_list_.values()) {
+    for (Stack<SpanBuffer> &stack : span_buffers_free_list_.values()) {
       while (!stack.is_empty()) {
-        MEM_freeN(stack.pop());
+        MEM_freeN(stack.pop().data);
       }
     }
   }
@@ -196,19 +214,27 @@ class ValueAllocator : NonCopyable, NonMovable {
     if (alignment > min_alignment) {
       /* In this rare case we fallback to not reusing existing buffers. */
       buffer = MEM_mallocN_aligned(element_size * size, alignment, __func__);
+      return this->obtain<VariableValue_Span>(buffer, true, size);
     }
-    else {
-      Stack<void *> *stack = span_buffers_free_list_.lookup_ptr(element_size);
-      if (stack == nullptr || stack->is_empty()) {
-        buffer = MEM_mallocN_aligned(element_size * size, min_alignment, __func__);
-      }
-      else {
+
+    Stack<SpanBuffer> *stack = span_buffers_free_list_.lookup_ptr(element_size);
+    int64_t capacity = size;
+    while (stack != nullptr && !stack->is_empty()) {
+      const SpanBuffer span_buffer = stack->pop();
+      if (span_buffer.capacity >= size) {
         /* Reuse existing buffer. */
-        buffer = stack->pop();
+        buffer = span_buffer.data;
+        capacity = span_buffer.capacity;
+        break;
       }
+      /* The buffer is too small, which happens when chunks of different sizes are processed. */
+      MEM_freeN(span_buffer.data);
+    }
+    if (buffer == nullptr) {
+      buffer = MEM_mallocN_aligned(element_size * size, min_alignment, __func__);
     }
 
-    return this->obtain<VariableValue_Span>(buffer, true);
+    return this->obtain<VariableValue_Span>(buffer, true, capacity);
   }
 
   VariableValue_GVectorArray *obtain_GVectorArray_not_owned(GVectorArray &data)
@@ -245,8 +271,8 @@ class ValueAllocator : NonCopyable, NonMovable {
         if (value_typed->owned) {
           const CPPType &type = data_type.single_type();
           /* Assumes all values in the buffer are uninitialized already. */
-          Stack<void *> &buffers = span_buffers_free_list_.lookup_or_add_default(type.size());
-          buffers.push(value_typed->data);
+          Stack<SpanBuffer> &buffers = span_buffers_free_list_.lookup_or_add_default(type.size());
+          buffers.push({value_typed->data, value_typed->capacity});
         }
         break;
       }
@@ -812,12 +838,13 @@ void ValueAllocator::release_variable_state(VariableState *state)
 /** Keeps track of the states of all variables during evaluation. */
 class VariableStates {
  private:
-  ValueAllocator value_allocator_;
+  ValueAllocator &value_allocator_;
   Map<const MFVariable *, VariableState *> variable_states_;
   IndexMask full_mask_;
 
  public:
-  VariableStates(IndexMask full_mask) : full_mask_(full_mask)
+  VariableStates(ValueAllocator &value_allocator, IndexMask full_mask)
+      : value_allocator_(value_allocator), full_mask_(full_mask)
   {
   }
 
@@ -1157,17 +1184,18 @@ class InstructionScheduler {
   }
 };
 
-void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext context) const
+static void execute_procedure(const MFProcedureExecutor &fn,
+                              const MFProcedure &procedure,
+                              IndexMask full_mask,
+                              MFParams params,
+                              const MFContext &context,
+                              ValueAllocator &value_allocator)
 {
-  BLI_assert(procedure_.validate());
-
-  LinearAllocator<> allocator;
-
-  VariableStates variable_states{full_mask};
-  variable_states.add_initial_variable_states(*this, procedure_, params);
+  VariableStates variable_states{value_allocator, full_mask};
+  variable_states.add_initial_variable_states(fn, procedure, params);
 
   InstructionScheduler scheduler;
-  scheduler.add_referenced_indices(*procedure_.entry(), full_mask);
+  scheduler.add_referenced_indices(*procedure.entry(), full_mask);
 
   /* Loop until all indices got to a return instruction. */
   while (NextInstructionInfo instr_info = scheduler.pop_next()) {
@@ -1213,9 +1241,9 @@ void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext c
     }
   }
 
-  for (const int param_index : this->param_indices()) {
-    const MFParamType param_type = this->param_type(param_index);
-    const MFVariable *variable = procedure_.params()[param_index].variable;
+  for (const int param_index : fn.param_indices()) {
+    const MFParamType param_type = fn.param_type(param_index);
+    const MFVariable *variable = procedure.params()[param_index].variable;
     VariableState &variable_state = variable_states.get_variable_state(*variable);
     switch (param_type.interface_type()) {
       case MFParamType::Input: {
@@ -1236,4 +1264,79 @@ void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext c
   }
 }
 
+/**
+ * Slice all parameters to the range of indices covered by a chunk, so that the procedure can be
+ * executed on the chunk without taking care of the index offset.
+ */
+static void add_sliced_params(const MultiFunction &fn,
+                              MFParams params,
+                              const IndexRange slice_range,
+                              MFParamsBuilder &r_sub_params)
+{
+  ResourceScope &scope = r_sub_params.resource_scope();
+
+  for (const int param_index : fn.param_indices()) {
+    const MFParamType param_type = fn.param_type(param_index);
+    switch (param_type.category()) {
+      case MFParamType::SingleInput: {
+        const GVArray &varray = params.readonly_single_input(param_index);
+        const GVArray &sliced_varray = scope.construct<GVArray_Slice>(varray, slice_range);
+        r_sub_params.add_readonly_single_input(sliced_varray);
+        break;
+      }
+      case MFParamType::SingleMutable: {
+        const GMutableSpan span = params.single_mutable(param_index);
+        r_sub_params.add_single_mutable(span.slice(slice_range.start(), slice_range.size()));
+        break;
+      }
+      case MFParamType::SingleOutput: {
+        const GMutableSpan span = params.uninitialized_single_output(param_index);
+        r_sub_params.add_uninitialized_single_output(
+            span.slice(slice_range.start(), slice_range.size()));
+        break;
+      }
+      case MFParamType::VectorInput:
+      case MFParamType::VectorMutable:
+      case MFParamType::VectorOutput: {
+        BLI_assert_unreachable();
+        break;
+      }
+    }
+  }
+}
+
+void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext context) const
+{
+  BLI_assert(procedure_.validate());
+
+  if (full_mask.size() <= chunk_size_ || !chunking_supported_) {
+    ValueAllocator value_allocator;
+    execute_procedure(*this, procedure_, full_mask, params, context, value_allocator);
+    return;
+  }
+
+  /* Buffers for intermediate values are reused by all chunks processed on the same thread. */
+  threading::EnumerableThreadSpecific<ValueAllocator> value_allocators;
+
+  threading::parallel_for(full_mask.index_range(), chunk_size_, [&](const IndexRange range) {
+    ValueAllocator &value_allocator = value_allocators.local();
+    Vector<int64_t> sub_mask_indices;
+
+    /* The grain size is only the minimum size of a range given to a thread, so the range is split
+     * further here to make sure that no chunk is larger than the chunk size. */
+    for (int64_t offset = 0; offset < range.size(); offset += chunk_size_) {
+      const int64_t slice_size_in_mask = std::min(chunk_size_, range.size() - offset);
+      const IndexRange mask_slice = range.slice(offset, slice_size_in_mask);
+      const IndexMask sub_mask = full_mask.slice_and_offset(mask_slice, sub_mask_indices);
+      const int64_t slice_start = full_mask[mask_slice.first()];
+      const int64_t slice_size = full_mask[mask_slice.last()] - slice_start + 1;
+
+      MFParamsBuilder sub_params{*this, sub_mask.min_array_size()};
+      add_sliced_params(*this, params, IndexRange(slice_start, slice_size), sub_params);
+
+      execute_procedure(*this, procedure_, sub_mask, sub_params, context, value_allocator);
+    }
+  });
+}
+
 }  // namespace blender::fn
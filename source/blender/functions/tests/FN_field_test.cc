@@ -291,4 +291,35 @@ TEST(field, IgnoredOutput)
   EXPECT_EQ(results->get(3), 5);
 }
 
+TEST(field, ReuseCachedProcedure)
+{
+  field_procedure_cache_clear();
+
+  /* Both trees have the same structure, but call different functions. */
+  auto evaluate = [](std::unique_ptr<MultiFunction> fn) {
+    GField index_field{std::make_shared<IndexFieldInput>()};
+    GField output_field{std::make_shared<FieldOperation>(
+                            FieldOperation(std::move(fn), {index_field, index_field})),
+                        0};
+    Array<int> result(4);
+    FieldContext context;
+    FieldEvaluator evaluator{context, 4};
+    evaluator.add_with_destination(output_field, result.as_mutable_span());
+    evaluator.evaluate();
+    return result;
+  };
+
+  const Array<int> result_1 = evaluate(std::make_unique<CustomMF_SI_SI_SO<int, int, int>>(
+      "add", [](int a, int b) { return a + b; }));
+  const Array<int> result_2 = evaluate(std::make_unique<CustomMF_SI_SI_SO<int, int, int>>(
+      "mul", [](int a, int b) { return a * b; }));
+
+  EXPECT_EQ(result_1[3], 6);
+  EXPECT_EQ(result_2[3], 9);
+
+  const FieldProcedureCacheStats stats = field_procedure_cache_stats();
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 1);
+}
+
 }  // namespace blender::fn::tests
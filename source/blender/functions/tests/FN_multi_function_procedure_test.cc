@@ -2,6 +2,8 @@
 
 #include "testing/testing.h"
 
+#include "BLI_timeit.hh"
+
 #include "FN_multi_function_builder.hh"
 #include "FN_multi_function_procedure_builder.hh"
 #include "FN_multi_function_procedure_executor.hh"
@@ -341,4 +343,181 @@ TEST(multi_function_procedure, BufferReuse)
   EXPECT_EQ(results[4], 53);
 }
 
+TEST(multi_function_procedure, ChunkedExecution)
+{
+  /**
+   * procedure(int a, bool cond, int *out) {
+   *   int b = a + 10;
+   *   if (cond) {
+   *     b += 100;
+   *   }
+   *   out = b + 10;
+   * }
+   */
+
+  CustomMF_SI_SO<int, int> add_10_fn{"add 10", [](int a) { return a + 10; }};
+  CustomMF_SM<int> add_100_fn{"add_100", [](int &a) { a += 100; }};
+
+  MFProcedure procedure;
+  MFProcedureBuilder builder{procedure};
+
+  MFVariable *var_a = &builder.add_single_input_parameter<int>();
+  MFVariable *var_cond = &builder.add_single_input_parameter<bool>();
+  auto [var_b] = builder.add_call<1>(add_10_fn, {var_a});
+  builder.add_destruct(*var_a);
+  MFProcedureBuilder::Branch branch = builder.add_branch(*var_cond);
+  branch.branch_true.add_call(add_100_fn, {var_b});
+  builder.set_cursor_after_branch(branch);
+  builder.add_destruct(*var_cond);
+  auto [var_out] = builder.add_call<1>(add_10_fn, {var_b});
+  builder.add_destruct(*var_b);
+  builder.add_return();
+  builder.add_output_parameter(*var_out);
+
+  EXPECT_TRUE(procedure.validate());
+
+  /* Use small chunks, so that buffers are reused for chunks spanning different index ranges. */
+  MFProcedureExecutor procedure_fn{"Chunked Execution", procedure, 1000};
+
+  const int size = 100000;
+  Array<int> inputs(size);
+  Array<bool> conditions(size);
+  for (const int i : IndexRange(size)) {
+    inputs[i] = i;
+    conditions[i] = i % 3 == 0;
+  }
+
+  /* The mask is dense at first and sparse afterwards. */
+  Vector<int64_t> mask_indices;
+  for (const int i : IndexRange(size)) {
+    if (i < 5000 || i % 7 == 0) {
+      mask_indices.append(i);
+    }
+  }
+
+  Array<int> results(size, -1);
+
+  MFParamsBuilder params{procedure_fn, size};
+  params.add_readonly_single_input(inputs.as_span());
+  params.add_readonly_single_input(conditions.as_span());
+  params.add_uninitialized_single_output(results.as_mutable_span());
+
+  MFContextBuilder context;
+  procedure_fn.call(mask_indices.as_span(), params, context);
+
+  for (const int i : IndexRange(size)) {
+    if (i < 5000 || i % 7 == 0) {
+      EXPECT_EQ(results[i], i + ((i % 3 == 0) ? 120 : 20));
+    }
+    else {
+      EXPECT_EQ(results[i], -1);
+    }
+  }
+}
+
+TEST(multi_function_procedure, ChunkSizeLimit)
+{
+  /**
+   * procedure(int *var) {
+   *   max_mask_size(var);
+   * }
+   */
+
+  MaxMaskSizeFunction max_mask_size_fn;
+
+  MFProcedure procedure;
+  MFProcedureBuilder builder{procedure};
+
+  MFVariable *var = &builder.add_single_mutable_parameter<int>();
+  builder.add_call(max_mask_size_fn, {var});
+  builder.add_return();
+
+  EXPECT_TRUE(procedure.validate());
+
+  const int64_t chunk_size = 100;
+  MFProcedureExecutor procedure_fn{"Chunk Size Limit", procedure, chunk_size};
+
+  const int size = 100000;
+  Array<int> values(size, 0);
+
+  MFParamsBuilder params{procedure_fn, size};
+  params.add_single_mutable(values.as_mutable_span());
+
+  MFContextBuilder context;
+  procedure_fn.call(IndexRange(size), params, context);
+
+  /* Ranges given to threads can be much larger than the grain size, they must still be split. */
+  EXPECT_EQ(max_mask_size_fn.max_mask_size.load(), chunk_size);
+  for (const int i : IndexRange(size)) {
+    EXPECT_EQ(values[i], 1);
+  }
+}
+
+/**
+ * Set this to 1 to activate the benchmark. It is disabled by default, because it takes a while.
+ */
+#if 0
+static void benchmark_math_chain(const int64_t chunk_size)
+{
+  /**
+   * procedure(float a, float *out) {
+   *   float b = a;
+   *   for (50 times) {
+   *     b = b * 1.01 + 0.5;
+   *   }
+   *   out = b;
+   * }
+   */
+
+  CustomMF_SI_SI_SO<float, float, float> mul_fn{"mul", [](float a, float b) { return a * b; }};
+  CustomMF_SI_SI_SO<float, float, float> add_fn{"add", [](float a, float b) { return a + b; }};
+  CustomMF_Constant<float> factor_fn{1.01f};
+  CustomMF_Constant<float> offset_fn{0.5f};
+
+  MFProcedure procedure;
+  MFProcedureBuilder builder{procedure};
+
+  MFVariable *var = &builder.add_single_input_parameter<float>();
+  auto [var_factor] = builder.add_call<1>(factor_fn);
+  auto [var_offset] = builder.add_call<1>(offset_fn);
+  for (int i = 0; i < 50; i++) {
+    auto [var_mul] = builder.add_call<1>(mul_fn, {var, var_factor});
+    builder.add_destruct(*var);
+    auto [var_add] = builder.add_call<1>(add_fn, {var_mul, var_offset});
+    builder.add_destruct(*var_mul);
+    var = var_add;
+  }
+  builder.add_destruct({var_factor, var_offset});
+  builder.add_return();
+  builder.add_output_parameter(*var);
+
+  MFProcedureExecutor procedure_fn{"Math Chain", procedure, chunk_size};
+
+  const int size = 10000000;
+  Array<float> inputs(size, 1.0f);
+  Array<float> results(size);
+
+  MFParamsBuilder params{procedure_fn, size};
+  params.add_readonly_single_input(inputs.as_span());
+  params.add_uninitialized_single_output(results.as_mutable_span());
+
+  MFContextBuilder context;
+  {
+    SCOPED_TIMER("Chunk size " + std::to_string(chunk_size));
+    procedure_fn.call(IndexRange(size), params, context);
+  }
+
+  /* Print a value to avoid some compiler optimizations. */
+  std::cout << "Result: " << results[size / 2] << "\n";
+}
+
+TEST(multi_function_procedure, Benchmark)
+{
+  for (int i = 0; i < 3; i++) {
+    benchmark_math_chain(INT64_MAX);
+    benchmark_math_chain(MFProcedureExecutor::default_chunk_size);
+  }
+}
+#endif
+
 }  // namespace blender::fn::tests
@@ -2,6 +2,8 @@
 
 #include "testing/testing.h"
 
+#include "BLI_timeit.hh"
+
 #include "FN_multi_function.hh"
 #include "FN_multi_function_builder.hh"
 #include "FN_multi_function_test_common.hh"
@@ -221,6 +223,50 @@ TEST(multi_function, CustomMF_SI_SI_SI_SO)
   EXPECT_EQ(outputs[3], 13);
 }
 
+TEST(multi_function, CustomMF_DevirtualizedInputs)
+{
+  CustomMF_SI_SI_SI_SO<int, int, int, int> fn{"sum",
+                                              [](int a, int b, int c) { return a + b + c; }};
+
+  Array<int> values_a = {1, 2, 3, 4};
+  int value_b = 10;
+  auto get_c = [](int64_t i) { return (int)i * 100; };
+  GVArray_For_EmbeddedVArray<int, VArray_For_Func<int, decltype(get_c)>> values_c{4, 4, get_c};
+
+  /* All inputs are spans or single values. */
+  {
+    Array<int> outputs(values_a.size(), -1);
+    MFParamsBuilder params(fn, values_a.size());
+    params.add_readonly_single_input(values_a.as_span());
+    params.add_readonly_single_input(&value_b);
+    params.add_readonly_single_input(&value_b);
+    params.add_uninitialized_single_output(outputs.as_mutable_span());
+    MFContextBuilder context;
+    fn.call(IndexRange(1, 3), params, context);
+
+    EXPECT_EQ(outputs[0], -1);
+    EXPECT_EQ(outputs[1], 22);
+    EXPECT_EQ(outputs[2], 23);
+    EXPECT_EQ(outputs[3], 24);
+  }
+  /* One input can only be accessed through the virtual array. */
+  {
+    Array<int> outputs(values_a.size(), -1);
+    MFParamsBuilder params(fn, values_a.size());
+    params.add_readonly_single_input(values_a.as_span());
+    params.add_readonly_single_input(&value_b);
+    params.add_readonly_single_input(values_c);
+    params.add_uninitialized_single_output(outputs.as_mutable_span());
+    MFContextBuilder context;
+    fn.call({0, 2, 3}, params, context);
+
+    EXPECT_EQ(outputs[0], 11);
+    EXPECT_EQ(outputs[1], -1);
+    EXPECT_EQ(outputs[2], 213);
+    EXPECT_EQ(outputs[3], 314);
+  }
+}
+
 TEST(multi_function, CustomMF_SM)
 {
   CustomMF_SM<std::string> fn("AddSuffix", [](std::string &value) { value += " test"; });
@@ -355,5 +401,66 @@ TEST(multi_function, IgnoredOutputs)
   }
 }
 
+#if 0
+/* Compares the element functions with per element virtual method calls to the devirtualized
+ * loops that are used by the multi-function builders. */
+static void benchmark_element_function(const char *name,
+                                       const MultiFunction &fn,
+                                       const IndexMask mask,
+                                       const Span<float> values_a,
+                                       const float value_b,
+                                       MutableSpan<float> r_outputs)
+{
+  MFParamsBuilder params(fn, values_a.size());
+  params.add_readonly_single_input(values_a);
+  params.add_readonly_single_input(&value_b);
+  params.add_uninitialized_single_output(r_outputs);
+  MFContextBuilder context;
+
+  SCOPED_TIMER(name);
+  for (int i = 0; i < 20; i++) {
+    fn.call(mask, params, context);
+  }
+}
+
+TEST(multi_function, BenchmarkDevirtualization)
+{
+  const int64_t size = 10000000;
+  Array<float> values_a(size);
+  for (const int64_t i : values_a.index_range()) {
+    values_a[i] = i * 0.001f;
+  }
+  Array<float> outputs(size);
+
+  auto element_fn = [](float a, float b) { return a * b + 1.0f; };
+  using Fn = CustomMF_SI_SI_SO<float, float, float>;
+  std::function<void(IndexMask, const VArray<float> &, const VArray<float> &, MutableSpan<float>)>
+      virtual_loop = [&](IndexMask mask,
+                         const VArray<float> &a,
+                         const VArray<float> &b,
+                         MutableSpan<float> r) {
+        mask.foreach_index([&](const int64_t i) { r[i] = element_fn(a[i], b[i]); });
+      };
+  Fn virtual_fn{"virtual", virtual_loop};
+  Fn devirtualized_fn{"devirtualized", element_fn};
+
+  Vector<int64_t> indices;
+  for (int64_t i = 0; i < size; i += 2) {
+    indices.append(i);
+  }
+
+  for (int i = 0; i < 5; i++) {
+    benchmark_element_function(
+        "virtual range", virtual_fn, IndexRange(size), values_a, 2.0f, outputs);
+    benchmark_element_function(
+        "devirtualized range", devirtualized_fn, IndexRange(size), values_a, 2.0f, outputs);
+    benchmark_element_function(
+        "virtual indices", virtual_fn, indices.as_span(), values_a, 2.0f, outputs);
+    benchmark_element_function(
+        "devirtualized indices", devirtualized_fn, indices.as_span(), values_a, 2.0f, outputs);
+  }
+}
+#endif
+
 }  // namespace
 }  // namespace blender::fn::tests
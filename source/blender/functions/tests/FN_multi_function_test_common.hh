@@ -1,5 +1,7 @@
 /* Apache License, Version 2.0 */
 
+#include <atomic>
+
 #include "FN_multi_function.hh"
 
 namespace blender::fn::tests {
@@ -200,4 +202,36 @@ class OptionalOutputsFunction : public MultiFunction {
   }
 };
 
+class MaxMaskSizeFunction : public MultiFunction {
+ public:
+  /** Largest mask that the function has been called with. */
+  mutable std::atomic<int64_t> max_mask_size = 0;
+
+  MaxMaskSizeFunction()
+  {
+    static MFSignature signature = create_signature();
+    this->set_signature(&signature);
+  }
+
+  static MFSignature create_signature()
+  {
+    MFSignatureBuilder signature{"Max Mask Size"};
+    signature.single_mutable<int>("Value");
+    return signature.build();
+  }
+
+  void call(IndexMask mask, MFParams params, MFContext UNUSED(context)) const override
+  {
+    MutableSpan<int> values = params.single_mutable<int>(0, "Value");
+
+    int64_t max_size = max_mask_size.load();
+    while (mask.size() > max_size && !max_mask_size.compare_exchange_weak(max_size, mask.size())) {
+    }
+
+    for (int64_t i : mask) {
+      values[i] += 1;
+    }
+  }
+};
+
 }  // namespace blender::fn::tests
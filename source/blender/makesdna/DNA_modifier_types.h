@@ -2265,9 +2265,18 @@ typedef struct NodesModifierData {
   /* Contains logged information from the last evaluation. This can be used to help the user to
    * debug a node tree. */
   void *runtime_eval_log;
+  /** #NodesModifierFlag. */
+  int flag;
+  /** Memory limit of the node output cache in megabytes. */
+  int output_cache_memory_limit;
   void *_pad1;
 } NodesModifierData;
 
+/** #NodesModifierData.flag */
+typedef enum NodesModifierFlag {
+  NODES_MODIFIER_USE_OUTPUT_CACHE = (1 << 0),
+} NodesModifierFlag;
+
 typedef struct MeshToVolumeModifierData {
   ModifierData modifier;
 
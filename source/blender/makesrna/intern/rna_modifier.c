@@ -6943,6 +6943,22 @@ static void rna_def_modifier_nodes(BlenderRNA *brna)
   RNA_def_property_flag(prop, PROP_EDITABLE);
   RNA_def_property_update(prop, 0, "rna_NodesModifier_node_group_update");
 
+  prop = RNA_def_property(srna, "use_output_cache", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", NODES_MODIFIER_USE_OUTPUT_CACHE);
+  RNA_def_property_ui_text(
+      prop,
+      "Use Output Cache",
+      "Reuse outputs of nodes from previous evaluations when their inputs did not change");
+  RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
+  prop = RNA_def_property(srna, "output_cache_memory_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_range(prop, 1, INT_MAX);
+  RNA_def_property_ui_range(prop, 1, 32768, 64, -1);
+  RNA_def_property_ui_text(prop,
+                           "Cache Memory Limit",
+                           "Maximum memory used by the node output cache (in megabytes)");
+  RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
   RNA_define_lib_overridable(false);
 }
 
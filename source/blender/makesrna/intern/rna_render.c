@@ -966,6 +966,16 @@ static void rna_def_render_engine(BlenderRNA *brna)
   RNA_def_property_ui_text(
       prop, "Use Alembic Procedural", "Support loading Alembic data at render time");
 
+  prop = RNA_def_property(srna, "bl_use_packed_bake", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "type->flag", RE_USE_PACKED_BAKE);
+  RNA_def_property_flag(prop, PROP_REGISTER_OPTIONAL);
+  RNA_def_property_ui_text(
+      prop,
+      "Use Packed Bake",
+      "Bake multiple target images at once, laid out one after the other in rows of the widest "
+      "image with the last row only partially filled. The width and height passed to bake are "
+      "then the size of this layout");
+
   RNA_define_verify_sdna(1);
 }
 
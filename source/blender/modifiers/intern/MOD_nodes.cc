@@ -81,6 +81,7 @@
 #include "MOD_modifiertypes.h"
 #include "MOD_nodes.h"
 #include "MOD_nodes_evaluator.hh"
+#include "MOD_nodes_output_cache.hh"
 #include "MOD_ui_common.h"
 
 #include "ED_spreadsheet.h"
@@ -93,6 +94,8 @@
 #include "FN_field.hh"
 #include "FN_multi_function.hh"
 
+#include "CLG_log.h"
+
 using blender::ColorGeometry4f;
 using blender::destruct_ptr;
 using blender::float3;
@@ -108,6 +111,7 @@ using blender::bke::OutputAttribute;
 using blender::fn::GField;
 using blender::fn::GMutablePointer;
 using blender::fn::GPointer;
+using blender::modifiers::geometry_nodes::NodeOutputCache;
 using blender::nodes::FieldInferencingInterface;
 using blender::nodes::GeoNodeExecParams;
 using blender::nodes::InputSocketFieldType;
@@ -115,6 +119,8 @@ using blender::threading::EnumerableThreadSpecific;
 using namespace blender::fn::multi_function_types;
 using namespace blender::nodes::derived_node_tree_types;
 
+static CLG_LogRef LOG = {"mod.nodes"};
+
 static void initData(ModifierData *md)
 {
   NodesModifierData *nmd = (NodesModifierData *)md;
@@ -846,6 +852,25 @@ static void clear_runtime_data(NodesModifierData *nmd)
   }
 }
 
+/**
+ * The node output cache is stored in the runtime data of the evaluated modifier, which is kept
+ * when the evaluated copy of the object is updated.
+ */
+static NodeOutputCache *ensure_output_cache(NodesModifierData *nmd)
+{
+  if (nmd->modifier.runtime == nullptr) {
+    nmd->modifier.runtime = new NodeOutputCache();
+  }
+  NodeOutputCache *output_cache = static_cast<NodeOutputCache *>(nmd->modifier.runtime);
+  output_cache->set_memory_limit(int64_t(nmd->output_cache_memory_limit) * 1024 * 1024);
+  return output_cache;
+}
+
+static void freeRuntimeData(void *runtime_data)
+{
+  delete static_cast<NodeOutputCache *>(runtime_data);
+}
+
 static void store_field_on_geometry_component(GeometryComponent &component,
                                               const StringRef attribute_name,
                                               AttributeDomain domain,
@@ -982,8 +1007,28 @@ static GeometrySet compute_geometry(const DerivedNodeTree &tree,
   eval_params.depsgraph = ctx->depsgraph;
   eval_params.self_object = ctx->object;
   eval_params.geo_logger = geo_logger.has_value() ? &*geo_logger : nullptr;
+  if (nmd->flag & NODES_MODIFIER_USE_OUTPUT_CACHE) {
+    eval_params.output_cache = ensure_output_cache(nmd);
+  }
+  else if (nmd->modifier.runtime != nullptr) {
+    freeRuntimeData(nmd->modifier.runtime);
+    nmd->modifier.runtime = nullptr;
+  }
   blender::modifiers::geometry_nodes::evaluate_geometry_nodes(eval_params);
 
+  if (CLOG_CHECK(&LOG, 1)) {
+    /* The cache is shared by all modifiers, so these are totals since the cache was cleared. */
+    const blender::fn::FieldProcedureCacheStats stats = blender::fn::field_procedure_cache_stats();
+    CLOG_INFO(&LOG,
+              1,
+              "%s: field procedure cache: %lld hits, %lld misses, %.2f ms building, %.2f ms saved",
+              nmd->modifier.name,
+              (long long)stats.hits,
+              (long long)stats.misses,
+              stats.build_time * 1000.0,
+              stats.time_saved * 1000.0);
+  }
+
   if (geo_logger.has_value()) {
     NodesModifierData *nmd_orig = (NodesModifierData *)BKE_modifier_get_original(&nmd->modifier);
     clear_runtime_data(nmd_orig);
@@ -1293,6 +1338,27 @@ static void output_attribute_panel_draw(const bContext *UNUSED(C), Panel *panel)
   }
 }
 
+static void output_cache_panel_draw_header(const bContext *UNUSED(C), Panel *panel)
+{
+  uiLayout *layout = panel->layout;
+
+  PointerRNA *ptr = modifier_panel_get_property_pointers(panel, nullptr);
+
+  uiItemR(layout, ptr, "use_output_cache", 0, IFACE_("Cache"), ICON_NONE);
+}
+
+static void output_cache_panel_draw(const bContext *UNUSED(C), Panel *panel)
+{
+  uiLayout *layout = panel->layout;
+
+  PointerRNA *ptr = modifier_panel_get_property_pointers(panel, nullptr);
+
+  uiLayoutSetPropSep(layout, true);
+
+  uiLayoutSetActive(layout, RNA_boolean_get(ptr, "use_output_cache"));
+  uiItemR(layout, ptr, "output_cache_memory_limit", 0, IFACE_("Memory Limit"), ICON_NONE);
+}
+
 static void panelRegister(ARegionType *region_type)
 {
   PanelType *panel_type = modifier_panel_register(region_type, eModifierType_Nodes, panel_draw);
@@ -1302,6 +1368,12 @@ static void panelRegister(ARegionType *region_type)
                              nullptr,
                              output_attribute_panel_draw,
                              panel_type);
+  modifier_subpanel_register(region_type,
+                             "output_cache",
+                             "",
+                             output_cache_panel_draw_header,
+                             output_cache_panel_draw,
+                             panel_type);
 }
 
 static void blendWrite(BlendWriter *writer, const ModifierData *md)
@@ -1345,6 +1417,8 @@ static void freeData(ModifierData *md)
   }
 
   clear_runtime_data(nmd);
+  freeRuntimeData(nmd->modifier.runtime);
+  nmd->modifier.runtime = nullptr;
 }
 
 static void requiredDataMask(Object *UNUSED(ob),
@@ -1389,7 +1463,7 @@ ModifierTypeInfo modifierType_Nodes = {
     /* dependsOnNormals */ nullptr,
     /* foreachIDLink */ foreachIDLink,
     /* foreachTexLink */ foreachTexLink,
-    /* freeRuntimeData */ nullptr,
+    /* freeRuntimeData */ freeRuntimeData,
     /* panelRegister */ panelRegister,
     /* blendWrite */ blendWrite,
     /* blendRead */ blendRead,
@@ -15,6 +15,7 @@
  */
 
 #include "MOD_nodes_evaluator.hh"
+#include "MOD_nodes_output_cache.hh"
 
 #include "NOD_geometry_exec.hh"
 #include "NOD_socket_declarations.hh"
@@ -29,6 +30,7 @@
 
 #include "BLT_translation.h"
 
+#include "BLI_array.hh"
 #include "BLI_enumerable_thread_specific.hh"
 #include "BLI_stack.hh"
 #include "BLI_task.h"
@@ -228,6 +230,14 @@ struct NodeState {
    * not run twice at the same time accidentally.
    */
   NodeScheduleState schedule_state = NodeScheduleState::NotScheduled;
+
+  /**
+   * Key of the execution of the node in the output cache, if it has one. The outputs of the node
+   * are fully determined by it, so the keys of nodes that use the outputs are built from this key
+   * instead of the content of the values. This is set before any output is forwarded, so it can be
+   * read without a lock by nodes that received an output.
+   */
+  std::optional<NodeOutputCacheKey> output_cache_key;
 };
 
 /**
@@ -378,6 +388,13 @@ class NodeParamsProvider : public nodes::GeoNodeExecParamsProvider {
   NodeState &node_state_;
 
  public:
+  /**
+   * When set, a copy of every output value is stored in this entry, so that it can be added to the
+   * output cache after the node has been executed. This is reset to null when an output cannot be
+   * cached.
+   */
+  NodeOutputCacheEntry *cache_entry = nullptr;
+
   NodeParamsProvider(GeometryNodesEvaluator &evaluator, DNode dnode, NodeState &node_state);
 
   bool can_get_input(StringRef identifier) const override;
@@ -392,6 +409,8 @@ class NodeParamsProvider : public nodes::GeoNodeExecParamsProvider {
 
   bool lazy_require_input(StringRef identifier) override;
   bool lazy_output_is_required(StringRef identifier) const override;
+
+  void add_warning(geo_log::NodeWarningType type, StringRef message) override;
 };
 
 class GeometryNodesEvaluator {
@@ -901,7 +920,182 @@ class GeometryNodesEvaluator {
       params.error_message_add(geo_log::NodeWarningType::Legacy,
                                TIP_("Legacy node will be removed before Blender 4.0"));
     }
+
+    node_state.output_cache_key = this->try_build_output_cache_key(node, node_state);
+    if (!node_state.output_cache_key.has_value()) {
+      bnode.typeinfo->geometry_node_execute(params);
+      return;
+    }
+    const NodeOutputCacheKey &cache_key = *node_state.output_cache_key;
+    if (this->try_forward_cached_outputs(node, node_state, cache_key)) {
+      return;
+    }
+    auto cache_entry = std::make_shared<NodeOutputCacheEntry>(int(node->outputs().size()));
+    params_provider.cache_entry = cache_entry.get();
     bnode.typeinfo->geometry_node_execute(params);
+    if (params_provider.cache_entry != nullptr) {
+      params_.output_cache->add(cache_key, std::move(cache_entry));
+    }
+  }
+
+  /**
+   * Compute the key under which the outputs of the node are stored in the output cache. This has
+   * to be done before the node is executed, because it may take ownership of its inputs.
+   */
+  std::optional<NodeOutputCacheKey> try_build_output_cache_key(const DNode node,
+                                                               NodeState &node_state)
+  {
+    if (params_.output_cache == nullptr) {
+      return std::nullopt;
+    }
+    if (node_supports_laziness(node)) {
+      /* The outputs of lazy nodes can depend on which inputs have been requested. */
+      return std::nullopt;
+    }
+    NodeOutputCacheKeyBuilder key_builder{*params_.self_object};
+    if (!key_builder.add_node(*node->bnode())) {
+      return std::nullopt;
+    }
+    bool has_inputs = false;
+    for (const InputSocketRef *socket_ref : node->inputs()) {
+      if (!socket_ref->is_available()) {
+        continue;
+      }
+      const InputState &input_state = node_state.inputs[socket_ref->index()];
+      if (input_state.type == nullptr) {
+        continue;
+      }
+      key_builder.add(socket_ref->index());
+      has_inputs = true;
+      if (socket_ref->is_multi_input_socket()) {
+        /* Use the same order of the values as #NodeParamsProvider::extract_multi_input. */
+        const DInputSocket socket{node.context(), socket_ref};
+        const MultiInputValue &multi_value = *input_state.value.multi;
+        Array<bool> item_used(multi_value.items.size(), false);
+        bool success = true;
+        bool is_linked = false;
+        socket.foreach_origin_socket([&](DSocket origin) {
+          is_linked = true;
+          for (const int i : multi_value.items.index_range()) {
+            const MultiInputValueItem &item = multi_value.items[i];
+            if (item.origin == origin && !item_used[i] && item.value != nullptr) {
+              item_used[i] = true;
+              success &= this->add_input_to_output_cache_key(
+                  key_builder, origin, *input_state.type, item.value);
+              return;
+            }
+          }
+          success = false;
+        });
+        if (!is_linked) {
+          if (multi_value.items.size() != 1) {
+            return std::nullopt;
+          }
+          const MultiInputValueItem &item = multi_value.items[0];
+          success = this->add_input_to_output_cache_key(
+              key_builder, item.origin, *input_state.type, item.value);
+        }
+        if (!success) {
+          return std::nullopt;
+        }
+      }
+      else {
+        const void *value = input_state.value.single->value;
+        if (value == nullptr) {
+          return std::nullopt;
+        }
+        const DInputSocket socket{node.context(), socket_ref};
+        DSocket origin;
+        socket.foreach_origin_socket([&](DSocket origin_socket) { origin = origin_socket; });
+        if (!this->add_input_to_output_cache_key(key_builder, origin, *input_state.type, value)) {
+          return std::nullopt;
+        }
+      }
+    }
+    if (!has_inputs) {
+      /* Nodes without inputs are generally cheap or depend on data that is not part of the key,
+       * like the scene time. */
+      return std::nullopt;
+    }
+    return key_builder.build();
+  }
+
+  /**
+   * Add an input value to the key. Values computed by a node with a key are identified by that key
+   * and the output, so only values entering the tree from outside and outputs of nodes without a
+   * key have to be hashed by their content.
+   */
+  bool add_input_to_output_cache_key(NodeOutputCacheKeyBuilder &key_builder,
+                                     const DSocket origin,
+                                     const CPPType &type,
+                                     const void *value)
+  {
+    if (origin && origin->is_output()) {
+      const NodeWithState *origin_node_with_state = node_states_.lookup_key_ptr_as(
+          origin.node());
+      if (origin_node_with_state != nullptr) {
+        const NodeState &origin_node_state = *origin_node_with_state->state;
+        if (origin_node_state.output_cache_key.has_value()) {
+          key_builder.add_output(*origin_node_state.output_cache_key, origin->index(), type);
+          return true;
+        }
+      }
+    }
+    return key_builder.add_value(type, value);
+  }
+
+  /**
+   * Forward copies of cached outputs of a previous execution of the node. Returns false when not
+   * all required outputs are in the cache, in which case the node has to be executed.
+   */
+  bool try_forward_cached_outputs(const DNode node,
+                                  NodeState &node_state,
+                                  const NodeOutputCacheKey &cache_key)
+  {
+    std::shared_ptr<const NodeOutputCacheEntry> cache_entry = params_.output_cache->lookup(
+        cache_key);
+    if (!cache_entry) {
+      return false;
+    }
+    if (cache_entry->outputs.size() != node->outputs().size()) {
+      return false;
+    }
+    for (const OutputSocketRef *socket_ref : node->outputs()) {
+      if (!socket_ref->is_available()) {
+        continue;
+      }
+      const OutputState &output_state = node_state.outputs[socket_ref->index()];
+      if (output_state.output_usage_for_execution == ValueUsage::Unused) {
+        continue;
+      }
+      if (cache_entry->outputs[socket_ref->index()].get() == nullptr) {
+        return false;
+      }
+    }
+
+    LinearAllocator<> &allocator = local_allocators_.local();
+    for (const OutputSocketRef *socket_ref : node->outputs()) {
+      if (!socket_ref->is_available()) {
+        continue;
+      }
+      OutputState &output_state = node_state.outputs[socket_ref->index()];
+      if (output_state.output_usage_for_execution == ValueUsage::Unused) {
+        continue;
+      }
+      const GMutablePointer cached_value = cache_entry->outputs[socket_ref->index()];
+      const CPPType &type = *cached_value.type();
+      void *buffer = allocator.allocate(type.size(), type.alignment());
+      type.copy_construct(cached_value.get(), buffer);
+      this->forward_output({node.context(), socket_ref}, {type, buffer});
+      output_state.has_been_computed = true;
+    }
+    if (params_.geo_logger != nullptr) {
+      geo_log::LocalGeoLogger &local_logger = params_.geo_logger->local();
+      for (const geo_log::NodeWarning &warning : cache_entry->warnings) {
+        local_logger.log_node_warning(node, warning.type, warning.message);
+      }
+    }
+    return true;
   }
 
   void execute_multi_function_node(const DNode node,
@@ -1641,6 +1835,11 @@ void NodeParamsProvider::set_output(StringRef identifier, GMutablePointer value)
 
   OutputState &output_state = node_state_.outputs[socket->index()];
   BLI_assert(!output_state.has_been_computed);
+  if (this->cache_entry != nullptr) {
+    if (!this->cache_entry->add_output(socket->index(), *value.type(), value.get())) {
+      this->cache_entry = nullptr;
+    }
+  }
   evaluator_.forward_output(socket, value);
   output_state.has_been_computed = true;
 }
@@ -1696,6 +1895,14 @@ bool NodeParamsProvider::lazy_output_is_required(StringRef identifier) const
   return output_state.output_usage_for_execution == ValueUsage::Required;
 }
 
+void NodeParamsProvider::add_warning(const geo_log::NodeWarningType type,
+                                     const StringRef message)
+{
+  if (this->cache_entry != nullptr) {
+    this->cache_entry->warnings.append({type, message});
+  }
+}
+
 void evaluate_geometry_nodes(GeometryNodesEvaluationParams &params)
 {
   GeometryNodesEvaluator evaluator{params};
@@ -0,0 +1,613 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <cstring>
+
+#include "MOD_nodes_output_cache.hh"
+
+#include "BKE_customdata.h"
+#include "BKE_node.h"
+#include "BKE_geometry_set.hh"
+#include "BKE_geometry_set_instances.hh"
+#include "BKE_spline.hh"
+
+#include "BLI_color.hh"
+#include "BLI_float3.hh"
+#include "BLI_listbase.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_genfile.h"
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_node_types.h"
+#include "DNA_object_types.h"
+#include "DNA_pointcloud_types.h"
+#include "DNA_sdna_types.h"
+
+#include "FN_field_cpp_type.hh"
+
+#include "MEM_guardedalloc.h"
+
+namespace blender::modifiers::geometry_nodes {
+
+using fn::FieldCPPType;
+
+/**
+ * Limits the recursion through instances and referenced objects. Deeper nesting is not cached.
+ */
+static constexpr int max_nesting_depth = 16;
+
+static bool add_geometry_set(NodeOutputCacheKeyBuilder &builder,
+                             const GeometrySet &geometry_set,
+                             int depth);
+
+/* -------------------------------------------------------------------- */
+/** \name Key Builder
+ * \{ */
+
+NodeOutputCacheKeyBuilder::NodeOutputCacheKeyBuilder(const Object &self_object)
+    : hash1_(0x9e3779b97f4a7c15), hash2_(0x165667b19e3779f9), self_object_(self_object)
+{
+}
+
+static uint64_t rotate_left(const uint64_t value, const int shift)
+{
+  return (value << shift) | (value >> (64 - shift));
+}
+
+void NodeOutputCacheKeyBuilder::add_data(const void *data, const int64_t size)
+{
+  /* Two independent 64 bit hashes are computed, so that a collision of the 128 bit hash is
+   * practically impossible. The key only stores the hash of geometries, not the geometries. */
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  uint64_t hash1 = hash1_ ^ (uint64_t)size;
+  uint64_t hash2 = hash2_ + (uint64_t)size;
+  int64_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, bytes + i, 8);
+    hash1 = rotate_left(hash1 ^ (word * 0x87c37b91114253d5), 31) * 0x9e3779b97f4a7c15;
+    hash2 = rotate_left(hash2 + (word ^ 0x4cf5ad432745937f), 27) * 0xc2b2ae3d27d4eb4f + hash1;
+  }
+  if (i < size) {
+    uint64_t word = 0;
+    memcpy(&word, bytes + i, (size_t)(size - i));
+    hash1 = rotate_left(hash1 ^ (word * 0x87c37b91114253d5), 31) * 0x9e3779b97f4a7c15;
+    hash2 = rotate_left(hash2 + (word ^ 0x4cf5ad432745937f), 27) * 0xc2b2ae3d27d4eb4f + hash1;
+  }
+  hash1_ = hash1;
+  hash2_ = hash2;
+}
+
+static bool sdna_struct_contains_pointers(const SDNA &sdna, const int struct_nr)
+{
+  const SDNA_Struct *struct_info = sdna.structs[struct_nr];
+  for (const SDNA_StructMember &member : Span(struct_info->members, struct_info->members_len)) {
+    const char *name = sdna.names[member.name];
+    if (name[0] == '*' || (name[0] == '(' && name[1] == '*')) {
+      return true;
+    }
+    const int member_struct_nr = DNA_struct_find_nr(&sdna, sdna.types[member.type]);
+    if (member_struct_nr != -1 && sdna_struct_contains_pointers(sdna, member_struct_nr)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * The storage of a node is hashed by its bytes, which is only correct when it does not point to
+ * other data. For example the #CurveMapping of curve nodes is not part of the storage itself.
+ */
+static bool node_storage_is_hashable(const bNode &bnode)
+{
+  const char *storage_name = bnode.typeinfo->storagename;
+  if (storage_name[0] == '\0') {
+    return false;
+  }
+  const SDNA *sdna = DNA_sdna_current_get();
+  const int struct_nr = DNA_struct_find_nr(sdna, storage_name);
+  if (struct_nr == -1) {
+    return false;
+  }
+  return !sdna_struct_contains_pointers(*sdna, struct_nr);
+}
+
+bool NodeOutputCacheKeyBuilder::add_node(const bNode &bnode)
+{
+  this->add_data(bnode.idname, (int64_t)strlen(bnode.idname));
+  this->add(bnode.custom1);
+  this->add(bnode.custom2);
+  this->add(bnode.custom3);
+  this->add(bnode.custom4);
+  this->add(bnode.id);
+  if (bnode.storage != nullptr) {
+    if (!node_storage_is_hashable(bnode)) {
+      return false;
+    }
+    this->add_data(bnode.storage, (int64_t)MEM_allocN_len(bnode.storage));
+  }
+  LISTBASE_FOREACH (const bNodeSocket *, socket, &bnode.inputs) {
+    this->add(socket->flag & SOCK_UNAVAIL);
+  }
+  LISTBASE_FOREACH (const bNodeSocket *, socket, &bnode.outputs) {
+    this->add(socket->flag & SOCK_UNAVAIL);
+  }
+  return true;
+}
+
+static bool add_custom_data(NodeOutputCacheKeyBuilder &builder,
+                            const CustomData &custom_data,
+                            const int size)
+{
+  builder.add(size);
+  builder.add(custom_data.totlayer);
+  for (const CustomDataLayer &layer : Span(custom_data.layers, custom_data.totlayer)) {
+    builder.add(layer.type);
+    builder.add(layer.active);
+    builder.add(layer.active_rnd);
+    builder.add(layer.active_clone);
+    builder.add(layer.active_mask);
+    builder.add_data(layer.name, (int64_t)strlen(layer.name));
+    builder.add(layer.anonymous_id);
+    if (layer.data == nullptr) {
+      continue;
+    }
+    if (layer.type == CD_MDEFORMVERT) {
+      for (const MDeformVert &dvert : Span(static_cast<const MDeformVert *>(layer.data), size)) {
+        builder.add(dvert.totweight);
+        builder.add_data(dvert.dw, sizeof(MDeformWeight) * dvert.totweight);
+      }
+    }
+    else if (ELEM(layer.type, CD_MDISPS, CD_GRID_PAINT_MASK)) {
+      /* Layers that point to more data are not supported. */
+      return false;
+    }
+    else {
+      builder.add_data(layer.data, (int64_t)CustomData_sizeof(layer.type) * size);
+    }
+  }
+  return true;
+}
+
+static bool add_mesh(NodeOutputCacheKeyBuilder &builder, const Mesh &mesh)
+{
+  builder.add(mesh.flag);
+  builder.add(mesh.smoothresh);
+  builder.add(mesh.totcol);
+  builder.add_data(mesh.mat, (int64_t)sizeof(Material *) * mesh.totcol);
+  LISTBASE_FOREACH (const bDeformGroup *, group, &mesh.vertex_group_names) {
+    builder.add_data(group->name, (int64_t)strlen(group->name));
+  }
+  return add_custom_data(builder, mesh.vdata, mesh.totvert) &&
+         add_custom_data(builder, mesh.edata, mesh.totedge) &&
+         add_custom_data(builder, mesh.fdata, mesh.totface) &&
+         add_custom_data(builder, mesh.ldata, mesh.totloop) &&
+         add_custom_data(builder, mesh.pdata, mesh.totpoly);
+}
+
+static bool add_pointcloud(NodeOutputCacheKeyBuilder &builder, const PointCloud &pointcloud)
+{
+  builder.add(pointcloud.totcol);
+  builder.add_data(pointcloud.mat, (int64_t)sizeof(Material *) * pointcloud.totcol);
+  return add_custom_data(builder, pointcloud.pdata, pointcloud.totpoint);
+}
+
+template<typename T> static void add_span(NodeOutputCacheKeyBuilder &builder, const Span<T> span)
+{
+  builder.add(span.size());
+  builder.add_data(span.data(), span.size_in_bytes());
+}
+
+static bool add_curve(NodeOutputCacheKeyBuilder &builder, const CurveEval &curve)
+{
+  builder.add(curve.splines().size());
+  for (const SplinePtr &spline_ptr : curve.splines()) {
+    const Spline &spline = *spline_ptr;
+    builder.add(spline.type());
+    builder.add(spline.is_cyclic());
+    builder.add(spline.normal_mode);
+    add_span(builder, spline.positions());
+    add_span(builder, spline.radii());
+    add_span(builder, spline.tilts());
+    if (const BezierSpline *bezier = dynamic_cast<const BezierSpline *>(&spline)) {
+      builder.add(bezier->resolution());
+      add_span(builder, bezier->handle_types_left());
+      add_span(builder, bezier->handle_types_right());
+      add_span(builder, bezier->handle_positions_left());
+      add_span(builder, bezier->handle_positions_right());
+    }
+    else if (const NURBSpline *nurbs = dynamic_cast<const NURBSpline *>(&spline)) {
+      builder.add(nurbs->resolution());
+      builder.add(nurbs->order());
+      builder.add(nurbs->knots_mode);
+      add_span(builder, nurbs->weights());
+    }
+    if (!add_custom_data(builder, spline.attributes.data, spline.size())) {
+      return false;
+    }
+  }
+  return add_custom_data(builder, curve.attributes.data, curve.splines().size());
+}
+
+static bool add_object(NodeOutputCacheKeyBuilder &builder, const Object &object, const int depth)
+{
+  /* There is no version of the evaluated geometry of an object that could be used instead. */
+  builder.add(&object);
+  builder.add(object.obmat);
+  const GeometrySet geometry_set = bke::object_get_evaluated_geometry_set(object);
+  return add_geometry_set(builder, geometry_set, depth + 1);
+}
+
+static bool add_collection(NodeOutputCacheKeyBuilder &builder,
+                           const Collection &collection,
+                           const int depth)
+{
+  if (depth > max_nesting_depth) {
+    return false;
+  }
+  builder.add(&collection);
+  builder.add(collection.instance_offset);
+  LISTBASE_FOREACH (const CollectionObject *, collection_object, &collection.gobject) {
+    if (!add_object(builder, *collection_object->ob, depth + 1)) {
+      return false;
+    }
+  }
+  LISTBASE_FOREACH (const CollectionChild *, collection_child, &collection.children) {
+    if (!add_collection(builder, *collection_child->collection, depth + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool add_instances(NodeOutputCacheKeyBuilder &builder,
+                          const InstancesComponent &instances,
+                          const int depth)
+{
+  add_span(builder, instances.instance_reference_handles());
+  add_span(builder, instances.instance_transforms());
+  add_span(builder, instances.instance_ids());
+  builder.add(instances.references().size());
+  for (const InstanceReference &reference : instances.references()) {
+    builder.add(reference.type());
+    switch (reference.type()) {
+      case InstanceReference::Type::None: {
+        break;
+      }
+      case InstanceReference::Type::Object: {
+        if (!add_object(builder, reference.object(), depth + 1)) {
+          return false;
+        }
+        break;
+      }
+      case InstanceReference::Type::Collection: {
+        if (!add_collection(builder, reference.collection(), depth + 1)) {
+          return false;
+        }
+        break;
+      }
+      case InstanceReference::Type::GeometrySet: {
+        if (!add_geometry_set(builder, reference.geometry_set(), depth + 1)) {
+          return false;
+        }
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+static bool add_geometry_set(NodeOutputCacheKeyBuilder &builder,
+                             const GeometrySet &geometry_set,
+                             const int depth)
+{
+  if (depth > max_nesting_depth) {
+    return false;
+  }
+  /* Volume grids are not hashed. */
+  if (geometry_set.has<VolumeComponent>()) {
+    return false;
+  }
+  if (const Mesh *mesh = geometry_set.get_mesh_for_read()) {
+    builder.add(GEO_COMPONENT_TYPE_MESH);
+    if (!add_mesh(builder, *mesh)) {
+      return false;
+    }
+  }
+  if (const PointCloud *pointcloud = geometry_set.get_pointcloud_for_read()) {
+    builder.add(GEO_COMPONENT_TYPE_POINT_CLOUD);
+    if (!add_pointcloud(builder, *pointcloud)) {
+      return false;
+    }
+  }
+  if (const CurveEval *curve = geometry_set.get_curve_for_read()) {
+    builder.add(GEO_COMPONENT_TYPE_CURVE);
+    if (!add_curve(builder, *curve)) {
+      return false;
+    }
+  }
+  if (const InstancesComponent *instances =
+          geometry_set.get_component_for_read<InstancesComponent>()) {
+    builder.add(GEO_COMPONENT_TYPE_INSTANCES);
+    if (!add_instances(builder, *instances, depth)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool NodeOutputCacheKeyBuilder::add_value(const CPPType &type, const void *value)
+{
+  this->add(&type);
+  if (type.is<GeometrySet>()) {
+    return add_geometry_set(*this, *static_cast<const GeometrySet *>(value), 0);
+  }
+  if (const FieldCPPType *field_cpp_type = dynamic_cast<const FieldCPPType *>(&type)) {
+    const GField &field = field_cpp_type->get_gfield(value);
+    if (!field.node().depends_on_input()) {
+      const CPPType &value_type = field_cpp_type->field_type();
+      BUFFER_FOR_CPP_TYPE_VALUE(value_type, buffer);
+      fn::evaluate_constant_field(field, buffer);
+      const bool success = this->add_value(value_type, buffer);
+      value_type.destruct(buffer);
+      return success;
+    }
+    if (field.node().is_input()) {
+      this->add(field.hash());
+      field_inputs_.append(field);
+      return true;
+    }
+    /* Other fields usually reference multi-functions that are owned by the evaluation. */
+    return false;
+  }
+  if (type.is<std::string>()) {
+    const std::string &string = *static_cast<const std::string *>(value);
+    this->add_data(string.data(), (int64_t)string.size());
+    return true;
+  }
+  if (type.is<Object *>()) {
+    const Object *object = *static_cast<Object *const *>(value);
+    uses_self_object_ = true;
+    return object == nullptr || add_object(*this, *object, 0);
+  }
+  if (type.is<Collection *>()) {
+    const Collection *collection = *static_cast<Collection *const *>(value);
+    uses_self_object_ = true;
+    return collection == nullptr || add_collection(*this, *collection, 0);
+  }
+  if (type.is<Material *>()) {
+    this->add(*static_cast<Material *const *>(value));
+    return true;
+  }
+  if (type.is<float>() || type.is<int>() || type.is<bool>() || type.is<float3>() ||
+      type.is<ColorGeometry4f>()) {
+    this->add_data(value, type.size());
+    return true;
+  }
+  /* Textures and images can change without their pointer changing. */
+  return false;
+}
+
+void NodeOutputCacheKeyBuilder::add_output(const NodeOutputCacheKey &key,
+                                           const int output_index,
+                                           const CPPType &type)
+{
+  /* The type can differ from the output when the value has been converted. */
+  this->add(&type);
+  this->add(key.hash1_);
+  this->add(key.hash2_);
+  this->add(output_index);
+  field_inputs_.extend(key.field_inputs_);
+}
+
+NodeOutputCacheKey NodeOutputCacheKeyBuilder::build()
+{
+  if (uses_self_object_) {
+    /* Objects and collections are often used relative to the transform of the modifier object. */
+    this->add(self_object_.obmat);
+  }
+  NodeOutputCacheKey key;
+  key.hash1_ = hash1_;
+  key.hash2_ = hash2_;
+  key.field_inputs_ = std::move(field_inputs_);
+  return key;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Memory Estimation
+ * \{ */
+
+static int64_t custom_data_memory(const CustomData &custom_data, const int size)
+{
+  int64_t memory = 0;
+  for (const CustomDataLayer &layer : Span(custom_data.layers, custom_data.totlayer)) {
+    memory += (int64_t)CustomData_sizeof(layer.type) * size;
+  }
+  return memory;
+}
+
+static int64_t curve_memory(const CurveEval &curve)
+{
+  int64_t memory = custom_data_memory(curve.attributes.data, curve.splines().size());
+  for (const SplinePtr &spline : curve.splines()) {
+    /* Positions, radii and tilts, and the evaluated positions that are cached. */
+    memory += (int64_t)spline->size() * (sizeof(float3) + sizeof(float) * 2);
+    memory += (int64_t)spline->evaluated_points_size() * sizeof(float3);
+    memory += custom_data_memory(spline->attributes.data, spline->size());
+  }
+  return memory;
+}
+
+/** Returns -1 when the geometry should not be cached. */
+static int64_t geometry_set_memory(const GeometrySet &geometry_set, const int depth)
+{
+  if (depth > max_nesting_depth || geometry_set.has<VolumeComponent>()) {
+    return -1;
+  }
+  int64_t memory = sizeof(GeometrySet);
+  if (const Mesh *mesh = geometry_set.get_mesh_for_read()) {
+    memory += custom_data_memory(mesh->vdata, mesh->totvert) +
+              custom_data_memory(mesh->edata, mesh->totedge) +
+              custom_data_memory(mesh->ldata, mesh->totloop) +
+              custom_data_memory(mesh->pdata, mesh->totpoly);
+  }
+  if (const PointCloud *pointcloud = geometry_set.get_pointcloud_for_read()) {
+    memory += custom_data_memory(pointcloud->pdata, pointcloud->totpoint);
+  }
+  if (const CurveEval *curve = geometry_set.get_curve_for_read()) {
+    memory += curve_memory(*curve);
+  }
+  if (const InstancesComponent *instances =
+          geometry_set.get_component_for_read<InstancesComponent>()) {
+    memory += (int64_t)instances->instances_amount() * (sizeof(float4x4) + sizeof(int) * 2);
+    for (const InstanceReference &reference : instances->references()) {
+      if (reference.type() == InstanceReference::Type::GeometrySet) {
+        const int64_t reference_memory = geometry_set_memory(reference.geometry_set(), depth + 1);
+        if (reference_memory == -1) {
+          return -1;
+        }
+        memory += reference_memory;
+      }
+    }
+  }
+  return memory;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cache Entry
+ * \{ */
+
+NodeOutputCacheEntry::NodeOutputCacheEntry(const int outputs_num) : outputs(outputs_num)
+{
+}
+
+NodeOutputCacheEntry::~NodeOutputCacheEntry()
+{
+  for (GMutablePointer &value : outputs) {
+    if (value.get() != nullptr) {
+      value.destruct();
+      MEM_freeN(value.get());
+    }
+  }
+}
+
+bool NodeOutputCacheEntry::add_output(const int index, const CPPType &type, const void *value)
+{
+  int64_t value_memory = type.size();
+  if (type.is<GeometrySet>()) {
+    value_memory = geometry_set_memory(*static_cast<const GeometrySet *>(value), 0);
+    if (value_memory == -1) {
+      return false;
+    }
+  }
+  else if (const FieldCPPType *field_cpp_type = dynamic_cast<const FieldCPPType *>(&type)) {
+    /* Field operations usually reference multi-functions of nodes, which are owned by the
+     * evaluation and freed after it. The cache outlives the evaluation, so constant fields are
+     * stored as a field that owns its value, and fields of other operations are not cached. */
+    const GField &field = field_cpp_type->get_gfield(value);
+    if (!field.node().depends_on_input()) {
+      const GField constant_field = fn::make_field_constant_if_possible(field);
+      void *buffer = MEM_mallocN_aligned(type.size(), type.alignment(), __func__);
+      field_cpp_type->construct_from_gfield(buffer, constant_field);
+      outputs[index] = {type, buffer};
+      memory += value_memory;
+      return true;
+    }
+    if (!field.node().is_input()) {
+      return false;
+    }
+  }
+  void *buffer = MEM_mallocN_aligned(type.size(), type.alignment(), __func__);
+  /* Geometry components are shared with the copy, so the cached geometry is not modified by
+   * nodes that use it later on. */
+  type.copy_construct(value, buffer);
+  outputs[index] = {type, buffer};
+  memory += value_memory;
+  return true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cache
+ * \{ */
+
+void NodeOutputCache::set_memory_limit(const int64_t memory_limit)
+{
+  std::lock_guard lock{mutex_};
+  memory_limit_ = memory_limit;
+  this->evict_to_memory_limit(memory_limit);
+}
+
+std::shared_ptr<const NodeOutputCacheEntry> NodeOutputCache::lookup(const NodeOutputCacheKey &key)
+{
+  std::lock_guard lock{mutex_};
+  Item *item = items_.lookup_ptr(key);
+  if (item == nullptr) {
+    return {};
+  }
+  item->last_used = ++usage_clock_;
+  return item->entry;
+}
+
+void NodeOutputCache::add(const NodeOutputCacheKey &key,
+                          std::shared_ptr<const NodeOutputCacheEntry> entry)
+{
+  std::lock_guard lock{mutex_};
+  if (entry->memory > memory_limit_) {
+    return;
+  }
+  this->evict_to_memory_limit(memory_limit_ - entry->memory);
+  const int64_t entry_memory = entry->memory;
+  Item *item = items_.lookup_ptr(key);
+  if (item != nullptr) {
+    /* Another thread computed the same outputs, or outputs that were not required before. */
+    memory_ -= item->entry->memory;
+    *item = {std::move(entry), ++usage_clock_};
+  }
+  else {
+    items_.add_new(key, {std::move(entry), ++usage_clock_});
+  }
+  memory_ += entry_memory;
+}
+
+void NodeOutputCache::evict_to_memory_limit(const int64_t memory_limit)
+{
+  while (memory_ > memory_limit && !items_.is_empty()) {
+    /* Evictions are rare compared to lookups, so keeping the items sorted is not worth it. */
+    const NodeOutputCacheKey *oldest_key = nullptr;
+    uint64_t oldest_usage = UINT64_MAX;
+    for (const auto item : items_.items()) {
+      if (item.value.last_used < oldest_usage) {
+        oldest_usage = item.value.last_used;
+        oldest_key = &item.key;
+      }
+    }
+    /* Entries that are still in use by an evaluation are freed when they are not used anymore. */
+    memory_ -= items_.lookup(*oldest_key).entry->memory;
+    items_.remove_contained(*oldest_key);
+  }
+}
+
+/** \} */
+
+}  // namespace blender::modifiers::geometry_nodes
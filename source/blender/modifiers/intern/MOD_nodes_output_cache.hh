@@ -0,0 +1,171 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup modifiers
+ *
+ * Geometry nodes are pure functions of their inputs and settings. This allows reusing the outputs
+ * of a node from a previous evaluation of the modifier, when the node is executed with the same
+ * settings and inputs again. That is the case for all nodes upstream of a change in the node tree
+ * or the modifier inputs.
+ *
+ * The outputs are stored under a key that is computed from the node settings and all its inputs.
+ * Inputs computed by a node that has a key are identified by that key, because it determines all
+ * outputs of the node. Other inputs, like the group inputs and referenced objects, are hashed by
+ * their content, including the evaluated geometry and transform of objects. Nodes with inputs that
+ * cannot be part of a key are executed as usual.
+ */
+
+#include <memory>
+#include <mutex>
+
+#include "BLI_map.hh"
+#include "BLI_vector.hh"
+
+#include "FN_field.hh"
+#include "FN_generic_pointer.hh"
+
+#include "NOD_geometry_nodes_eval_log.hh"
+
+struct bNode;
+struct Object;
+
+namespace blender::modifiers::geometry_nodes {
+
+using fn::CPPType;
+using fn::GField;
+using fn::GMutablePointer;
+
+class NodeOutputCacheKey {
+ private:
+  uint64_t hash1_ = 0;
+  uint64_t hash2_ = 0;
+  /**
+   * Field inputs that are passed to the node are compared by value and not by a hash, because
+   * many field inputs are only equal to themselves. Keeping them here also ensures that their
+   * addresses are not reused by other field inputs while the key exists.
+   */
+  Vector<GField> field_inputs_;
+
+  friend class NodeOutputCacheKeyBuilder;
+
+ public:
+  uint64_t hash() const
+  {
+    return hash1_;
+  }
+
+  friend bool operator==(const NodeOutputCacheKey &a, const NodeOutputCacheKey &b)
+  {
+    return a.hash1_ == b.hash1_ && a.hash2_ == b.hash2_ &&
+           a.field_inputs_.as_span() == b.field_inputs_.as_span();
+  }
+};
+
+/**
+ * Computes the key for an execution of a node. The settings of the node and all its input values
+ * have to be added.
+ */
+class NodeOutputCacheKeyBuilder {
+ private:
+  uint64_t hash1_;
+  uint64_t hash2_;
+  Vector<GField> field_inputs_;
+  const Object &self_object_;
+  bool uses_self_object_ = false;
+
+ public:
+  NodeOutputCacheKeyBuilder(const Object &self_object);
+
+  /**
+   * Add the settings of the node. Returns false when they cannot be part of a key, because the
+   * node storage references other data.
+   */
+  bool add_node(const bNode &bnode);
+
+  /**
+   * Add an input value of the node. Returns false when the value cannot be part of a key, in which
+   * case the outputs of the node cannot be cached.
+   */
+  bool add_value(const CPPType &type, const void *value);
+
+  /**
+   * Add an input value that is an output of a node execution with the given key. This is much
+   * cheaper than adding the value, which has to hash geometries.
+   */
+  void add_output(const NodeOutputCacheKey &key, int output_index, const CPPType &type);
+
+  NodeOutputCacheKey build();
+
+  void add_data(const void *data, int64_t size);
+  template<typename T> void add(const T &value)
+  {
+    this->add_data(&value, sizeof(T));
+  }
+};
+
+/**
+ * The outputs of one execution of a node.
+ */
+struct NodeOutputCacheEntry : NonCopyable, NonMovable {
+  /** The value of every output socket, with null data when the output was not computed. */
+  Vector<GMutablePointer> outputs;
+  /** Warnings added by the node, which are logged again when the outputs are reused. */
+  Vector<nodes::geometry_nodes_eval_log::NodeWarning> warnings;
+  /** Estimated number of bytes used by the output values. */
+  int64_t memory = 0;
+
+  NodeOutputCacheEntry(int outputs_num);
+  ~NodeOutputCacheEntry();
+
+  /**
+   * Store a copy of the value of an output socket. Returns false when the value cannot be cached.
+   */
+  bool add_output(int index, const CPPType &type, const void *value);
+};
+
+/**
+ * Stores outputs of node executions, evicting the least recently used entries when the memory
+ * limit is exceeded. Nodes are executed on multiple threads, so all methods are thread-safe.
+ */
+class NodeOutputCache : NonCopyable, NonMovable {
+ private:
+  struct Item {
+    std::shared_ptr<const NodeOutputCacheEntry> entry;
+    uint64_t last_used;
+  };
+
+  std::mutex mutex_;
+  Map<NodeOutputCacheKey, Item> items_;
+  int64_t memory_limit_ = 0;
+  int64_t memory_ = 0;
+  uint64_t usage_clock_ = 0;
+
+ public:
+  void set_memory_limit(int64_t memory_limit);
+
+  /** Returns null when there are no outputs cached for the key. */
+  std::shared_ptr<const NodeOutputCacheEntry> lookup(const NodeOutputCacheKey &key);
+
+  void add(const NodeOutputCacheKey &key, std::shared_ptr<const NodeOutputCacheEntry> entry);
+
+ private:
+  void evict_to_memory_limit(int64_t memory_limit);
+};
+
+}  // namespace blender::modifiers::geometry_nodes
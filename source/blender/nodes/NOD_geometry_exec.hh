@@ -122,6 +122,14 @@ class GeoNodeExecParamsProvider {
   virtual bool output_is_required(StringRef identifier) const = 0;
   virtual bool lazy_require_input(StringRef identifier) = 0;
   virtual bool lazy_output_is_required(StringRef identifier) const = 0;
+
+  /**
+   * Called for every warning that is added by the node, also when there is no logger. This
+   * allows storing the warnings when the outputs of the node are reused later on.
+   */
+  virtual void add_warning(NodeWarningType /* type */, StringRef /* message */)
+  {
+  }
 };
 
 class GeoNodeExecParams {
@@ -29,6 +29,7 @@ namespace blender::nodes {
 
 void GeoNodeExecParams::error_message_add(const NodeWarningType type, std::string message) const
 {
+  provider_->add_warning(type, message);
   if (provider_->logger == nullptr) {
     return;
   }
@@ -50,7 +50,7 @@ typedef struct BakeTargets {
 
   /* Pixel buffer to bake to. */
   float *result;
-  int num_pixels;
+  size_t num_pixels;
   int num_channels;
 
   /* Baking to non-color data image. */
@@ -80,8 +80,8 @@ bool RE_bake_has_engine(const struct Render *re);
 
 bool RE_bake_engine(struct Render *re,
                     struct Depsgraph *depsgraph,
-                    struct Object *object,
-                    const int object_id,
+                    struct Object **objects,
+                    const int num_objects,
                     const BakePixel pixel_array[],
                     const BakeTargets *targets,
                     const eScenePassType pass_type,
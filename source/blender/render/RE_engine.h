@@ -68,6 +68,7 @@ extern "C" {
 #define RE_USE_CUSTOM_FREESTYLE 1024
 #define RE_USE_NO_IMAGE_SAVE 2048
 #define RE_USE_ALEMBIC_PROCEDURAL 4096
+#define RE_USE_PACKED_BAKE 8192
 
 /* RenderEngine.flag */
 #define RE_ENGINE_ANIMATION 1
@@ -158,7 +159,10 @@ typedef struct RenderEngine {
   struct {
     const struct BakePixel *pixels;
     float *result;
+    /* With #RE_USE_PACKED_BAKE, multiple target images laid out in rows
+     * of width, the last row is only filled up to num_pixels. */
     int width, height, depth;
+    size_t num_pixels;
     int object_id;
   } bake;
 
@@ -31,6 +31,7 @@
 
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_math_bits.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
@@ -187,6 +188,16 @@ void RE_engine_free(RenderEngine *engine)
 
 /* Bake Render Results */
 
+/* Number of pixels of a row starting at bake_offset that lie within the bake pixels, as the last
+ * row of the target images is only partially filled. */
+static int bake_row_length(const RenderEngine *engine, const size_t bake_offset, const int w)
+{
+  if (bake_offset >= engine->bake.num_pixels) {
+    return 0;
+  }
+  return (int)min_zz((size_t)w, engine->bake.num_pixels - bake_offset);
+}
+
 static RenderResult *render_result_from_bake(RenderEngine *engine, int x, int y, int w, int h)
 {
   /* Create render result with specified size. */
@@ -218,11 +229,12 @@ static RenderResult *render_result_from_bake(RenderEngine *engine, int x, int y,
     float *primitive = primitive_pass->rect + offset;
     float *differential = differential_pass->rect + offset;
 
-    size_t bake_offset = (y + ty) * engine->bake.width + x;
+    size_t bake_offset = (size_t)(y + ty) * engine->bake.width + x;
     const BakePixel *bake_pixel = engine->bake.pixels + bake_offset;
+    const int row_length = bake_row_length(engine, bake_offset, w);
 
     for (int tx = 0; tx < w; tx++) {
-      if (bake_pixel->object_id != engine->bake.object_id) {
+      if (tx >= row_length || bake_pixel->object_id != engine->bake.object_id) {
         primitive[0] = int_as_float(-1);
         primitive[1] = int_as_float(-1);
       }
@@ -247,10 +259,12 @@ static RenderResult *render_result_from_bake(RenderEngine *engine, int x, int y,
   /* Initialize tile render result from full image bake result. */
   for (int ty = 0; ty < h; ty++) {
     size_t offset = ty * w * engine->bake.depth;
-    size_t bake_offset = ((y + ty) * engine->bake.width + x) * engine->bake.depth;
-    size_t size = w * engine->bake.depth * sizeof(float);
+    size_t bake_offset = (size_t)(y + ty) * engine->bake.width + x;
+    size_t size = bake_row_length(engine, bake_offset, w) * engine->bake.depth * sizeof(float);
 
-    memcpy(result_pass->rect + offset, engine->bake.result + bake_offset, size);
+    memcpy(result_pass->rect + offset,
+           engine->bake.result + bake_offset * engine->bake.depth,
+           size);
   }
 
   return rr;
@@ -272,10 +286,10 @@ static void render_result_to_bake(RenderEngine *engine, RenderResult *rr)
 
   for (int ty = 0; ty < h; ty++) {
     size_t offset = ty * w * engine->bake.depth;
-    size_t bake_offset = ((y + ty) * engine->bake.width + x) * engine->bake.depth;
-    size_t size = w * engine->bake.depth * sizeof(float);
+    size_t bake_offset = (size_t)(y + ty) * engine->bake.width + x;
+    size_t size = bake_row_length(engine, bake_offset, w) * engine->bake.depth * sizeof(float);
 
-    memcpy(engine->bake.result + bake_offset, rpass->rect + offset, size);
+    memcpy(engine->bake.result + bake_offset * engine->bake.depth, rpass->rect + offset, size);
   }
 }
 
@@ -793,10 +807,49 @@ bool RE_bake_has_engine(const Render *re)
   return (type->bake != NULL);
 }
 
+/**
+ * Target images are stored one after the other in the pixel and result arrays. For engines that
+ * support #RE_USE_PACKED_BAKE, consecutive images are baked at once as rows of the widest image
+ * rather than separately. This way the engine distributes work over all their pixels, instead of
+ * going idle at the end of every small image. Other engines get one image per run.
+ *
+ * Engines store the bake pass in buffers of `width * height` pixels indexed with int, so a run
+ * ends before that size would overflow an int. Returns the index after the last image of the run
+ * starting at `first_image`.
+ */
+static int bake_targets_next_run(const BakeTargets *targets,
+                                 const int first_image,
+                                 const bool pack_images,
+                                 int *r_width,
+                                 int *r_height,
+                                 size_t *r_num_pixels)
+{
+  size_t width = 0;
+  size_t height = 0;
+  size_t num_pixels = 0;
+  int image_index = first_image;
+  for (; image_index < targets->num_images; image_index++) {
+    const BakeImage *image = &targets->images[image_index];
+    const size_t run_width = max_zz(width, (size_t)image->width);
+    const size_t run_num_pixels = num_pixels + (size_t)image->width * (size_t)image->height;
+    const size_t run_height = (run_num_pixels + run_width - 1) / run_width;
+    if (image_index > first_image && (!pack_images || run_width * run_height > INT_MAX)) {
+      break;
+    }
+    width = run_width;
+    height = run_height;
+    num_pixels = run_num_pixels;
+  }
+  *r_width = (int)width;
+  *r_height = (int)height;
+  *r_num_pixels = num_pixels;
+  return image_index;
+}
+
 bool RE_bake_engine(Render *re,
                     Depsgraph *depsgraph,
-                    Object *object,
-                    const int object_id,
+                    Object **objects,
+                    const int num_objects,
                     const BakePixel pixel_array[],
                     const BakeTargets *targets,
                     const eScenePassType pass_type,
@@ -834,20 +887,38 @@ bool RE_bake_engine(Render *re,
       type->update(engine, re->main, engine->depsgraph);
     }
 
-    for (int i = 0; i < targets->num_images; i++) {
-      const BakeImage *image = targets->images + i;
-
-      engine->bake.pixels = pixel_array + image->offset;
-      engine->bake.result = result + image->offset * targets->num_channels;
-      engine->bake.width = image->width;
-      engine->bake.height = image->height;
-      engine->bake.depth = targets->num_channels;
-      engine->bake.object_id = object_id;
-
-      type->bake(
-          engine, engine->depsgraph, object, pass_type, pass_filter, image->width, image->height);
-
-      memset(&engine->bake, 0, sizeof(engine->bake));
+    /* All objects are baked with the same engine, so that scene data and acceleration structures
+     * are synchronized only once. */
+    const bool pack_images = (type->flag & RE_USE_PACKED_BAKE) != 0;
+    bool cancel = false;
+    for (int i = 0; i < num_objects && !cancel; i++) {
+      int first_image = 0;
+      while (first_image < targets->num_images && !cancel) {
+        int width, height;
+        size_t num_pixels;
+        const int next_image = bake_targets_next_run(
+            targets, first_image, pack_images, &width, &height, &num_pixels);
+        const size_t offset = targets->images[first_image].offset;
+        first_image = next_image;
+
+        if (num_pixels == 0) {
+          continue;
+        }
+
+        engine->bake.pixels = pixel_array + offset;
+        engine->bake.result = result + offset * targets->num_channels;
+        engine->bake.width = width;
+        engine->bake.height = height;
+        engine->bake.depth = targets->num_channels;
+        engine->bake.num_pixels = num_pixels;
+        engine->bake.object_id = i;
+
+        type->bake(engine, engine->depsgraph, objects[i], pass_type, pass_filter, width, height);
+
+        memset(&engine->bake, 0, sizeof(engine->bake));
+
+        cancel = RE_engine_test_break(engine);
+      }
     }
 
     engine->depsgraph = NULL;